@@ -6,6 +6,7 @@
 #include "ServerPort.h"
 #include "ServerPortDlg.h"
 #include "base/at_exit.h"
+#include "base/command_line.h"
 #include "ipc_process/server_main_thread_impl.h"
 
 #ifdef _DEBUG
@@ -72,6 +73,7 @@ BOOL CServerPortApp::InitInstance()
 	SetRegistryKey(_T("Local AppWizard-Generated Applications"));
 
   base::AtExitManager exit_manager;
+  CommandLine::Init(0, NULL);
 	CServerPortDlg dlg;
 	m_pMainWnd = &dlg;
   //dlg.DoModal();
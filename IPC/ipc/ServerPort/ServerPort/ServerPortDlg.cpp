@@ -20,6 +20,14 @@
 #define new DEBUG_NEW
 #endif
 
+namespace {
+
+// Backs the PROCESS_LAUNCHER BrowserThread with the blocking pool instead
+// of a dedicated thread.
+const char kPooledBrowserThreads[] = "pooled-browser-threads";
+
+}  // namespace
+
 
 // CAboutDlg dialog used for App About
 
@@ -186,6 +194,13 @@ void CServerPortDlg::OnShowWindow(BOOL bShow, UINT nStatus)
 }
 
 bool CServerPortDlg::CreateProcessLaunchThread(){
+  // With --pooled-browser-threads, processes are launched from a sequence
+  // on the blocking pool rather than from a thread of their own.
+  if (CommandLine::ForCurrentProcess()->HasSwitch(kPooledBrowserThreads)) {
+    BrowserThreadImpl::UseBlockingPoolForThread(
+        BrowserThread::PROCESS_LAUNCHER);
+    return true;
+  }
   base::Thread::Options io_message_loop_options;
   io_message_loop_options.message_loop_type = MessageLoop::TYPE_DEFAULT;
   base::Thread::Options* options = &io_message_loop_options;
@@ -184,7 +184,9 @@ class  BrowserThread {
   static bool IsWellKnownThread(ID identifier);
 
   // Callable on any thread.  Returns whether you're currently on a particular
-  // thread.
+  // thread.  For an ID backed by the blocking pool (see
+  // BrowserThreadImpl::UseBlockingPoolForThread()), that is whether you're
+  // running one of its tasks.
   static bool CurrentlyOn(ID identifier);
 
   // Callable on any thread.  Returns whether the threads message loop is valid.
@@ -192,7 +194,8 @@ class  BrowserThread {
   // down.
   static bool IsMessageLoopValid(ID identifier);
 
-  // If the current message loop is one of the known threads, returns true and
+  // If the current message loop is one of the known threads, or the current
+  // task was posted to an ID backed by the blocking pool, returns true and
   // sets identifier to its ID.  Otherwise returns false.
   static bool GetCurrentThreadIdentifier(ID* identifier);
 
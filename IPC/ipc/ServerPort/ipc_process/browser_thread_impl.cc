@@ -36,10 +36,18 @@ struct BrowserThreadGlobals {
     memset(threads, 0, BrowserThread::ID_COUNT * sizeof(threads[0]));
     memset(thread_delegates, 0,
            BrowserThread::ID_COUNT * sizeof(thread_delegates[0]));
+    memset(pooled, 0, BrowserThread::ID_COUNT * sizeof(pooled[0]));
   }
 
-  // This lock protects |threads|. Do not read or modify that array
-  // without holding this lock. Do not block while holding this lock.
+  // Whether |identifier| is backed by |blocking_pool|. Unlike the rest of
+  // |pooled|, this can be read without |lock|, as PostTaskHelper() does.
+  bool IsPooled(int identifier) const {
+    return base::subtle::Acquire_Load(&pooled[identifier]) != 0;
+  }
+
+  // This lock protects |threads|, |pooled| and |pooled_tokens|. Do not modify
+  // those arrays, or read them other than through IsPooled(), without holding
+  // this lock. Do not block while holding this lock.
   base::Lock lock;
 
   // This array is protected by |lock|. The threads are not owned by this
@@ -52,6 +60,14 @@ struct BrowserThreadGlobals {
   // by this array, rather by whoever calls BrowserThread::SetDelegate.
   BrowserThreadDelegate* thread_delegates[BrowserThread::ID_COUNT];
 
+  // Whether each ID is backed by the sequence of |blocking_pool| in
+  // |pooled_tokens| rather than by a thread in |threads|. See
+  // BrowserThreadImpl::UseBlockingPoolForThread(). An ID's token is set
+  // before it is marked pooled, and not changed after.
+  base::subtle::Atomic32 pooled[BrowserThread::ID_COUNT];
+  base::SequencedWorkerPool::SequenceToken
+      pooled_tokens[BrowserThread::ID_COUNT];
+
   const scoped_refptr<base::SequencedWorkerPool> blocking_pool;
 };
 
@@ -83,6 +99,26 @@ void BrowserThreadImpl::ShutdownThreadPool() {
   const int kMaxNewShutdownBlockingTasks = 1000;
   BrowserThreadGlobals& globals = g_globals.Get();
   globals.blocking_pool->Shutdown(kMaxNewShutdownBlockingTasks);
+
+  // The pool now rejects new tasks, so the IDs it backed are gone.
+  base::AutoLock lock(globals.lock);
+  for (int i = 0; i < ID_COUNT; ++i)
+    base::subtle::Release_Store(&globals.pooled[i], 0);
+}
+
+// static
+void BrowserThreadImpl::UseBlockingPoolForThread(BrowserThread::ID identifier) {
+  DCHECK(identifier >= 0 && identifier < ID_COUNT);
+  DCHECK(identifier != UI && identifier != IO);
+  BrowserThreadGlobals& globals = g_globals.Get();
+  base::SequencedWorkerPool::SequenceToken token =
+      globals.blocking_pool->GetSequenceToken();
+
+  base::AutoLock lock(globals.lock);
+  DCHECK(!globals.threads[identifier]);
+  DCHECK(!globals.IsPooled(identifier));
+  globals.pooled_tokens[identifier] = token;
+  base::subtle::Release_Store(&globals.pooled[identifier], 1);
 }
 
 // static
@@ -213,6 +249,7 @@ void BrowserThreadImpl::Initialize() {
   base::AutoLock lock(globals.lock);
   DCHECK(identifier_ >= 0 && identifier_ < ID_COUNT);
   DCHECK(globals.threads[identifier_] == NULL);
+  DCHECK(!globals.IsPooled(identifier_));
   globals.threads[identifier_] = this;
 }
 
@@ -257,20 +294,30 @@ bool BrowserThreadImpl::PostTaskHelper(
   if (!target_thread_outlives_current)
     globals.lock.Acquire();
 
-  MessageLoop* message_loop = globals.threads[identifier] ?
-      globals.threads[identifier]->message_loop() : NULL;
-  if (message_loop) {
-    if (nestable) {
-      message_loop->PostDelayedTask(from_here, task, delay);
-    } else {
-      message_loop->PostNonNestableDelayedTask(from_here, task, delay);
+  // Pool tasks never nest, so |nestable| makes no difference to them. A pooled
+  // ID can stop being so at any time on shutdown, whether or not the lock is
+  // held; the pool then rejects the task.
+  bool posted = false;
+  if (globals.IsPooled(identifier)) {
+    posted = globals.blocking_pool->PostDelayedSequencedWorkerTask(
+        globals.pooled_tokens[identifier], from_here, task, delay);
+  } else {
+    MessageLoop* message_loop = globals.threads[identifier] ?
+        globals.threads[identifier]->message_loop() : NULL;
+    if (message_loop) {
+      if (nestable) {
+        message_loop->PostDelayedTask(from_here, task, delay);
+      } else {
+        message_loop->PostNonNestableDelayedTask(from_here, task, delay);
+      }
+      posted = true;
     }
   }
 
   if (!target_thread_outlives_current)
     globals.lock.Release();
 
-  return !!message_loop;
+  return posted;
 }
 
 // An implementation of MessageLoopProxy to be used in conjunction
@@ -345,7 +392,7 @@ bool BrowserThread::IsWellKnownThread(ID identifier) {
   BrowserThreadGlobals& globals = g_globals.Get();
   base::AutoLock lock(globals.lock);
   return (identifier >= 0 && identifier < ID_COUNT &&
-          globals.threads[identifier]);
+          (globals.threads[identifier] || globals.IsPooled(identifier)));
 }
 
 // static
@@ -358,6 +405,10 @@ bool BrowserThread::CurrentlyOn(ID identifier) {
   BrowserThreadGlobals& globals = g_globals.Get();
   base::AutoLock lock(globals.lock);
   DCHECK(identifier >= 0 && identifier < ID_COUNT);
+  if (globals.IsPooled(identifier)) {
+    return globals.blocking_pool->IsRunningSequenceOnCurrentThread(
+        globals.pooled_tokens[identifier]);
+  }
   return globals.threads[identifier] &&
          globals.threads[identifier]->message_loop() ==
              MessageLoop::current();
@@ -371,6 +422,10 @@ bool BrowserThread::IsMessageLoopValid(ID identifier) {
   BrowserThreadGlobals& globals = g_globals.Get();
   base::AutoLock lock(globals.lock);
   DCHECK(identifier >= 0 && identifier < ID_COUNT);
+  // A pooled ID has no MessageLoop, but is valid for as long as it takes
+  // tasks.
+  if (globals.IsPooled(identifier))
+    return true;
   return globals.threads[identifier] &&
          globals.threads[identifier]->message_loop();
 }
@@ -442,6 +497,20 @@ bool BrowserThread::GetCurrentThreadIdentifier(ID* identifier) {
     }
   }
 
+  // Pool threads have no MessageLoop; check whether they are running the
+  // sequence of a pooled ID.
+  if (cur_message_loop)
+    return false;
+  base::AutoLock lock(globals.lock);
+  for (int i = 0; i < ID_COUNT; ++i) {
+    if (globals.IsPooled(i) &&
+        globals.blocking_pool->IsRunningSequenceOnCurrentThread(
+            globals.pooled_tokens[i])) {
+      *identifier = static_cast<ID>(i);
+      return true;
+    }
+  }
+
   return false;
 }
 
@@ -460,6 +529,7 @@ MessageLoop* BrowserThread::UnsafeGetMessageLoopForThread(ID identifier) {
 
   BrowserThreadGlobals& globals = g_globals.Get();
   base::AutoLock lock(globals.lock);
+  DCHECK(!globals.IsPooled(identifier)) << "Pooled IDs have no MessageLoop";
   base::Thread* thread = globals.threads[identifier];
   DCHECK(thread);
   MessageLoop* loop = thread->message_loop();
@@ -22,6 +22,15 @@ class BrowserThreadImpl : public BrowserThread,
 
   static void ShutdownThreadPool();
 
+  // Backs |identifier| with a sequence on the blocking pool instead of a
+  // dedicated thread: tasks posted to it run one at a time, in order, on
+  // whichever pool thread is free, and CurrentlyOn() is true while one of
+  // them runs. It has no MessageLoop of its own. Must be called before any
+  // task is posted to |identifier|, and instead of constructing a
+  // BrowserThreadImpl for it. UI and IO cannot be pooled. The ID stops
+  // accepting tasks once ShutdownThreadPool() has run.
+  static void UseBlockingPoolForThread(BrowserThread::ID identifier);
+
  protected:
   virtual void Init() OVERRIDE;
   virtual void Run(MessageLoop* message_loop) OVERRIDE;
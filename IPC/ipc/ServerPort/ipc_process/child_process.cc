@@ -3,7 +3,9 @@
 // found in the LICENSE file.
 
 #include "child_process.h"
+#include "base/command_line.h"
 #include "base/message_loop.h"
+#include "base/metrics/shared_histogram_allocator.h"
 #include "base/metrics/statistics_recorder.h"
 #include "base/process_util.h"
 #include "base/string_number_conversions.h"
@@ -23,6 +25,10 @@ ChildProcess::ChildProcess()
   child_process_ = this;
 
   base::StatisticsRecorder::Initialize();
+  // Before any histogram is created, so that they all go in the segment the
+  // parent process reads them from.
+  base::SharedHistogramAllocator::InitGlobalFromCommandLine(
+      *CommandLine::ForCurrentProcess());
 
   // We can't recover from failing to start the IO thread.
   CHECK(io_thread_.StartWithOptions(
@@ -6,13 +6,17 @@
 
 #include <utility>  // For std::pair.
 
+#include "base/base_switches.h"
 #include "base/bind.h"
 #include "base/command_line.h"
 #include "base/file_util.h"
 #include "base/logging.h"
 #include "base/memory/scoped_ptr.h"
 #include "base/metrics/histogram.h"
+#include "base/metrics/shared_histogram_allocator.h"
+#include "base/metrics/statistics_recorder.h"
 #include "base/process_util.h"
+#include "base/stringprintf.h"
 #include "base/synchronization/lock.h"
 #include "base/threading/thread.h"
 #include "browser_thread.h"
@@ -52,6 +56,22 @@ class ChildProcessLauncher::Context
     client_ = client;
     //CHECK(BrowserThread::GetCurrentThreadIdentifier(&client_thread_id_));
 
+    // The child's histograms are merged into this process's, which are only
+    // registered, and so only seen, once the StatisticsRecorder exists.
+    base::StatisticsRecorder::Initialize();
+
+    // The segment outlives the child, so its histograms can still be read if
+    // it crashes.
+    std::string histogram_segment = base::StringPrintf(
+        "ChildHistograms.%d.%d", static_cast<int>(base::GetCurrentProcId()),
+        child_process_id);
+    histogram_allocator_ = base::SharedHistogramAllocator::Create(
+        histogram_segment, base::SharedHistogramAllocator::kDefaultSize);
+    if (histogram_allocator_.get()) {
+      cmd_line->AppendSwitchASCII(switches::kHistogramSharedMemory,
+                                  histogram_segment);
+    }
+
     base::ProcessHandle handle = 0;
     base::LaunchProcess(*cmd_line, base::LaunchOptions(), &handle);
     starting_ = false;
@@ -178,6 +198,8 @@ class ChildProcessLauncher::Context
   // Controls whether the child process should be terminated on browser
   // shutdown. Default behavior is to terminate the child.
   bool terminate_child_on_shutdown_;
+  // Holds the child's histograms. NULL if the segment couldn't be created.
+  scoped_ptr<base::SharedHistogramAllocator> histogram_allocator_;
 };
 
 
@@ -229,8 +251,10 @@ base::TerminationStatus ChildProcessLauncher::GetChildTerminationStatus(
   // it'll reap the process.  However, if GetTerminationStatus didn't
   // reap the child (because it was still running), we'll need to
   // Terminate via ProcessWatcher. So we can't close the handle here.
-  if (context_->termination_status_ != base::TERMINATION_STATUS_STILL_RUNNING)
+  if (context_->termination_status_ != base::TERMINATION_STATUS_STILL_RUNNING) {
     context_->process_.Close();
+    MergeChildHistograms();
+  }
 
   return context_->termination_status_;
 }
@@ -248,3 +272,8 @@ void ChildProcessLauncher::SetTerminateChildOnShutdown(
   if (context_)
     context_->set_terminate_child_on_shutdown(terminate_on_shutdown);
 }
+
+void ChildProcessLauncher::MergeChildHistograms() {
+  if (context_ && context_->histogram_allocator_.get())
+    context_->histogram_allocator_->MergeDeltas();
+}
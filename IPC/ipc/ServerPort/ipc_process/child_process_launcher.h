@@ -57,6 +57,13 @@ class  ChildProcessLauncher {
   // shutdown.
   void SetTerminateChildOnShutdown(bool terminate_on_shutdown);
 
+  // Adds the samples the child has recorded since the last call to the
+  // histograms of this process. The child keeps its histograms in memory
+  // shared with this process, so this works without IPC, and after the child
+  // has exited or crashed. GetChildTerminationStatus() calls it once the
+  // child is gone.
+  void MergeChildHistograms();
+
  private:
   class Context;
 
@@ -21,6 +21,10 @@ const char kEnableDCHECK[]                  = "enable-dcheck";
 // Generates full memory crash dump.
 const char kFullMemoryCrashReport[]         = "full-memory-crash-report";
 
+// Names the shared memory segment, created by the parent process, that a child
+// process places its histograms in. See SharedHistogramAllocator.
+const char kHistogramSharedMemory[]         = "histogram-shared-memory";
+
 // Suppresses all error dialogs when present.
 const char kNoErrorDialogs[]                = "noerrdialogs";
 
@@ -13,6 +13,7 @@ extern const char kDebugOnStart[];
 extern const char kDisableBreakpad[];
 extern const char kEnableDCHECK[];
 extern const char kFullMemoryCrashReport[];
+extern const char kHistogramSharedMemory[];
 extern const char kNoErrorDialogs[];
 extern const char kTestChildProcess[];
 extern const char kV[];
@@ -32,6 +32,8 @@ CPU::CPU()
     has_ssse3_(false),
     has_sse41_(false),
     has_sse42_(false),
+    has_avx_(false),
+    has_non_stop_time_stamp_counter_(false),
     cpu_vendor_("unknown") {
   Initialize();
 }
@@ -122,9 +124,10 @@ void CPU::Initialize() {
 
   // Get the brand string of the cpu.
   __cpuid(cpu_info, 0x80000000);
+  const int max_parameter = cpu_info[0];
   const int parameter_end = 0x80000004;
 
-  if (cpu_info[0] >= parameter_end) {
+  if (max_parameter >= parameter_end) {
     char* cpu_string_ptr = cpu_string;
 
     for (int parameter = 0x80000002; parameter <= parameter_end &&
@@ -135,6 +138,14 @@ void CPU::Initialize() {
     }
     cpu_brand_.assign(cpu_string, cpu_string_ptr - cpu_string);
   }
+
+  // The advanced power management leaf says whether the time stamp counter
+  // is invariant.
+  const int parameter_containing_non_stop_time_stamp_counter = 0x80000007;
+  if (max_parameter >= parameter_containing_non_stop_time_stamp_counter) {
+    __cpuid(cpu_info, parameter_containing_non_stop_time_stamp_counter);
+    has_non_stop_time_stamp_counter_ = (cpu_info[3] & (1 << 8)) != 0;
+  }
 #endif
 }
 
@@ -0,0 +1,67 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Converts a trace written by TraceLog::SetBinaryOutputFile() to the JSON
+// that TraceLog::Flush() and TraceResultBuffer produce, so that it can be
+// loaded into about:tracing or trace_event_analyzer.
+//
+// Usage: trace_binary_to_json <binary trace> <json output>
+
+#include <stdio.h>
+
+#include <string>
+
+#include "base/at_exit.h"
+#include "base/bind.h"
+#include "base/command_line.h"
+#include "base/debug/trace_event_binary.h"
+#include "base/debug/trace_event_impl.h"
+#include "base/file_util.h"
+#include "base/files/file_path.h"
+
+namespace {
+
+void AddFragment(base::debug::TraceResultBuffer* result_buffer,
+                 const scoped_refptr<base::RefCountedString>& fragment) {
+  result_buffer->AddFragment(fragment->data());
+}
+
+}  // namespace
+
+int main(int argc, const char* argv[]) {
+  base::AtExitManager at_exit;
+  CommandLine::Init(argc, argv);
+  CommandLine::StringVector args = CommandLine::ForCurrentProcess()->GetArgs();
+  if (args.size() != 2) {
+    fprintf(stderr, "Usage: %s <binary trace> <json output>\n", argv[0]);
+    return 1;
+  }
+
+  base::FilePath input_path(args[0]);
+  base::FilePath output_path(args[1]);
+  std::string binary_trace;
+  if (!file_util::ReadFileToString(input_path, &binary_trace)) {
+    fprintf(stderr, "Couldn't read the binary trace.\n");
+    return 1;
+  }
+
+  base::debug::TraceResultBuffer result_buffer;
+  base::debug::TraceResultBuffer::SimpleOutput output;
+  result_buffer.SetOutputCallback(output.GetCallback());
+  result_buffer.Start();
+  bool ok = base::debug::ConvertBinaryTraceToJSON(
+      binary_trace,
+      base::Bind(&AddFragment, &result_buffer));
+  result_buffer.Finish();
+  if (!ok)
+    fprintf(stderr, "The binary trace is truncated or corrupt.\n");
+
+  int size = static_cast<int>(output.json_output.size());
+  if (file_util::WriteFile(output_path, output.json_output.data(), size) !=
+      size) {
+    fprintf(stderr, "Couldn't write the JSON output.\n");
+    return 1;
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,487 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/debug/trace_event_binary.h"
+
+#include <string.h>
+
+#include <deque>
+#include <vector>
+
+#include "base/debug/trace_event.h"
+#include "base/logging.h"
+#include "base/memory/ref_counted_memory.h"
+#include "base/synchronization/condition_variable.h"
+#include "base/synchronization/lock.h"
+#include "base/threading/platform_thread.h"
+#include "base/threading/thread_restrictions.h"
+
+namespace base {
+namespace debug {
+
+namespace {
+
+const char kMagic[] = "TRCB";
+const size_t kMagicSize = 4;
+const unsigned char kVersion = 1;
+
+const char kStringRecord = 'S';
+const char kEventRecord = 'E';
+
+// Events per fragment passed to the callback, as TraceLog::Flush() does.
+const size_t kEventsPerFragment = 1000;
+
+// Buffers waiting for the file thread, beyond which the disk is deemed unable
+// to keep up and the trace is cut short, rather than held in memory.
+const size_t kMaxQueuedBuffers = 64;
+
+uint64 ZigZagEncode(int64 value) {
+  return (static_cast<uint64>(value) << 1) ^ static_cast<uint64>(value >> 63);
+}
+
+int64 ZigZagDecode(uint64 value) {
+  return static_cast<int64>(value >> 1) ^ -static_cast<int64>(value & 1);
+}
+
+void AppendVarint(uint64 value, std::string* out) {
+  while (value >= 0x80) {
+    out->push_back(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  out->push_back(static_cast<char>(value));
+}
+
+// Reads what TraceBinaryWriter writes. Each Read* method returns false if
+// the data ends first.
+class TraceBinaryReader {
+ public:
+  explicit TraceBinaryReader(const std::string& data)
+      : data_(data),
+        position_(0) {
+  }
+
+  bool AtEnd() const { return position_ == data_.size(); }
+
+  bool ReadByte(unsigned char* value) {
+    if (AtEnd())
+      return false;
+    *value = static_cast<unsigned char>(data_[position_++]);
+    return true;
+  }
+
+  bool ReadVarint(uint64* value) {
+    *value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      unsigned char byte;
+      if (!ReadByte(&byte))
+        return false;
+      *value |= static_cast<uint64>(byte & 0x7f) << shift;
+      if (!(byte & 0x80))
+        return true;
+    }
+    return false;
+  }
+
+  bool ReadSignedVarint(int64* value) {
+    uint64 encoded;
+    if (!ReadVarint(&encoded))
+      return false;
+    *value = ZigZagDecode(encoded);
+    return true;
+  }
+
+  bool ReadBytes(size_t size, std::string* value) {
+    if (data_.size() - position_ < size)
+      return false;
+    value->assign(data_, position_, size);
+    position_ += size;
+    return true;
+  }
+
+  // Reads a string table record. The writer hands out ids in order from 1,
+  // so any other id is a corrupt trace.
+  bool ReadStringRecord() {
+    uint64 id;
+    uint64 size;
+    if (strings_.empty())
+      strings_.resize(1);
+    if (!ReadVarint(&id) || !ReadVarint(&size) || id != strings_.size())
+      return false;
+    strings_.push_back(std::string());
+    return ReadBytes(size, &strings_.back());
+  }
+
+  // Reads a string of an event. The string stays valid until
+  // ClearEventStrings().
+  bool ReadString(const char** value) {
+    uint64 reference;
+    if (!ReadVarint(&reference))
+      return false;
+    if (reference == 0) {
+      *value = NULL;
+      return true;
+    }
+    if (reference & 1) {
+      event_strings_.push_back(std::string());
+      if (!ReadBytes(reference >> 1, &event_strings_.back()))
+        return false;
+      *value = event_strings_.back().c_str();
+      return true;
+    }
+    uint64 id = reference >> 1;
+    if (id >= strings_.size())
+      return false;
+    *value = strings_[id].c_str();
+    return true;
+  }
+
+  void ClearEventStrings() { event_strings_.clear(); }
+
+ private:
+  const std::string& data_;
+  size_t position_;
+  // The string table, by id.
+  std::vector<std::string> strings_;
+  // The strings written inline in the event being read. A deque doesn't move
+  // them as it grows.
+  std::deque<std::string> event_strings_;
+
+  DISALLOW_COPY_AND_ASSIGN(TraceBinaryReader);
+};
+
+// Reads an event into |event| and the name of its category into
+// |category_name|.
+bool ReadEvent(TraceBinaryReader* reader,
+               int64* timestamp,
+               TraceEvent* event,
+               const char** category_name) {
+  int64 thread_id;
+  int64 timestamp_delta;
+  unsigned char phase;
+  const char* name;
+  unsigned char flags;
+  if (!reader->ReadSignedVarint(&thread_id) ||
+      !reader->ReadSignedVarint(&timestamp_delta) ||
+      !reader->ReadByte(&phase) ||
+      !reader->ReadString(category_name) ||
+      !reader->ReadString(&name) ||
+      !reader->ReadByte(&flags)) {
+    return false;
+  }
+  if (!*category_name || !name)
+    return false;
+  *timestamp += timestamp_delta;
+
+  uint64 id = 0;
+  if ((flags & TRACE_EVENT_FLAG_HAS_ID) && !reader->ReadVarint(&id))
+    return false;
+
+  unsigned char num_args;
+  if (!reader->ReadByte(&num_args) || num_args > kTraceMaxNumArgs)
+    return false;
+  const char* arg_names[kTraceMaxNumArgs];
+  unsigned char arg_types[kTraceMaxNumArgs];
+  unsigned long long arg_values[kTraceMaxNumArgs];
+  for (int i = 0; i < num_args; ++i) {
+    if (!reader->ReadString(&arg_names[i]) || !arg_names[i] ||
+        !reader->ReadByte(&arg_types[i])) {
+      return false;
+    }
+    TraceEvent::TraceValue value;
+    value.as_uint = 0;
+    switch (arg_types[i]) {
+      case TRACE_VALUE_TYPE_BOOL:
+      case TRACE_VALUE_TYPE_UINT:
+      case TRACE_VALUE_TYPE_POINTER: {
+        uint64 uint_value;
+        if (!reader->ReadVarint(&uint_value))
+          return false;
+        value.as_uint = uint_value;
+        break;
+      }
+      case TRACE_VALUE_TYPE_INT: {
+        int64 int_value;
+        if (!reader->ReadSignedVarint(&int_value))
+          return false;
+        value.as_int = int_value;
+        break;
+      }
+      case TRACE_VALUE_TYPE_DOUBLE: {
+        std::string bytes;
+        if (!reader->ReadBytes(sizeof(value.as_double), &bytes))
+          return false;
+        memcpy(&value.as_double, bytes.data(), sizeof(value.as_double));
+        break;
+      }
+      case TRACE_VALUE_TYPE_STRING:
+      case TRACE_VALUE_TYPE_COPY_STRING:
+        if (!reader->ReadString(&value.as_string))
+          return false;
+        break;
+      default:
+        return false;
+    }
+    arg_values[i] = value.as_uint;
+  }
+
+  event->Initialize(static_cast<int>(thread_id),
+                    TimeTicks::FromInternalValue(*timestamp),
+                    static_cast<char>(phase), NULL, name, id, num_args,
+                    arg_names, arg_types, arg_values, flags);
+  return true;
+}
+
+}  // namespace
+
+// Writes the buffers it is given to a file, in order, on a thread of its own.
+// It doesn't use a MessageLoop, whose tasks are traced themselves: posting
+// one while TraceLog's lock is held could need that lock again.
+class TraceBinaryWriter::FileThread : public PlatformThread::Delegate {
+ public:
+  explicit FileThread(PlatformFile file)
+      : file_(file),
+        has_work_(&lock_),
+        started_(false),
+        stopping_(false),
+        failed_(false) {
+    started_ = PlatformThread::Create(0, this, &handle_);
+    if (!started_)
+      failed_ = true;
+  }
+
+  // Writes out what is queued, then stops the thread.
+  virtual ~FileThread() {
+    if (!started_)
+      return;
+    {
+      AutoLock lock(lock_);
+      stopping_ = true;
+      has_work_.Signal();
+    }
+    // Waits on the last writes.
+    ThreadRestrictions::ScopedAllowIO allow_io;
+    PlatformThread::Join(handle_);
+  }
+
+  // Queues the contents of |buffer| to be written, and empties it. Returns
+  // false if the file couldn't be written to so far.
+  bool Write(std::string* buffer) {
+    AutoLock lock(lock_);
+    if (!failed_ && !buffer->empty()) {
+      if (queue_.size() < kMaxQueuedBuffers) {
+        queue_.push_back(std::string());
+        queue_.back().swap(*buffer);
+        has_work_.Signal();
+      } else {
+        DLOG(ERROR) << "Trace file writes are too slow, events are dropped";
+        failed_ = true;
+      }
+    }
+    buffer->clear();
+    return !failed_;
+  }
+
+  // PlatformThread::Delegate implementation.
+  virtual void ThreadMain() OVERRIDE {
+    AutoLock lock(lock_);
+    while (true) {
+      while (queue_.empty() && !stopping_)
+        has_work_.Wait();
+      if (queue_.empty())
+        return;
+
+      std::string buffer;
+      buffer.swap(queue_.front());
+      queue_.pop_front();
+      bool written;
+      {
+        AutoUnlock unlock(lock_);
+        int size = static_cast<int>(buffer.size());
+        written = WritePlatformFileAtCurrentPos(file_, buffer.data(), size) ==
+            size;
+      }
+      // A buffer that isn't written leaves the rest without their strings.
+      if (!written) {
+        failed_ = true;
+        queue_.clear();
+      }
+    }
+  }
+
+ private:
+  PlatformFile file_;
+  PlatformThreadHandle handle_;
+
+  Lock lock_;
+  // Signaled when a buffer is queued, or the thread is to stop.
+  ConditionVariable has_work_;
+  std::deque<std::string> queue_;
+  bool started_;
+  bool stopping_;
+  bool failed_;
+
+  DISALLOW_COPY_AND_ASSIGN(FileThread);
+};
+
+TraceBinaryWriter::TraceBinaryWriter(PlatformFile file, int process_id)
+    : file_thread_(new FileThread(file)),
+      last_timestamp_(0) {
+  buffer_.append(kMagic, kMagicSize);
+  buffer_.push_back(static_cast<char>(kVersion));
+  AppendVarint(ZigZagEncode(process_id), &buffer_);
+}
+
+TraceBinaryWriter::~TraceBinaryWriter() {
+  Flush();
+  file_thread_.reset();
+}
+
+void TraceBinaryWriter::WriteEvent(const TraceEvent& event) {
+  // Any strings new to the table are added to |buffer_| as |record| is
+  // written, ahead of it.
+  std::string record(1, kEventRecord);
+  bool copy = !!(event.flags() & TRACE_EVENT_FLAG_COPY);
+  int64 timestamp = event.timestamp().ToInternalValue();
+  AppendVarint(ZigZagEncode(event.thread_id()), &record);
+  AppendVarint(ZigZagEncode(timestamp - last_timestamp_), &record);
+  last_timestamp_ = timestamp;
+  record.push_back(event.phase());
+  AppendString(TraceLog::GetCategoryName(event.category_enabled()), false,
+               &record);
+  AppendString(event.name(), copy, &record);
+  record.push_back(static_cast<char>(event.flags()));
+  if (event.flags() & TRACE_EVENT_FLAG_HAS_ID)
+    AppendVarint(event.id(), &record);
+
+  int num_args = 0;
+  while (num_args < kTraceMaxNumArgs && event.arg_name(num_args))
+    ++num_args;
+  record.push_back(static_cast<char>(num_args));
+  for (int i = 0; i < num_args; ++i) {
+    unsigned char type = event.arg_type(i);
+    TraceEvent::TraceValue value = event.arg_value(i);
+    AppendString(event.arg_name(i), copy, &record);
+    record.push_back(static_cast<char>(type));
+    switch (type) {
+      case TRACE_VALUE_TYPE_BOOL:
+        AppendVarint(value.as_bool ? 1 : 0, &record);
+        break;
+      case TRACE_VALUE_TYPE_UINT:
+        AppendVarint(value.as_uint, &record);
+        break;
+      case TRACE_VALUE_TYPE_POINTER:
+        AppendVarint(reinterpret_cast<uintptr_t>(value.as_pointer), &record);
+        break;
+      case TRACE_VALUE_TYPE_INT:
+        AppendVarint(ZigZagEncode(value.as_int), &record);
+        break;
+      case TRACE_VALUE_TYPE_DOUBLE:
+        record.append(reinterpret_cast<const char*>(&value.as_double),
+                      sizeof(value.as_double));
+        break;
+      case TRACE_VALUE_TYPE_STRING:
+        AppendString(value.as_string, false, &record);
+        break;
+      case TRACE_VALUE_TYPE_COPY_STRING:
+        AppendString(value.as_string, true, &record);
+        break;
+      default:
+        NOTREACHED() << "Don't know how to write this value";
+        AppendVarint(0, &record);
+        break;
+    }
+  }
+
+  buffer_.append(record);
+  if (buffer_.size() >= kBufferSize)
+    Flush();
+}
+
+bool TraceBinaryWriter::Flush() {
+  return file_thread_->Write(&buffer_);
+}
+
+void TraceBinaryWriter::AppendString(const char* str,
+                                     bool copied,
+                                     std::string* out) {
+  if (!str) {
+    AppendVarint(0, out);
+    return;
+  }
+  if (copied) {
+    size_t length = strlen(str);
+    AppendVarint((static_cast<uint64>(length) << 1) | 1, out);
+    out->append(str, length);
+    return;
+  }
+
+  hash_map<const char*, uint64>::const_iterator it = string_ids_.find(str);
+  uint64 id;
+  if (it != string_ids_.end()) {
+    id = it->second;
+  } else {
+    id = string_ids_.size() + 1;
+    string_ids_[str] = id;
+    size_t length = strlen(str);
+    buffer_.push_back(kStringRecord);
+    AppendVarint(id, &buffer_);
+    AppendVarint(length, &buffer_);
+    buffer_.append(str, length);
+  }
+  AppendVarint(id << 1, out);
+}
+
+bool ConvertBinaryTraceToJSON(const std::string& binary_trace,
+                              const TraceLog::OutputCallback& callback) {
+  if (binary_trace.compare(0, kMagicSize, kMagic) != 0)
+    return false;
+
+  std::string data(binary_trace, kMagicSize);
+  TraceBinaryReader reader(data);
+  unsigned char version;
+  int64 process_id;
+  if (!reader.ReadByte(&version) || version != kVersion ||
+      !reader.ReadSignedVarint(&process_id)) {
+    return false;
+  }
+
+  bool ok = true;
+  int64 timestamp = 0;
+  TraceEvent event;
+  scoped_refptr<RefCountedString> fragment = new RefCountedString;
+  size_t events_in_fragment = 0;
+  while (!reader.AtEnd()) {
+    unsigned char kind;
+    reader.ReadByte(&kind);
+    if (kind == kStringRecord) {
+      ok = reader.ReadStringRecord();
+    } else if (kind == kEventRecord) {
+      const char* category_name;
+      ok = ReadEvent(&reader, &timestamp, &event, &category_name);
+      if (ok) {
+        if (events_in_fragment++)
+          fragment->data() += ",";
+        event.AppendAsJSON(category_name, static_cast<int>(process_id),
+                           &fragment->data());
+      }
+      reader.ClearEventStrings();
+    } else {
+      ok = false;
+    }
+    if (!ok)
+      break;
+
+    if (events_in_fragment == kEventsPerFragment) {
+      callback.Run(fragment);
+      fragment = new RefCountedString;
+      events_in_fragment = 0;
+    }
+  }
+  if (events_in_fragment)
+    callback.Run(fragment);
+  return ok;
+}
+
+}  // namespace debug
+}  // namespace base
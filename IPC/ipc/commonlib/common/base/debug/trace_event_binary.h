@@ -0,0 +1,87 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// A compact binary form of the events TraceLog records, which can be written
+// to a file while tracing runs instead of being kept in memory as JSON.
+//
+// The file starts with the 4 bytes "TRCB", a version byte and the process id,
+// and is followed by records of one of two kinds:
+//   'S' <id> <length> <bytes>   Adds a string to the string table.
+//   'E' <event>                 A trace event.
+// Numbers are varints, and signed ones are zigzag encoded first. An event is
+//   <thread id> <timestamp> <phase> <category> <name> <flags> [<id>]
+//   <num args> (<arg name> <arg type> <arg value>)*
+// where the timestamp is the microseconds since the previous event's, <id> is
+// only there with TRACE_EVENT_FLAG_HAS_ID, and strings are either 0 for NULL,
+// an even number that is twice their id in the string table, or an odd number
+// that is twice their length plus one, followed by their bytes. Strings that
+// live as long as the process, like category and event names, are added to
+// the table the first time they are written; copied ones are written inline.
+// Doubles are written as their 8 bytes in the writer's byte order.
+
+#ifndef BASE_DEBUG_TRACE_EVENT_BINARY_H_
+#define BASE_DEBUG_TRACE_EVENT_BINARY_H_
+
+#include <string>
+
+#include "base/base_export.h"
+#include "base/basictypes.h"
+#include "base/debug/trace_event_impl.h"
+#include "base/hash_tables.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/platform_file.h"
+
+namespace base {
+namespace debug {
+
+// Writes TraceEvents to a file as they come. They are encoded into buffers of
+// kBufferSize bytes, which a thread of the writer's own writes to the file, so
+// that the threads that trace never wait on the disk. Not thread safe; TraceLog
+// calls it with its lock held.
+class BASE_EXPORT TraceBinaryWriter {
+ public:
+  static const size_t kBufferSize = 64 * 1024;
+
+  // Doesn't take ownership of |file|, which must stay open as long as the
+  // writer.
+  TraceBinaryWriter(PlatformFile file, int process_id);
+
+  // Waits until everything written has reached the file.
+  ~TraceBinaryWriter();
+
+  void WriteEvent(const TraceEvent& event);
+
+  // Hands what is buffered to the file thread. Returns false if the file
+  // couldn't be written to so far, in which case events are dropped.
+  bool Flush();
+
+ private:
+  class FileThread;
+
+  // Appends |str| to |out|. Unless |copied|, |str| is referred to by its id
+  // in the string table, and is added to the table in |buffer_| if new.
+  void AppendString(const char* str, bool copied, std::string* out);
+
+  scoped_ptr<FileThread> file_thread_;
+  std::string buffer_;
+
+  // The ids of the strings in the string table, by address.
+  hash_map<const char*, uint64> string_ids_;
+  int64 last_timestamp_;
+
+  DISALLOW_COPY_AND_ASSIGN(TraceBinaryWriter);
+};
+
+// Reads a trace written by TraceBinaryWriter and passes it to |callback| in
+// the fragments TraceLog::Flush() would have, for a TraceResultBuffer to turn
+// into the same JSON. Returns false if |binary_trace| isn't a whole trace;
+// the events before the fault have been passed on.
+BASE_EXPORT bool ConvertBinaryTraceToJSON(
+    const std::string& binary_trace,
+    const TraceLog::OutputCallback& callback);
+
+}  // namespace debug
+}  // namespace base
+
+#endif  // BASE_DEBUG_TRACE_EVENT_BINARY_H_
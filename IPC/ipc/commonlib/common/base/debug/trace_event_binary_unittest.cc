@@ -0,0 +1,286 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/debug/trace_event_binary.h"
+
+#include <string>
+#include <vector>
+
+#include "base/at_exit.h"
+#include "base/bind.h"
+#include "base/debug/trace_event.h"
+#include "base/file_util.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/json/json_reader.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/threading/platform_thread.h"
+#include "base/values.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+namespace debug {
+
+namespace {
+
+class TraceEventBinaryTest : public testing::Test {
+ public:
+  virtual void SetUp() OVERRIDE {
+    TraceLog::DeleteForTesting();
+    TraceLog::Resurrect();
+    ASSERT_TRUE(TraceLog::GetInstance());
+    ASSERT_TRUE(temp_dir_.CreateUniqueTempDir());
+    path_ = temp_dir_.path().AppendASCII("trace.bin");
+  }
+
+  // Opens |path_| for writing.
+  PlatformFile OpenFile() {
+    return CreatePlatformFile(path_,
+                              PLATFORM_FILE_CREATE_ALWAYS |
+                                  PLATFORM_FILE_WRITE,
+                              NULL, NULL);
+  }
+
+  // Converts |binary_trace| with ConvertBinaryTraceToJSON(), and returns
+  // the fragments joined as TraceLog::Flush() would have.
+  bool Convert(const std::string& binary_trace, std::string* json) {
+    json->clear();
+    return ConvertBinaryTraceToJSON(
+        binary_trace,
+        Bind(&TraceEventBinaryTest::OnFragment, Unretained(this), json));
+  }
+
+  void OnFragment(std::string* json,
+                  const scoped_refptr<RefCountedString>& fragment) {
+    if (!json->empty())
+      *json += ",";
+    *json += fragment->data();
+  }
+
+ protected:
+  ScopedTempDir temp_dir_;
+  FilePath path_;
+
+ private:
+  // We want our singleton torn down after each test.
+  ShadowingAtExitManager at_exit_manager_;
+};
+
+// Writes |events| to |file|, and appends the JSON they are written as
+// directly to |expected_json|.
+void WriteEvents(const std::vector<TraceEvent>& events,
+                 PlatformFile file,
+                 std::string* expected_json) {
+  TraceBinaryWriter writer(file, TraceLog::GetInstance()->process_id());
+  for (size_t i = 0; i < events.size(); ++i) {
+    writer.WriteEvent(events[i]);
+    if (i > 0)
+      *expected_json += ",";
+    events[i].AppendAsJSON(expected_json);
+  }
+  EXPECT_TRUE(writer.Flush());
+}
+
+std::vector<TraceEvent> MakeEvents() {
+  const unsigned char* category = TraceLog::GetCategoryEnabled("binary");
+  const unsigned char* other_category = TraceLog::GetCategoryEnabled("other");
+  std::vector<TraceEvent> events;
+
+  events.push_back(TraceEvent(1, TimeTicks::FromInternalValue(1000),
+                              TRACE_EVENT_PHASE_BEGIN, category, "begin", 0,
+                              0, NULL, NULL, NULL, TRACE_EVENT_FLAG_NONE));
+
+  // Goes back in time, from another thread.
+  const char* arg_names[] = { "int", "string" };
+  unsigned char arg_types[] = { TRACE_VALUE_TYPE_INT,
+                                TRACE_VALUE_TYPE_STRING };
+  TraceEvent::TraceValue values[2];
+  values[0].as_int = -42;
+  values[1].as_string = "static string";
+  unsigned long long arg_values[] = { values[0].as_uint, values[1].as_uint };
+  events.push_back(TraceEvent(-7, TimeTicks::FromInternalValue(900),
+                              TRACE_EVENT_PHASE_INSTANT, other_category,
+                              "instant", 0, 2, arg_names, arg_types,
+                              arg_values, TRACE_EVENT_SCOPE_PROCESS));
+
+  // Copied strings and an id.
+  std::string copied_name("copied name");
+  std::string copied_arg("copied arg");
+  const char* copy_arg_names[] = { copied_arg.c_str(), "double" };
+  unsigned char copy_arg_types[] = { TRACE_VALUE_TYPE_BOOL,
+                                     TRACE_VALUE_TYPE_DOUBLE };
+  values[0].as_uint = 0;
+  values[0].as_bool = true;
+  values[1].as_double = 3.25;
+  unsigned long long copy_arg_values[] = { values[0].as_uint,
+                                           values[1].as_uint };
+  events.push_back(TraceEvent(1, TimeTicks::FromInternalValue(2000),
+                              TRACE_EVENT_PHASE_ASYNC_BEGIN, category,
+                              copied_name.c_str(), 0xfedcba9876543210ull, 2,
+                              copy_arg_names, copy_arg_types,
+                              copy_arg_values,
+                              TRACE_EVENT_FLAG_HAS_ID |
+                                  TRACE_EVENT_FLAG_COPY));
+
+  // The same names again, now from the string table.
+  const char* more_arg_names[] = { "uint", "pointer" };
+  unsigned char more_arg_types[] = { TRACE_VALUE_TYPE_UINT,
+                                     TRACE_VALUE_TYPE_POINTER };
+  values[0].as_uint = 1ull << 40;
+  values[1].as_uint = 0;
+  values[1].as_pointer = &events;
+  unsigned long long more_arg_values[] = { values[0].as_uint,
+                                           values[1].as_uint };
+  events.push_back(TraceEvent(1, TimeTicks::FromInternalValue(2500),
+                              TRACE_EVENT_PHASE_END, category, "begin", 0,
+                              2, more_arg_names, more_arg_types,
+                              more_arg_values, TRACE_EVENT_FLAG_NONE));
+
+  // A string argument whose value is copied.
+  std::string copied_value("copied \"value\"");
+  const char* string_arg_name = "copy_string";
+  unsigned char string_arg_type = TRACE_VALUE_TYPE_COPY_STRING;
+  values[0].as_uint = 0;
+  values[0].as_string = copied_value.c_str();
+  unsigned long long string_arg_value = values[0].as_uint;
+  events.push_back(TraceEvent(2, TimeTicks::FromInternalValue(2600),
+                              TRACE_EVENT_PHASE_METADATA, category,
+                              "thread_name", 0, 1, &string_arg_name,
+                              &string_arg_type, &string_arg_value,
+                              TRACE_EVENT_FLAG_NONE));
+  return events;
+}
+
+}  // namespace
+
+TEST_F(TraceEventBinaryTest, ConvertsToSameJSON) {
+  std::vector<TraceEvent> events = MakeEvents();
+  PlatformFile file = OpenFile();
+  ASSERT_NE(kInvalidPlatformFileValue, file);
+  std::string expected_json;
+  WriteEvents(events, file, &expected_json);
+  ClosePlatformFile(file);
+
+  std::string binary_trace;
+  ASSERT_TRUE(file_util::ReadFileToString(path_, &binary_trace));
+  std::string json;
+  EXPECT_TRUE(Convert(binary_trace, &json));
+  EXPECT_EQ(expected_json, json);
+
+  // The interned strings are written once; the copied ones each time.
+  std::string twice;
+  std::vector<TraceEvent> doubled(events);
+  doubled.insert(doubled.end(), events.begin(), events.end());
+  file = OpenFile();
+  WriteEvents(doubled, file, &twice);
+  ClosePlatformFile(file);
+  std::string doubled_trace;
+  ASSERT_TRUE(file_util::ReadFileToString(path_, &doubled_trace));
+  EXPECT_TRUE(Convert(doubled_trace, &json));
+  EXPECT_EQ(twice, json);
+  EXPECT_LT(doubled_trace.size(), 2 * binary_trace.size());
+}
+
+TEST_F(TraceEventBinaryTest, RejectsTruncatedTrace) {
+  std::vector<TraceEvent> events = MakeEvents();
+  PlatformFile file = OpenFile();
+  ASSERT_NE(kInvalidPlatformFileValue, file);
+  std::string expected_json;
+  WriteEvents(events, file, &expected_json);
+  ClosePlatformFile(file);
+
+  std::string binary_trace;
+  ASSERT_TRUE(file_util::ReadFileToString(path_, &binary_trace));
+  std::string json;
+  EXPECT_FALSE(Convert(binary_trace.substr(0, binary_trace.size() - 1),
+                       &json));
+  // The events before the last one are still converted.
+  EXPECT_FALSE(json.empty());
+  EXPECT_EQ(0u, expected_json.find(json));
+  EXPECT_LT(json.size(), expected_json.size());
+
+  EXPECT_FALSE(Convert("TRC", &json));
+  EXPECT_FALSE(Convert("not a binary trace", &json));
+}
+
+TEST_F(TraceEventBinaryTest, RejectsOutOfOrderStringIds) {
+  // A header for process 1, then an empty string record.
+  const char kFirstString[] = "TRCB\x01\x02S\x01\x00";
+  const char kFifthString[] = "TRCB\x01\x02S\x05\x00";
+  const char kHugeStringId[] = "TRCB\x01\x02S\xff\xff\xff\xff\x0f\x00";
+  std::string json;
+  EXPECT_TRUE(Convert(std::string(kFirstString, sizeof(kFirstString) - 1),
+                      &json));
+  EXPECT_FALSE(Convert(std::string(kFifthString, sizeof(kFifthString) - 1),
+                       &json));
+  EXPECT_FALSE(Convert(std::string(kHugeStringId, sizeof(kHugeStringId) - 1),
+                       &json));
+}
+
+TEST_F(TraceEventBinaryTest, StreamsWhileTracing) {
+  const int kNumEvents = 10000;
+  PlatformFile file = OpenFile();
+  ASSERT_NE(kInvalidPlatformFileValue, file);
+  TraceLog* trace_log = TraceLog::GetInstance();
+  trace_log->SetBinaryOutputFile(file);
+  const char* old_thread_name = PlatformThread::GetName();
+  std::string saved_thread_name(old_thread_name ? old_thread_name : "");
+  PlatformThread::SetName("StreamingThread");
+
+  trace_log->SetEnabled(std::string("*"), TraceLog::RECORD_UNTIL_FULL);
+  for (int i = 0; i < kNumEvents; ++i)
+    TRACE_EVENT_INSTANT1("binary", "event", TRACE_EVENT_SCOPE_THREAD, "i", i);
+  // More than TraceBinaryWriter::kBufferSize has been traced, so the file
+  // thread writes some of it while tracing goes on.
+  int64 size = 0;
+  for (int i = 0; i < 500 && size == 0; ++i) {
+    if (i > 0)
+      PlatformThread::Sleep(TimeDelta::FromMilliseconds(10));
+    ASSERT_TRUE(file_util::GetFileSize(path_, &size));
+  }
+  EXPECT_GT(size, 0);
+  trace_log->SetDisabled();
+  PlatformThread::SetName(saved_thread_name.c_str());
+
+  // Flush() writes the rest of the events to the file, and none to the
+  // callback.
+  std::string flushed_json;
+  trace_log->Flush(Bind(&TraceEventBinaryTest::OnFragment, Unretained(this),
+                        &flushed_json));
+  EXPECT_TRUE(flushed_json.empty());
+  trace_log->SetBinaryOutputFile(kInvalidPlatformFileValue);
+  ClosePlatformFile(file);
+
+  std::string binary_trace;
+  ASSERT_TRUE(file_util::ReadFileToString(path_, &binary_trace));
+  std::string json;
+  ASSERT_TRUE(Convert(binary_trace, &json));
+  scoped_ptr<Value> root(JSONReader::Read("[" + json + "]"));
+  ListValue* list = NULL;
+  ASSERT_TRUE(root.get() && root->GetAsList(&list));
+
+  int num_events = 0;
+  bool found_thread_name = false;
+  for (size_t i = 0; i < list->GetSize(); ++i) {
+    DictionaryValue* dict = NULL;
+    ASSERT_TRUE(list->GetDictionary(i, &dict));
+    std::string name;
+    EXPECT_TRUE(dict->GetString("name", &name));
+    if (name == "event") {
+      int value = -1;
+      EXPECT_TRUE(dict->GetInteger("args.i", &value));
+      EXPECT_EQ(num_events, value);
+      ++num_events;
+    } else if (name == "thread_name") {
+      std::string thread_name;
+      EXPECT_TRUE(dict->GetString("args.name", &thread_name));
+      if (thread_name == "StreamingThread")
+        found_thread_name = true;
+    }
+  }
+  EXPECT_EQ(kNumEvents, num_events);
+  EXPECT_TRUE(found_thread_name);
+}
+
+}  // namespace debug
+}  // namespace base
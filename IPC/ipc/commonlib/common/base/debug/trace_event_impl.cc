@@ -5,12 +5,13 @@
 #include "base/debug/trace_event_impl.h"
 
 #include <algorithm>
+#include <deque>
 
 #include "base/bind.h"
 #include "base/debug/leak_annotations.h"
+#include "base/debug/trace_event_binary.h"
 #include "base/debug/trace_event.h"
 #include "base/format_macros.h"
-#include "base/lazy_instance.h"
 #include "base/memory/singleton.h"
 #include "base/process_util.h"
 #include "base/stl_util.h"
@@ -24,7 +25,6 @@
 #include "base/third_party/dynamic_annotations/dynamic_annotations.h"
 #include "base/threading/platform_thread.h"
 #include "base/threading/thread_id_name_manager.h"
-#include "base/threading/thread_local.h"
 #include "base/time.h"
 #include "base/utf_string_conversions.h"
 
@@ -51,8 +51,9 @@ namespace debug {
 // Controls the number of trace events we will buffer in-memory
 // before throwing them away.
 const size_t kTraceEventBufferSize = 500000;
+const size_t kTraceEventBufferChunks =
+    kTraceEventBufferSize / TraceBufferChunk::kTraceBufferChunkSize;
 const size_t kTraceEventBatchSize = 1000;
-const size_t kTraceEventInitialBufferSize = 1024;
 
 #define TRACE_EVENT_MAX_CATEGORIES 100
 
@@ -77,152 +78,206 @@ const int g_category_metadata = 2;
 const int g_num_builtin_categories = 3;
 int g_category_index = g_num_builtin_categories; // Skip default categories.
 
-// The name of the current thread. This is used to decide if the current
-// thread name has changed. We combine all the seen thread names into the
-// output name for the thread.
-LazyInstance<ThreadLocalPointer<const char> >::Leaky
-    g_current_thread_name = LAZY_INSTANCE_INITIALIZER;
-
 const char kRecordUntilFull[] = "record-until-full";
 const char kRecordContinuously[] = "record-continuously";
 
-size_t NextIndex(size_t index) {
-  index++;
-  if (index >= kTraceEventBufferSize)
-    index = 0;
-  return index;
-}
-
 }  // namespace
 
-class TraceBufferRingBuffer : public TraceBuffer {
+// Keeps the chunks handed back by the threads, oldest first.
+class ChunkedTraceBuffer : public TraceBuffer {
  public:
-  TraceBufferRingBuffer()
-      : unused_event_index_(0),
-        oldest_event_index_(0) {
-    logged_events_.reserve(kTraceEventInitialBufferSize);
+  ChunkedTraceBuffer()
+      : current_chunk_index_(0),
+        current_event_index_(0) {
   }
 
-  ~TraceBufferRingBuffer() {}
+  ~ChunkedTraceBuffer() {
+    STLDeleteElements(&chunks_);
+  }
 
-  void AddEvent(const TraceEvent& event) OVERRIDE {
-    if (unused_event_index_ < Size())
-      logged_events_[unused_event_index_] = event;
-    else
-      logged_events_.push_back(event);
+  void ReturnChunk(scoped_ptr<TraceBufferChunk> chunk) OVERRIDE {
+    if (chunk->size())
+      chunks_.push_back(chunk.release());
+  }
 
-    unused_event_index_ = NextIndex(unused_event_index_);
-    if (unused_event_index_ == oldest_event_index_) {
-      oldest_event_index_ = NextIndex(oldest_event_index_);
+  void AddEvent(const TraceEvent& event) OVERRIDE {
+    if (chunks_.empty() || chunks_.back()->IsFull()) {
+      scoped_ptr<TraceBufferChunk> chunk = GetChunk();
+      // The thread name metadata events are added even when the buffer is
+      // full.
+      if (!chunk.get())
+        chunk.reset(new TraceBufferChunk);
+      chunks_.push_back(chunk.release());
     }
+    *chunks_.back()->AddTraceEvent() = event;
   }
 
   bool HasMoreEvents() const OVERRIDE {
-    return oldest_event_index_ != unused_event_index_;
+    return current_chunk_index_ < chunks_.size();
   }
 
   const TraceEvent& NextEvent() OVERRIDE {
     DCHECK(HasMoreEvents());
 
-    size_t next = oldest_event_index_;
-    oldest_event_index_ = NextIndex(oldest_event_index_);
-    return GetEventAt(next);
-  }
-
-  bool IsFull() const OVERRIDE {
-    return false;
+    const TraceBufferChunk* chunk = chunks_[current_chunk_index_];
+    const TraceEvent& event = chunk->GetEventAt(current_event_index_++);
+    if (current_event_index_ == chunk->size()) {
+      ++current_chunk_index_;
+      current_event_index_ = 0;
+    }
+    return event;
   }
 
-  size_t CountEnabledByName(const unsigned char* category,
-                            const std::string& event_name) const OVERRIDE {
+  size_t CountEnabledByName(
+      const unsigned char* category,
+      const std::string& event_name) const OVERRIDE {
     size_t notify_count = 0;
-    size_t index = oldest_event_index_;
-    while (index != unused_event_index_) {
-      const TraceEvent& event = GetEventAt(index);
-      if (category == event.category_enabled() &&
-          strcmp(event_name.c_str(), event.name()) == 0) {
-        ++notify_count;
+    for (size_t i = 0; i < chunks_.size(); ++i) {
+      for (size_t j = 0; j < chunks_[i]->size(); ++j) {
+        const TraceEvent& event = chunks_[i]->GetEventAt(j);
+        if (category == event.category_enabled() &&
+            strcmp(event_name.c_str(), event.name()) == 0) {
+          ++notify_count;
+        }
       }
-      index = NextIndex(index);
     }
     return notify_count;
   }
 
   const TraceEvent& GetEventAt(size_t index) const OVERRIDE {
-    DCHECK(index < logged_events_.size());
-    return logged_events_[index];
+    for (size_t i = 0; i < chunks_.size(); ++i) {
+      if (index < chunks_[i]->size())
+        return chunks_[i]->GetEventAt(index);
+      index -= chunks_[i]->size();
+    }
+    NOTREACHED();
+    return chunks_.back()->GetEventAt(0);
   }
 
   size_t Size() const OVERRIDE {
-    return logged_events_.size();
+    size_t size = 0;
+    for (size_t i = 0; i < chunks_.size(); ++i)
+      size += chunks_[i]->size();
+    return size;
+  }
+
+ protected:
+  size_t num_chunks() const { return chunks_.size(); }
+
+  // Removes the oldest chunk and returns it emptied.
+  scoped_ptr<TraceBufferChunk> TakeOldestChunk() {
+    DCHECK(!chunks_.empty());
+    scoped_ptr<TraceBufferChunk> chunk(chunks_.front());
+    chunks_.pop_front();
+    chunk->Reset();
+    return chunk.Pass();
   }
 
  private:
-  size_t unused_event_index_;
-  size_t oldest_event_index_;
-  std::vector<TraceEvent> logged_events_;
+  std::deque<TraceBufferChunk*> chunks_;
+  size_t current_chunk_index_;
+  size_t current_event_index_;
 
+  DISALLOW_COPY_AND_ASSIGN(ChunkedTraceBuffer);
+};
+
+// Once full, reuses its oldest chunk for each new one.
+class TraceBufferRingBuffer : public ChunkedTraceBuffer {
+ public:
+  TraceBufferRingBuffer() {}
+
+  scoped_ptr<TraceBufferChunk> GetChunk() OVERRIDE {
+    if (num_chunks() >= kTraceEventBufferChunks)
+      return TakeOldestChunk();
+    return scoped_ptr<TraceBufferChunk>(new TraceBufferChunk);
+  }
+
+  bool IsFull() const OVERRIDE {
+    return false;
+  }
+
+ private:
   DISALLOW_COPY_AND_ASSIGN(TraceBufferRingBuffer);
 };
 
-class TraceBufferVector : public TraceBuffer {
+// Once full, stops handing out chunks.
+class TraceBufferVector : public ChunkedTraceBuffer {
+ public:
+  TraceBufferVector() {}
+
+  scoped_ptr<TraceBufferChunk> GetChunk() OVERRIDE {
+    if (IsFull())
+      return scoped_ptr<TraceBufferChunk>();
+    return scoped_ptr<TraceBufferChunk>(new TraceBufferChunk);
+  }
+
+  bool IsFull() const OVERRIDE {
+    return num_chunks() >= kTraceEventBufferChunks;
+  }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(TraceBufferVector);
+};
+
+// Writes each chunk to a TraceBinaryWriter as it is handed back, and keeps
+// no events of its own.
+class TraceBufferStreaming : public TraceBuffer {
  public:
-  TraceBufferVector() : current_iteration_index_(0) {
-    logged_events_.reserve(kTraceEventInitialBufferSize);
+  explicit TraceBufferStreaming(TraceBinaryWriter* writer)
+      : writer_(writer) {
   }
 
-  ~TraceBufferVector() {
+  scoped_ptr<TraceBufferChunk> GetChunk() OVERRIDE {
+    if (spare_chunk_.get())
+      return spare_chunk_.Pass();
+    return scoped_ptr<TraceBufferChunk>(new TraceBufferChunk);
+  }
+
+  void ReturnChunk(scoped_ptr<TraceBufferChunk> chunk) OVERRIDE {
+    for (size_t i = 0; i < chunk->size(); ++i)
+      writer_->WriteEvent(chunk->GetEventAt(i));
+    chunk->Reset();
+    spare_chunk_ = chunk.Pass();
   }
 
   void AddEvent(const TraceEvent& event) OVERRIDE {
-    // Note, we have two callers which need to be handled. The first is
-    // AddTraceEventWithThreadIdAndTimestamp() which checks Size() and does an
-    // early exit if full. The second is AddThreadNameMetadataEvents().
-    // We can not DECHECK(!IsFull()) because we have to add the metadata
-    // events even if the buffer is full.
-    logged_events_.push_back(event);
+    writer_->WriteEvent(event);
   }
 
   bool HasMoreEvents() const OVERRIDE {
-    return current_iteration_index_ < Size();
+    return false;
   }
 
   const TraceEvent& NextEvent() OVERRIDE {
-    DCHECK(HasMoreEvents());
-    return GetEventAt(current_iteration_index_++);
+    NOTREACHED();
+    return null_event_;
   }
 
   bool IsFull() const OVERRIDE {
-    return Size() >= kTraceEventBufferSize;
+    return false;
   }
 
-  size_t CountEnabledByName(const unsigned char* category,
-                            const std::string& event_name) const OVERRIDE {
-    size_t notify_count = 0;
-    for (size_t i = 0; i < Size(); i++) {
-      const TraceEvent& event = GetEventAt(i);
-      if (category == event.category_enabled() &&
-          strcmp(event_name.c_str(), event.name()) == 0) {
-        ++notify_count;
-      }
-    }
-    return notify_count;
+  size_t CountEnabledByName(
+      const unsigned char* category,
+      const std::string& event_name) const OVERRIDE {
+    return 0;
   }
 
   const TraceEvent& GetEventAt(size_t index) const OVERRIDE {
-    DCHECK(index < logged_events_.size());
-    return logged_events_[index];
+    NOTREACHED();
+    return null_event_;
   }
 
   size_t Size() const OVERRIDE {
-    return logged_events_.size();
+    return 0;
   }
 
  private:
-  size_t current_iteration_index_;
-  std::vector<TraceEvent> logged_events_;
+  TraceBinaryWriter* writer_;
+  scoped_ptr<TraceBufferChunk> spare_chunk_;
+  TraceEvent null_event_;
 
-  DISALLOW_COPY_AND_ASSIGN(TraceBufferVector);
+  DISALLOW_COPY_AND_ASSIGN(TraceBufferStreaming);
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -272,14 +327,34 @@ TraceEvent::TraceEvent(int thread_id,
                        const char** arg_names,
                        const unsigned char* arg_types,
                        const unsigned long long* arg_values,
-                       unsigned char flags)
-    : timestamp_(timestamp),
-      id_(id),
-      category_enabled_(category_enabled),
-      name_(name),
-      thread_id_(thread_id),
-      phase_(phase),
-      flags_(flags) {
+                       unsigned char flags) {
+  Initialize(thread_id, timestamp, phase, category_enabled, name, id,
+             num_args, arg_names, arg_types, arg_values, flags);
+}
+
+TraceEvent::~TraceEvent() {
+}
+
+void TraceEvent::Initialize(int thread_id,
+                            TimeTicks timestamp,
+                            char phase,
+                            const unsigned char* category_enabled,
+                            const char* name,
+                            unsigned long long id,
+                            int num_args,
+                            const char** arg_names,
+                            const unsigned char* arg_types,
+                            const unsigned long long* arg_values,
+                            unsigned char flags) {
+  timestamp_ = timestamp;
+  id_ = id;
+  category_enabled_ = category_enabled;
+  name_ = name;
+  thread_id_ = thread_id;
+  phase_ = phase;
+  flags_ = flags;
+  parameter_copy_storage_ = NULL;
+
   // Clamp num_args since it may have been set by a third_party library.
   num_args = (num_args > kTraceMaxNumArgs) ? kTraceMaxNumArgs : num_args;
   int i = 0;
@@ -331,9 +406,6 @@ TraceEvent::TraceEvent(int thread_id,
   }
 }
 
-TraceEvent::~TraceEvent() {
-}
-
 // static
 void TraceEvent::AppendValueAsJSON(unsigned char type,
                                    TraceEvent::TraceValue value,
@@ -380,14 +452,21 @@ void TraceEvent::AppendValueAsJSON(unsigned char type,
 }
 
 void TraceEvent::AppendAsJSON(std::string* out) const {
+  AppendAsJSON(TraceLog::GetCategoryName(category_enabled_),
+               TraceLog::GetInstance()->process_id(),
+               out);
+}
+
+void TraceEvent::AppendAsJSON(const char* category_name,
+                              int process_id,
+                              std::string* out) const {
   int64 time_int64 = timestamp_.ToInternalValue();
-  int process_id = TraceLog::GetInstance()->process_id();
   // Category name checked at category creation time.
   DCHECK(!strchr(name_, '"'));
   StringAppendF(out,
       "{\"cat\":\"%s\",\"pid\":%i,\"tid\":%i,\"ts\":%" PRId64 ","
       "\"ph\":\"%c\",\"name\":\"%s\",\"args\":{",
-      TraceLog::GetCategoryName(category_enabled_),
+      category_name,
       process_id,
       thread_id_,
       time_int64,
@@ -432,6 +511,28 @@ void TraceEvent::AppendAsJSON(std::string* out) const {
   *out += "}";
 }
 
+////////////////////////////////////////////////////////////////////////////////
+//
+// TraceBufferChunk
+//
+////////////////////////////////////////////////////////////////////////////////
+
+TraceBufferChunk::TraceBufferChunk() : next_free_(0) {
+}
+
+TraceBufferChunk::~TraceBufferChunk() {
+}
+
+TraceEvent* TraceBufferChunk::AddTraceEvent() {
+  DCHECK(!IsFull());
+  return &chunk_[next_free_++];
+}
+
+const TraceEvent& TraceBufferChunk::GetEventAt(size_t index) const {
+  DCHECK(index < size());
+  return chunk_[index];
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 // TraceResultBuffer
@@ -644,6 +745,108 @@ void TraceLog::NotificationHelper::SendNotificationIfAny() {
     callback_copy_.Run(notification_);
 }
 
+// The thread adds its events to |chunk_| without taking the TraceLog lock. The
+// lock is only taken to swap a full chunk for an empty one, and by
+// FlushWhileLocked() to take the chunk from another thread. |state_| tells the
+// two apart: the flushing thread waits for an event being added to be done,
+// and an event added while a flush is taking the chunk goes through the lock.
+class TraceLog::ThreadLocalEventBuffer {
+ public:
+  explicit ThreadLocalEventBuffer(TraceLog* trace_log);
+  ~ThreadLocalEventBuffer();
+
+  // Returns the event to fill in, or NULL if the event must be added with the
+  // lock held instead, because the chunk is being flushed or the trace buffer
+  // is full. A non-NULL return must be followed by EndAddEvent().
+  TraceEvent* BeginAddEvent(NotificationHelper* notifier);
+  void EndAddEvent();
+
+  // Moves the events into the trace buffer. The TraceLog lock must be held.
+  void FlushWhileLocked();
+
+  // The name the thread had when it last added an event.
+  const char* thread_name() const { return thread_name_; }
+  void set_thread_name(const char* thread_name) { thread_name_ = thread_name; }
+
+  // Flushes and deletes |event_buffer| when its thread exits.
+  static void OnThreadExit(void* event_buffer);
+
+ private:
+  enum State {
+    IDLE,
+    ADDING_EVENT,
+    FLUSHING
+  };
+
+  TraceLog* trace_log_;
+  subtle::Atomic32 state_;
+  scoped_ptr<TraceBufferChunk> chunk_;
+  const char* thread_name_;
+
+  DISALLOW_COPY_AND_ASSIGN(ThreadLocalEventBuffer);
+};
+
+TraceLog::ThreadLocalEventBuffer::ThreadLocalEventBuffer(TraceLog* trace_log)
+    : trace_log_(trace_log),
+      state_(IDLE),
+      thread_name_(NULL) {
+}
+
+TraceLog::ThreadLocalEventBuffer::~ThreadLocalEventBuffer() {
+}
+
+TraceEvent* TraceLog::ThreadLocalEventBuffer::BeginAddEvent(
+    NotificationHelper* notifier) {
+  if (subtle::Acquire_CompareAndSwap(&state_, IDLE, ADDING_EVENT) != IDLE)
+    return NULL;
+  if (chunk_.get() && !chunk_->IsFull())
+    return chunk_->AddTraceEvent();
+  subtle::Release_Store(&state_, IDLE);
+
+  // Chunks are only flushed with the lock held, so the chunk can be swapped
+  // while holding it.
+  AutoLock lock(trace_log_->lock_);
+  TraceBuffer* logged_events = trace_log_->logged_events_.get();
+  if (chunk_.get()) {
+    logged_events->ReturnChunk(chunk_.Pass());
+    if (logged_events->IsFull())
+      notifier->AddNotificationWhileLocked(TRACE_BUFFER_FULL);
+  }
+  chunk_ = logged_events->GetChunk();
+  if (!chunk_.get())
+    return NULL;
+  subtle::NoBarrier_Store(&state_, ADDING_EVENT);
+  return chunk_->AddTraceEvent();
+}
+
+void TraceLog::ThreadLocalEventBuffer::EndAddEvent() {
+  subtle::Release_Store(&state_, IDLE);
+}
+
+void TraceLog::ThreadLocalEventBuffer::FlushWhileLocked() {
+  trace_log_->lock_.AssertAcquired();
+  // An event being added is done without the lock, so this doesn't wait long.
+  while (subtle::Acquire_CompareAndSwap(&state_, IDLE, FLUSHING) != IDLE)
+    PlatformThread::YieldCurrentThread();
+  if (chunk_.get())
+    trace_log_->logged_events_->ReturnChunk(chunk_.Pass());
+  subtle::Release_Store(&state_, IDLE);
+}
+
+// static
+void TraceLog::ThreadLocalEventBuffer::OnThreadExit(void* event_buffer) {
+  ThreadLocalEventBuffer* thread_local_event_buffer =
+      static_cast<ThreadLocalEventBuffer*>(event_buffer);
+  TraceLog* trace_log = thread_local_event_buffer->trace_log_;
+  AutoLock lock(trace_log->lock_);
+  thread_local_event_buffer->FlushWhileLocked();
+  std::vector<ThreadLocalEventBuffer*>& buffers =
+      trace_log->thread_local_event_buffers_;
+  buffers.erase(std::find(buffers.begin(), buffers.end(),
+                          thread_local_event_buffer));
+  delete thread_local_event_buffer;
+}
+
 // static
 TraceLog* TraceLog::GetInstance() {
   return Singleton<TraceLog, StaticMemorySingletonTraits<TraceLog> >::get();
@@ -676,10 +879,12 @@ TraceLog::Options TraceLog::TraceOptionsFromString(const std::string& options) {
 TraceLog::TraceLog()
     : enable_count_(0),
       logged_events_(NULL),
+      event_callback_(0),
       dispatching_to_observer_list_(false),
-      watch_category_(NULL),
+      watch_category_(0),
       trace_options_(RECORD_UNTIL_FULL),
-      sampling_thread_handle_(0) {
+      sampling_thread_handle_(0),
+      thread_local_event_buffer_(&ThreadLocalEventBuffer::OnThreadExit) {
   // Trace is enabled or disabled on one thread while other threads are
   // accessing the enabled flag. We don't care whether edge-case events are
   // traced or not, so we allow races on the enabled flag to keep the trace
@@ -701,6 +906,10 @@ TraceLog::TraceLog()
 }
 
 TraceLog::~TraceLog() {
+  // Threads still holding a buffer won't look at it again once the slot is
+  // freed.
+  thread_local_event_buffer_.Free();
+  STLDeleteElements(&thread_local_event_buffers_);
 }
 
 const unsigned char* TraceLog::GetCategoryEnabled(const char* name) {
@@ -836,6 +1045,7 @@ void TraceLog::SetEnabled(const std::vector<std::string>& included_categories,
 
   if (options != trace_options_) {
     trace_options_ = options;
+    FlushThreadLocalEventBuffersWhileLocked();
     logged_events_.reset(GetTraceBuffer());
   }
 
@@ -941,7 +1151,7 @@ void TraceLog::SetDisabled() {
 
   included_categories_.clear();
   excluded_categories_.clear();
-  watch_category_ = NULL;
+  subtle::NoBarrier_Store(&watch_category_, 0);
   watch_event_name_ = "";
   for (int i = 0; i < g_category_index; i++)
     g_category_enabled[i] = 0;
@@ -975,20 +1185,44 @@ void TraceLog::SetNotificationCallback(
 }
 
 TraceBuffer* TraceLog::GetTraceBuffer() {
+  if (binary_writer_.get())
+    return new TraceBufferStreaming(binary_writer_.get());
   if (trace_options_ & RECORD_CONTINUOUSLY)
     return new TraceBufferRingBuffer();
   return new TraceBufferVector();
 }
 
 void TraceLog::SetEventCallback(EventCallback cb) {
-  AutoLock lock(lock_);
-  event_callback_ = cb;
+  subtle::NoBarrier_Store(&event_callback_,
+                          reinterpret_cast<subtle::AtomicWord>(cb));
 };
 
+void TraceLog::SetBinaryOutputFile(PlatformFile file) {
+  // Destroyed once |lock_| is released, as it waits on the file thread.
+  scoped_ptr<TraceBinaryWriter> previous_binary_writer;
+  AutoLock lock(lock_);
+  if (enable_count_) {
+    DLOG(ERROR) << "Cannot change the binary output file while tracing.";
+    return;
+  }
+
+  FlushThreadLocalEventBuffersWhileLocked();
+  // Events already in the buffer go to the previous file, or are dropped when
+  // switching away from the in-memory buffer.
+  logged_events_.reset();
+  previous_binary_writer.swap(binary_writer_);
+  if (file != kInvalidPlatformFileValue)
+    binary_writer_.reset(new TraceBinaryWriter(file, process_id_));
+  logged_events_.reset(GetTraceBuffer());
+}
+
 void TraceLog::Flush(const TraceLog::OutputCallback& cb) {
   scoped_ptr<TraceBuffer> previous_logged_events;
   {
     AutoLock lock(lock_);
+    FlushThreadLocalEventBuffersWhileLocked();
+    if (binary_writer_.get())
+      binary_writer_->Flush();
     previous_logged_events.swap(logged_events_);
     logged_events_.reset(GetTraceBuffer());
   }  // release lock
@@ -1050,63 +1284,83 @@ void TraceLog::AddTraceEventWithThreadIdAndTimestamp(
                num_args, arg_names, arg_types, arg_values, flags);
 #endif
 
-  TimeTicks now = timestamp - time_offset_;
-  EventCallback event_callback_copy;
+  // Checked without the lock, as the TRACE_EVENT macros do.
+  if (*category_enabled != CATEGORY_ENABLED)
+    return;
 
+  TimeTicks now = timestamp - time_offset_;
   NotificationHelper notifier(this);
+  ThreadLocalEventBuffer* thread_local_event_buffer =
+      GetThreadLocalEventBuffer();
+
+  const char* new_name = ThreadIdNameManager::GetInstance()->
+      GetName(thread_id);
+  // Check if the thread name has been set or changed since the previous
+  // call (if any), but don't bother if the new name is empty. Note this will
+  // not detect a thread name change within the same char* buffer address: we
+  // favor common case performance over corner case correctness.
+  if (new_name != thread_local_event_buffer->thread_name() &&
+      new_name && *new_name) {
+    thread_local_event_buffer->set_thread_name(new_name);
 
-  {
     AutoLock lock(lock_);
-    if (*category_enabled != CATEGORY_ENABLED)
-      return;
-    if (logged_events_->IsFull())
-      return;
-
-    const char* new_name = ThreadIdNameManager::GetInstance()->
-        GetName(thread_id);
-    // Check if the thread name has been set or changed since the previous
-    // call (if any), but don't bother if the new name is empty. Note this will
-    // not detect a thread name change within the same char* buffer address: we
-    // favor common case performance over corner case correctness.
-    if (new_name != g_current_thread_name.Get().Get() &&
-        new_name && *new_name) {
-      g_current_thread_name.Get().Set(new_name);
-
-      hash_map<int, std::string>::iterator existing_name =
-          thread_names_.find(thread_id);
-      if (existing_name == thread_names_.end()) {
-        // This is a new thread id, and a new name.
-        thread_names_[thread_id] = new_name;
-      } else {
-        // This is a thread id that we've seen before, but potentially with a
-        // new name.
-        std::vector<StringPiece> existing_names;
-        Tokenize(existing_name->second, ",", &existing_names);
-        bool found = std::find(existing_names.begin(),
-                               existing_names.end(),
-                               new_name) != existing_names.end();
-        if (!found) {
-          existing_name->second.push_back(',');
-          existing_name->second.append(new_name);
-        }
+    hash_map<int, std::string>::iterator existing_name =
+        thread_names_.find(thread_id);
+    if (existing_name == thread_names_.end()) {
+      // This is a new thread id, and a new name.
+      thread_names_[thread_id] = new_name;
+    } else {
+      // This is a thread id that we've seen before, but potentially with a
+      // new name.
+      std::vector<StringPiece> existing_names;
+      Tokenize(existing_name->second, ",", &existing_names);
+      bool found = std::find(existing_names.begin(),
+                             existing_names.end(),
+                             new_name) != existing_names.end();
+      if (!found) {
+        existing_name->second.push_back(',');
+        existing_name->second.append(new_name);
       }
     }
+  }
 
-    logged_events_->AddEvent(TraceEvent(thread_id,
-        now, phase, category_enabled, name, id,
-        num_args, arg_names, arg_types, arg_values,
-        flags));
+  bool dropped = false;
+  TraceEvent* trace_event =
+      thread_local_event_buffer->BeginAddEvent(&notifier);
+  if (trace_event) {
+    trace_event->Initialize(thread_id, now, phase, category_enabled, name, id,
+                            num_args, arg_names, arg_types, arg_values, flags);
+    thread_local_event_buffer->EndAddEvent();
+  } else {
+    AutoLock lock(lock_);
+    if (logged_events_->IsFull()) {
+      dropped = true;
+    } else {
+      logged_events_->AddEvent(TraceEvent(thread_id,
+          now, phase, category_enabled, name, id,
+          num_args, arg_names, arg_types, arg_values,
+          flags));
 
-    if (logged_events_->IsFull())
-      notifier.AddNotificationWhileLocked(TRACE_BUFFER_FULL);
+      if (logged_events_->IsFull())
+        notifier.AddNotificationWhileLocked(TRACE_BUFFER_FULL);
+    }
+  }  // release lock
 
-    if (watch_category_ == category_enabled && watch_event_name_ == name)
-      notifier.AddNotificationWhileLocked(EVENT_WATCH_NOTIFICATION);
+  if (dropped) {
+    notifier.SendNotificationIfAny();
+    return;
+  }
 
-    event_callback_copy = event_callback_;
-  }  // release lock
+  if (reinterpret_cast<const unsigned char*>(
+          subtle::NoBarrier_Load(&watch_category_)) == category_enabled) {
+    AutoLock lock(lock_);
+    if (watch_event_name_ == name)
+      notifier.AddNotificationWhileLocked(EVENT_WATCH_NOTIFICATION);
+  }
 
   notifier.SendNotificationIfAny();
+  EventCallback event_callback_copy = reinterpret_cast<EventCallback>(
+      subtle::NoBarrier_Load(&event_callback_));
   if (event_callback_copy != NULL) {
     event_callback_copy(phase, category_enabled, name, id,
         num_args, arg_names, arg_types, arg_values,
@@ -1143,11 +1397,13 @@ void TraceLog::SetWatchEvent(const std::string& category_name,
   size_t notify_count = 0;
   {
     AutoLock lock(lock_);
-    watch_category_ = category;
+    subtle::NoBarrier_Store(&watch_category_,
+                            reinterpret_cast<subtle::AtomicWord>(category));
     watch_event_name_ = event_name;
 
     // First, search existing events for watch event because we want to catch
     // it even if it has already occurred.
+    FlushThreadLocalEventBuffersWhileLocked();
     notify_count = logged_events_->CountEnabledByName(category, event_name);
   }  // release lock
 
@@ -1163,7 +1419,7 @@ void TraceLog::SetWatchEvent(const std::string& category_name,
 
 void TraceLog::CancelWatchEvent() {
   AutoLock lock(lock_);
-  watch_category_ = NULL;
+  subtle::NoBarrier_Store(&watch_category_, 0);
   watch_event_name_ = "";
 }
 
@@ -1188,6 +1444,24 @@ void TraceLog::AddThreadNameMetadataEvents() {
   }
 }
 
+TraceLog::ThreadLocalEventBuffer* TraceLog::GetThreadLocalEventBuffer() {
+  ThreadLocalEventBuffer* thread_local_event_buffer =
+      static_cast<ThreadLocalEventBuffer*>(thread_local_event_buffer_.Get());
+  if (!thread_local_event_buffer) {
+    thread_local_event_buffer = new ThreadLocalEventBuffer(this);
+    thread_local_event_buffer_.Set(thread_local_event_buffer);
+    AutoLock lock(lock_);
+    thread_local_event_buffers_.push_back(thread_local_event_buffer);
+  }
+  return thread_local_event_buffer;
+}
+
+void TraceLog::FlushThreadLocalEventBuffersWhileLocked() {
+  lock_.AssertAcquired();
+  for (size_t i = 0; i < thread_local_event_buffers_.size(); ++i)
+    thread_local_event_buffers_[i]->FlushWhileLocked();
+}
+
 void TraceLog::InstallWaitableEventForSamplingTesting(
     WaitableEvent* waitable_event) {
   sampling_thread_->InstallWaitableEventForSamplingTesting(waitable_event);
@@ -1201,6 +1475,18 @@ void TraceLog::Resurrect() {
   StaticMemorySingletonTraits<TraceLog>::Resurrect();
 }
 
+size_t TraceLog::GetEventsSize() {
+  AutoLock lock(lock_);
+  FlushThreadLocalEventBuffersWhileLocked();
+  return logged_events_->Size();
+}
+
+const TraceEvent& TraceLog::GetEventAt(size_t index) {
+  AutoLock lock(lock_);
+  FlushThreadLocalEventBuffersWhileLocked();
+  return logged_events_->GetEventAt(index);
+}
+
 void TraceLog::SetProcessID(int process_id) {
   process_id_ = process_id;
   // Create a FNV hash from the process ID for XORing.
@@ -9,15 +9,18 @@
 #include <string>
 #include <vector>
 
+#include "base/atomicops.h"
 #include "base/callback.h"
 #include "base/hash_tables.h"
 #include "base/memory/ref_counted_memory.h"
 #include "base/memory/scoped_vector.h"
 #include "base/observer_list.h"
+#include "base/platform_file.h"
 #include "base/string_util.h"
 #include "base/synchronization/condition_variable.h"
 #include "base/synchronization/lock.h"
 #include "base/threading/thread.h"
+#include "base/threading/thread_local_storage.h"
 #include "base/timer.h"
 
 // Older style trace macros with explicit id and extra data
@@ -46,6 +49,8 @@ class WaitableEvent;
 
 namespace debug {
 
+class TraceBinaryWriter;
+
 const int kTraceMaxNumArgs = 2;
 
 // Output records are "Events" and can be obtained via the
@@ -77,18 +82,45 @@ class BASE_EXPORT TraceEvent {
              unsigned char flags);
   ~TraceEvent();
 
+  // Sets every field as the constructor above does. Events are filled in
+  // place in a TraceBufferChunk, and again each time the chunk is reused.
+  void Initialize(int thread_id,
+                  TimeTicks timestamp,
+                  char phase,
+                  const unsigned char* category_enabled,
+                  const char* name,
+                  unsigned long long id,
+                  int num_args,
+                  const char** arg_names,
+                  const unsigned char* arg_types,
+                  const unsigned long long* arg_values,
+                  unsigned char flags);
+
   // Serialize event data to JSON
   static void AppendEventsAsJSON(const std::vector<TraceEvent>& events,
                                  size_t start,
                                  size_t count,
                                  std::string* out);
   void AppendAsJSON(std::string* out) const;
+  // As above, for an event read back from a file, which has no
+  // |category_enabled| and may come from another process.
+  void AppendAsJSON(const char* category_name,
+                    int process_id,
+                    std::string* out) const;
 
   static void AppendValueAsJSON(unsigned char type,
                                 TraceValue value,
                                 std::string* out);
 
   TimeTicks timestamp() const { return timestamp_; }
+  int thread_id() const { return thread_id_; }
+  char phase() const { return phase_; }
+  unsigned char flags() const { return flags_; }
+  unsigned long long id() const { return id_; }
+  // Arguments past the last one have a NULL name.
+  const char* arg_name(int index) const { return arg_names_[index]; }
+  unsigned char arg_type(int index) const { return arg_types_[index]; }
+  TraceValue arg_value(int index) const { return arg_values_[index]; }
 
   // Exposed for unittesting:
 
@@ -115,11 +147,44 @@ class BASE_EXPORT TraceEvent {
   unsigned char arg_types_[kTraceMaxNumArgs];
 };
 
-// TraceBuffer holds the events as they are collected.
+// A run of events that one thread fills without taking the TraceLog lock.
+// When it is full the thread hands it to the TraceBuffer for an empty one.
+class BASE_EXPORT TraceBufferChunk {
+ public:
+  static const size_t kTraceBufferChunkSize = 64;
+
+  TraceBufferChunk();
+  ~TraceBufferChunk();
+
+  // Forgets the events so that the chunk can be filled again.
+  void Reset() { next_free_ = 0; }
+
+  // Returns the next unused event, to be filled in with Initialize(). Must
+  // not be called when the chunk is full.
+  TraceEvent* AddTraceEvent();
+
+  bool IsFull() const { return next_free_ == kTraceBufferChunkSize; }
+  size_t size() const { return next_free_; }
+  const TraceEvent& GetEventAt(size_t index) const;
+
+ private:
+  size_t next_free_;
+  TraceEvent chunk_[kTraceBufferChunkSize];
+
+  DISALLOW_COPY_AND_ASSIGN(TraceBufferChunk);
+};
+
+// TraceBuffer holds the events as they are collected, in chunks.
 class BASE_EXPORT TraceBuffer {
  public:
   virtual ~TraceBuffer() {}
 
+  // Returns an empty chunk for a thread to fill, or NULL if the buffer is
+  // full and keeps its oldest events.
+  virtual scoped_ptr<TraceBufferChunk> GetChunk() = 0;
+  // Takes back a chunk, from GetChunk() or not, with its events.
+  virtual void ReturnChunk(scoped_ptr<TraceBufferChunk> chunk) = 0;
+
   virtual void AddEvent(const TraceEvent& event) = 0;
   virtual bool HasMoreEvents() const = 0;
   virtual const TraceEvent& NextEvent() = 0;
@@ -193,7 +258,8 @@ class BASE_EXPORT TraceLog {
     RECORD_UNTIL_FULL = 1 << 0,
 
     // Record until the user ends the trace. The trace buffer is a fixed size
-    // and we use it as a ring buffer during recording.
+    // and we use it as a ring buffer during recording, overwriting the oldest
+    // chunk of events once it is full.
     RECORD_CONTINUOUSLY = 1 << 1,
 
     // Enable the sampling profiler.
@@ -303,6 +369,13 @@ class BASE_EXPORT TraceLog {
       OutputCallback;
   void Flush(const OutputCallback& cb);
 
+  // Writes events to |file| in the format of trace_event_binary.h as they are
+  // recorded, instead of keeping them for Flush(), which then only hands what
+  // is still buffered to the file thread. Pass kInvalidPlatformFileValue to go
+  // back to keeping them in memory; |file| is complete, and must stay open,
+  // until then. Must be called while tracing is disabled.
+  void SetBinaryOutputFile(PlatformFile file);
+
   // Called by TRACE_EVENT* macros, don't call this directly.
   static const unsigned char* GetCategoryEnabled(const char* name);
   static const char* GetCategoryName(const unsigned char* category_enabled);
@@ -362,11 +435,10 @@ class BASE_EXPORT TraceLog {
   // Allows resurrecting our singleton instance post-AtExit processing.
   static void Resurrect();
 
-  // Allow tests to inspect TraceEvents.
-  size_t GetEventsSize() const { return logged_events_->Size(); }
-  const TraceEvent& GetEventAt(size_t index) const {
-    return logged_events_->GetEventAt(index);
-  }
+  // Allow tests to inspect TraceEvents. These first move the events each
+  // thread is holding into the trace buffer.
+  size_t GetEventsSize();
+  const TraceEvent& GetEventAt(size_t index);
 
   void SetProcessID(int process_id);
 
@@ -413,6 +485,9 @@ class BASE_EXPORT TraceLog {
     int notification_;
   };
 
+  // The chunk of events a thread is filling. Defined in the .cc file.
+  class ThreadLocalEventBuffer;
+
   TraceLog();
   ~TraceLog();
   const unsigned char* GetCategoryEnabledInternal(const char* name);
@@ -433,14 +508,22 @@ class BASE_EXPORT TraceLog {
 
   TraceBuffer* GetTraceBuffer();
 
-  // TODO(nduca): switch to per-thread trace buffers to reduce thread
-  // synchronization.
-  // This lock protects TraceLog member accesses from arbitrary threads.
+  // Returns the calling thread's buffer, creating it if need be.
+  ThreadLocalEventBuffer* GetThreadLocalEventBuffer();
+  // Moves the events held by every thread into |logged_events_|.
+  void FlushThreadLocalEventBuffersWhileLocked();
+
+  // This lock protects TraceLog member accesses from arbitrary threads. Events
+  // are added without it, to the calling thread's ThreadLocalEventBuffer; it
+  // is only taken when that thread swaps its chunk.
   Lock lock_;
   int enable_count_;
   NotificationCallback notification_callback_;
   scoped_ptr<TraceBuffer> logged_events_;
-  EventCallback event_callback_;
+  // Set while events are written to a file; see SetBinaryOutputFile().
+  scoped_ptr<TraceBinaryWriter> binary_writer_;
+  // An EventCallback, read without |lock_| for each event.
+  subtle::AtomicWord event_callback_;
   std::vector<std::string> included_categories_;
   std::vector<std::string> excluded_categories_;
   bool dispatching_to_observer_list_;
@@ -455,8 +538,9 @@ class BASE_EXPORT TraceLog {
 
   TimeDelta time_offset_;
 
-  // Allow tests to wake up when certain events occur.
-  const unsigned char* watch_category_;
+  // Allow tests to wake up when certain events occur. |watch_category_| is a
+  // const unsigned char*, read without |lock_| for each event.
+  subtle::AtomicWord watch_category_;
   std::string watch_event_name_;
 
   Options trace_options_;
@@ -465,6 +549,11 @@ class BASE_EXPORT TraceLog {
   scoped_ptr<TraceSamplingThread> sampling_thread_;
   PlatformThreadHandle sampling_thread_handle_;
 
+  // Each thread's ThreadLocalEventBuffer, all of which are also kept in
+  // |thread_local_event_buffers_| so that they can be flushed.
+  ThreadLocalStorage::Slot thread_local_event_buffer_;
+  std::vector<ThreadLocalEventBuffer*> thread_local_event_buffers_;
+
   DISALLOW_COPY_AND_ASSIGN(TraceLog);
 };
 
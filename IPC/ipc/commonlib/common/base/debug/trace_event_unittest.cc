@@ -55,6 +55,8 @@ class TraceEventTestFixture : public testing::Test {
   void OnTraceNotification(int notification) {
     if (notification & TraceLog::EVENT_WATCH_NOTIFICATION)
       ++event_watch_notification_;
+    if (notification & TraceLog::TRACE_BUFFER_FULL)
+      ++buffer_full_notification_;
   }
   DictionaryValue* FindMatchingTraceEntry(const JsonKeyValue* key_values);
   DictionaryValue* FindNamePhase(const char* name, const char* phase);
@@ -73,6 +75,7 @@ class TraceEventTestFixture : public testing::Test {
 
   void BeginTrace() {
     event_watch_notification_ = 0;
+    buffer_full_notification_ = 0;
     TraceLog::GetInstance()->SetEnabled(std::string("*"),
                                         TraceLog::RECORD_UNTIL_FULL);
   }
@@ -102,6 +105,7 @@ class TraceEventTestFixture : public testing::Test {
   base::debug::TraceResultBuffer trace_buffer_;
   base::debug::TraceResultBuffer::SimpleOutput json_output_;
   int event_watch_notification_;
+  int buffer_full_notification_;
 
  private:
   // We want our singleton torn down after each test.
@@ -1640,7 +1644,94 @@ TEST_F(TraceEventCallbackTest, TraceEventCallback) {
   EXPECT_EQ("event2", collected_events_[1]);
 }
 
-// TODO(dsinclair): Continuous Tracing unit test.
+// Test that a full buffer keeps its oldest events, unless recording
+// continuously, when it keeps the newest.
+TEST_F(TraceEventTestFixture, RecordContinuously) {
+  ManualTestSetUp();
+  TraceLog* trace_log = TraceLog::GetInstance();
+
+  BeginTrace();
+  TRACE_EVENT_INSTANT0("all", "first", TRACE_EVENT_SCOPE_THREAD);
+  while (!buffer_full_notification_)
+    TRACE_EVENT_INSTANT0("all", "fill", TRACE_EVENT_SCOPE_THREAD);
+  size_t capacity = trace_log->GetEventsSize();
+  TRACE_EVENT_INSTANT0("all", "dropped", TRACE_EVENT_SCOPE_THREAD);
+  EXPECT_EQ(capacity, trace_log->GetEventsSize());
+  EXPECT_STREQ("first", trace_log->GetEventAt(0).name());
+  EXPECT_STREQ("fill", trace_log->GetEventAt(capacity - 1).name());
+  trace_log->SetDisabled();
+
+  buffer_full_notification_ = 0;
+  trace_log->SetEnabled(std::string("*"), TraceLog::RECORD_CONTINUOUSLY);
+  TRACE_EVENT_INSTANT0("all", "first", TRACE_EVENT_SCOPE_THREAD);
+  for (size_t i = 0; i < 2 * capacity; ++i)
+    TRACE_EVENT_INSTANT0("all", "fill", TRACE_EVENT_SCOPE_THREAD);
+  TRACE_EVENT_INSTANT0("all", "last", TRACE_EVENT_SCOPE_THREAD);
+  size_t size = trace_log->GetEventsSize();
+  EXPECT_LE(size, capacity + TraceBufferChunk::kTraceBufferChunkSize);
+  EXPECT_GE(size, capacity - TraceBufferChunk::kTraceBufferChunkSize);
+  EXPECT_STREQ("fill", trace_log->GetEventAt(0).name());
+  EXPECT_STREQ("last", trace_log->GetEventAt(size - 1).name());
+  EXPECT_EQ(0, buffer_full_notification_);
+  trace_log->SetDisabled();
+}
+
+static void TraceConcurrentEvents(int num_events,
+                                  WaitableEvent* task_complete_event) {
+  for (int i = 0; i < num_events; ++i)
+    TRACE_EVENT_INSTANT0("all", "concurrent", TRACE_EVENT_SCOPE_THREAD);
+  task_complete_event->Signal();
+}
+
+static void CountConcurrentEvents(
+    int* count,
+    const scoped_refptr<RefCountedString>& events_str) {
+  const std::string kName("\"name\":\"concurrent\"");
+  const std::string& data = events_str->data();
+  for (size_t pos = data.find(kName); pos != std::string::npos;
+       pos = data.find(kName, pos + kName.size())) {
+    ++*count;
+  }
+}
+
+// Test that flushing while other threads add events loses none of them.
+TEST_F(TraceEventTestFixture, FlushWhileThreadsTrace) {
+  ManualTestSetUp();
+  BeginTrace();
+
+  const int num_threads = 4;
+  const int num_events = 20000;
+  Thread* threads[num_threads];
+  WaitableEvent* task_complete_events[num_threads];
+  for (int i = 0; i < num_threads; i++) {
+    threads[i] = new Thread(StringPrintf("Thread %d", i).c_str());
+    task_complete_events[i] = new WaitableEvent(false, false);
+    threads[i]->Start();
+    threads[i]->message_loop()->PostTask(
+        FROM_HERE, base::Bind(&TraceConcurrentEvents,
+                              num_events, task_complete_events[i]));
+  }
+
+  int flushed_events = 0;
+  for (int i = 0; i < num_threads; i++) {
+    while (!task_complete_events[i]->IsSignaled()) {
+      TraceLog::GetInstance()->Flush(
+          base::Bind(&CountConcurrentEvents, &flushed_events));
+    }
+  }
+
+  // The events left in each thread's chunk are flushed as the thread exits.
+  for (int i = 0; i < num_threads; i++) {
+    threads[i]->Stop();
+    delete threads[i];
+    delete task_complete_events[i];
+  }
+  TraceLog::GetInstance()->SetDisabled();
+  TraceLog::GetInstance()->Flush(
+      base::Bind(&CountConcurrentEvents, &flushed_events));
+
+  EXPECT_EQ(num_threads * num_events, flushed_events);
+}
 
 }  // namespace debug
 }  // namespace base
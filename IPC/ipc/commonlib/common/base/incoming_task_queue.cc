@@ -0,0 +1,154 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/incoming_task_queue.h"
+
+#include "base/logging.h"
+#include "base/memory/ref_counted.h"
+#include "base/message_pump.h"
+
+// The list is Dmitry Vyukov's intrusive multi-producer single-consumer queue.
+// A producer swaps its node in as the new tail and then links the previous
+// tail to it. Between the two steps the list is cut short at the previous
+// tail; the consumer treats that as the end of the list for the time being,
+// and |pending_count_| tells it that more is coming.
+
+namespace base {
+
+IncomingTaskQueue::Node::Node(const PendingTask& pending_task)
+    : pending_task(pending_task) {
+  next = 0;
+}
+
+IncomingTaskQueue::IncomingTaskQueue()
+    : pending_count_(0),
+      next_sequence_num_(0),
+      tail_(reinterpret_cast<subtle::AtomicWord>(&stub_)),
+      head_(&stub_) {
+  stub_.next = 0;
+}
+
+IncomingTaskQueue::~IncomingTaskQueue() {
+  while (Node* node = Pop())
+    delete node;
+  DCHECK_EQ(reinterpret_cast<subtle::AtomicWord>(head_),
+            subtle::NoBarrier_Load(&tail_));
+}
+
+int IncomingTaskQueue::GetNextSequenceNum() {
+  return GetNextSequenceNums(1);
+}
+
+int IncomingTaskQueue::GetNextSequenceNums(int count) {
+  DCHECK_GT(count, 0);
+  return subtle::NoBarrier_AtomicIncrement(&next_sequence_num_, count) - count;
+}
+
+void IncomingTaskQueue::AddTask(const PendingTask& pending_task,
+                                MessagePump* pump) {
+  Node* node = new Node(pending_task);
+
+  scoped_refptr<MessagePump> pump_to_wake;
+  if (subtle::Barrier_AtomicIncrement(&pending_count_, 1) == 1)
+    pump_to_wake = pump;
+
+  Push(node);
+
+  if (pump_to_wake)
+    pump_to_wake->ScheduleWork();
+}
+
+void IncomingTaskQueue::AddTasks(const std::vector<PendingTask>& pending_tasks,
+                                 MessagePump* pump) {
+  if (pending_tasks.empty())
+    return;
+
+  // Link the nodes up among themselves before anyone can see them.
+  Node* first = new Node(pending_tasks[0]);
+  Node* last = first;
+  for (size_t i = 1; i < pending_tasks.size(); ++i) {
+    Node* node = new Node(pending_tasks[i]);
+    last->next = reinterpret_cast<subtle::AtomicWord>(node);
+    last = node;
+  }
+
+  scoped_refptr<MessagePump> pump_to_wake;
+  subtle::Atomic32 count = static_cast<subtle::Atomic32>(pending_tasks.size());
+  if (subtle::Barrier_AtomicIncrement(&pending_count_, count) == count)
+    pump_to_wake = pump;
+
+  PushChain(first, last);
+
+  if (pump_to_wake)
+    pump_to_wake->ScheduleWork();
+}
+
+bool IncomingTaskQueue::TakeTasks(TaskQueue* work_queue) {
+  subtle::Atomic32 count = subtle::Acquire_Load(&pending_count_);
+  if (!count)
+    return true;
+
+  subtle::Atomic32 taken = 0;
+  while (taken < count) {
+    Node* node = Pop();
+    if (!node)
+      break;
+    work_queue->push(node->pending_task);
+    delete node;
+    ++taken;
+  }
+  subtle::Barrier_AtomicIncrement(&pending_count_, -taken);
+  return taken == count;
+}
+
+bool IncomingTaskQueue::IsEmpty() const {
+  return !subtle::Acquire_Load(&pending_count_);
+}
+
+void IncomingTaskQueue::Push(Link* link) {
+  PushChain(link, link);
+}
+
+void IncomingTaskQueue::PushChain(Link* first, Link* last) {
+  // Publish the chain, and its payload, before another producer can link to
+  // it.
+  subtle::MemoryBarrier();
+  Link* prev = reinterpret_cast<Link*>(subtle::NoBarrier_AtomicExchange(
+      &tail_, reinterpret_cast<subtle::AtomicWord>(last)));
+  subtle::Release_Store(&prev->next,
+                        reinterpret_cast<subtle::AtomicWord>(first));
+}
+
+IncomingTaskQueue::Node* IncomingTaskQueue::Pop() {
+  Link* head = head_;
+  Link* next = reinterpret_cast<Link*>(subtle::Acquire_Load(&head->next));
+  if (head == &stub_) {
+    if (!next)
+      return NULL;
+    head_ = next;
+    head = next;
+    next = reinterpret_cast<Link*>(subtle::Acquire_Load(&next->next));
+  }
+  if (next) {
+    head_ = next;
+    return static_cast<Node*>(head);
+  }
+
+  // |head| is the last node linked in. It can only be taken once something
+  // follows it, so put the stub behind it unless a producer is busy doing
+  // the same with its own node.
+  Link* tail = reinterpret_cast<Link*>(subtle::Acquire_Load(&tail_));
+  if (tail != head)
+    return NULL;
+  stub_.next = 0;
+  Push(&stub_);
+  next = reinterpret_cast<Link*>(subtle::Acquire_Load(&head->next));
+  if (next) {
+    head_ = next;
+    return static_cast<Node*>(head);
+  }
+  return NULL;
+}
+
+}  // namespace base
@@ -0,0 +1,113 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_INCOMING_TASK_QUEUE_H_
+#define BASE_INCOMING_TASK_QUEUE_H_
+
+#include <vector>
+
+#include "base/atomicops.h"
+#include "base/base_export.h"
+#include "base/basictypes.h"
+#include "base/pending_task.h"
+
+namespace base {
+
+class MessagePump;
+
+// The queue of tasks posted to a MessageLoop from any thread, before the
+// loop's thread sorts them into its work queues.
+//
+// Any number of threads may add tasks without taking a lock; only the loop's
+// thread takes them. Each task is kept in a node that holds the link to the
+// next one, so adding a task is one allocation, one atomic increment and one
+// atomic exchange. Tasks are taken in the order in which they were linked in,
+// which is the order in which they were added for tasks added on one thread.
+class BASE_EXPORT IncomingTaskQueue {
+ public:
+  IncomingTaskQueue();
+
+  // Deletes the tasks that were not taken.
+  ~IncomingTaskQueue();
+
+  // Returns the sequence number for the next task, see
+  // PendingTask::sequence_num. May be called on any thread.
+  int GetNextSequenceNum();
+
+  // Like GetNextSequenceNum(), but reserves |count| consecutive numbers and
+  // returns the first one.
+  int GetNextSequenceNums(int count);
+
+  // Adds a copy of |pending_task| and calls pump->ScheduleWork() if the queue
+  // was empty, i.e. if the consumer may be waiting for work. May be called on
+  // any thread.
+  //
+  // The consumer may run the task, and destroy this queue, as soon as the
+  // task is linked in. Nothing but |pump| is touched after that, and |pump|
+  // is kept alive for the ScheduleWork() call.
+  void AddTask(const PendingTask& pending_task, MessagePump* pump);
+
+  // Like AddTask() for each of |pending_tasks| in turn, but they are linked
+  // in at once: no other task lands between them, and |pump| is woken up at
+  // most once.
+  void AddTasks(const std::vector<PendingTask>& pending_tasks,
+                MessagePump* pump);
+
+  // Moves all the tasks that can be taken to the back of |work_queue|.
+  // Returns false if a task was added but is still being linked in by
+  // another thread. The caller must then come back for it, as the producer
+  // won't call ScheduleWork() again. Must be called on the consumer thread.
+  bool TakeTasks(TaskQueue* work_queue);
+
+  // Returns true if no task has been added since the last TakeTasks(). The
+  // result is stale as soon as it's returned unless producers are quiet.
+  bool IsEmpty() const;
+
+ private:
+  struct Link {
+    // Set once, by the producer of the next node.
+    volatile subtle::AtomicWord next;
+  };
+
+  struct Node : public Link {
+    explicit Node(const PendingTask& pending_task);
+
+    PendingTask pending_task;
+  };
+
+  // Links |link| in after the current tail.
+  void Push(Link* link);
+
+  // Links the chain from |first| to |last| in after the current tail. The
+  // chain must already be linked up and end at |last|.
+  void PushChain(Link* first, Link* last);
+
+  // Returns the oldest node, or NULL if there is none or if the oldest one is
+  // still being linked in.
+  Node* Pop();
+
+  // The number of tasks added and not yet taken. A producer increments it
+  // before linking its task in, so a non-zero count always means that the
+  // consumer has work coming, and the producer that makes it non-zero is the
+  // one that wakes the consumer up.
+  volatile subtle::Atomic32 pending_count_;
+
+  volatile subtle::Atomic32 next_sequence_num_;
+
+  // The node that the last producer linked in. Producers swap themselves in.
+  volatile subtle::AtomicWord tail_;
+
+  // The oldest link. Only touched by the consumer.
+  Link* head_;
+
+  // Keeps the list non-empty so that producers never touch |head_|. It's
+  // re-linked at the tail when the consumer is about to take the last node.
+  Link stub_;
+
+  DISALLOW_COPY_AND_ASSIGN(IncomingTaskQueue);
+};
+
+}  // namespace base
+
+#endif  // BASE_INCOMING_TASK_QUEUE_H_
@@ -0,0 +1,286 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/incoming_task_queue.h"
+
+#include <vector>
+
+#include "base/bind.h"
+#include "base/memory/scoped_vector.h"
+#include "base/message_pump.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/threading/simple_thread.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+namespace {
+
+// Counts ScheduleWork() calls.
+class CountingPump : public MessagePump {
+ public:
+  CountingPump() : schedule_work_count_(0) {}
+
+  virtual void Run(Delegate* delegate) OVERRIDE {}
+  virtual void Quit() OVERRIDE {}
+  virtual void ScheduleWork() OVERRIDE {
+    subtle::NoBarrier_AtomicIncrement(&schedule_work_count_, 1);
+  }
+  virtual void ScheduleDelayedWork(
+      const TimeTicks& delayed_work_time) OVERRIDE {}
+
+  int schedule_work_count() const {
+    return subtle::NoBarrier_Load(&schedule_work_count_);
+  }
+
+ private:
+  virtual ~CountingPump() {}
+
+  volatile subtle::Atomic32 schedule_work_count_;
+};
+
+void Nop() {
+}
+
+void HoldData(const scoped_refptr<RefCountedData<int> >& data) {
+}
+
+PendingTask MakeTask(int sequence_num) {
+  PendingTask pending_task(FROM_HERE, Bind(&Nop));
+  pending_task.sequence_num = sequence_num;
+  return pending_task;
+}
+
+TEST(IncomingTaskQueueTest, SequenceNumbers) {
+  IncomingTaskQueue queue;
+  EXPECT_EQ(0, queue.GetNextSequenceNum());
+  EXPECT_EQ(1, queue.GetNextSequenceNum());
+  EXPECT_EQ(2, queue.GetNextSequenceNum());
+}
+
+TEST(IncomingTaskQueueTest, TakesTasksInOrder) {
+  scoped_refptr<CountingPump> pump(new CountingPump);
+  IncomingTaskQueue queue;
+  EXPECT_TRUE(queue.IsEmpty());
+
+  for (int i = 0; i < 10; ++i)
+    queue.AddTask(MakeTask(i), pump);
+  EXPECT_FALSE(queue.IsEmpty());
+
+  TaskQueue work_queue;
+  EXPECT_TRUE(queue.TakeTasks(&work_queue));
+  EXPECT_TRUE(queue.IsEmpty());
+  ASSERT_EQ(10u, work_queue.size());
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(i, work_queue.front().sequence_num);
+    work_queue.pop();
+  }
+
+  // The queue can be taken empty and refilled.
+  EXPECT_TRUE(queue.TakeTasks(&work_queue));
+  EXPECT_TRUE(work_queue.empty());
+  queue.AddTask(MakeTask(10), pump);
+  EXPECT_TRUE(queue.TakeTasks(&work_queue));
+  ASSERT_EQ(1u, work_queue.size());
+  EXPECT_EQ(10, work_queue.front().sequence_num);
+}
+
+TEST(IncomingTaskQueueTest, SchedulesWorkWhenNoLongerEmpty) {
+  scoped_refptr<CountingPump> pump(new CountingPump);
+  IncomingTaskQueue queue;
+
+  queue.AddTask(MakeTask(0), pump);
+  EXPECT_EQ(1, pump->schedule_work_count());
+  queue.AddTask(MakeTask(1), pump);
+  queue.AddTask(MakeTask(2), pump);
+  EXPECT_EQ(1, pump->schedule_work_count());
+
+  TaskQueue work_queue;
+  EXPECT_TRUE(queue.TakeTasks(&work_queue));
+  queue.AddTask(MakeTask(3), pump);
+  EXPECT_EQ(2, pump->schedule_work_count());
+}
+
+TEST(IncomingTaskQueueTest, AddsBatches) {
+  scoped_refptr<CountingPump> pump(new CountingPump);
+  IncomingTaskQueue queue;
+
+  // One wakeup for the batch that makes the queue non-empty, none for the
+  // ones after it.
+  std::vector<PendingTask> batch;
+  for (int i = 0; i < 5; ++i)
+    batch.push_back(MakeTask(i));
+  queue.AddTasks(batch, pump);
+  EXPECT_EQ(1, pump->schedule_work_count());
+  queue.AddTask(MakeTask(5), pump);
+  batch.clear();
+  for (int i = 6; i < 9; ++i)
+    batch.push_back(MakeTask(i));
+  queue.AddTasks(batch, pump);
+  queue.AddTasks(std::vector<PendingTask>(), pump);
+  EXPECT_EQ(1, pump->schedule_work_count());
+
+  TaskQueue work_queue;
+  EXPECT_TRUE(queue.TakeTasks(&work_queue));
+  EXPECT_TRUE(queue.IsEmpty());
+  ASSERT_EQ(9u, work_queue.size());
+  for (int i = 0; i < 9; ++i) {
+    EXPECT_EQ(i, work_queue.front().sequence_num);
+    work_queue.pop();
+  }
+}
+
+TEST(IncomingTaskQueueTest, DeletesTasksNotTaken) {
+  scoped_refptr<CountingPump> pump(new CountingPump);
+  scoped_refptr<RefCountedData<int> > data(new RefCountedData<int>);
+  {
+    IncomingTaskQueue queue;
+    queue.AddTask(
+        PendingTask(FROM_HERE, Bind(&HoldData, data)), pump);
+    EXPECT_FALSE(data->HasOneRef());
+  }
+  EXPECT_TRUE(data->HasOneRef());
+}
+
+// Adds |count| tasks numbered |first|, |first| + 1, ... once |start| is
+// signaled.
+class Producer : public DelegateSimpleThread::Delegate {
+ public:
+  Producer(IncomingTaskQueue* queue, MessagePump* pump, WaitableEvent* start,
+           int first, int count)
+      : queue_(queue), pump_(pump), start_(start), first_(first),
+        count_(count) {}
+
+  virtual void Run() OVERRIDE {
+    start_->Wait();
+    for (int i = 0; i < count_; ++i)
+      queue_->AddTask(MakeTask(first_ + i), pump_);
+  }
+
+ protected:
+  IncomingTaskQueue* queue_;
+  MessagePump* pump_;
+  WaitableEvent* start_;
+  int first_;
+  int count_;
+};
+
+// Like Producer, but adds its tasks in batches of |batch_size|.
+class BatchProducer : public Producer {
+ public:
+  BatchProducer(IncomingTaskQueue* queue, MessagePump* pump,
+                WaitableEvent* start, int first, int count, int batch_size)
+      : Producer(queue, pump, start, first, count), batch_size_(batch_size) {}
+
+  virtual void Run() OVERRIDE {
+    start_->Wait();
+    std::vector<PendingTask> batch;
+    for (int i = 0; i < count_; ++i) {
+      batch.push_back(MakeTask(first_ + i));
+      if (static_cast<int>(batch.size()) == batch_size_) {
+        queue_->AddTasks(batch, pump_);
+        batch.clear();
+      }
+    }
+    queue_->AddTasks(batch, pump_);
+  }
+
+ private:
+  int batch_size_;
+};
+
+TEST(IncomingTaskQueueTest, ManyProducers) {
+  const int kProducers = 8;
+  const int kTasksPerProducer = 10000;
+
+  scoped_refptr<CountingPump> pump(new CountingPump);
+  IncomingTaskQueue queue;
+  WaitableEvent start(true, false);
+  ScopedVector<Producer> producers;
+  ScopedVector<DelegateSimpleThread> threads;
+  for (int i = 0; i < kProducers; ++i) {
+    producers.push_back(new Producer(&queue, pump, &start,
+                                     i * kTasksPerProducer,
+                                     kTasksPerProducer));
+    threads.push_back(new DelegateSimpleThread(producers.back(),
+                                               "IncomingTaskQueueProducer"));
+    threads.back()->Start();
+  }
+  start.Signal();
+
+  // Take tasks while the producers are adding them. The tasks of each
+  // producer must come out in the order it added them.
+  std::vector<int> next(kProducers, 0);
+  int taken = 0;
+  TaskQueue work_queue;
+  while (taken < kProducers * kTasksPerProducer) {
+    queue.TakeTasks(&work_queue);
+    while (!work_queue.empty()) {
+      int sequence_num = work_queue.front().sequence_num;
+      work_queue.pop();
+      int producer = sequence_num / kTasksPerProducer;
+      EXPECT_EQ(producer * kTasksPerProducer + next[producer], sequence_num);
+      ++next[producer];
+      ++taken;
+    }
+  }
+
+  for (int i = 0; i < kProducers; ++i)
+    threads[i]->Join();
+  EXPECT_TRUE(queue.TakeTasks(&work_queue));
+  EXPECT_TRUE(work_queue.empty());
+  EXPECT_TRUE(queue.IsEmpty());
+  EXPECT_GE(pump->schedule_work_count(), 1);
+}
+
+TEST(IncomingTaskQueueTest, ManyBatchProducers) {
+  const int kProducers = 8;
+  const int kTasksPerProducer = 10000;
+  const int kBatchSize = 16;
+
+  scoped_refptr<CountingPump> pump(new CountingPump);
+  IncomingTaskQueue queue;
+  WaitableEvent start(true, false);
+  ScopedVector<BatchProducer> producers;
+  ScopedVector<DelegateSimpleThread> threads;
+  for (int i = 0; i < kProducers; ++i) {
+    producers.push_back(new BatchProducer(&queue, pump, &start,
+                                          i * kTasksPerProducer,
+                                          kTasksPerProducer, kBatchSize));
+    threads.push_back(new DelegateSimpleThread(producers.back(),
+                                               "IncomingTaskQueueProducer"));
+    threads.back()->Start();
+  }
+  start.Signal();
+
+  // Each batch must come out whole, in order, and in the order of the other
+  // batches of its producer.
+  std::vector<int> next(kProducers, 0);
+  int taken = 0;
+  int current_producer = -1;
+  TaskQueue work_queue;
+  while (taken < kProducers * kTasksPerProducer) {
+    queue.TakeTasks(&work_queue);
+    while (!work_queue.empty()) {
+      int sequence_num = work_queue.front().sequence_num;
+      work_queue.pop();
+      int producer = sequence_num / kTasksPerProducer;
+      EXPECT_EQ(producer * kTasksPerProducer + next[producer], sequence_num);
+      if (next[producer] % kBatchSize != 0) {
+        EXPECT_EQ(current_producer, producer);
+      }
+      current_producer = producer;
+      ++next[producer];
+      ++taken;
+    }
+  }
+
+  for (int i = 0; i < kProducers; ++i)
+    threads[i]->Join();
+  EXPECT_TRUE(queue.TakeTasks(&work_queue));
+  EXPECT_TRUE(work_queue.empty());
+  EXPECT_TRUE(queue.IsEmpty());
+}
+
+}  // namespace
+}  // namespace base
@@ -6,6 +6,7 @@
 
 #include <algorithm>
 
+#include "base/atomic_sequence_num.h"
 #include "base/bind.h"
 #include "base/compiler_specific.h"
 #include "base/debug/alias.h"
@@ -50,6 +51,9 @@ namespace {
 base::LazyInstance<base::ThreadLocalPointer<MessageLoop> > lazy_tls_ptr =
     LAZY_INSTANCE_INITIALIZER;
 
+// Hands out MessageLoop::id().
+base::StaticAtomicSequenceNumber g_next_message_loop_id;
+
 // Logical events for Histogram profiling. Run with -message-loop-histogrammer
 // to get an accounting of messages and actions taken on each thread.
 const int kTaskRunEvent = 0x1;
@@ -138,14 +142,15 @@ MessageLoop::DestructionObserver::~DestructionObserver() {
 
 MessageLoop::MessageLoop(Type type)
     : type_(type),
+      id_(g_next_message_loop_id.GetNext() + 1),
       nestable_tasks_allowed_(true),
       exception_restoration_(false),
       message_histogram_(NULL),
-      run_loop_(NULL),
+      track_task_latency_(false),
 #if defined(OS_WIN)
       os_modal_loop_(false),
 #endif  // OS_WIN
-      next_sequence_num_(0) {
+      run_loop_(NULL) {
   DCHECK(!current()) << "should only have one message loop per thread";
   lazy_tls_ptr.Pointer()->Set(this);
 
@@ -308,6 +313,59 @@ void MessageLoop::PostNonNestableDelayedTask(
   AddToIncomingQueue(&pending_task);
 }
 
+void MessageLoop::PostTasks(
+    const tracked_objects::Location& from_here,
+    const std::vector<base::Closure>& tasks) {
+  if (tasks.empty())
+    return;
+
+  // The tasks get consecutive sequence numbers, as they would if posted one
+  // by one from this thread with nothing else posted meanwhile.
+  TimeTicks delayed_run_time = CalculateDelayedRuntime(TimeDelta());
+  int sequence_num =
+      incoming_task_queue_.GetNextSequenceNums(static_cast<int>(tasks.size()));
+  std::vector<PendingTask> pending_tasks;
+  pending_tasks.reserve(tasks.size());
+  for (size_t i = 0; i < tasks.size(); ++i) {
+    DCHECK(!tasks[i].is_null()) << from_here.ToString();
+    pending_tasks.push_back(
+        PendingTask(from_here, tasks[i], delayed_run_time, true));
+    pending_tasks.back().sequence_num = sequence_num++;
+    TRACE_EVENT_FLOW_BEGIN0("task", "MessageLoop::PostTask",
+        TRACE_ID_MANGLE(GetTaskTraceID(pending_tasks.back(), this)));
+  }
+
+  // As in AddToIncomingQueue(), |this| may be gone once the tasks are queued.
+  incoming_task_queue_.AddTasks(pending_tasks, pump_.get());
+}
+
+int MessageLoop::PostCancelableDelayedTask(
+    const tracked_objects::Location& from_here,
+    const base::Closure& task,
+    TimeDelta delay) {
+  DCHECK_EQ(this, current());
+  DCHECK(!task.is_null()) << from_here.ToString();
+  TimeTicks delayed_run_time = CalculateDelayedRuntime(delay);
+  if (delayed_run_time.is_null())
+    delayed_run_time = TimeTicks::Now();
+  PendingTask pending_task(from_here, task, delayed_run_time, true);
+  pending_task.sequence_num = incoming_task_queue_.GetNextSequenceNum();
+
+  TRACE_EVENT_FLOW_BEGIN0("task", "MessageLoop::PostTask",
+      TRACE_ID_MANGLE(GetTaskTraceID(pending_task, this)));
+
+  // We're on the loop's thread, so there's no need to go through the incoming
+  // queue; the pump only needs to hear about an earlier wakeup.
+  if (AddToDelayedWorkQueue(pending_task, true))
+    pump_->ScheduleDelayedWork(delayed_run_time);
+  return pending_task.sequence_num;
+}
+
+bool MessageLoop::CancelDelayedTask(int task_id) {
+  DCHECK_EQ(this, current());
+  return delayed_work_queue_.Cancel(task_id);
+}
+
 void MessageLoop::Run() {
   base::RunLoop run_loop;
   run_loop.Run();
@@ -367,6 +425,15 @@ bool MessageLoop::IsNested() {
   return run_loop_->run_depth_ > 1;
 }
 
+void MessageLoop::SetTaskLatencyTracking(bool enabled) {
+  DCHECK_EQ(this, current());
+  if (enabled && !track_task_latency_) {
+    task_latency_tracker_.set_name(
+        thread_name_.empty() ? "Unnamed" : thread_name_);
+  }
+  track_task_latency_ = enabled;
+}
+
 void MessageLoop::AddTaskObserver(TaskObserver* task_observer) {
   DCHECK_EQ(this, current());
   task_observers_.AddObserver(task_observer);
@@ -378,9 +445,9 @@ void MessageLoop::RemoveTaskObserver(TaskObserver* task_observer) {
 }
 
 void MessageLoop::AssertIdle() const {
-  // We only check |incoming_queue_|, since we don't want to lock |work_queue_|.
-  base::AutoLock lock(incoming_queue_lock_);
-  DCHECK(incoming_queue_.empty());
+  // We only check |incoming_task_queue_|, since |work_queue_| is only safe to
+  // access on this thread.
+  DCHECK(incoming_task_queue_.IsEmpty());
 }
 
 bool MessageLoop::is_running() const {
@@ -471,6 +538,12 @@ void MessageLoop::RunTask(const PendingTask& pending_task) {
   tracked_objects::TrackedTime start_time =
       tracked_objects::ThreadData::NowForStartOfRun(pending_task.birth_tally);
 
+  // The task may turn tracking on or off; it's recorded as it started.
+  bool track_task_latency = track_task_latency_;
+  TimeTicks latency_start_time;
+  if (track_task_latency)
+    latency_start_time = TimeTicks::Now();
+
   FOR_EACH_OBSERVER(TaskObserver, task_observers_,
                     WillProcessTask(pending_task));
   pending_task.task.Run();
@@ -480,6 +553,11 @@ void MessageLoop::RunTask(const PendingTask& pending_task) {
   tracked_objects::ThreadData::TallyRunOnNamedThreadIfTracking(pending_task,
       start_time, tracked_objects::ThreadData::NowForEndOfRun());
 
+  if (track_task_latency) {
+    task_latency_tracker_.RecordTask(pending_task, latency_start_time,
+                                     TimeTicks::Now());
+  }
+
   nestable_tasks_allowed_ = true;
 }
 
@@ -497,27 +575,30 @@ bool MessageLoop::DeferOrRunPendingTask(const PendingTask& pending_task) {
   return false;
 }
 
-void MessageLoop::AddToDelayedWorkQueue(const PendingTask& pending_task) {
+bool MessageLoop::AddToDelayedWorkQueue(const PendingTask& pending_task,
+                                        bool cancelable) {
+  // The wheel may only know a bound on its next run time, but the pump is
+  // never scheduled later than that bound, so it's enough to compare with it.
+  bool is_first = delayed_work_queue_.empty() ||
+      pending_task.delayed_run_time < delayed_work_queue_.GetNextRunTime();
+
   // Move to the delayed work queue.
-  delayed_work_queue_.push(pending_task);
+  delayed_work_queue_.Push(pending_task, cancelable);
+  return is_first;
 }
 
 void MessageLoop::ReloadWorkQueue() {
-  // We can improve performance of our loading tasks from incoming_queue_ to
-  // work_queue_ by waiting until the last minute (work_queue_ is empty) to
-  // load.  That reduces the number of locks-per-task significantly when our
-  // queues get large.
+  // We can improve performance of our loading tasks from incoming_task_queue_
+  // to work_queue_ by waiting until the last minute (work_queue_ is empty) to
+  // load.  That reduces the number of atomic operations per task
+  // significantly when our queues get large.
   if (!work_queue_.empty())
-    return;  // Wait till we *really* need to lock and load.
+    return;  // Wait till we *really* need to load.
 
-  // Acquire all we can from the inter-thread queue with one lock acquisition.
-  {
-    base::AutoLock lock(incoming_queue_lock_);
-    if (incoming_queue_.empty())
-      return;
-    incoming_queue_.Swap(&work_queue_);  // Constant time
-    DCHECK(incoming_queue_.empty());
-  }
+  // Take all we can from the inter-thread queue. A task that is still being
+  // linked in by its poster won't wake us up, so come back for it.
+  if (!incoming_task_queue_.TakeTasks(&work_queue_))
+    pump_->ScheduleWork();
 }
 
 bool MessageLoop::DeletePendingTasks() {
@@ -529,7 +610,7 @@ bool MessageLoop::DeletePendingTasks() {
       // We want to delete delayed tasks in the same order in which they would
       // normally be deleted in case of any funny dependencies between delayed
       // tasks.
-      AddToDelayedWorkQueue(pending_task);
+      AddToDelayedWorkQueue(pending_task, false);
     }
   }
   did_work |= !deferred_non_nestable_work_queue_.empty();
@@ -543,9 +624,7 @@ bool MessageLoop::DeletePendingTasks() {
   // code is replicating legacy behavior, and should not be considered
   // absolutely "correct" behavior.  See TODO above about deleting all tasks
   // when it's safe.
-  while (!delayed_work_queue_.empty()) {
-    delayed_work_queue_.pop();
-  }
+  delayed_work_queue_.Clear();
   return did_work;
 }
 
@@ -593,32 +672,23 @@ void MessageLoop::AddToIncomingQueue(PendingTask* pending_task) {
   // directly, as it could starve handling of foreign threads.  Put every task
   // into this queue.
 
-  scoped_refptr<base::MessagePump> pump;
-  {
-    base::AutoLock locked(incoming_queue_lock_);
-
-    // Initialize the sequence number. The sequence number is used for delayed
-    // tasks (to faciliate FIFO sorting when two tasks have the same
-    // delayed_run_time value) and for identifying the task in about:tracing.
-    pending_task->sequence_num = next_sequence_num_++;
-
-    TRACE_EVENT_FLOW_BEGIN0("task", "MessageLoop::PostTask",
-        TRACE_ID_MANGLE(GetTaskTraceID(*pending_task, this)));
-
-    bool was_empty = incoming_queue_.empty();
-    incoming_queue_.push(*pending_task);
-    pending_task->task.Reset();
-    if (!was_empty)
-      return;  // Someone else should have started the sub-pump.
+  // Initialize the sequence number. The sequence number is used for delayed
+  // tasks (to faciliate FIFO sorting when two tasks have the same
+  // delayed_run_time value) and for identifying the task in about:tracing.
+  // Tasks posted from one thread get increasing numbers in the order they are
+  // queued; tasks posted concurrently from different threads had no order to
+  // begin with.
+  pending_task->sequence_num = incoming_task_queue_.GetNextSequenceNum();
 
-    pump = pump_;
-  }
-  // Since the incoming_queue_ may contain a task that destroys this message
-  // loop, we cannot exit incoming_queue_lock_ until we are done with |this|.
-  // We use a stack-based reference to the message pump so that we can call
-  // ScheduleWork outside of incoming_queue_lock_.
+  TRACE_EVENT_FLOW_BEGIN0("task", "MessageLoop::PostTask",
+      TRACE_ID_MANGLE(GetTaskTraceID(*pending_task, this)));
 
-  pump->ScheduleWork();
+  // Since the incoming_task_queue_ may contain a task that destroys this
+  // message loop, we cannot touch |this| once the task is queued.
+  // AddTask() only starts the sub-pump if the queue was empty; otherwise
+  // someone else should have started it.
+  incoming_task_queue_.AddTask(*pending_task, pump_.get());
+  pending_task->task.Reset();
 }
 
 //------------------------------------------------------------------------------
@@ -663,9 +733,8 @@ bool MessageLoop::DoWork() {
       PendingTask pending_task = work_queue_.front();
       work_queue_.pop();
       if (!pending_task.delayed_run_time.is_null()) {
-        AddToDelayedWorkQueue(pending_task);
         // If we changed the topmost task, then it is time to reschedule.
-        if (delayed_work_queue_.top().task.Equals(pending_task.task))
+        if (AddToDelayedWorkQueue(pending_task, false))
           pump_->ScheduleDelayedWork(pending_task.delayed_run_time);
       } else {
         if (DeferOrRunPendingTask(pending_task))
@@ -691,7 +760,7 @@ bool MessageLoop::DoDelayedWork(TimeTicks* next_delayed_work_time) {
   // fall behind (and have a lot of ready-to-run delayed tasks), the more
   // efficient we'll be at handling the tasks.
 
-  TimeTicks next_run_time = delayed_work_queue_.top().delayed_run_time;
+  TimeTicks next_run_time = delayed_work_queue_.GetNextRunTime();
   if (next_run_time > recent_time_) {
     recent_time_ = TimeTicks::Now();  // Get a better view of Now();
     if (next_run_time > recent_time_) {
@@ -700,11 +769,17 @@ bool MessageLoop::DoDelayedWork(TimeTicks* next_delayed_work_time) {
     }
   }
 
-  PendingTask pending_task = delayed_work_queue_.top();
-  delayed_work_queue_.pop();
+  // |next_run_time| may have been a bound for tasks further out on the wheel.
+  // Turning the wheel up to |recent_time_| tells whether one is due.
+  if (!delayed_work_queue_.AdvanceTo(recent_time_)) {
+    *next_delayed_work_time = delayed_work_queue_.GetNextRunTime();
+    return false;
+  }
+
+  PendingTask pending_task = delayed_work_queue_.Pop();
 
   if (!delayed_work_queue_.empty())
-    *next_delayed_work_time = delayed_work_queue_.top().delayed_run_time;
+    *next_delayed_work_time = delayed_work_queue_.GetNextRunTime();
 
   return DeferOrRunPendingTask(pending_task);
 }
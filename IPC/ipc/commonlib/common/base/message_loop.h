@@ -7,10 +7,12 @@
 
 #include <queue>
 #include <string>
+#include <vector>
 
 #include "base/base_export.h"
 #include "base/basictypes.h"
 #include "base/callback_forward.h"
+#include "base/incoming_task_queue.h"
 #include "base/location.h"
 #include "base/memory/ref_counted.h"
 #include "base/message_loop_proxy.h"
@@ -19,8 +21,10 @@
 #include "base/pending_task.h"
 #include "base/sequenced_task_runner_helpers.h"
 #include "base/synchronization/lock.h"
+#include "base/task_latency_tracker.h"
 #include "base/tracking_info.h"
 #include "base/time.h"
+#include "base/timer_wheel.h"
 
 #if defined(OS_WIN)
 // We need this to declare base::MessagePumpWin::Dispatcher, which we should
@@ -180,6 +184,28 @@ class BASE_EXPORT MessageLoop : public base::MessagePump::Delegate {
       const base::Closure& task,
       base::TimeDelta delay);
 
+  // Posts |tasks| as PostTask() would one after the other, but queues them
+  // all at once and wakes the loop up at most once. They run in order, with
+  // no other task in between. Each task is tracked on its own, with
+  // |from_here| as its birth place.
+  void PostTasks(
+      const tracked_objects::Location& from_here,
+      const std::vector<base::Closure>& tasks);
+
+  // Like PostDelayedTask, but returns an id that CancelDelayedTask() takes to
+  // remove the task again, deleting it without running it. The task goes
+  // straight into the delayed work queue, so this may only be called on the
+  // thread that executes MessageLoop::Run(). Used by base::Timer.
+  int PostCancelableDelayedTask(
+      const tracked_objects::Location& from_here,
+      const base::Closure& task,
+      base::TimeDelta delay);
+
+  // Deletes the task posted with PostCancelableDelayedTask() that returned
+  // |task_id|. Returns false if it already ran or was cancelled. Must be
+  // called on the thread that executes MessageLoop::Run().
+  bool CancelDelayedTask(int task_id);
+
   // A variant on PostTask that deletes the given object.  This is useful
   // if the object needs to live until the next run of the MessageLoop (for
   // example, deleting a RenderProcessHost from within an IPC callback is not
@@ -262,6 +288,11 @@ class BASE_EXPORT MessageLoop : public base::MessagePump::Delegate {
   // Returns the type passed to the constructor.
   Type type() const { return type_; }
 
+  // Returns a number that no other MessageLoop of this process has, so that
+  // a loop can be told apart from an earlier one at the same address. It is
+  // never 0.
+  int id() const { return id_; }
+
   // Optional call to connect the thread name with this loop.
   void set_thread_name(const std::string& thread_name) {
     DCHECK(thread_name_.empty()) << "Should not rename this thread!";
@@ -269,6 +300,19 @@ class BASE_EXPORT MessageLoop : public base::MessagePump::Delegate {
   }
   const std::string& thread_name() const { return thread_name_; }
 
+  // Starts or stops recording how long each task run by this loop waited in
+  // its queues and how long it ran, keyed by where the task was posted from.
+  // See base::TaskLatencyTracker. Off by default, which costs a branch per
+  // task. Must be called on the loop's thread.
+  void SetTaskLatencyTracking(bool enabled);
+
+  // Writes the task latencies recorded so far as JSON, see
+  // TaskLatencyTracker::WriteJSON(). May be called on any thread while the
+  // loop is alive.
+  void WriteTaskLatencyJSON(std::string* output) const {
+    task_latency_tracker_.WriteJSON(output);
+  }
+
   // Gets the message loop proxy associated with this message loop.
   scoped_refptr<base::MessageLoopProxy> message_loop_proxy() {
     return message_loop_proxy_.get();
@@ -420,10 +464,13 @@ class BASE_EXPORT MessageLoop : public base::MessagePump::Delegate {
   // cannot be run right now.  Returns true if the task was run.
   bool DeferOrRunPendingTask(const base::PendingTask& pending_task);
 
-  // Adds the pending task to delayed_work_queue_.
-  void AddToDelayedWorkQueue(const base::PendingTask& pending_task);
+  // Adds the pending task to delayed_work_queue_. If |cancelable|,
+  // CancelDelayedTask() can take it out again by its sequence number. Returns
+  // true if the pump needs to be rescheduled for the task.
+  bool AddToDelayedWorkQueue(const base::PendingTask& pending_task,
+                             bool cancelable);
 
-  // Adds the pending task to our incoming_queue_.
+  // Adds the pending task to our incoming_task_queue_.
   //
   // Caller retains ownership of |pending_task|, but this function will
   // reset the value of pending_task->task.  This is needed to ensure
@@ -431,9 +478,9 @@ class BASE_EXPORT MessageLoop : public base::MessagePump::Delegate {
   // beyond this function call.
   void AddToIncomingQueue(base::PendingTask* pending_task);
 
-  // Load tasks from the incoming_queue_ into work_queue_ if the latter is
-  // empty.  The former requires a lock to access, while the latter is directly
-  // accessible on this thread.
+  // Load tasks from the incoming_task_queue_ into work_queue_ if the latter is
+  // empty.  The former is shared with the posting threads, while the latter is
+  // directly accessible on this thread.
   void ReloadWorkQueue();
 
   // Delete tasks that haven't run yet without running them.  Used in the
@@ -459,13 +506,15 @@ class BASE_EXPORT MessageLoop : public base::MessagePump::Delegate {
   virtual bool DoIdleWork() OVERRIDE;
 
   Type type_;
+  const int id_;
 
   // A list of tasks that need to be processed by this instance.  Note that
   // this queue is only accessed (push/pop) by our current thread.
   base::TaskQueue work_queue_;
 
-  // Contains delayed tasks, sorted by their 'delayed_run_time' property.
-  base::DelayedTaskQueue delayed_work_queue_;
+  // Contains delayed tasks, in the order of their 'delayed_run_time'
+  // property.
+  base::TimerWheel delayed_work_queue_;
 
   // A recent snapshot of Time::Now(), used to check delayed_work_queue_.
   base::TimeTicks recent_time_;
@@ -487,14 +536,16 @@ class BASE_EXPORT MessageLoop : public base::MessagePump::Delegate {
   // A profiling histogram showing the counts of various messages and events.
   base::HistogramBase* message_histogram_;
 
-  // An incoming queue of tasks that are acquired under a mutex for processing
-  // on this instance's thread. These tasks have not yet been sorted out into
-  // items for our work_queue_ vs delayed_work_queue_.
-  base::TaskQueue incoming_queue_;
-  // Protect access to incoming_queue_.
-  mutable base::Lock incoming_queue_lock_;
+  // Per-task queueing delay and run time, recorded if
+  // |track_task_latency_|.
+  bool track_task_latency_;
+  base::TaskLatencyTracker task_latency_tracker_;
 
-  base::RunLoop* run_loop_;
+  // An incoming queue of tasks that are posted without a lock from any thread
+  // for processing on this instance's thread. These tasks have not yet been
+  // sorted out into items for our work_queue_ vs delayed_work_queue_. It also
+  // hands out the sequence numbers of posted tasks.
+  base::IncomingTaskQueue incoming_task_queue_;
 
 #if defined(OS_WIN)
   base::TimeTicks high_resolution_timer_expiration_;
@@ -503,9 +554,7 @@ class BASE_EXPORT MessageLoop : public base::MessagePump::Delegate {
   bool os_modal_loop_;
 #endif
 
-  // The next sequence number to use for delayed tasks. Updating this counter is
-  // protected by incoming_queue_lock_.
-  int next_sequence_num_;
+  base::RunLoop* run_loop_;
 
   ObserverList<TaskObserver> task_observers_;
 
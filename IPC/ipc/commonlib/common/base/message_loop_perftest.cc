@@ -0,0 +1,309 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <vector>
+
+#include "base/bind.h"
+#include "base/incoming_task_queue.h"
+#include "base/memory/scoped_vector.h"
+#include "base/message_loop.h"
+#include "base/message_loop_proxy.h"
+#include "base/message_pump.h"
+#include "base/perftimer.h"
+#include "base/stringprintf.h"
+#include "base/synchronization/lock.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/threading/simple_thread.h"
+#include "base/threading/thread.h"
+#include "base/timer.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+// Measures posting tasks from 1 to 32 threads at once, first to the bare
+// incoming queue of a MessageLoop next to the std::queue and lock it replaced,
+// then to a running MessageLoop, and posting from one thread with and without
+// PostTasks(). Also measures arming, stopping and restarting many timers.
+
+namespace base {
+namespace {
+
+const int kProducerCounts[] = { 1, 2, 4, 8, 16, 32 };
+const int kTasksPerProducer = 50000;
+
+void Nop() {
+}
+
+// Ignores wakeups; the consumers below poll.
+class NullPump : public MessagePump {
+ public:
+  NullPump() {}
+
+  virtual void Run(Delegate* delegate) OVERRIDE {}
+  virtual void Quit() OVERRIDE {}
+  virtual void ScheduleWork() OVERRIDE {}
+  virtual void ScheduleDelayedWork(
+      const TimeTicks& delayed_work_time) OVERRIDE {}
+
+ private:
+  virtual ~NullPump() {}
+};
+
+// The incoming queue as it was before IncomingTaskQueue.
+class LockedTaskQueue {
+ public:
+  LockedTaskQueue() : next_sequence_num_(0) {}
+
+  void AddTask(const PendingTask& pending_task, MessagePump* pump) {
+    scoped_refptr<MessagePump> pump_to_wake;
+    {
+      AutoLock lock(lock_);
+      PendingTask copy(pending_task);
+      copy.sequence_num = next_sequence_num_++;
+      bool was_empty = queue_.empty();
+      queue_.push(copy);
+      if (!was_empty)
+        return;
+      pump_to_wake = pump;
+    }
+    pump_to_wake->ScheduleWork();
+  }
+
+  bool TakeTasks(TaskQueue* work_queue) {
+    AutoLock lock(lock_);
+    queue_.Swap(work_queue);
+    return true;
+  }
+
+ private:
+  Lock lock_;
+  TaskQueue queue_;
+  int next_sequence_num_;
+};
+
+template <typename Queue>
+class QueueProducer : public DelegateSimpleThread::Delegate {
+ public:
+  QueueProducer(Queue* queue, MessagePump* pump, WaitableEvent* start)
+      : queue_(queue), pump_(pump), start_(start) {}
+
+  virtual void Run() OVERRIDE {
+    PendingTask pending_task(FROM_HERE, Bind(&Nop));
+    start_->Wait();
+    for (int i = 0; i < kTasksPerProducer; ++i)
+      queue_->AddTask(pending_task, pump_);
+  }
+
+ private:
+  Queue* queue_;
+  MessagePump* pump_;
+  WaitableEvent* start_;
+};
+
+// Adds kTasksPerProducer tasks from each of |producer_count| threads while
+// this thread takes them, and logs how long it took.
+template <typename Queue>
+void RunQueueBenchmark(const char* name, int producer_count) {
+  scoped_refptr<NullPump> pump(new NullPump);
+  Queue queue;
+  WaitableEvent start(true, false);
+  ScopedVector<QueueProducer<Queue> > producers;
+  ScopedVector<DelegateSimpleThread> threads;
+  for (int i = 0; i < producer_count; ++i) {
+    producers.push_back(new QueueProducer<Queue>(&queue, pump, &start));
+    threads.push_back(new DelegateSimpleThread(producers.back(), name));
+    threads.back()->Start();
+  }
+
+  int total = producer_count * kTasksPerProducer;
+  int taken = 0;
+  TaskQueue work_queue;
+  PerfTimer timer;
+  start.Signal();
+  while (taken < total) {
+    queue.TakeTasks(&work_queue);
+    while (!work_queue.empty()) {
+      work_queue.pop();
+      ++taken;
+    }
+  }
+  TimeDelta elapsed = timer.Elapsed();
+
+  for (int i = 0; i < producer_count; ++i)
+    threads[i]->Join();
+
+  std::string test_name = StringPrintf("%s_%d", name, producer_count);
+  LogPerfResult(test_name.c_str(), elapsed.InMillisecondsF(), "ms");
+  LogPerfResult((test_name + "_throughput").c_str(),
+                total / elapsed.InSecondsF(), "tasks/s");
+}
+
+TEST(MessageLoopPerfTest, ContendedIncomingQueue) {
+  for (size_t i = 0; i < arraysize(kProducerCounts); ++i) {
+    RunQueueBenchmark<LockedTaskQueue>("LockedTaskQueue", kProducerCounts[i]);
+    RunQueueBenchmark<IncomingTaskQueue>("IncomingTaskQueue",
+                                         kProducerCounts[i]);
+  }
+}
+
+// Runs on the loop's thread.
+void CountTask(int* count, int total, WaitableEvent* done) {
+  if (++*count == total)
+    done->Signal();
+}
+
+class PostTaskProducer : public DelegateSimpleThread::Delegate {
+ public:
+  PostTaskProducer(MessageLoop* loop, const Closure& task,
+                   WaitableEvent* start)
+      : loop_(loop), task_(task), start_(start) {}
+
+  virtual void Run() OVERRIDE {
+    start_->Wait();
+    for (int i = 0; i < kTasksPerProducer; ++i)
+      loop_->PostTask(FROM_HERE, task_);
+  }
+
+ private:
+  MessageLoop* loop_;
+  Closure task_;
+  WaitableEvent* start_;
+};
+
+void RunPostTaskBenchmark(MessageLoop::Type type, const char* name,
+                          int producer_count) {
+  Thread thread(name);
+  ASSERT_TRUE(thread.StartWithOptions(Thread::Options(type, 0)));
+
+  int total = producer_count * kTasksPerProducer;
+  int count = 0;
+  WaitableEvent done(false, false);
+  Closure task = Bind(&CountTask, Unretained(&count), total,
+                      Unretained(&done));
+
+  WaitableEvent start(true, false);
+  ScopedVector<PostTaskProducer> producers;
+  ScopedVector<DelegateSimpleThread> threads;
+  for (int i = 0; i < producer_count; ++i) {
+    producers.push_back(
+        new PostTaskProducer(thread.message_loop(), task, &start));
+    threads.push_back(new DelegateSimpleThread(producers.back(), name));
+    threads.back()->Start();
+  }
+
+  PerfTimer timer;
+  start.Signal();
+  done.Wait();
+  TimeDelta elapsed = timer.Elapsed();
+
+  for (int i = 0; i < producer_count; ++i)
+    threads[i]->Join();
+  thread.Stop();
+
+  std::string test_name = StringPrintf("%s_%d", name, producer_count);
+  LogPerfResult(test_name.c_str(), elapsed.InMillisecondsF(), "ms");
+  LogPerfResult((test_name + "_throughput").c_str(),
+                total / elapsed.InSecondsF(), "tasks/s");
+}
+
+TEST(MessageLoopPerfTest, ContendedPostTask) {
+  for (size_t i = 0; i < arraysize(kProducerCounts); ++i) {
+    RunPostTaskBenchmark(MessageLoop::TYPE_DEFAULT, "PostTask_Default",
+                         kProducerCounts[i]);
+    RunPostTaskBenchmark(MessageLoop::TYPE_IO, "PostTask_IO",
+                         kProducerCounts[i]);
+  }
+}
+
+// Posts kTasksPerProducer tasks to a running loop from this thread, one by
+// one or in batches of |batch_size|, and logs how long they took to run.
+void RunBatchBenchmark(int batch_size) {
+  Thread thread("PostTasks");
+  ASSERT_TRUE(thread.Start());
+
+  int count = 0;
+  WaitableEvent done(false, false);
+  Closure task = Bind(&CountTask, Unretained(&count), kTasksPerProducer,
+                      Unretained(&done));
+  std::vector<Closure> batch(batch_size, task);
+  scoped_refptr<MessageLoopProxy> proxy = thread.message_loop_proxy();
+
+  PerfTimer timer;
+  if (batch_size == 1) {
+    for (int i = 0; i < kTasksPerProducer; ++i)
+      proxy->PostTask(FROM_HERE, task);
+  } else {
+    for (int i = 0; i < kTasksPerProducer; i += batch_size) {
+      if (kTasksPerProducer - i < batch_size)
+        batch.resize(kTasksPerProducer - i);
+      proxy->PostTasks(FROM_HERE, batch);
+    }
+  }
+  done.Wait();
+  TimeDelta elapsed = timer.Elapsed();
+  thread.Stop();
+
+  std::string test_name = StringPrintf("PostTasks_%d", batch_size);
+  LogPerfResult(test_name.c_str(), elapsed.InMillisecondsF(), "ms");
+  LogPerfResult((test_name + "_throughput").c_str(),
+                kTasksPerProducer / elapsed.InSecondsF(), "tasks/s");
+}
+
+TEST(MessageLoopPerfTest, BatchedPostTask) {
+  const int kBatchSizes[] = { 1, 10, 100, 1000 };
+  for (size_t i = 0; i < arraysize(kBatchSizes); ++i)
+    RunBatchBenchmark(kBatchSizes[i]);
+}
+
+void CountTimer(int* count) {
+  ++*count;
+}
+
+// Arms 100k timers spread over a couple of minutes, idles the loop, then
+// stops, restarts and deletes them, and logs how long each step took.
+TEST(MessageLoopPerfTest, ManyArmedTimers) {
+  const int kNumTimers = 100000;
+  MessageLoop loop(MessageLoop::TYPE_DEFAULT);
+  int count = 0;
+  ScopedVector<Timer> timers;
+  for (int i = 0; i < kNumTimers; ++i)
+    timers.push_back(new Timer(true, false));
+
+  PerfTimer start_timer;
+  for (int i = 0; i < kNumTimers; ++i) {
+    // 1 to 120 seconds, in an order that jumps around.
+    TimeDelta delay = TimeDelta::FromMilliseconds(
+        1000 + (i * GG_INT64_C(7919)) % 119000);
+    timers[i]->Start(FROM_HERE, delay, Bind(&CountTimer, Unretained(&count)));
+  }
+  TimeDelta start_time = start_timer.Elapsed();
+
+  PerfTimer idle_timer;
+  loop.RunUntilIdle();
+  TimeDelta idle_time = idle_timer.Elapsed();
+
+  PerfTimer stop_timer;
+  for (int i = 0; i < kNumTimers; ++i)
+    timers[i]->Stop();
+  TimeDelta stop_time = stop_timer.Elapsed();
+
+  PerfTimer reset_timer;
+  for (int i = 0; i < kNumTimers; ++i)
+    timers[i]->Reset();
+  TimeDelta reset_time = reset_timer.Elapsed();
+
+  PerfTimer delete_timer;
+  timers.clear();
+  TimeDelta delete_time = delete_timer.Elapsed();
+
+  loop.RunUntilIdle();
+  EXPECT_EQ(0, count);
+
+  LogPerfResult("ManyArmedTimers_Start", start_time.InMillisecondsF(), "ms");
+  LogPerfResult("ManyArmedTimers_IdleLoop", idle_time.InMillisecondsF(), "ms");
+  LogPerfResult("ManyArmedTimers_Stop", stop_time.InMillisecondsF(), "ms");
+  LogPerfResult("ManyArmedTimers_Reset", reset_time.InMillisecondsF(), "ms");
+  LogPerfResult("ManyArmedTimers_Delete", delete_time.InMillisecondsF(), "ms");
+}
+
+}  // namespace
+}  // namespace base
@@ -25,6 +25,8 @@ class BASE_EXPORT MessageLoopProxyImpl : public MessageLoopProxy {
       const tracked_objects::Location& from_here,
       const base::Closure& task,
       base::TimeDelta delay) OVERRIDE;
+  virtual bool PostTasks(const tracked_objects::Location& from_here,
+                         const std::vector<base::Closure>& tasks) OVERRIDE;
   virtual bool RunsTasksOnCurrentThread() const OVERRIDE;
 
  protected:
@@ -4,6 +4,8 @@
 
 #include "base/message_loop_proxy_impl.h"
 
+#include <vector>
+
 #include "base/bind.h"
 #include "base/memory/scoped_ptr.h"
 #include "base/message_loop.h"
@@ -54,6 +56,13 @@ class MessageLoopProxyImplTest : public testing::Test {
     test->Quit();
   }
 
+  static void RecordOnFileThread(MessageLoopProxyImplTest* test,
+                                 std::vector<int>* order,
+                                 int value) {
+    test->AssertOnFileThread();
+    order->push_back(value);
+  }
+
   static void AssertNotRun() {
     FAIL() << "Callback Should not get executed.";
   }
@@ -124,3 +133,34 @@ TEST_F(MessageLoopProxyImplTest, PostTaskAfterThreadIsDeleted) {
       base::Bind(&MessageLoopProxyImplTest::AssertNotRun));
   EXPECT_FALSE(ret);
 }
+
+TEST_F(MessageLoopProxyImplTest, PostTasks) {
+  std::vector<int> order;
+  std::vector<base::Closure> tasks;
+  for (int i = 0; i < 3; ++i) {
+    tasks.push_back(base::Bind(&MessageLoopProxyImplTest::RecordOnFileThread,
+                               base::Unretained(this),
+                               base::Unretained(&order), i));
+  }
+  tasks.push_back(base::Bind(&MessageLoopProxyImplTest::Quit,
+                             base::Unretained(this)));
+  EXPECT_TRUE(file_thread_->message_loop_proxy()->PostTasks(FROM_HERE, tasks));
+  MessageLoop::current()->Run();
+
+  ASSERT_EQ(3u, order.size());
+  for (int i = 0; i < 3; ++i)
+    EXPECT_EQ(i, order[i]);
+}
+
+TEST_F(MessageLoopProxyImplTest, PostTasksAfterThreadExits) {
+  scoped_ptr<base::Thread> test_thread(
+      new base::Thread("MessageLoopProxyImplTest_Dummy"));
+  test_thread->Start();
+  scoped_refptr<base::MessageLoopProxy> message_loop_proxy =
+      test_thread->message_loop_proxy();
+  test_thread->Stop();
+
+  std::vector<base::Closure> tasks(
+      2, base::Bind(&MessageLoopProxyImplTest::AssertNotRun));
+  EXPECT_FALSE(message_loop_proxy->PostTasks(FROM_HERE, tasks));
+}
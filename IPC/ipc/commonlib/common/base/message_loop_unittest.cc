@@ -1602,6 +1602,19 @@ void RunTest_WaitForIO() {
 // that message loops work properly in all configurations.  Of course, in some
 // cases, a unit test may only be for a particular type of loop.
 
+TEST(MessageLoopTest, Ids) {
+  int first_id;
+  {
+    MessageLoop loop(MessageLoop::TYPE_DEFAULT);
+    first_id = loop.id();
+    EXPECT_NE(0, first_id);
+  }
+  // Likely at the same address as the first loop, but with another id.
+  MessageLoop loop(MessageLoop::TYPE_DEFAULT);
+  EXPECT_NE(0, loop.id());
+  EXPECT_NE(first_id, loop.id());
+}
+
 TEST(MessageLoopTest, PostTask) {
   RunTest_PostTask(MessageLoop::TYPE_DEFAULT);
   RunTest_PostTask(MessageLoop::TYPE_UI);
@@ -0,0 +1,315 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/message_pump_epoll.h"
+
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "base/auto_reset.h"
+#include "base/containers/stack_container.h"
+#include "base/logging.h"
+#include "base/memory/weak_ptr.h"
+#include "base/posix/eintr_wrapper.h"
+
+namespace base {
+
+namespace {
+
+// Number of events taken from the kernel per epoll_wait().
+const int kMaxEvents = 64;
+
+// Readiness that wakes up read and write watchers. Like libevent, errors and
+// hang-ups are reported to both so that they see the failing read or write.
+const uint32 kReadEvents = EPOLLIN | EPOLLPRI | EPOLLERR | EPOLLHUP;
+const uint32 kWriteEvents = EPOLLOUT | EPOLLERR | EPOLLHUP;
+
+}  // namespace
+
+MessagePumpEpoll::Entry::Entry() : registered_events(0) {
+}
+
+MessagePumpEpoll::Entry::~Entry() {
+}
+
+MessagePumpEpoll::MessagePumpEpoll(MessagePumpLibevent* owner)
+    : owner_(owner),
+      keep_running_(true),
+      in_run_(false),
+      processed_io_events_(false),
+      epoll_fd_(epoll_create1(EPOLL_CLOEXEC)),
+      wakeup_fd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {
+  DCHECK(owner_);
+  PCHECK(epoll_fd_ >= 0) << "epoll_create1";
+  PCHECK(wakeup_fd_ >= 0) << "eventfd";
+
+  struct epoll_event event;
+  event.events = EPOLLIN | EPOLLET;
+  event.data.fd = wakeup_fd_;
+  PCHECK(epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wakeup_fd_, &event) == 0)
+      << "epoll_ctl";
+}
+
+MessagePumpEpoll::~MessagePumpEpoll() {
+  // Controllers may outlive the pump, see
+  // MessageLoopTest.FileDescriptorWatcherOutlivesMessageLoop. Detach them so
+  // that they don't call back into it.
+  for (EntryMap::iterator it = entries_.begin(); it != entries_.end(); ++it) {
+    for (size_t i = 0; i < it->second.controllers.size(); ++i) {
+      it->second.controllers[i]->epoll_pump_ = NULL;
+      it->second.controllers[i]->epoll_fd_ = -1;
+    }
+  }
+  if (HANDLE_EINTR(close(wakeup_fd_)) < 0)
+    DPLOG(ERROR) << "close";
+  if (HANDLE_EINTR(close(epoll_fd_)) < 0)
+    DPLOG(ERROR) << "close";
+}
+
+bool MessagePumpEpoll::WatchFileDescriptor(int fd,
+                                           bool persistent,
+                                           int mode,
+                                           FileDescriptorWatcher* controller,
+                                           Watcher* delegate) {
+  if (controller->epoll_pump_) {
+    // Watching again adds to what |controller| already watches.
+    if (controller->epoll_pump_ != this || controller->epoll_fd_ != fd) {
+      NOTREACHED() << "FDs don't match" << controller->epoll_fd_ << "!="
+                   << fd;
+      return false;
+    }
+    mode |= controller->epoll_mode_;
+    persistent |= controller->epoll_persistent_;
+  } else {
+    entries_[fd].controllers.push_back(controller);
+    controller->epoll_pump_ = this;
+    controller->epoll_fd_ = fd;
+  }
+  controller->epoll_mode_ = mode;
+  controller->epoll_persistent_ = persistent;
+  controller->epoll_armed_ = true;
+
+  if (!UpdateRegistration(fd)) {
+    StopWatching(controller);
+    return false;
+  }
+
+  controller->set_watcher(delegate);
+  controller->set_pump(owner_);
+  return true;
+}
+
+void MessagePumpEpoll::StopWatching(FileDescriptorWatcher* controller) {
+  DCHECK_EQ(this, controller->epoll_pump_);
+  int fd = controller->epoll_fd_;
+  controller->epoll_pump_ = NULL;
+  controller->epoll_fd_ = -1;
+
+  EntryMap::iterator it = entries_.find(fd);
+  DCHECK(it != entries_.end());
+  std::vector<FileDescriptorWatcher*>& controllers = it->second.controllers;
+  controllers.erase(
+      std::remove(controllers.begin(), controllers.end(), controller),
+      controllers.end());
+  UpdateRegistration(fd);
+}
+
+void MessagePumpEpoll::Run(Delegate* delegate) {
+  DCHECK(keep_running_) << "Quit must have been called outside of Run!";
+  AutoReset<bool> auto_reset_in_run(&in_run_, true);
+
+  for (;;) {
+    bool did_work = delegate->DoWork();
+    if (!keep_running_)
+      break;
+
+    WaitAndDispatch(0);
+    did_work |= processed_io_events_;
+    processed_io_events_ = false;
+    if (!keep_running_)
+      break;
+
+    did_work |= delegate->DoDelayedWork(&delayed_work_time_);
+    if (!keep_running_)
+      break;
+
+    if (did_work)
+      continue;
+
+    did_work = delegate->DoIdleWork();
+    if (!keep_running_)
+      break;
+
+    if (did_work)
+      continue;
+
+    int timeout_ms = -1;
+    if (!delayed_work_time_.is_null()) {
+      TimeDelta delay = delayed_work_time_ - TimeTicks::Now();
+      if (delay <= TimeDelta()) {
+        // It looks like delayed_work_time_ indicates a time in the past, so
+        // we need to call DoDelayedWork now.
+        delayed_work_time_ = TimeTicks();
+        continue;
+      }
+      // Round up, so that we don't wake up before the delayed work is due.
+      timeout_ms = static_cast<int>(std::min<int64>(
+          (delay.InMicroseconds() + Time::kMicrosecondsPerMillisecond - 1) /
+              Time::kMicrosecondsPerMillisecond,
+          kint32max));
+    }
+    WaitAndDispatch(timeout_ms);
+  }
+
+  keep_running_ = true;
+}
+
+void MessagePumpEpoll::Quit() {
+  DCHECK(in_run_);
+  keep_running_ = false;
+  ScheduleWork();
+}
+
+void MessagePumpEpoll::ScheduleWork() {
+  // Every write is a new edge, even while the counter is non-zero.
+  uint64 value = 1;
+  int nwrite = HANDLE_EINTR(write(wakeup_fd_, &value, sizeof(value)));
+  DCHECK(nwrite == sizeof(value) || errno == EAGAIN)
+      << "[nwrite:" << nwrite << "] [errno:" << errno << "]";
+}
+
+void MessagePumpEpoll::ScheduleDelayedWork(
+    const TimeTicks& delayed_work_time) {
+  // We know that we can't be blocked in epoll_wait() right now since this
+  // method can only be called on the same thread as Run, so we only need to
+  // update our record of how long to sleep when we do sleep.
+  delayed_work_time_ = delayed_work_time;
+}
+
+bool MessagePumpEpoll::UpdateRegistration(int fd) {
+  EntryMap::iterator it = entries_.find(fd);
+  if (it == entries_.end())
+    return true;
+  Entry& entry = it->second;
+
+  uint32 events = 0;
+  for (size_t i = 0; i < entry.controllers.size(); ++i) {
+    const FileDescriptorWatcher* controller = entry.controllers[i];
+    if (!controller->epoll_armed_)
+      continue;
+    if (controller->epoll_mode_ & MessagePumpLibevent::WATCH_READ)
+      events |= EPOLLIN;
+    if (controller->epoll_mode_ & MessagePumpLibevent::WATCH_WRITE)
+      events |= EPOLLOUT;
+  }
+
+  if (entry.controllers.empty()) {
+    // Fails harmlessly if |fd| was closed while watched.
+    if (entry.registered_events &&
+        epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, NULL) != 0 &&
+        errno != EBADF && errno != ENOENT) {
+      DPLOG(ERROR) << "epoll_ctl(EPOLL_CTL_DEL)";
+    }
+    entries_.erase(it);
+    return true;
+  }
+
+  if (events == entry.registered_events)
+    return true;
+
+  struct epoll_event event;
+  event.events = events;
+  event.data.fd = fd;
+  int rv;
+  if (!entry.registered_events) {
+    rv = epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event);
+  } else if (!events) {
+    rv = epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, NULL);
+  } else {
+    rv = epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fd, &event);
+    // The descriptor number was closed and reused while watched, which
+    // dropped the old registration.
+    if (rv != 0 && errno == ENOENT)
+      rv = epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event);
+  }
+  if (rv != 0) {
+    DPLOG(ERROR) << "epoll_ctl";
+    entry.registered_events = 0;
+    return false;
+  }
+  entry.registered_events = events;
+  return true;
+}
+
+void MessagePumpEpoll::WaitAndDispatch(int timeout_ms) {
+  struct epoll_event events[kMaxEvents];
+  int count = epoll_wait(epoll_fd_, events, kMaxEvents, timeout_ms);
+  if (count < 0) {
+    DPCHECK(errno == EINTR) << "epoll_wait";
+    return;
+  }
+
+  for (int i = 0; i < count; ++i) {
+    if (events[i].data.fd == wakeup_fd_) {
+      processed_io_events_ = true;
+      continue;
+    }
+    DispatchEvents(events[i].data.fd, events[i].events);
+    if (!keep_running_)
+      break;
+  }
+}
+
+void MessagePumpEpoll::DispatchEvents(int fd, uint32 events) {
+  // Events still queued for a descriptor that is no longer watched.
+  EntryMap::iterator it = entries_.find(fd);
+  if (it == entries_.end())
+    return;
+
+  // The callbacks may stop watching, start watching or delete controllers.
+  StackVector<WeakPtr<FileDescriptorWatcher>, 4> controllers;
+  const std::vector<FileDescriptorWatcher*>& entry_controllers =
+      it->second.controllers;
+  for (size_t i = 0; i < entry_controllers.size(); ++i)
+    controllers->push_back(entry_controllers[i]->weak_factory_.GetWeakPtr());
+
+  bool rearm = false;
+  for (size_t i = 0; i < controllers->size(); ++i) {
+    FileDescriptorWatcher* controller = controllers[i].get();
+    if (!controller || controller->epoll_pump_ != this ||
+        controller->epoll_fd_ != fd || !controller->epoll_armed_) {
+      continue;
+    }
+
+    bool can_write = (events & kWriteEvents) &&
+        (controller->epoll_mode_ & MessagePumpLibevent::WATCH_WRITE);
+    bool can_read = (events & kReadEvents) &&
+        (controller->epoll_mode_ & MessagePumpLibevent::WATCH_READ);
+    if (!can_write && !can_read)
+      continue;
+
+    if (!controller->epoll_persistent_) {
+      controller->epoll_armed_ = false;
+      rearm = true;
+    }
+    processed_io_events_ = true;
+
+    if (can_write)
+      controller->OnFileCanWriteWithoutBlocking(fd, owner_);
+    // Check |controller| in case it's been deleted in
+    // controller->OnFileCanWriteWithoutBlocking().
+    if (can_read && controllers[i].get())
+      controllers[i]->OnFileCanReadWithoutBlocking(fd, owner_);
+  }
+
+  // Stop reporting the descriptor to the one-shot watches that just fired.
+  if (rearm)
+    UpdateRegistration(fd);
+}
+
+}  // namespace base
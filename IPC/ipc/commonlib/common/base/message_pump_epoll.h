@@ -0,0 +1,113 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_MESSAGE_PUMP_EPOLL_H_
+#define BASE_MESSAGE_PUMP_EPOLL_H_
+
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/compiler_specific.h"
+#include "base/hash_tables.h"
+#include "base/message_pump.h"
+#include "base/message_pump_libevent.h"
+#include "base/time.h"
+
+namespace base {
+
+// Watches file descriptors with epoll directly instead of going through
+// libevent. A MessagePumpLibevent created after
+// MessagePumpLibevent::SetUseEpoll(true) runs on one of these, so
+// MessageLoopForIO and the Watcher and FileDescriptorWatcher API are the same
+// either way.
+//
+// Compared with libevent:
+//  - Watching a descriptor allocates nothing. The FileDescriptorWatcher holds
+//    the watch state, and the pump keeps one entry per watched descriptor.
+//  - epoll_ctl() is only called when the events watched on a descriptor
+//    change, e.g. when a one-shot watch fires.
+//  - ScheduleWork() is a single write() to an eventfd. The eventfd is
+//    registered edge-triggered, so it never has to be read back.
+//
+// Descriptors are registered level-triggered. Watchers may handle part of
+// what is available and rely on being called again, e.g. a listening socket
+// accepting one connection per notification.
+class BASE_EXPORT MessagePumpEpoll : public MessagePump {
+ public:
+  typedef MessagePumpLibevent::Watcher Watcher;
+  typedef MessagePumpLibevent::FileDescriptorWatcher FileDescriptorWatcher;
+
+  // |owner| is the pump that MessageLoopForIO sees. It dispatches the
+  // IOObserver notifications and must outlive this pump.
+  explicit MessagePumpEpoll(MessagePumpLibevent* owner);
+
+  // See MessagePumpLibevent::WatchFileDescriptor().
+  bool WatchFileDescriptor(int fd,
+                           bool persistent,
+                           int mode,
+                           FileDescriptorWatcher* controller,
+                           Watcher* delegate);
+
+  // Called by |controller| when it stops watching.
+  void StopWatching(FileDescriptorWatcher* controller);
+
+  // MessagePump methods:
+  virtual void Run(Delegate* delegate) OVERRIDE;
+  virtual void Quit() OVERRIDE;
+  virtual void ScheduleWork() OVERRIDE;
+  virtual void ScheduleDelayedWork(const TimeTicks& delayed_work_time) OVERRIDE;
+
+ protected:
+  virtual ~MessagePumpEpoll();
+
+ private:
+  // The controllers watching one descriptor, and the epoll events currently
+  // registered for it.
+  struct Entry {
+    Entry();
+    ~Entry();
+
+    std::vector<FileDescriptorWatcher*> controllers;
+    uint32 registered_events;
+  };
+  typedef base::hash_map<int, Entry> EntryMap;
+
+  // Registers the union of what the active controllers of |fd| watch, or
+  // unregisters |fd| once no controller is left. Returns false if epoll
+  // refused.
+  bool UpdateRegistration(int fd);
+
+  // Waits up to |timeout_ms| (-1 for no limit) for events and dispatches
+  // them.
+  void WaitAndDispatch(int timeout_ms);
+
+  void DispatchEvents(int fd, uint32 events);
+
+  MessagePumpLibevent* owner_;
+
+  // This flag is set to false when Run should return.
+  bool keep_running_;
+
+  // This flag is set when inside Run.
+  bool in_run_;
+
+  // This flag is set if IO events or a wakeup were processed.
+  bool processed_io_events_;
+
+  // The time at which we should call DoDelayedWork.
+  TimeTicks delayed_work_time_;
+
+  int epoll_fd_;
+
+  // ScheduleWork() writes to it to wake up epoll_wait().
+  int wakeup_fd_;
+
+  EntryMap entries_;
+
+  DISALLOW_COPY_AND_ASSIGN(MessagePumpEpoll);
+};
+
+}  // namespace base
+
+#endif  // BASE_MESSAGE_PUMP_EPOLL_H_
@@ -8,6 +8,7 @@
 #include <fcntl.h>
 #include <unistd.h>
 
+#include "base/atomicops.h"
 #include "base/auto_reset.h"
 #include "base/compiler_specific.h"
 #include "base/logging.h"
@@ -15,6 +16,9 @@
 #include "base/mac/scoped_nsautorelease_pool.h"
 #endif
 #include "base/memory/scoped_ptr.h"
+#if defined(OS_LINUX)
+#include "base/message_pump_epoll.h"
+#endif
 #include "base/observer_list.h"
 #include "base/posix/eintr_wrapper.h"
 #include "base/time.h"
@@ -44,6 +48,20 @@
 
 namespace base {
 
+#if defined(OS_LINUX)
+namespace {
+
+// IO threads create their pumps while other threads may call SetUseEpoll().
+subtle::Atomic32 g_use_epoll = 0;
+
+// Returns NULL if the pump will run on a MessagePumpEpoll.
+event_base* CreateEventBase() {
+  return subtle::NoBarrier_Load(&g_use_epoll) ? NULL : event_base_new();
+}
+
+}  // namespace
+#endif
+
 // Return 0 on success
 // Too small a function to bother putting in a library?
 static int SetNonBlocking(int fd) {
@@ -57,16 +75,37 @@ MessagePumpLibevent::FileDescriptorWatcher::FileDescriptorWatcher()
     : event_(NULL),
       pump_(NULL),
       watcher_(NULL),
-      ALLOW_THIS_IN_INITIALIZER_LIST(weak_factory_(this)) {
+      ALLOW_THIS_IN_INITIALIZER_LIST(weak_factory_(this))
+#if defined(OS_LINUX)
+      , epoll_pump_(NULL),
+      epoll_fd_(-1),
+      epoll_mode_(0),
+      epoll_persistent_(false),
+      epoll_armed_(false)
+#endif
+      {
 }
 
 MessagePumpLibevent::FileDescriptorWatcher::~FileDescriptorWatcher() {
   if (event_) {
     StopWatchingFileDescriptor();
   }
+#if defined(OS_LINUX)
+  if (epoll_pump_)
+    StopWatchingFileDescriptor();
+#endif
 }
 
 bool MessagePumpLibevent::FileDescriptorWatcher::StopWatchingFileDescriptor() {
+#if defined(OS_LINUX)
+  if (epoll_pump_) {
+    epoll_pump_->StopWatching(this);
+    pump_ = NULL;
+    watcher_ = NULL;
+    return true;
+  }
+#endif
+
   event* e = ReleaseEvent();
   if (e == NULL)
     return true;
@@ -115,14 +154,29 @@ MessagePumpLibevent::MessagePumpLibevent()
     : keep_running_(true),
       in_run_(false),
       processed_io_events_(false),
+#if defined(OS_LINUX)
+      event_base_(CreateEventBase()),
+#else
       event_base_(event_base_new()),
+#endif
       wakeup_pipe_in_(-1),
-      wakeup_pipe_out_(-1) {
+      wakeup_pipe_out_(-1),
+      wakeup_event_(NULL) {
+#if defined(OS_LINUX)
+  if (!event_base_) {
+    epoll_pump_ = new MessagePumpEpoll(this);
+    return;
+  }
+#endif
   if (!Init())
      NOTREACHED();
 }
 
 MessagePumpLibevent::~MessagePumpLibevent() {
+#if defined(OS_LINUX)
+  if (epoll_pump_)
+    return;
+#endif
   DCHECK(wakeup_event_);
   DCHECK(event_base_);
   event_del(wakeup_event_);
@@ -151,6 +205,13 @@ bool MessagePumpLibevent::WatchFileDescriptor(int fd,
   // threadsafe, and your watcher may never be registered.
   DCHECK(watch_file_descriptor_caller_checker_.CalledOnValidThread());
 
+#if defined(OS_LINUX)
+  if (epoll_pump_) {
+    return epoll_pump_->WatchFileDescriptor(fd, persistent, mode, controller,
+                                            delegate);
+  }
+#endif
+
   int event_mask = persistent ? EV_PERSIST : 0;
   if (mode & WATCH_READ) {
     event_mask |= EV_READ;
@@ -204,6 +265,13 @@ bool MessagePumpLibevent::WatchFileDescriptor(int fd,
   return true;
 }
 
+#if defined(OS_LINUX)
+// static
+void MessagePumpLibevent::SetUseEpoll(bool use_epoll) {
+  subtle::NoBarrier_Store(&g_use_epoll, use_epoll ? 1 : 0);
+}
+#endif
+
 void MessagePumpLibevent::AddIOObserver(IOObserver *obs) {
   io_observers_.AddObserver(obs);
 }
@@ -220,6 +288,13 @@ static void timer_callback(int fd, short events, void *context)
 
 // Reentrant!
 void MessagePumpLibevent::Run(Delegate* delegate) {
+#if defined(OS_LINUX)
+  if (epoll_pump_) {
+    epoll_pump_->Run(delegate);
+    return;
+  }
+#endif
+
   DCHECK(keep_running_) << "Quit must have been called outside of Run!";
   base::AutoReset<bool> auto_reset_in_run(&in_run_, true);
 
@@ -283,6 +358,13 @@ void MessagePumpLibevent::Run(Delegate* delegate) {
 }
 
 void MessagePumpLibevent::Quit() {
+#if defined(OS_LINUX)
+  if (epoll_pump_) {
+    epoll_pump_->Quit();
+    return;
+  }
+#endif
+
   DCHECK(in_run_);
   // Tell both libevent and Run that they should break out of their loops.
   keep_running_ = false;
@@ -290,6 +372,13 @@ void MessagePumpLibevent::Quit() {
 }
 
 void MessagePumpLibevent::ScheduleWork() {
+#if defined(OS_LINUX)
+  if (epoll_pump_) {
+    epoll_pump_->ScheduleWork();
+    return;
+  }
+#endif
+
   // Tell libevent (in a threadsafe way) that it should break out of its loop.
   char buf = 0;
   int nwrite = HANDLE_EINTR(write(wakeup_pipe_in_, &buf, 1));
@@ -299,6 +388,13 @@ void MessagePumpLibevent::ScheduleWork() {
 
 void MessagePumpLibevent::ScheduleDelayedWork(
     const TimeTicks& delayed_work_time) {
+#if defined(OS_LINUX)
+  if (epoll_pump_) {
+    epoll_pump_->ScheduleDelayedWork(delayed_work_time);
+    return;
+  }
+#endif
+
   // We know that we can't be blocked on Wait right now since this method can
   // only be called on the same thread as Run, so we only need to update our
   // record of how long to sleep when we do sleep.
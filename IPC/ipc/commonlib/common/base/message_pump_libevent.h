@@ -7,11 +7,13 @@
 
 #include "base/basictypes.h"
 #include "base/compiler_specific.h"
+#include "base/memory/ref_counted.h"
 #include "base/memory/weak_ptr.h"
 #include "base/message_pump.h"
 #include "base/observer_list.h"
 #include "base/threading/thread_checker.h"
 #include "base/time.h"
+#include "build/build_config.h"
 
 // Declare structs we need from libevent.h rather than including it
 struct event_base;
@@ -19,6 +21,10 @@ struct event;
 
 namespace base {
 
+#if defined(OS_LINUX)
+class MessagePumpEpoll;
+#endif
+
 // Class to monitor sockets and issue callbacks when sockets are ready for I/O
 // TODO(dkegel): add support for background file IO somehow
 class BASE_EXPORT MessagePumpLibevent : public MessagePump {
@@ -65,6 +71,7 @@ class BASE_EXPORT MessagePumpLibevent : public MessagePump {
     bool StopWatchingFileDescriptor();
 
    private:
+    friend class MessagePumpEpoll;
     friend class MessagePumpLibevent;
     friend class MessagePumpLibeventTest;
 
@@ -88,6 +95,16 @@ class BASE_EXPORT MessagePumpLibevent : public MessagePump {
     Watcher* watcher_;
     base::WeakPtrFactory<FileDescriptorWatcher> weak_factory_;
 
+#if defined(OS_LINUX)
+    // Used instead of |event_| when the pump runs on a MessagePumpEpoll.
+    MessagePumpEpoll* epoll_pump_;
+    int epoll_fd_;
+    int epoll_mode_;
+    bool epoll_persistent_;
+    // Cleared when a watch that isn't persistent has fired.
+    bool epoll_armed_;
+#endif
+
     DISALLOW_COPY_AND_ASSIGN(FileDescriptorWatcher);
   };
 
@@ -99,6 +116,13 @@ class BASE_EXPORT MessagePumpLibevent : public MessagePump {
 
   MessagePumpLibevent();
 
+#if defined(OS_LINUX)
+  // Makes the MessagePumpLibevents created afterwards run on a
+  // MessagePumpEpoll instead of libevent. Off by default. Must be called
+  // before the MessageLoopForIOs it should affect are created.
+  static void SetUseEpoll(bool use_epoll);
+#endif
+
   // Have the current thread's message loop watch for a a situation in which
   // reading/writing to the FD can be performed without blocking.
   // Callers must provide a preallocated FileDescriptorWatcher object which
@@ -169,6 +193,12 @@ class BASE_EXPORT MessagePumpLibevent : public MessagePump {
   // ... libevent wrapper for read end
   event* wakeup_event_;
 
+#if defined(OS_LINUX)
+  // Set if SetUseEpoll(true) was called before construction. Then it does all
+  // the work and |event_base_| is NULL.
+  scoped_refptr<MessagePumpEpoll> epoll_pump_;
+#endif
+
   ObserverList<IOObserver> io_observers_;
   ThreadChecker watch_file_descriptor_caller_checker_;
   DISALLOW_COPY_AND_ASSIGN(MessagePumpLibevent);
@@ -4,10 +4,13 @@
 
 #include "base/message_pump_libevent.h"
 
+#include <sys/socket.h>
 #include <unistd.h>
 
+#include "base/bind.h"
 #include "base/message_loop.h"
 #include "base/posix/eintr_wrapper.h"
+#include "base/synchronization/waitable_event.h"
 #include "base/threading/thread.h"
 #include "testing/gtest/include/gtest/gtest.h"
 #include "third_party/libevent/event.h"
@@ -157,6 +160,170 @@ TEST_F(MessagePumpLibeventTest, StopWatcher) {
   OnLibeventNotification(pump, &watcher);
 }
 
+#if defined(OS_LINUX)
+
+// Runs the tests above against the pumps of MessagePumpLibevent::SetUseEpoll.
+class MessagePumpEpollTest : public MessagePumpLibeventTest {
+ protected:
+  virtual void SetUp() OVERRIDE {
+    MessagePumpLibevent::SetUseEpoll(true);
+    MessagePumpLibeventTest::SetUp();
+  }
+
+  virtual void TearDown() OVERRIDE {
+    MessagePumpLibeventTest::TearDown();
+    MessagePumpLibevent::SetUseEpoll(false);
+  }
+};
+
+// Runs a pump until it has nothing left to do.
+class RunUntilIdleDelegate : public MessagePump::Delegate {
+ public:
+  explicit RunUntilIdleDelegate(MessagePump* pump) : pump_(pump) {}
+  virtual ~RunUntilIdleDelegate() {}
+
+  virtual bool DoWork() OVERRIDE { return false; }
+  virtual bool DoDelayedWork(TimeTicks* next_delayed_work_time) OVERRIDE {
+    return false;
+  }
+  virtual bool DoIdleWork() OVERRIDE {
+    pump_->Quit();
+    return false;
+  }
+
+ private:
+  MessagePump* pump_;
+};
+
+class CountingWatcher : public MessagePumpLibevent::Watcher {
+ public:
+  CountingWatcher() : read_count_(0), write_count_(0) {}
+  virtual ~CountingWatcher() {}
+
+  virtual void OnFileCanReadWithoutBlocking(int /* fd */) OVERRIDE {
+    ++read_count_;
+  }
+  virtual void OnFileCanWriteWithoutBlocking(int /* fd */) OVERRIDE {
+    ++write_count_;
+  }
+
+  int read_count() const { return read_count_; }
+  int write_count() const { return write_count_; }
+
+ private:
+  int read_count_;
+  int write_count_;
+};
+
+#if GTEST_HAS_DEATH_TEST && !defined(NDEBUG)
+
+TEST_F(MessagePumpEpollTest, TestWatchingFromBadThread) {
+  MessagePumpLibevent::FileDescriptorWatcher watcher;
+  StupidWatcher delegate;
+
+  ASSERT_DEATH(io_loop()->WatchFileDescriptor(
+      STDOUT_FILENO, false, MessageLoopForIO::WATCH_READ, &watcher, &delegate),
+      "Check failed: "
+      "watch_file_descriptor_caller_checker_.CalledOnValidThread()");
+}
+
+#endif  // GTEST_HAS_DEATH_TEST && !defined(NDEBUG)
+
+TEST_F(MessagePumpEpollTest, DeleteWatcher) {
+  scoped_refptr<MessagePumpLibevent> pump(new MessagePumpLibevent);
+  MessagePumpLibevent::FileDescriptorWatcher* watcher =
+      new MessagePumpLibevent::FileDescriptorWatcher;
+  DeleteWatcher delegate(watcher);
+  ASSERT_TRUE(pump->WatchFileDescriptor(pipefds_[1],
+      false, MessagePumpLibevent::WATCH_READ_WRITE, watcher, &delegate));
+
+  // The write end of the pipe is writable right away.
+  RunUntilIdleDelegate run_delegate(pump);
+  pump->Run(&run_delegate);
+}
+
+TEST_F(MessagePumpEpollTest, StopWatcher) {
+  scoped_refptr<MessagePumpLibevent> pump(new MessagePumpLibevent);
+  MessagePumpLibevent::FileDescriptorWatcher watcher;
+  StopWatcher delegate(&watcher);
+  ASSERT_TRUE(pump->WatchFileDescriptor(pipefds_[1],
+      true, MessagePumpLibevent::WATCH_READ_WRITE, &watcher, &delegate));
+
+  RunUntilIdleDelegate run_delegate(pump);
+  pump->Run(&run_delegate);
+}
+
+TEST_F(MessagePumpEpollTest, OneShotWatchFiresOnce) {
+  scoped_refptr<MessagePumpLibevent> pump(new MessagePumpLibevent);
+  MessagePumpLibevent::FileDescriptorWatcher watcher;
+  CountingWatcher delegate;
+  ASSERT_TRUE(pump->WatchFileDescriptor(pipefds_[1],
+      false, MessagePumpLibevent::WATCH_WRITE, &watcher, &delegate));
+
+  RunUntilIdleDelegate run_delegate(pump);
+  pump->Run(&run_delegate);
+  pump->Run(&run_delegate);
+  EXPECT_EQ(1, delegate.write_count());
+
+  // Watching again re-arms the watch.
+  ASSERT_TRUE(pump->WatchFileDescriptor(pipefds_[1],
+      false, MessagePumpLibevent::WATCH_WRITE, &watcher, &delegate));
+  pump->Run(&run_delegate);
+  EXPECT_EQ(2, delegate.write_count());
+  EXPECT_EQ(0, delegate.read_count());
+}
+
+TEST_F(MessagePumpEpollTest, TwoControllersOnOneDescriptor) {
+  int sockets[2];
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sockets));
+  char buf = 0;
+  ASSERT_EQ(1, HANDLE_EINTR(write(sockets[1], &buf, 1)));
+
+  scoped_refptr<MessagePumpLibevent> pump(new MessagePumpLibevent);
+  CountingWatcher read_delegate;
+  CountingWatcher write_delegate;
+  {
+    MessagePumpLibevent::FileDescriptorWatcher read_watcher;
+    MessagePumpLibevent::FileDescriptorWatcher write_watcher;
+    ASSERT_TRUE(pump->WatchFileDescriptor(sockets[0],
+        false, MessagePumpLibevent::WATCH_READ, &read_watcher,
+        &read_delegate));
+    ASSERT_TRUE(pump->WatchFileDescriptor(sockets[0],
+        false, MessagePumpLibevent::WATCH_WRITE, &write_watcher,
+        &write_delegate));
+
+    RunUntilIdleDelegate run_delegate(pump);
+    pump->Run(&run_delegate);
+    EXPECT_EQ(1, read_delegate.read_count());
+    EXPECT_EQ(0, read_delegate.write_count());
+    EXPECT_EQ(0, write_delegate.read_count());
+    EXPECT_EQ(1, write_delegate.write_count());
+
+    // Stopping one watch leaves the other one alone.
+    EXPECT_TRUE(write_watcher.StopWatchingFileDescriptor());
+    ASSERT_TRUE(pump->WatchFileDescriptor(sockets[0],
+        false, MessagePumpLibevent::WATCH_READ, &read_watcher,
+        &read_delegate));
+    pump->Run(&run_delegate);
+    EXPECT_EQ(2, read_delegate.read_count());
+    EXPECT_EQ(1, write_delegate.write_count());
+  }
+
+  if (HANDLE_EINTR(close(sockets[0])) < 0)
+    PLOG(ERROR) << "close";
+  if (HANDLE_EINTR(close(sockets[1])) < 0)
+    PLOG(ERROR) << "close";
+}
+
+TEST_F(MessagePumpEpollTest, PostTaskFromOtherThread) {
+  WaitableEvent event(false, false);
+  io_loop()->PostTask(FROM_HERE,
+                      Bind(&WaitableEvent::Signal, Unretained(&event)));
+  EXPECT_TRUE(event.TimedWait(TimeDelta::FromSeconds(10)));
+}
+
+#endif  // defined(OS_LINUX)
+
 }  // namespace
 
 }  // namespace base
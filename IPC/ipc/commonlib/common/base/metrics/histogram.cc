@@ -18,6 +18,7 @@
 #include "base/debug/alias.h"
 #include "base/logging.h"
 #include "base/metrics/sample_vector.h"
+#include "base/metrics/shared_histogram_allocator.h"
 #include "base/metrics/statistics_recorder.h"
 #include "base/pickle.h"
 #include "base/string_util.h"
@@ -105,6 +106,7 @@ HistogramBase* Histogram::FactoryGet(const string& name,
         new Histogram(name, minimum, maximum, bucket_count, registered_ranges);
 
     tentative_histogram->SetFlags(flags);
+    tentative_histogram->AllocateSharedSamples();
     histogram =
         StatisticsRecorder::RegisterOrDeleteDuplicate(tentative_histogram);
   }
@@ -262,7 +264,7 @@ void Histogram::Add(int value) {
     value = kSampleType_MAX - 1;
   if (value < 0)
     value = 0;
-  samples_->Accumulate(value, 1);
+  GetSampleShard()->Accumulate(value, 1);
 }
 
 scoped_ptr<HistogramSamples> Histogram::SnapshotSamples() const {
@@ -270,11 +272,11 @@ scoped_ptr<HistogramSamples> Histogram::SnapshotSamples() const {
 }
 
 void Histogram::AddSamples(const HistogramSamples& samples) {
-  samples_->Add(samples);
+  GetSampleShard()->Add(samples);
 }
 
 bool Histogram::AddSamplesFromPickle(PickleIterator* iter) {
-  return samples_->AddFromPickle(iter);
+  return GetSampleShard()->AddFromPickle(iter);
 }
 
 // The following methods provide a graphical histogram display.
@@ -309,8 +311,8 @@ Histogram::Histogram(const string& name,
     declared_min_(minimum),
     declared_max_(maximum),
     bucket_count_(bucket_count) {
-  if (ranges)
-    samples_.reset(new SampleVector(ranges));
+  for (size_t i = 0; i < kMaxSampleShards; ++i)
+    sample_shards_[i] = 0;
 }
 
 Histogram::~Histogram() {
@@ -319,6 +321,14 @@ Histogram::~Histogram() {
     WriteAsciiImpl(true, "\n", &output);
     DLOG(INFO) << output;
   }
+  for (size_t i = 0; i < kMaxSampleShards; ++i)
+    delete reinterpret_cast<SampleVector*>(sample_shards_[i]);
+}
+
+void Histogram::AllocateSharedSamples() {
+  SharedHistogramAllocator* allocator = SharedHistogramAllocator::GetGlobal();
+  if (allocator)
+    shared_samples_ = allocator->AllocateSamples(this);
 }
 
 bool Histogram::PrintEmptyBucket(size_t index) const {
@@ -378,10 +388,35 @@ HistogramBase* Histogram::DeserializeInfoImpl(PickleIterator* iter) {
 
 scoped_ptr<SampleVector> Histogram::SnapshotSampleVector() const {
   scoped_ptr<SampleVector> samples(new SampleVector(bucket_ranges()));
-  samples->Add(*samples_);
+  for (size_t i = 0; i < kMaxSampleShards; ++i) {
+    const SampleVector* shard = reinterpret_cast<const SampleVector*>(
+        subtle::Acquire_Load(&sample_shards_[i]));
+    if (shard)
+      samples->Add(*shard);
+  }
+  if (shared_samples_.get())
+    samples->Add(*shared_samples_);
   return samples.Pass();
 }
 
+SampleVector* Histogram::GetSampleShard() {
+  if (shared_samples_.get())
+    return shared_samples_.get();
+
+  subtle::AtomicWord* shard = &sample_shards_[GetCurrentSampleShard()];
+  subtle::AtomicWord samples = subtle::Acquire_Load(shard);
+  if (samples)
+    return reinterpret_cast<SampleVector*>(samples);
+
+  // Another thread given the same shard may be creating it too.
+  scoped_ptr<SampleVector> new_samples(new SampleVector(bucket_ranges_));
+  samples = subtle::Release_CompareAndSwap(
+      shard, 0, reinterpret_cast<subtle::AtomicWord>(new_samples.get()));
+  if (samples)
+    return reinterpret_cast<SampleVector*>(samples);
+  return new_samples.release();
+}
+
 void Histogram::WriteAsciiImpl(bool graph_it,
                                const string& newline,
                                string* output) const {
@@ -593,6 +628,7 @@ HistogramBase* LinearHistogram::FactoryGetWithRangeDescription(
     }
 
     tentative_histogram->SetFlags(flags);
+    tentative_histogram->AllocateSharedSamples();
     histogram =
         StatisticsRecorder::RegisterOrDeleteDuplicate(tentative_histogram);
   }
@@ -692,6 +728,7 @@ HistogramBase* BooleanHistogram::FactoryGet(const string& name, int32 flags) {
         new BooleanHistogram(name, registered_ranges);
 
     tentative_histogram->SetFlags(flags);
+    tentative_histogram->AllocateSharedSamples();
     histogram =
         StatisticsRecorder::RegisterOrDeleteDuplicate(tentative_histogram);
   }
@@ -750,6 +787,7 @@ HistogramBase* CustomHistogram::FactoryGet(const string& name,
         new CustomHistogram(name, registered_ranges);
 
     tentative_histogram->SetFlags(flags);
+    tentative_histogram->AllocateSharedSamples();
 
     histogram =
         StatisticsRecorder::RegisterOrDeleteDuplicate(tentative_histogram);
@@ -76,6 +76,7 @@
 #include "base/metrics/bucket_ranges.h"
 #include "base/metrics/histogram_base.h"
 #include "base/metrics/histogram_samples.h"
+#include "base/metrics/sample_shards.h"
 #include "base/time.h"
 
 class Pickle;
@@ -457,6 +458,11 @@ class BASE_EXPORT Histogram : public HistogramBase {
 
   virtual ~Histogram();
 
+  // Keeps the samples in the global SharedHistogramAllocator, if there is one
+  // and it has room. Called by the factories before registering a new
+  // histogram.
+  void AllocateSharedSamples();
+
   // HistogramBase implementation:
   virtual bool SerializeInfoImpl(Pickle* pickle) const OVERRIDE;
 
@@ -489,6 +495,10 @@ class BASE_EXPORT Histogram : public HistogramBase {
   // Implementation of SnapshotSamples function.
   scoped_ptr<SampleVector> SnapshotSampleVector() const;
 
+  // Returns the samples of the calling thread's shard, creating them if need
+  // be, or the shared samples if there are some.
+  SampleVector* GetSampleShard();
+
   //----------------------------------------------------------------------------
   // Helpers for emitting Ascii graphic.  Each method appends data to output.
 
@@ -533,8 +543,14 @@ class BASE_EXPORT Histogram : public HistogramBase {
   size_t bucket_count_;  // Dimension of counts_[].
 
   // Finally, provide the state that changes with the addition of each new
-  // sample.
-  scoped_ptr<SampleVector> samples_;
+  // sample. Each shard is a SampleVector*, set when a thread first adds to it;
+  // see sample_shards.h.
+  subtle::AtomicWord sample_shards_[kMaxSampleShards];
+
+  // The samples, when they are kept in memory shared with another process.
+  // All threads add to them, as there is one set of counts per histogram in
+  // the shared memory.
+  scoped_ptr<SampleVector> shared_samples_;
 
   DISALLOW_COPY_AND_ASSIGN(Histogram);
 };
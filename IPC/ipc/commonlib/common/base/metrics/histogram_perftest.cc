@@ -0,0 +1,154 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <string>
+
+#include "base/memory/scoped_ptr.h"
+#include "base/memory/scoped_vector.h"
+#include "base/metrics/bucket_ranges.h"
+#include "base/metrics/histogram.h"
+#include "base/metrics/sample_map.h"
+#include "base/metrics/sample_vector.h"
+#include "base/metrics/sparse_histogram.h"
+#include "base/perftimer.h"
+#include "base/stringprintf.h"
+#include "base/synchronization/lock.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/threading/simple_thread.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+// Measures adding samples to one histogram from 1 to 16 threads at once, for
+// each kind of histogram and for the unsharded storage histograms used before
+// sample_shards.h: one SampleVector, and one SampleMap behind one lock.
+
+namespace base {
+namespace {
+
+const int kThreadCounts[] = { 1, 2, 4, 8, 16 };
+const int kSamplesPerThread = 1000000;
+
+const HistogramBase::Sample kMaximum = 1000;
+const size_t kBucketCount = 50;
+
+class SampleRecorder {
+ public:
+  virtual ~SampleRecorder() {}
+  virtual void Add(HistogramBase::Sample value) = 0;
+};
+
+class HistogramRecorder : public SampleRecorder {
+ public:
+  explicit HistogramRecorder(HistogramBase* histogram)
+      : histogram_(histogram) {}
+
+  virtual void Add(HistogramBase::Sample value) OVERRIDE {
+    histogram_->Add(value);
+  }
+
+ private:
+  HistogramBase* histogram_;
+};
+
+// What Histogram::Add() did with a single SampleVector.
+class SharedSampleVectorRecorder : public SampleRecorder {
+ public:
+  SharedSampleVectorRecorder() : ranges_(kBucketCount + 1) {
+    Histogram::InitializeBucketRanges(1, kMaximum, kBucketCount, &ranges_);
+    samples_.reset(new SampleVector(&ranges_));
+  }
+
+  virtual void Add(HistogramBase::Sample value) OVERRIDE {
+    samples_->Accumulate(value, 1);
+  }
+
+ private:
+  BucketRanges ranges_;
+  scoped_ptr<SampleVector> samples_;
+};
+
+// What SparseHistogram::Add() did with a single lock.
+class LockedSampleMapRecorder : public SampleRecorder {
+ public:
+  virtual void Add(HistogramBase::Sample value) OVERRIDE {
+    AutoLock auto_lock(lock_);
+    samples_.Accumulate(value, 1);
+  }
+
+ private:
+  Lock lock_;
+  SampleMap samples_;
+};
+
+class RecordingThread : public DelegateSimpleThread::Delegate {
+ public:
+  RecordingThread(SampleRecorder* recorder, WaitableEvent* start)
+      : recorder_(recorder), start_(start) {}
+
+  virtual void Run() OVERRIDE {
+    start_->Wait();
+    for (int i = 0; i < kSamplesPerThread; ++i)
+      recorder_->Add(i % kMaximum);
+  }
+
+ private:
+  SampleRecorder* recorder_;
+  WaitableEvent* start_;
+};
+
+// Adds kSamplesPerThread samples to |recorder| from each of |thread_count|
+// threads, and logs how long it took.
+void RunRecordingBenchmark(const char* name,
+                           SampleRecorder* recorder,
+                           int thread_count) {
+  WaitableEvent start(true, false);
+  ScopedVector<RecordingThread> delegates;
+  ScopedVector<DelegateSimpleThread> threads;
+  for (int i = 0; i < thread_count; ++i) {
+    delegates.push_back(new RecordingThread(recorder, &start));
+    threads.push_back(new DelegateSimpleThread(delegates.back(), name));
+    threads.back()->Start();
+  }
+
+  PerfTimer timer;
+  start.Signal();
+  for (int i = 0; i < thread_count; ++i)
+    threads[i]->Join();
+  TimeDelta elapsed = timer.Elapsed();
+
+  int total = thread_count * kSamplesPerThread;
+  std::string test_name = StringPrintf("%s_%d", name, thread_count);
+  LogPerfResult(test_name.c_str(), elapsed.InMillisecondsF(), "ms");
+  LogPerfResult((test_name + "_throughput").c_str(),
+                total / elapsed.InSecondsF(), "samples/s");
+}
+
+TEST(HistogramPerfTest, ContendedAdd) {
+  for (size_t i = 0; i < arraysize(kThreadCounts); ++i) {
+    int thread_count = kThreadCounts[i];
+    std::string suffix = StringPrintf("%d", thread_count);
+
+    SharedSampleVectorRecorder shared_sample_vector;
+    RunRecordingBenchmark("SharedSampleVector", &shared_sample_vector,
+                          thread_count);
+    HistogramRecorder histogram(Histogram::FactoryGet(
+        "HistogramPerfTest.Histogram" + suffix, 1, kMaximum, kBucketCount,
+        HistogramBase::kNoFlags));
+    RunRecordingBenchmark("Histogram", &histogram, thread_count);
+    HistogramRecorder linear_histogram(LinearHistogram::FactoryGet(
+        "HistogramPerfTest.LinearHistogram" + suffix, 1, kMaximum,
+        kBucketCount, HistogramBase::kNoFlags));
+    RunRecordingBenchmark("LinearHistogram", &linear_histogram, thread_count);
+
+    LockedSampleMapRecorder locked_sample_map;
+    RunRecordingBenchmark("LockedSampleMap", &locked_sample_map,
+                          thread_count);
+    HistogramRecorder sparse_histogram(SparseHistogram::FactoryGet(
+        "HistogramPerfTest.SparseHistogram" + suffix,
+        HistogramBase::kNoFlags));
+    RunRecordingBenchmark("SparseHistogram", &sparse_histogram, thread_count);
+  }
+}
+
+}  // namespace
+}  // namespace base
@@ -58,13 +58,18 @@ void SampleCountPickleIterator::Get(HistogramBase::Sample* min,
 
 }  // namespace
 
-HistogramSamples::HistogramSamples() : sum_(0), redundant_count_(0) {}
+HistogramSamples::HistogramSamples() : meta_(&local_meta_) {
+  meta_->sum = 0;
+  meta_->redundant_count = 0;
+}
+
+HistogramSamples::HistogramSamples(Metadata* meta) : meta_(meta) {}
 
 HistogramSamples::~HistogramSamples() {}
 
 void HistogramSamples::Add(const HistogramSamples& other) {
-  sum_ += other.sum();
-  redundant_count_ += other.redundant_count();
+  meta_->sum += other.sum();
+  meta_->redundant_count += other.redundant_count();
   bool success = AddSubtractImpl(other.Iterator().get(), ADD);
   DCHECK(success);
 }
@@ -75,22 +80,23 @@ bool HistogramSamples::AddFromPickle(PickleIterator* iter) {
 
   if (!iter->ReadInt64(&sum) || !iter->ReadInt(&redundant_count))
     return false;
-  sum_ += sum;
-  redundant_count_ += redundant_count;
+  meta_->sum += sum;
+  meta_->redundant_count += redundant_count;
 
   SampleCountPickleIterator pickle_iter(iter);
   return AddSubtractImpl(&pickle_iter, ADD);
 }
 
 void HistogramSamples::Subtract(const HistogramSamples& other) {
-  sum_ -= other.sum();
-  redundant_count_ -= other.redundant_count();
+  meta_->sum -= other.sum();
+  meta_->redundant_count -= other.redundant_count();
   bool success = AddSubtractImpl(other.Iterator().get(), SUBTRACT);
   DCHECK(success);
 }
 
 bool HistogramSamples::Serialize(Pickle* pickle) const {
-  if (!pickle->WriteInt64(sum_) || !pickle->WriteInt(redundant_count_))
+  if (!pickle->WriteInt64(meta_->sum) ||
+      !pickle->WriteInt(meta_->redundant_count))
     return false;
 
   HistogramBase::Sample min;
@@ -109,11 +115,11 @@ bool HistogramSamples::Serialize(Pickle* pickle) const {
 }
 
 void HistogramSamples::IncreaseSum(int64 diff) {
-  sum_ += diff;
+  meta_->sum += diff;
 }
 
 void HistogramSamples::IncreaseRedundantCount(HistogramBase::Count diff) {
-  redundant_count_ += diff;
+  meta_->redundant_count += diff;
 }
 
 SampleCountIterator::~SampleCountIterator() {}
@@ -19,7 +19,25 @@ class SampleCountIterator;
 // HistogramSamples is a container storing all samples of a histogram.
 class BASE_EXPORT HistogramSamples {
  public:
+  // The totals kept beside the sample counts. They are in a struct of their
+  // own so that they can be placed in memory shared with another process,
+  // see SharedHistogramAllocator.
+  struct Metadata {
+    int64 sum;
+
+    // |redundant_count| helps identify memory corruption. It redundantly
+    // stores the total number of samples accumulated in the histogram. We can
+    // compare this count to the sum of the counts (TotalCount() function), and
+    // detect problems. Note, depending on the implementation of different
+    // histogram types, there might be races during histogram accumulation and
+    // snapshotting that we choose to accept. In this case, the tallies might
+    // mismatch even when no memory corruption has happened.
+    HistogramBase::Count redundant_count;
+  };
+
   HistogramSamples();
+  // Keeps the totals in |meta|, which must outlive this object.
+  explicit HistogramSamples(Metadata* meta);
   virtual ~HistogramSamples();
 
   virtual void Accumulate(HistogramBase::Sample value,
@@ -38,8 +56,10 @@ class BASE_EXPORT HistogramSamples {
   virtual bool Serialize(Pickle* pickle) const;
 
   // Accessor fuctions.
-  int64 sum() const { return sum_; }
-  HistogramBase::Count redundant_count() const { return redundant_count_; }
+  int64 sum() const { return meta_->sum; }
+  HistogramBase::Count redundant_count() const {
+    return meta_->redundant_count;
+  }
 
  protected:
   // Based on |op| type, add or subtract sample counts data from the iterator.
@@ -50,16 +70,9 @@ class BASE_EXPORT HistogramSamples {
   void IncreaseRedundantCount(HistogramBase::Count diff);
 
  private:
-  int64 sum_;
-
-  // |redundant_count_| helps identify memory corruption. It redundantly stores
-  // the total number of samples accumulated in the histogram. We can compare
-  // this count to the sum of the counts (TotalCount() function), and detect
-  // problems. Note, depending on the implementation of different histogram
-  // types, there might be races during histogram accumulation and snapshotting
-  // that we choose to accept. In this case, the tallies might mismatch even
-  // when no memory corruption has happened.
-  HistogramBase::Count redundant_count_;
+  // Holds |sum| and |redundant_count| unless they are kept elsewhere.
+  Metadata local_meta_;
+  Metadata* meta_;
 };
 
 class BASE_EXPORT SampleCountIterator {
@@ -15,6 +15,7 @@
 #include "base/metrics/sample_vector.h"
 #include "base/metrics/statistics_recorder.h"
 #include "base/pickle.h"
+#include "base/threading/simple_thread.h"
 #include "base/time.h"
 #include "testing/gtest/include/gtest/gtest.h"
 
@@ -306,6 +307,56 @@ TEST_F(HistogramTest, BucketPlacementTest) {
     EXPECT_EQ(i + 1, samples->GetCountAtIndex(i));
 }
 
+namespace {
+
+class AddSamplesThread : public DelegateSimpleThread::Delegate {
+ public:
+  AddSamplesThread(HistogramBase* histogram, int value)
+      : histogram_(histogram), value_(value) {}
+
+  virtual void Run() OVERRIDE {
+    for (int i = 0; i < value_; ++i)
+      histogram_->Add(value_);
+  }
+
+ private:
+  HistogramBase* histogram_;
+  int value_;
+};
+
+}  // namespace
+
+// Threads record into shards of their own when there are processors enough,
+// and snapshots add the shards together.
+TEST_F(HistogramTest, SamplesFromManyThreads) {
+  const int kNumThreads = 20;
+  HistogramBase* histogram = LinearHistogram::FactoryGet(
+      "Threads", 1, kNumThreads + 1, kNumThreads + 2,
+      HistogramBase::kNoFlags);
+
+  // Run the threads one after another, as threads that share a shard can
+  // race.
+  for (int i = 1; i <= kNumThreads; ++i) {
+    AddSamplesThread delegate(histogram, i);
+    DelegateSimpleThread thread(&delegate, "AddSamplesThread");
+    thread.Start();
+    thread.Join();
+  }
+  histogram->Add(0);
+
+  scoped_ptr<HistogramSamples> samples = histogram->SnapshotSamples();
+  EXPECT_EQ(1, samples->GetCount(0));
+  int64 sum = 0;
+  for (int i = 1; i <= kNumThreads; ++i) {
+    EXPECT_EQ(i, samples->GetCount(i));
+    sum += i * i;
+  }
+  EXPECT_EQ(sum, samples->sum());
+  EXPECT_EQ(samples->TotalCount(), samples->redundant_count());
+  EXPECT_EQ(HistogramBase::NO_INCONSISTENCIES,
+            histogram->FindCorruption(*samples));
+}
+
 TEST_F(HistogramTest, CorruptSampleCounts) {
   Histogram* histogram = static_cast<Histogram*>(
       Histogram::FactoryGet("Histogram", 1, 64, 8, HistogramBase::kNoFlags));
@@ -0,0 +1,60 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/metrics/sample_shards.h"
+
+#include <algorithm>
+
+#include "base/atomicops.h"
+#include "base/lazy_instance.h"
+#include "base/sys_info.h"
+#include "base/threading/thread_local.h"
+
+namespace base {
+
+namespace {
+
+// The shard of the calling thread, plus one so that NULL means none yet.
+LazyInstance<ThreadLocalPointer<void> >::Leaky g_current_shard =
+    LAZY_INSTANCE_INITIALIZER;
+
+// The number of threads that have been given a shard.
+subtle::Atomic32 g_num_threads = 0;
+
+// The number of shards in use, or 0 until the first sample.
+subtle::Atomic32 g_num_shards = 0;
+
+size_t GetNumShards() {
+  subtle::Atomic32 num_shards = subtle::NoBarrier_Load(&g_num_shards);
+  if (!num_shards) {
+    num_shards = static_cast<subtle::Atomic32>(std::min(
+        static_cast<size_t>(std::max(SysInfo::NumberOfProcessors(), 1)),
+        kMaxSampleShards));
+    subtle::NoBarrier_Store(&g_num_shards, num_shards);
+  }
+  return num_shards;
+}
+
+}  // namespace
+
+size_t GetCurrentSampleShard() {
+  // With one processor there is nothing to shard, so skip the thread local
+  // lookup.
+  size_t num_shards = GetNumShards();
+  if (num_shards == 1)
+    return 0;
+
+  ThreadLocalPointer<void>* current_shard = g_current_shard.Pointer();
+  size_t shard_plus_one = reinterpret_cast<size_t>(current_shard->Get());
+  if (shard_plus_one)
+    return shard_plus_one - 1;
+
+  uint32 thread_number =
+      static_cast<uint32>(subtle::NoBarrier_AtomicIncrement(&g_num_threads, 1));
+  size_t shard = (thread_number - 1) % num_shards;
+  current_shard->Set(reinterpret_cast<void*>(shard + 1));
+  return shard;
+}
+
+}  // namespace base
@@ -0,0 +1,28 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Histograms keep their samples in shards and record each sample into the
+// shard of the calling thread, so that threads adding to the same histogram
+// rarely write to the same memory. Snapshots add the shards together.
+
+#ifndef BASE_METRICS_SAMPLE_SHARDS_H_
+#define BASE_METRICS_SAMPLE_SHARDS_H_
+
+#include "base/base_export.h"
+#include "base/basictypes.h"
+
+namespace base {
+
+// The most shards a histogram keeps its samples in.
+const size_t kMaxSampleShards = 16;
+
+// Returns the shard the calling thread records samples into, which is below
+// kMaxSampleShards. Each thread is given one the first time it asks, taking
+// turns over one shard per processor, so threads only share a shard when
+// there are more of them than processors.
+BASE_EXPORT_PRIVATE size_t GetCurrentSampleShard();
+
+}  // namespace base
+
+#endif  // BASE_METRICS_SAMPLE_SHARDS_H_
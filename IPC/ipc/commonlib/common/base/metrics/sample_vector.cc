@@ -15,8 +15,22 @@ typedef HistogramBase::Count Count;
 typedef HistogramBase::Sample Sample;
 
 SampleVector::SampleVector(const BucketRanges* bucket_ranges)
-    : counts_(bucket_ranges->size() - 1),
-      bucket_ranges_(bucket_ranges) {
+    : local_counts_(bucket_ranges->size() - 1),
+      counts_(&local_counts_[0]),
+      counts_size_(local_counts_.size()),
+      bucket_ranges_(bucket_ranges),
+      linear_(HasLinearRanges(bucket_ranges)) {
+  CHECK_GE(bucket_ranges_->size(), 2u);
+}
+
+SampleVector::SampleVector(const BucketRanges* bucket_ranges,
+                           Count* counts,
+                           HistogramSamples::Metadata* meta)
+    : HistogramSamples(meta),
+      counts_(counts),
+      counts_size_(bucket_ranges->size() - 1),
+      bucket_ranges_(bucket_ranges),
+      linear_(HasLinearRanges(bucket_ranges)) {
   CHECK_GE(bucket_ranges_->size(), 2u);
 }
 
@@ -36,20 +50,20 @@ Count SampleVector::GetCount(Sample value) const {
 
 Count SampleVector::TotalCount() const {
   Count count = 0;
-  for (size_t i = 0; i < counts_.size(); i++) {
+  for (size_t i = 0; i < counts_size_; i++) {
     count += counts_[i];
   }
   return count;
 }
 
 Count SampleVector::GetCountAtIndex(size_t bucket_index) const {
-  DCHECK(bucket_index < counts_.size());
+  DCHECK(bucket_index < counts_size_);
   return counts_[bucket_index];
 }
 
 scoped_ptr<SampleCountIterator> SampleVector::Iterator() const {
   return scoped_ptr<SampleCountIterator>(
-      new SampleVectorIterator(&counts_, bucket_ranges_));
+      new SampleVectorIterator(counts_, counts_size_, bucket_ranges_));
 }
 
 bool SampleVector::AddSubtractImpl(SampleCountIterator* iter,
@@ -60,7 +74,7 @@ bool SampleVector::AddSubtractImpl(SampleCountIterator* iter,
 
   // Go through the iterator and add the counts into correct bucket.
   size_t index = 0;
-  while (index < counts_.size() && !iter->Done()) {
+  while (index < counts_size_ && !iter->Done()) {
     iter->Get(&min, &max, &count);
     if (min == bucket_ranges_->range(index) &&
         max == bucket_ranges_->range(index + 1)) {
@@ -80,13 +94,15 @@ bool SampleVector::AddSubtractImpl(SampleCountIterator* iter,
   return iter->Done();
 }
 
-// Use simple binary search.  This is very general, but there are better
-// approaches if we knew that the buckets were linearly distributed.
+// Use simple binary search, unless the buckets are known to be linearly
+// distributed.
 size_t SampleVector::GetBucketIndex(Sample value) const {
   size_t bucket_count = bucket_ranges_->size() - 1;
   CHECK_GE(bucket_count, 1u);
   CHECK_GE(value, bucket_ranges_->range(0));
   CHECK_LT(value, bucket_ranges_->range(bucket_count));
+  if (linear_)
+    return GetLinearBucketIndex(value);
 
   size_t under = 0;
   size_t over = bucket_count;
@@ -107,19 +123,73 @@ size_t SampleVector::GetBucketIndex(Sample value) const {
   return mid;
 }
 
+// static
+bool SampleVector::HasLinearRanges(const BucketRanges* bucket_ranges) {
+  size_t bucket_count = bucket_ranges->size() - 1;
+  if (bucket_count < 3)
+    return false;
+  // See LinearHistogram::InitializeBucketRanges().
+  double min = bucket_ranges->range(1);
+  double max = bucket_ranges->range(bucket_count - 1);
+  if (max <= min)
+    return false;
+  for (size_t i = 1; i < bucket_count; ++i) {
+    double linear_range =
+        (min * (bucket_count - 1 - i) + max * (i - 1)) / (bucket_count - 2);
+    if (bucket_ranges->range(i) != static_cast<Sample>(linear_range + 0.5))
+      return false;
+  }
+  return true;
+}
+
+size_t SampleVector::GetLinearBucketIndex(Sample value) const {
+  size_t bucket_count = bucket_ranges_->size() - 1;
+  Sample min = bucket_ranges_->range(1);
+  Sample max = bucket_ranges_->range(bucket_count - 1);
+  if (value < min)
+    return 0;
+  if (value >= max)
+    return bucket_count - 1;
+
+  // Rounding the ranges to integers can put |value| a bucket either side of
+  // the one it would be in with exact ranges.
+  size_t index = 1 + static_cast<size_t>(
+      static_cast<int64>(value - min) * (bucket_count - 2) / (max - min));
+  if (bucket_ranges_->range(index) > value)
+    --index;
+  else if (bucket_ranges_->range(index + 1) <= value)
+    ++index;
+
+  DCHECK_LE(bucket_ranges_->range(index), value);
+  CHECK_GT(bucket_ranges_->range(index + 1), value);
+  return index;
+}
+
 SampleVectorIterator::SampleVectorIterator(const vector<Count>* counts,
                                            const BucketRanges* bucket_ranges)
+    : counts_(counts->empty() ? NULL : &(*counts)[0]),
+      counts_size_(counts->size()),
+      bucket_ranges_(bucket_ranges),
+      index_(0) {
+  CHECK_GT(bucket_ranges_->size(), counts_size_);
+  SkipEmptyBuckets();
+}
+
+SampleVectorIterator::SampleVectorIterator(const Count* counts,
+                                           size_t counts_size,
+                                           const BucketRanges* bucket_ranges)
     : counts_(counts),
+      counts_size_(counts_size),
       bucket_ranges_(bucket_ranges),
       index_(0) {
-  CHECK_GT(bucket_ranges_->size(), counts_->size());
+  CHECK_GT(bucket_ranges_->size(), counts_size_);
   SkipEmptyBuckets();
 }
 
 SampleVectorIterator::~SampleVectorIterator() {}
 
 bool SampleVectorIterator::Done() const {
-  return index_ >= counts_->size();
+  return index_ >= counts_size_;
 }
 
 void SampleVectorIterator::Next() {
@@ -137,7 +207,7 @@ void SampleVectorIterator::Get(HistogramBase::Sample* min,
   if (max != NULL)
     *max = bucket_ranges_->range(index_ + 1);
   if (count != NULL)
-    *count = (*counts_)[index_];
+    *count = counts_[index_];
 }
 
 bool SampleVectorIterator::GetBucketIndex(size_t* index) const {
@@ -151,8 +221,8 @@ void SampleVectorIterator::SkipEmptyBuckets() {
   if (Done())
     return;
 
-  while (index_ < counts_->size()) {
-    if ((*counts_)[index_] != 0)
+  while (index_ < counts_size_) {
+    if (counts_[index_] != 0)
       return;
     index_++;
   }
@@ -22,6 +22,13 @@ class BucketRanges;
 class BASE_EXPORT_PRIVATE SampleVector : public HistogramSamples {
  public:
   explicit SampleVector(const BucketRanges* bucket_ranges);
+  // Keeps the counts in |counts|, which has bucket_ranges->size() - 1
+  // elements, and the totals in |meta|. Both must outlive this object, and are
+  // used as they are: they may hold the samples of an earlier SampleVector,
+  // such as one in another process.
+  SampleVector(const BucketRanges* bucket_ranges,
+               HistogramBase::Count* counts,
+               HistogramSamples::Metadata* meta);
   virtual ~SampleVector();
 
   // HistogramSamples implementation:
@@ -43,12 +50,25 @@ class BASE_EXPORT_PRIVATE SampleVector : public HistogramSamples {
   virtual size_t GetBucketIndex(HistogramBase::Sample value) const;
 
  private:
+  // Returns true if the ranges between the underflow and overflow buckets are
+  // the evenly spaced ones LinearHistogram makes.
+  static bool HasLinearRanges(const BucketRanges* bucket_ranges);
 
-  std::vector<HistogramBase::Count> counts_;
+  // GetBucketIndex() for linear ranges, which computes the index instead of
+  // searching for it.
+  size_t GetLinearBucketIndex(HistogramBase::Sample value) const;
+
+  // Holds the counts unless they are kept elsewhere.
+  std::vector<HistogramBase::Count> local_counts_;
+
+  HistogramBase::Count* const counts_;
+  const size_t counts_size_;
 
   // Shares the same BucketRanges with Histogram object.
   const BucketRanges* const bucket_ranges_;
 
+  const bool linear_;
+
   DISALLOW_COPY_AND_ASSIGN(SampleVector);
 };
 
@@ -56,6 +76,9 @@ class BASE_EXPORT_PRIVATE SampleVectorIterator : public SampleCountIterator {
  public:
   SampleVectorIterator(const std::vector<HistogramBase::Count>* counts,
                        const BucketRanges* bucket_ranges);
+  SampleVectorIterator(const HistogramBase::Count* counts,
+                       size_t counts_size,
+                       const BucketRanges* bucket_ranges);
   virtual ~SampleVectorIterator();
 
   // SampleCountIterator implementation:
@@ -71,7 +94,8 @@ class BASE_EXPORT_PRIVATE SampleVectorIterator : public SampleCountIterator {
  private:
   void SkipEmptyBuckets();
 
-  const std::vector<HistogramBase::Count>* counts_;
+  const HistogramBase::Count* counts_;
+  size_t counts_size_;
   const BucketRanges* bucket_ranges_;
 
   size_t index_;
@@ -86,6 +86,43 @@ TEST(SampleVectorTest, AddSubtractTest) {
   EXPECT_EQ(samples1.redundant_count(), samples1.TotalCount());
 }
 
+// Linear ranges have their bucket index computed rather than searched for;
+// check it against a scan of the ranges.
+TEST(SampleVectorTest, LinearBucketIndexTest) {
+  struct {
+    HistogramBase::Sample minimum;
+    HistogramBase::Sample maximum;
+    size_t bucket_count;
+  } layouts[] = {
+    { 1, 2, 3 },       // BooleanHistogram.
+    { 1, 100, 101 },   // An enumeration.
+    { 1, 1000, 50 },
+    { 7, 1234, 97 },
+    { 10, 20, 4 },
+  };
+  for (size_t i = 0; i < arraysize(layouts); ++i) {
+    BucketRanges ranges(layouts[i].bucket_count + 1);
+    LinearHistogram::InitializeBucketRanges(layouts[i].minimum,
+                                            layouts[i].maximum,
+                                            layouts[i].bucket_count,
+                                            &ranges);
+    SampleVector samples(&ranges);
+    vector<HistogramBase::Count> expected(layouts[i].bucket_count);
+    for (HistogramBase::Sample value = 0;
+         value <= layouts[i].maximum + 2; ++value) {
+      samples.Accumulate(value, 1);
+      size_t index = 0;
+      while (ranges.range(index + 1) <= value)
+        ++index;
+      ++expected[index];
+    }
+    for (size_t index = 0; index < expected.size(); ++index) {
+      EXPECT_EQ(expected[index], samples.GetCountAtIndex(index))
+          << "layout " << i << ", bucket " << index;
+    }
+  }
+}
+
 #if (!defined(NDEBUG) || defined(DCHECK_ALWAYS_ON)) && GTEST_HAS_DEATH_TEST
 TEST(SampleVectorDeathTest, BucketIndexTest) {
   // 8 buckets with exponential layout:
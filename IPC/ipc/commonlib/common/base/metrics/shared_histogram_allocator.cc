@@ -0,0 +1,416 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/metrics/shared_histogram_allocator.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "base/atomicops.h"
+#include "base/base_switches.h"
+#include "base/command_line.h"
+#include "base/logging.h"
+#include "base/metrics/bucket_ranges.h"
+#include "base/metrics/histogram.h"
+#include "base/metrics/histogram_base.h"
+#include "base/metrics/histogram_samples.h"
+#include "base/metrics/sample_vector.h"
+#include "base/metrics/statistics_recorder.h"
+#include "base/pickle.h"
+
+namespace base {
+
+namespace {
+
+typedef HistogramBase::Count Count;
+typedef HistogramBase::Sample Sample;
+
+const uint32 kSegmentMagic = 0x54534948;  // "HIST"
+const uint32 kSegmentVersion = 1;
+
+// Records start at multiples of this, so that their int64s are aligned.
+const uint32 kAlignment = 8;
+
+// Bounds the size of a record, so that laying one out can't overflow.
+const uint32 kMaxInfoSize = 4096;
+
+struct SegmentHeader {
+  uint32 magic;
+  uint32 version;
+  uint32 size;
+
+  // The bytes allocated so far, this header included. Only advanced once the
+  // size of the record it moves past is set.
+  subtle::Atomic32 used;
+};
+
+struct RecordHeader {
+  // Set once the rest of the record is filled in.
+  subtle::Atomic32 complete;
+
+  // Set when the record is allocated, before SegmentHeader::used moves past
+  // it, so that a reader can skip the record before it is complete, or if
+  // its writer crashed.
+  subtle::Atomic32 size;
+
+  uint32 info_size;
+  uint32 bucket_count;
+};
+
+// Where the parts of a record are, relative to its start.
+struct RecordLayout {
+  uint32 info_offset;
+  uint32 ranges_offset;
+  uint32 meta_offset;
+  uint32 counts_offset;
+  uint32 size;
+};
+
+uint32 AlignUp(uint32 size) {
+  return (size + kAlignment - 1) & ~(kAlignment - 1);
+}
+
+uint32 SegmentStart() {
+  return AlignUp(sizeof(SegmentHeader));
+}
+
+bool ComputeRecordLayout(uint32 info_size,
+                         uint32 bucket_count,
+                         RecordLayout* layout) {
+  if (info_size > kMaxInfoSize || bucket_count < 1 ||
+      bucket_count > Histogram::kBucketCount_MAX) {
+    return false;
+  }
+  layout->info_offset = AlignUp(sizeof(RecordHeader));
+  layout->ranges_offset = AlignUp(layout->info_offset + info_size);
+  layout->meta_offset = AlignUp(layout->ranges_offset +
+                                (bucket_count + 1) * sizeof(Sample));
+  layout->counts_offset =
+      AlignUp(layout->meta_offset + sizeof(HistogramSamples::Metadata));
+  layout->size = AlignUp(layout->counts_offset + bucket_count * sizeof(Count));
+  return true;
+}
+
+// Returns true if |info| describes a kind of histogram that is placed in the
+// segment, and this process has no histogram of that name or has one made the
+// same way, so that DeserializeHistogramInfo() won't fail a CHECK on it.
+bool MatchesLocalHistogram(const Pickle& info) {
+  PickleIterator iter(info);
+  int type;
+  std::string name;
+  int flags;
+  int declared_min;
+  int declared_max;
+  uint64 bucket_count;
+  if (!iter.ReadInt(&type) ||
+      !iter.ReadString(&name) ||
+      !iter.ReadInt(&flags) ||
+      !iter.ReadInt(&declared_min) ||
+      !iter.ReadInt(&declared_max) ||
+      !iter.ReadUInt64(&bucket_count)) {
+    return false;
+  }
+  if (type != HISTOGRAM && type != LINEAR_HISTOGRAM &&
+      type != BOOLEAN_HISTOGRAM && type != CUSTOM_HISTOGRAM) {
+    return false;
+  }
+  HistogramBase* histogram = StatisticsRecorder::FindHistogram(name);
+  return !histogram ||
+      (histogram->GetHistogramType() == type &&
+       histogram->HasConstructionArguments(declared_min, declared_max,
+                                           bucket_count));
+}
+
+SharedHistogramAllocator* g_allocator = NULL;
+
+}  // namespace
+
+// A histogram of the other process that MergeDeltas() has read.
+struct SharedHistogramAllocator::Record {
+  // The histogram of the same name in this process, and its ranges.
+  HistogramBase* histogram;
+  const BucketRanges* ranges;
+
+  // The samples in the segment.
+  scoped_ptr<SampleVector> shared_samples;
+
+  // The samples already added to |histogram|.
+  scoped_ptr<SampleVector> merged_samples;
+};
+
+// static
+const size_t SharedHistogramAllocator::kDefaultSize = 512 * 1024;
+
+SharedHistogramAllocator::~SharedHistogramAllocator() {
+  if (owns_name_)
+    shared_memory_->Delete(name_);
+}
+
+// static
+scoped_ptr<SharedHistogramAllocator> SharedHistogramAllocator::Create(
+    const std::string& name,
+    size_t size) {
+  if (size < SegmentStart() || size > kint32max)
+    return scoped_ptr<SharedHistogramAllocator>();
+
+  // Start from a new segment, not one left behind by an earlier process.
+  scoped_ptr<SharedMemory> shared_memory(new SharedMemory());
+  shared_memory->Delete(name);
+  if (!shared_memory->CreateNamed(name, false, size) ||
+      !shared_memory->Map(size)) {
+    DLOG(ERROR) << "Couldn't create histogram segment " << name;
+    return scoped_ptr<SharedHistogramAllocator>();
+  }
+
+  SegmentHeader* header = static_cast<SegmentHeader*>(shared_memory->memory());
+  header->magic = kSegmentMagic;
+  header->version = kSegmentVersion;
+  header->size = static_cast<uint32>(size);
+  subtle::Release_Store(&header->used, SegmentStart());
+  return scoped_ptr<SharedHistogramAllocator>(new SharedHistogramAllocator(
+      name, shared_memory.Pass(), size, true));
+}
+
+// static
+scoped_ptr<SharedHistogramAllocator> SharedHistogramAllocator::Open(
+    const std::string& name) {
+  // Map the header to learn the size of the segment, then map all of it.
+  scoped_ptr<SharedMemory> shared_memory(new SharedMemory());
+  if (!shared_memory->Open(name, false) ||
+      !shared_memory->Map(sizeof(SegmentHeader))) {
+    DLOG(ERROR) << "Couldn't open histogram segment " << name;
+    return scoped_ptr<SharedHistogramAllocator>();
+  }
+  const SegmentHeader* header =
+      static_cast<const SegmentHeader*>(shared_memory->memory());
+  if (header->magic != kSegmentMagic || header->version != kSegmentVersion ||
+      header->size < SegmentStart()) {
+    DLOG(ERROR) << name << " is not a histogram segment";
+    return scoped_ptr<SharedHistogramAllocator>();
+  }
+  size_t size = header->size;
+  if (!shared_memory->Unmap() || !shared_memory->Map(size))
+    return scoped_ptr<SharedHistogramAllocator>();
+  return scoped_ptr<SharedHistogramAllocator>(new SharedHistogramAllocator(
+      name, shared_memory.Pass(), size, false));
+}
+
+// static
+void SharedHistogramAllocator::SetGlobal(
+    scoped_ptr<SharedHistogramAllocator> allocator) {
+  DCHECK(!g_allocator);
+  g_allocator = allocator.release();
+}
+
+// static
+SharedHistogramAllocator* SharedHistogramAllocator::GetGlobal() {
+  return g_allocator;
+}
+
+// static
+void SharedHistogramAllocator::InitGlobalFromCommandLine(
+    const CommandLine& command_line) {
+  if (!command_line.HasSwitch(switches::kHistogramSharedMemory))
+    return;
+  scoped_ptr<SharedHistogramAllocator> allocator = Open(
+      command_line.GetSwitchValueASCII(switches::kHistogramSharedMemory));
+  if (allocator.get())
+    SetGlobal(allocator.Pass());
+}
+
+scoped_ptr<SampleVector> SharedHistogramAllocator::AllocateSamples(
+    Histogram* histogram) {
+  // Like a histogram sent over IPC, this is the source of the samples the
+  // other process adds to its own histogram.
+  histogram->SetFlags(HistogramBase::kIPCSerializationSourceFlag);
+  Pickle info;
+  if (!histogram->SerializeInfo(&info))
+    return scoped_ptr<SampleVector>();
+
+  const BucketRanges* ranges = histogram->bucket_ranges();
+  uint32 bucket_count = static_cast<uint32>(ranges->size() - 1);
+  RecordLayout layout;
+  if (!ComputeRecordLayout(info.size(), bucket_count, &layout))
+    return scoped_ptr<SampleVector>();
+  uint32 offset = Allocate(layout.size);
+  if (!offset) {
+    DLOG(WARNING) << "Histogram segment " << name_ << " is full, "
+                  << histogram->histogram_name() << " is kept in this process";
+    return scoped_ptr<SampleVector>();
+  }
+
+  char* record = memory() + offset;
+  RecordHeader* header = reinterpret_cast<RecordHeader*>(record);
+  header->info_size = info.size();
+  header->bucket_count = bucket_count;
+  memcpy(record + layout.info_offset, info.data(), info.size());
+  Sample* shared_ranges =
+      reinterpret_cast<Sample*>(record + layout.ranges_offset);
+  for (uint32 i = 0; i <= bucket_count; ++i)
+    shared_ranges[i] = ranges->range(i);
+  HistogramSamples::Metadata* meta =
+      reinterpret_cast<HistogramSamples::Metadata*>(record + layout.meta_offset);
+  meta->sum = 0;
+  meta->redundant_count = 0;
+  Count* counts = reinterpret_cast<Count*>(record + layout.counts_offset);
+  memset(counts, 0, bucket_count * sizeof(Count));
+  subtle::Release_Store(&header->complete, 1);
+
+  return scoped_ptr<SampleVector>(new SampleVector(ranges, counts, meta));
+}
+
+size_t SharedHistogramAllocator::MergeDeltas() {
+  const SegmentHeader* header =
+      reinterpret_cast<const SegmentHeader*>(memory());
+  uint32 used = static_cast<uint32>(subtle::Acquire_Load(&header->used));
+  uint32 limit = std::min(used, static_cast<uint32>(size_));
+
+  // Retry the records that weren't complete the last time.
+  std::vector<uint32> incomplete_offsets;
+  incomplete_offsets.swap(incomplete_offsets_);
+  for (size_t i = 0; i < incomplete_offsets.size(); ++i)
+    ReadRecord(incomplete_offsets[i]);
+
+  while (read_offset_ < limit) {
+    uint32 record_size = GetRecordSize(read_offset_, limit);
+    if (!record_size) {
+      DLOG(ERROR) << "Corrupt histogram record in " << name_;
+      break;
+    }
+    ReadRecord(read_offset_);
+    read_offset_ += record_size;
+  }
+
+  for (size_t i = 0; i < records_.size(); ++i) {
+    Record* record = records_[i];
+    SampleVector delta(record->ranges);
+    delta.Add(*record->shared_samples);
+    delta.Subtract(*record->merged_samples);
+    record->merged_samples->Add(delta);
+    record->histogram->AddSamples(delta);
+  }
+  return records_.size();
+}
+
+SharedHistogramAllocator::SharedHistogramAllocator(
+    const std::string& name,
+    scoped_ptr<SharedMemory> shared_memory,
+    size_t size,
+    bool owns_name)
+    : name_(name),
+      shared_memory_(shared_memory.Pass()),
+      size_(size),
+      owns_name_(owns_name),
+      read_offset_(SegmentStart()) {
+}
+
+uint32 SharedHistogramAllocator::Allocate(uint32 size) {
+  DCHECK_GE(size, sizeof(RecordHeader));
+  DCHECK_EQ(0u, size % kAlignment);
+  SegmentHeader* header = reinterpret_cast<SegmentHeader*>(memory());
+  while (true) {
+    // The memory past |used| is still zero. A record is claimed by setting
+    // its size there, and only then is |used| moved past it, by its writer
+    // or by whichever writer finds it claimed first.
+    subtle::Atomic32 used = subtle::Acquire_Load(&header->used);
+    uint32 offset = static_cast<uint32>(used);
+    if (offset < SegmentStart() || offset > size_ || size > size_ - offset)
+      return 0;
+    RecordHeader* record = reinterpret_cast<RecordHeader*>(memory() + offset);
+    uint32 claimed_size = static_cast<uint32>(subtle::Acquire_CompareAndSwap(
+        &record->size, 0, static_cast<subtle::Atomic32>(size)));
+    if (!claimed_size) {
+      subtle::Release_CompareAndSwap(
+          &header->used, used, static_cast<subtle::Atomic32>(offset + size));
+      return offset;
+    }
+    if (claimed_size < sizeof(RecordHeader) || claimed_size % kAlignment ||
+        claimed_size > size_ - offset) {
+      return 0;
+    }
+    subtle::Release_CompareAndSwap(
+        &header->used, used,
+        static_cast<subtle::Atomic32>(offset + claimed_size));
+  }
+}
+
+uint32 SharedHistogramAllocator::GetRecordSize(uint32 offset,
+                                               uint32 limit) const {
+  if (offset > limit || sizeof(RecordHeader) > limit - offset)
+    return 0;
+  const RecordHeader* header =
+      reinterpret_cast<const RecordHeader*>(memory() + offset);
+  uint32 size = static_cast<uint32>(subtle::NoBarrier_Load(&header->size));
+  if (size < sizeof(RecordHeader) || size % kAlignment ||
+      size > limit - offset) {
+    return 0;
+  }
+  return size;
+}
+
+void SharedHistogramAllocator::ReadRecord(uint32 offset) {
+  const char* record = memory() + offset;
+  const RecordHeader* header = reinterpret_cast<const RecordHeader*>(record);
+  if (!subtle::Acquire_Load(&header->complete)) {
+    incomplete_offsets_.push_back(offset);
+    return;
+  }
+
+  // Copy the header, as the other process may change it under us.
+  uint32 record_size = static_cast<uint32>(
+      subtle::NoBarrier_Load(&header->size));
+  uint32 info_size = header->info_size;
+  uint32 bucket_count = header->bucket_count;
+  RecordLayout layout;
+  if (!ComputeRecordLayout(info_size, bucket_count, &layout) ||
+      layout.size != record_size || record_size > size_ - offset) {
+    DLOG(ERROR) << "Corrupt histogram record in " << name_;
+    return;
+  }
+
+  std::string info(record + layout.info_offset, info_size);
+  Pickle pickle(info.data(), info.size());
+  if (!MatchesLocalHistogram(pickle)) {
+    DLOG(ERROR) << "Histogram record in " << name_
+                << " doesn't match this process's histogram";
+    return;
+  }
+  PickleIterator iter(pickle);
+  HistogramBase* histogram = DeserializeHistogramInfo(&iter);
+  if (!histogram)
+    return;
+  if (histogram->flags() & HistogramBase::kIPCSerializationSourceFlag) {
+    DVLOG(1) << "Single process mode, histogram observed and not copied: "
+             << histogram->histogram_name();
+    return;
+  }
+
+  // The other process must have bucketed its samples as this one does.
+  const BucketRanges* ranges =
+      static_cast<Histogram*>(histogram)->bucket_ranges();
+  if (ranges->size() != bucket_count + 1)
+    return;
+  const Sample* shared_ranges =
+      reinterpret_cast<const Sample*>(record + layout.ranges_offset);
+  for (uint32 i = 0; i <= bucket_count; ++i) {
+    if (shared_ranges[i] != ranges->range(i))
+      return;
+  }
+
+  char* writable_record = memory() + offset;
+  scoped_ptr<Record> result(new Record);
+  result->histogram = histogram;
+  result->ranges = ranges;
+  result->shared_samples.reset(new SampleVector(
+      ranges,
+      reinterpret_cast<Count*>(writable_record + layout.counts_offset),
+      reinterpret_cast<HistogramSamples::Metadata*>(
+          writable_record + layout.meta_offset)));
+  result->merged_samples.reset(new SampleVector(ranges));
+  records_.push_back(result.release());
+}
+
+}  // namespace base
@@ -0,0 +1,133 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// SharedHistogramAllocator places the samples of histograms in a SharedMemory
+// segment, so that another process can read them without an IPC round trip,
+// and so that they outlive the process that records them.
+//
+// The parent process creates a segment for each child process with Create(),
+// and names it on the child's command line with
+// switches::kHistogramSharedMemory. The child opens it with Open() and makes
+// it the global allocator with SetGlobal(); from then on, the Histogram
+// factories place the BucketRanges, the counts and the sum of each new
+// histogram in the segment. The parent calls MergeDeltas() whenever it wants
+// the child's samples, including after the child has exited or crashed.
+//
+// Each histogram takes one record in the segment:
+//   RecordHeader
+//   the histogram's info, as HistogramBase::SerializeInfo() pickles it
+//   the BucketRanges, bucket_count + 1 Samples
+//   HistogramSamples::Metadata
+//   the counts, bucket_count Counts
+// Records are appended, and only marked complete once they are filled in, so
+// the parent can read the segment while the child adds to it. The size of a
+// record is set before the segment's end moves past it, so the parent can
+// skip a record that isn't complete yet, and come back to it later; the
+// records after one the child crashed while writing are still merged. The
+// parent checks every record, as the child may have been compromised.
+//
+// SparseHistogram does not keep its samples in a SampleVector, and is not
+// placed in the segment.
+
+#ifndef BASE_METRICS_SHARED_HISTOGRAM_ALLOCATOR_H_
+#define BASE_METRICS_SHARED_HISTOGRAM_ALLOCATOR_H_
+
+#include <string>
+#include <vector>
+
+#include "base/base_export.h"
+#include "base/basictypes.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/memory/scoped_vector.h"
+#include "base/shared_memory.h"
+
+class CommandLine;
+
+namespace base {
+
+class Histogram;
+class SampleVector;
+
+class BASE_EXPORT SharedHistogramAllocator {
+ public:
+  // The size of the segment ChildProcessLauncher creates for each child.
+  static const size_t kDefaultSize;
+
+  ~SharedHistogramAllocator();
+
+  // Creates a segment of |size| bytes named |name| for another process to
+  // place its histograms in. Returns NULL on failure.
+  static scoped_ptr<SharedHistogramAllocator> Create(const std::string& name,
+                                                     size_t size);
+
+  // Opens the segment named |name| that another process created. Returns NULL
+  // on failure, or if it is not a histogram segment.
+  static scoped_ptr<SharedHistogramAllocator> Open(const std::string& name);
+
+  // Makes |allocator| the one the Histogram factories place new histograms
+  // in. It is leaked, like the histograms placed in it. Call before creating
+  // the histograms of interest, and only once.
+  static void SetGlobal(scoped_ptr<SharedHistogramAllocator> allocator);
+  static SharedHistogramAllocator* GetGlobal();
+
+  // Opens the segment named by switches::kHistogramSharedMemory on
+  // |command_line|, if any, and makes it the global allocator.
+  static void InitGlobalFromCommandLine(const CommandLine& command_line);
+
+  // Places the samples of |histogram|, which has just been constructed, in
+  // the segment. Returns a SampleVector that keeps its counts and totals
+  // there, or NULL if the segment is full.
+  scoped_ptr<SampleVector> AllocateSamples(Histogram* histogram);
+
+  // Adds the samples that the other process has recorded since the last call
+  // to the histograms of the same names in this process, creating them if
+  // need be. Returns the number of histograms read from the segment.
+  size_t MergeDeltas();
+
+  const std::string& name() const { return name_; }
+
+ private:
+  struct Record;
+
+  SharedHistogramAllocator(const std::string& name,
+                           scoped_ptr<SharedMemory> shared_memory,
+                           size_t size,
+                           bool owns_name);
+
+  friend class SharedHistogramAllocatorTest;
+
+  // Reserves a record of |size| bytes at the end of the segment, and sets its
+  // size. Returns its offset, or 0 if the segment is full.
+  uint32 Allocate(uint32 size);
+
+  // Returns the size of the record at |offset|, or 0 if it doesn't fit below
+  // |limit|.
+  uint32 GetRecordSize(uint32 offset, uint32 limit) const;
+
+  // Reads the record at |offset| for MergeDeltas(), and adds it to |records_|
+  // if it can be merged, or to |incomplete_offsets_| if it isn't complete.
+  void ReadRecord(uint32 offset);
+
+  char* memory() const { return static_cast<char*>(shared_memory_->memory()); }
+
+  const std::string name_;
+  scoped_ptr<SharedMemory> shared_memory_;
+  const size_t size_;
+
+  // True if this process created the segment, and so deletes its name.
+  const bool owns_name_;
+
+  // The records MergeDeltas() has read, and the offset of the next one.
+  ScopedVector<Record> records_;
+  uint32 read_offset_;
+
+  // The records MergeDeltas() has passed that weren't complete yet.
+  std::vector<uint32> incomplete_offsets_;
+
+  DISALLOW_COPY_AND_ASSIGN(SharedHistogramAllocator);
+};
+
+}  // namespace base
+
+#endif  // BASE_METRICS_SHARED_HISTOGRAM_ALLOCATOR_H_
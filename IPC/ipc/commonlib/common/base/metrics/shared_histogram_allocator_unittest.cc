@@ -0,0 +1,200 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/metrics/shared_histogram_allocator.h"
+
+#include <string>
+
+#include "base/memory/scoped_ptr.h"
+#include "base/metrics/histogram.h"
+#include "base/metrics/sample_vector.h"
+#include "base/metrics/statistics_recorder.h"
+#include "base/process_util.h"
+#include "base/stringprintf.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+class SharedHistogramAllocatorTest : public testing::Test {
+ protected:
+  SharedHistogramAllocatorTest()
+      : statistics_recorder_(NULL),
+        name_(StringPrintf("SharedHistogramAllocatorTest.%d",
+                           static_cast<int>(GetCurrentProcId()))) {
+    ResetStatisticsRecorder();
+  }
+
+  virtual ~SharedHistogramAllocatorTest() {
+    delete statistics_recorder_;
+  }
+
+  // The parent and the child process share one StatisticsRecorder in a
+  // test, so the parent's histograms are made after the child's are dropped.
+  void ResetStatisticsRecorder() {
+    delete statistics_recorder_;
+    statistics_recorder_ = new StatisticsRecorder();
+  }
+
+  // Places the samples of a new Histogram named |name| with |allocator|, as
+  // the factories do with the global allocator.
+  scoped_ptr<SampleVector> AllocateHistogram(
+      SharedHistogramAllocator* allocator,
+      const std::string& name) {
+    HistogramBase* histogram = Histogram::FactoryGet(
+        name, 1, 1000, 10, HistogramBase::kNoFlags);
+    return allocator->AllocateSamples(static_cast<Histogram*>(histogram));
+  }
+
+  // Reserves a record in |allocator| and leaves it incomplete, as a process
+  // that crashed while writing it would.
+  uint32 AllocateIncompleteRecord(SharedHistogramAllocator* allocator) {
+    return allocator->Allocate(64);
+  }
+
+  StatisticsRecorder* statistics_recorder_;
+  const std::string name_;
+};
+
+TEST_F(SharedHistogramAllocatorTest, MergesDeltas) {
+  scoped_ptr<SharedHistogramAllocator> parent =
+      SharedHistogramAllocator::Create(name_, 64 * 1024);
+  ASSERT_TRUE(parent.get());
+  scoped_ptr<SharedHistogramAllocator> child =
+      SharedHistogramAllocator::Open(name_);
+  ASSERT_TRUE(child.get());
+
+  scoped_ptr<SampleVector> samples = AllocateHistogram(child.get(), "Test");
+  ASSERT_TRUE(samples.get());
+  samples->Accumulate(5, 2);
+  samples->Accumulate(500, 1);
+  ResetStatisticsRecorder();
+
+  EXPECT_EQ(1u, parent->MergeDeltas());
+  HistogramBase* histogram = StatisticsRecorder::FindHistogram("Test");
+  ASSERT_TRUE(histogram);
+  // It is the parent's histogram, not the child's.
+  EXPECT_FALSE(histogram->flags() & HistogramBase::kIPCSerializationSourceFlag);
+  scoped_ptr<HistogramSamples> snapshot = histogram->SnapshotSamples();
+  EXPECT_EQ(3, snapshot->TotalCount());
+  EXPECT_EQ(2, snapshot->GetCount(5));
+  EXPECT_EQ(1, snapshot->GetCount(500));
+  EXPECT_EQ(510, snapshot->sum());
+
+  // Only what was added since is merged.
+  samples->Accumulate(5, 1);
+  EXPECT_EQ(1u, parent->MergeDeltas());
+  snapshot = histogram->SnapshotSamples();
+  EXPECT_EQ(4, snapshot->TotalCount());
+  EXPECT_EQ(3, snapshot->GetCount(5));
+  EXPECT_EQ(515, snapshot->sum());
+  EXPECT_EQ(4, snapshot->redundant_count());
+
+  // The samples outlive the child.
+  samples->Accumulate(500, 1);
+  samples.reset();
+  child.reset();
+  EXPECT_EQ(1u, parent->MergeDeltas());
+  snapshot = histogram->SnapshotSamples();
+  EXPECT_EQ(5, snapshot->TotalCount());
+  EXPECT_EQ(2, snapshot->GetCount(500));
+}
+
+TEST_F(SharedHistogramAllocatorTest, FailsWhenFull) {
+  scoped_ptr<SharedHistogramAllocator> parent =
+      SharedHistogramAllocator::Create(name_, 512);
+  ASSERT_TRUE(parent.get());
+  scoped_ptr<SharedHistogramAllocator> child =
+      SharedHistogramAllocator::Open(name_);
+  ASSERT_TRUE(child.get());
+
+  size_t allocated = 0;
+  for (int i = 0; i < 10; ++i) {
+    if (AllocateHistogram(child.get(), StringPrintf("Test%d", i)).get())
+      ++allocated;
+  }
+  EXPECT_GT(allocated, 0u);
+  EXPECT_LT(allocated, 10u);
+  ResetStatisticsRecorder();
+  EXPECT_EQ(allocated, parent->MergeDeltas());
+}
+
+TEST_F(SharedHistogramAllocatorTest, SkipsMismatchedRanges) {
+  scoped_ptr<SharedHistogramAllocator> parent =
+      SharedHistogramAllocator::Create(name_, 64 * 1024);
+  ASSERT_TRUE(parent.get());
+  scoped_ptr<SharedHistogramAllocator> child =
+      SharedHistogramAllocator::Open(name_);
+  ASSERT_TRUE(child.get());
+
+  scoped_ptr<SampleVector> samples = AllocateHistogram(child.get(), "Test");
+  ASSERT_TRUE(samples.get());
+  samples->Accumulate(5, 1);
+  scoped_ptr<SampleVector> other_samples =
+      AllocateHistogram(child.get(), "Other");
+  ASSERT_TRUE(other_samples.get());
+  other_samples->Accumulate(5, 1);
+  ResetStatisticsRecorder();
+
+  // The parent buckets "Test" differently, so the child's samples of it can't
+  // be merged; "Other" still is.
+  HistogramBase* histogram = Histogram::FactoryGet(
+      "Test", 1, 1000, 20, HistogramBase::kNoFlags);
+  EXPECT_EQ(1u, parent->MergeDeltas());
+  EXPECT_EQ(0, histogram->SnapshotSamples()->TotalCount());
+  HistogramBase* other = StatisticsRecorder::FindHistogram("Other");
+  ASSERT_TRUE(other);
+  EXPECT_EQ(1, other->SnapshotSamples()->TotalCount());
+}
+
+TEST_F(SharedHistogramAllocatorTest, SkipsOwnHistograms) {
+  scoped_ptr<SharedHistogramAllocator> allocator =
+      SharedHistogramAllocator::Create(name_, 64 * 1024);
+  ASSERT_TRUE(allocator.get());
+
+  // In a single process, the histogram is found rather than copied, and its
+  // samples aren't added to it a second time.
+  scoped_ptr<SampleVector> samples =
+      AllocateHistogram(allocator.get(), "Test");
+  ASSERT_TRUE(samples.get());
+  samples->Accumulate(5, 1);
+  EXPECT_EQ(0u, allocator->MergeDeltas());
+  EXPECT_EQ(1, samples->TotalCount());
+}
+
+TEST_F(SharedHistogramAllocatorTest, SkipsIncompleteRecords) {
+  scoped_ptr<SharedHistogramAllocator> parent =
+      SharedHistogramAllocator::Create(name_, 64 * 1024);
+  ASSERT_TRUE(parent.get());
+  scoped_ptr<SharedHistogramAllocator> child =
+      SharedHistogramAllocator::Open(name_);
+  ASSERT_TRUE(child.get());
+
+  scoped_ptr<SampleVector> before = AllocateHistogram(child.get(), "Before");
+  ASSERT_TRUE(before.get());
+  before->Accumulate(5, 1);
+  EXPECT_NE(0u, AllocateIncompleteRecord(child.get()));
+  scoped_ptr<SampleVector> after = AllocateHistogram(child.get(), "After");
+  ASSERT_TRUE(after.get());
+  after->Accumulate(5, 2);
+  ResetStatisticsRecorder();
+
+  // The records on either side of the incomplete one are merged, again and
+  // again.
+  EXPECT_EQ(2u, parent->MergeDeltas());
+  after->Accumulate(5, 1);
+  EXPECT_EQ(2u, parent->MergeDeltas());
+  HistogramBase* histogram = StatisticsRecorder::FindHistogram("Before");
+  ASSERT_TRUE(histogram);
+  EXPECT_EQ(1, histogram->SnapshotSamples()->TotalCount());
+  histogram = StatisticsRecorder::FindHistogram("After");
+  ASSERT_TRUE(histogram);
+  EXPECT_EQ(3, histogram->SnapshotSamples()->TotalCount());
+}
+
+TEST_F(SharedHistogramAllocatorTest, RejectsOtherSegments) {
+  EXPECT_FALSE(SharedHistogramAllocator::Open(name_).get());
+  EXPECT_FALSE(SharedHistogramAllocator::Create(name_, 4).get());
+}
+
+}  // namespace base
@@ -32,7 +32,10 @@ HistogramBase* SparseHistogram::FactoryGet(const string& name, int32 flags) {
   return histogram;
 }
 
-SparseHistogram::~SparseHistogram() {}
+SparseHistogram::~SparseHistogram() {
+  for (size_t i = 0; i < kMaxSampleShards; ++i)
+    delete reinterpret_cast<SampleShard*>(sample_shards_[i]);
+}
 
 HistogramType SparseHistogram::GetHistogramType() const {
   return SPARSE_HISTOGRAM;
@@ -46,26 +49,35 @@ bool SparseHistogram::HasConstructionArguments(Sample minimum,
 }
 
 void SparseHistogram::Add(Sample value) {
-  base::AutoLock auto_lock(lock_);
-  samples_.Accumulate(value, 1);
+  SampleShard* shard = GetSampleShard();
+  base::AutoLock auto_lock(shard->lock);
+  shard->samples.Accumulate(value, 1);
 }
 
 scoped_ptr<HistogramSamples> SparseHistogram::SnapshotSamples() const {
   scoped_ptr<SampleMap> snapshot(new SampleMap());
 
-  base::AutoLock auto_lock(lock_);
-  snapshot->Add(samples_);
+  for (size_t i = 0; i < kMaxSampleShards; ++i) {
+    SampleShard* shard = reinterpret_cast<SampleShard*>(
+        subtle::Acquire_Load(&sample_shards_[i]));
+    if (!shard)
+      continue;
+    base::AutoLock auto_lock(shard->lock);
+    snapshot->Add(shard->samples);
+  }
   return snapshot.PassAs<HistogramSamples>();
 }
 
 void SparseHistogram::AddSamples(const HistogramSamples& samples) {
-  base::AutoLock auto_lock(lock_);
-  samples_.Add(samples);
+  SampleShard* shard = GetSampleShard();
+  base::AutoLock auto_lock(shard->lock);
+  shard->samples.Add(samples);
 }
 
 bool SparseHistogram::AddSamplesFromPickle(PickleIterator* iter) {
-  base::AutoLock auto_lock(lock_);
-  return samples_.AddFromPickle(iter);
+  SampleShard* shard = GetSampleShard();
+  base::AutoLock auto_lock(shard->lock);
+  return shard->samples.AddFromPickle(iter);
 }
 
 void SparseHistogram::WriteHTMLGraph(string* output) const {
@@ -81,7 +93,25 @@ bool SparseHistogram::SerializeInfoImpl(Pickle* pickle) const {
 }
 
 SparseHistogram::SparseHistogram(const string& name)
-    : HistogramBase(name) {}
+    : HistogramBase(name) {
+  for (size_t i = 0; i < kMaxSampleShards; ++i)
+    sample_shards_[i] = 0;
+}
+
+SparseHistogram::SampleShard* SparseHistogram::GetSampleShard() {
+  subtle::AtomicWord* shard = &sample_shards_[GetCurrentSampleShard()];
+  subtle::AtomicWord sample_shard = subtle::Acquire_Load(shard);
+  if (sample_shard)
+    return reinterpret_cast<SampleShard*>(sample_shard);
+
+  // Another thread given the same shard may be creating it too.
+  scoped_ptr<SampleShard> new_shard(new SampleShard);
+  sample_shard = subtle::Release_CompareAndSwap(
+      shard, 0, reinterpret_cast<subtle::AtomicWord>(new_shard.get()));
+  if (sample_shard)
+    return reinterpret_cast<SampleShard*>(sample_shard);
+  return new_shard.release();
+}
 
 HistogramBase* SparseHistogram::DeserializeInfoImpl(PickleIterator* iter) {
   string histogram_name;
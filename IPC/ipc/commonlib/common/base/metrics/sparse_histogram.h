@@ -8,6 +8,7 @@
 #include <map>
 #include <string>
 
+#include "base/atomicops.h"
 #include "base/base_export.h"
 #include "base/basictypes.h"
 #include "base/compiler_specific.h"
@@ -15,6 +16,7 @@
 #include "base/memory/scoped_ptr.h"
 #include "base/metrics/histogram_base.h"
 #include "base/metrics/sample_map.h"
+#include "base/metrics/sample_shards.h"
 #include "base/synchronization/lock.h"
 
 namespace base {
@@ -93,10 +95,18 @@ class BASE_EXPORT_PRIVATE SparseHistogram : public HistogramBase {
   // For constuctor calling.
   friend class SparseHistogramTest;
 
-  // Protects access to |samples_|.
-  mutable base::Lock lock_;
+  // The samples of one shard; see sample_shards.h.
+  struct SampleShard {
+    // Protects access to |samples|.
+    base::Lock lock;
+    SampleMap samples;
+  };
 
-  SampleMap samples_;
+  // Returns the calling thread's shard, creating it if need be.
+  SampleShard* GetSampleShard();
+
+  // Each shard is a SampleShard*, set when a thread first adds to it.
+  subtle::AtomicWord sample_shards_[kMaxSampleShards];
 
   DISALLOW_COPY_AND_ASSIGN(SparseHistogram);
 };
@@ -12,6 +12,7 @@
 #include "base/metrics/statistics_recorder.h"
 #include "base/pickle.h"
 #include "base/stringprintf.h"
+#include "base/threading/simple_thread.h"
 #include "testing/gtest/include/gtest/gtest.h"
 
 namespace base {
@@ -63,6 +64,41 @@ TEST_F(SparseHistogramTest, BasicTest) {
   EXPECT_EQ(1, snapshot2->GetCount(101));
 }
 
+namespace {
+
+class AddSamplesThread : public DelegateSimpleThread::Delegate {
+ public:
+  explicit AddSamplesThread(HistogramBase* histogram)
+      : histogram_(histogram) {}
+
+  virtual void Run() OVERRIDE {
+    for (int i = 0; i < 1000; ++i)
+      histogram_->Add(i % 10);
+  }
+
+ private:
+  HistogramBase* histogram_;
+};
+
+}  // namespace
+
+TEST_F(SparseHistogramTest, ConcurrentAdd) {
+  const int kNumThreads = 8;
+  scoped_ptr<SparseHistogram> histogram(NewSparseHistogram("Sparse"));
+  AddSamplesThread delegate(histogram.get());
+  DelegateSimpleThreadPool pool("AddSamplesThread", kNumThreads);
+  pool.AddWork(&delegate, kNumThreads);
+  pool.Start();
+  pool.JoinAll();
+
+  // Each shard has its own lock, so no samples are lost.
+  scoped_ptr<HistogramSamples> snapshot(histogram->SnapshotSamples());
+  EXPECT_EQ(kNumThreads * 1000, snapshot->TotalCount());
+  EXPECT_EQ(snapshot->TotalCount(), snapshot->redundant_count());
+  for (int i = 0; i < 10; ++i)
+    EXPECT_EQ(kNumThreads * 100, snapshot->GetCount(i));
+}
+
 TEST_F(SparseHistogramTest, MacroBasicTest) {
   HISTOGRAM_SPARSE_SLOWLY("Sparse", 100);
   HISTOGRAM_SPARSE_SLOWLY("Sparse", 200);
@@ -91,6 +91,7 @@ class BASE_EXPORT StatisticsRecorder {
   friend struct DefaultLazyInstanceTraits<StatisticsRecorder>;
   friend class HistogramBaseTest;
   friend class HistogramTest;
+  friend class SharedHistogramAllocatorTest;
   friend class SparseHistogramTest;
   friend class StatisticsRecorderTest;
 
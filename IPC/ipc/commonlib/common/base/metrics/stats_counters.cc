@@ -41,22 +41,23 @@ int* StatsCounter::GetPtr() {
   if (!table)
     return NULL;
 
+  // Each thread writes to its own slot, which it keeps in TLS.  A counter
+  // may be used by threads other than the one that looked it up, so each
+  // must register itself.
+  int slot = table->GetSlot();
+  if (!slot && !(slot = table->RegisterThread(""))) {
+    // There is no room for this thread.  This thread
+    // cannot use counters.
+    return NULL;
+  }
+
   // If counter_id_ is -1, then we haven't looked it up yet.
-  if (counter_id_ == -1) {
+  if (counter_id_ == -1)
     counter_id_ = table->FindCounter(name_);
-    if (table->GetSlot() == 0) {
-      if (!table->RegisterThread("")) {
-        // There is no room for this thread.  This thread
-        // cannot use counters.
-        counter_id_ = 0;
-        return NULL;
-      }
-    }
-  }
 
   // If counter_id_ is > 0, then we have a valid counter.
   if (counter_id_ > 0)
-    return table->GetLocation(counter_id_, table->GetSlot());
+    return table->GetLocation(counter_id_, slot);
 
   // counter_id_ was zero, which means the table is full.
   return NULL;
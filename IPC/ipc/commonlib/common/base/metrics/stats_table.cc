@@ -4,6 +4,7 @@
 
 #include "base/metrics/stats_table.h"
 
+#include "base/hash.h"
 #include "base/logging.h"
 #include "base/memory/scoped_ptr.h"
 #include "base/process_util.h"
@@ -62,7 +63,9 @@ namespace base {
 // table for faster lookup.  Since the hash table is process specific,
 // each process maintains its own cache.  We avoid complexity here by never
 // de-allocating from the hash table.  (Counters are dynamically added,
-// but not dynamically removed).
+// but not dynamically removed).  That also lets us read the hash table
+// without locking, so only the first lookup of a counter in a process
+// takes a lock.
 
 // In order for external viewers to be able to read our shared memory,
 // we all need to use the same size ints.
@@ -106,6 +109,14 @@ class StatsTable::Private {
   static Private* New(const std::string& name, int size,
                                 int max_threads, int max_counters);
 
+  // Construct a read-only Private for an existing table, or return NULL
+  // if there is none.
+  static Private* Open(const std::string& name);
+
+  // Returns the size of a table with room for |max_threads| threads and
+  // |max_counters| counters.
+  static int ComputeSize(int max_threads, int max_counters);
+
   SharedMemory* shared_memory() { return &shared_memory_; }
 
   // Accessors for our header pointers
@@ -150,6 +161,10 @@ class StatsTable::Private {
   void InitializeTable(void* memory, int size, int max_counters,
                        int max_threads);
 
+  // Maps all of the table whose header is mapped, which may be larger or
+  // smaller than the mapping.  Returns false if it isn't a valid table.
+  bool RemapTable();
+
   // Initializes our in-memory pointers into a pre-created StatsTable.
   void ComputeMappedPointers(void* memory);
 
@@ -177,9 +192,15 @@ StatsTable::Private* StatsTable::Private::New(const std::string& name,
   TableHeader* header = static_cast<TableHeader*>(memory);
 
   // If the version does not match, then assume the table needs
-  // to be initialized.
-  if (header->version != kTableVersion)
+  // to be initialized.  If it does, the table was created with sizes that
+  // override ours.
+  if (header->version != kTableVersion) {
     priv->InitializeTable(memory, size, max_counters, max_threads);
+  } else if (header->size != size) {
+    if (!priv->RemapTable())
+      return NULL;
+    memory = priv->shared_memory_.memory();
+  }
 
   // We have a valid table, so compute our pointers.
   priv->ComputeMappedPointers(memory);
@@ -187,6 +208,40 @@ StatsTable::Private* StatsTable::Private::New(const std::string& name,
   return priv.release();
 }
 
+// static
+StatsTable::Private* StatsTable::Private::Open(const std::string& name) {
+  scoped_ptr<Private> priv(new Private());
+  if (!priv->shared_memory_.Open(name, true))
+    return NULL;
+  if (!priv->shared_memory_.Map(sizeof(TableHeader)))
+    return NULL;
+  if (!priv->RemapTable())
+    return NULL;
+  priv->ComputeMappedPointers(priv->shared_memory_.memory());
+  return priv.release();
+}
+
+// static
+int StatsTable::Private::ComputeSize(int max_threads, int max_counters) {
+  return AlignedSize(sizeof(TableHeader)) +
+      AlignedSize((max_counters * sizeof(char) * kMaxCounterNameLength)) +
+      AlignedSize((max_threads * sizeof(char) * kMaxThreadNameLength)) +
+      AlignedSize(max_threads * sizeof(int)) +
+      AlignedSize(max_threads * sizeof(int)) +
+      AlignedSize((sizeof(int) * (max_counters * max_threads)));
+}
+
+bool StatsTable::Private::RemapTable() {
+  const TableHeader* header =
+      static_cast<const TableHeader*>(shared_memory_.memory());
+  if (header->version != kTableVersion ||
+      header->max_threads < 0 || header->max_counters < 0 ||
+      header->size != ComputeSize(header->max_threads, header->max_counters))
+    return false;
+  int size = header->size;
+  return shared_memory_.Unmap() && shared_memory_.Map(size);
+}
+
 void StatsTable::Private::InitializeTable(void* memory, int size,
                                           int max_counters,
                                           int max_threads) {
@@ -253,19 +308,22 @@ StatsTable* StatsTable::global_table_ = NULL;
 StatsTable::StatsTable(const std::string& name, int max_threads,
                        int max_counters)
     : impl_(NULL),
+      counter_ids_mask_(0),
       tls_index_(SlotReturnFunction) {
-  int table_size =
-    AlignedSize(sizeof(Private::TableHeader)) +
-    AlignedSize((max_counters * sizeof(char) * kMaxCounterNameLength)) +
-    AlignedSize((max_threads * sizeof(char) * kMaxThreadNameLength)) +
-    AlignedSize(max_threads * sizeof(int)) +
-    AlignedSize(max_threads * sizeof(int)) +
-    AlignedSize((sizeof(int) * (max_counters * max_threads)));
+  int table_size = Private::ComputeSize(max_threads, max_counters);
 
   impl_ = Private::New(name, table_size, max_threads, max_counters);
 
   if (!impl_)
     DPLOG(ERROR) << "StatsTable did not initialize";
+  InitCounterIds();
+}
+
+StatsTable::StatsTable(Private* impl)
+    : impl_(impl),
+      counter_ids_mask_(0),
+      tls_index_(SlotReturnFunction) {
+  InitCounterIds();
 }
 
 StatsTable::~StatsTable() {
@@ -285,6 +343,14 @@ StatsTable::~StatsTable() {
     global_table_ = NULL;
 }
 
+// static
+StatsTable* StatsTable::Open(const std::string& name) {
+  Private* impl = Private::Open(name);
+  if (!impl)
+    return NULL;
+  return new StatsTable(impl);
+}
+
 int StatsTable::GetSlot() const {
   TLSData* data = GetTLSData();
   if (!data)
@@ -347,25 +413,27 @@ int StatsTable::FindCounter(const std::string& name) {
   if (!impl_)
     return 0;
 
-  // Create a scope for our auto-lock.
-  {
-    AutoLock scoped_lock(counters_lock_);
+  // Look the counter up by the name it has in the table.
+  if (name.empty())
+    return FindCounter(kUnknownName);
+  if (name.size() >= static_cast<size_t>(kMaxCounterNameLength))
+    return FindCounter(name.substr(0, kMaxCounterNameLength - 1));
 
-    // Attempt to find the counter.
-    CountersMap::const_iterator iter;
-    iter = counters_.find(name);
-    if (iter != counters_.end())
-      return iter->second;
-  }
+  // Attempt to find the counter.
+  int counter_id = FindCachedCounter(name);
+  if (counter_id)
+    return counter_id;
 
-  // Counter does not exist, so add it.
+  // Counter is not in our hash, so find or add it in the table.
   return AddCounter(name);
 }
 
 int* StatsTable::GetLocation(int counter_id, int slot_id) const {
   if (!impl_)
     return NULL;
-  if (slot_id > impl_->max_threads())
+  if (slot_id < 1 || slot_id > impl_->max_threads())
+    return NULL;
+  if (counter_id < 1 || counter_id > impl_->max_counters())
     return NULL;
 
   int* row = impl_->row(counter_id);
@@ -390,7 +458,7 @@ int StatsTable::GetRowValue(int index, int pid) const {
   int rv = 0;
   int* row = impl_->row(index);
   for (int slot_id = 0; slot_id < impl_->max_threads(); slot_id++) {
-    if (pid == 0 || *impl_->thread_pid(slot_id) == pid)
+    if (pid == 0 || *impl_->thread_pid(slot_id + 1) == pid)
       rv += row[slot_id];
   }
   return rv;
@@ -531,21 +599,52 @@ int StatsTable::AddCounter(const std::string& name) {
     if (!counter_id)
       return 0;
 
-    std::string counter_name = name;
-    if (name.empty())
-      counter_name = kUnknownName;
-    strlcpy(impl_->counter_name(counter_id), counter_name.c_str(),
+    strlcpy(impl_->counter_name(counter_id), name.c_str(),
             kMaxCounterNameLength);
   }
 
   // now add to our in-memory cache
-  {
-    AutoLock lock(counters_lock_);
-    counters_[name] = counter_id;
-  }
+  CacheCounter(name, counter_id);
   return counter_id;
 }
 
+void StatsTable::InitCounterIds() {
+  if (!impl_)
+    return;
+  uint32 size = 1;
+  while (size < 2u * impl_->max_counters())
+    size <<= 1;
+  counter_ids_.reset(new subtle::Atomic32[size]);
+  memset(counter_ids_.get(), 0, size * sizeof(subtle::Atomic32));
+  counter_ids_mask_ = size - 1;
+}
+
+int StatsTable::FindCachedCounter(const std::string& name) const {
+  uint32 index = Hash(name) & counter_ids_mask_;
+  while (true) {
+    int counter_id = subtle::Acquire_Load(&counter_ids_[index]);
+    if (!counter_id)
+      return 0;
+    if (!strncmp(impl_->counter_name(counter_id), name.c_str(),
+                 kMaxCounterNameLength))
+      return counter_id;
+    index = (index + 1) & counter_ids_mask_;
+  }
+}
+
+void StatsTable::CacheCounter(const std::string& name, int counter_id) {
+  // Another thread may be caching the same counter.  Both probe the same
+  // entries, so one of them sees the other's.
+  uint32 index = Hash(name) & counter_ids_mask_;
+  while (true) {
+    subtle::Atomic32 previous =
+        subtle::Release_CompareAndSwap(&counter_ids_[index], 0, counter_id);
+    if (!previous || previous == counter_id)
+      return;
+    index = (index + 1) & counter_ids_mask_;
+  }
+}
+
 StatsTable::TLSData* StatsTable::GetTLSData() const {
   TLSData* data =
     static_cast<TLSData*>(tls_index_.Get());
@@ -16,16 +16,21 @@
 // which governs the maximum number of counters and concurrent
 // threads/processes which can use it.
 //
+// Once a counter has been found or added, finding it again takes no lock,
+// and each thread keeps the slot (column) it writes to in TLS, so updating a
+// counter is a plain write to shared memory.  Other processes, such as the
+// stats_viewer tool, read the counters with StatsTable::Open().
+//
 
 #ifndef BASE_METRICS_STATS_TABLE_H_
 #define BASE_METRICS_STATS_TABLE_H_
 
 #include <string>
 
+#include "base/atomicops.h"
 #include "base/base_export.h"
 #include "base/basictypes.h"
-#include "base/hash_tables.h"
-#include "base/synchronization/lock.h"
+#include "base/memory/scoped_ptr.h"
 #include "base/threading/thread_local_storage.h"
 
 namespace base {
@@ -50,6 +55,11 @@ class BASE_EXPORT StatsTable {
   // (across all processes), the StatsTable is removed from disk.
   ~StatsTable();
 
+  // Opens the existing StatsTable named |name| read-only, to view the
+  // counters of the processes using it.  Returns NULL if there is no such
+  // table.  Only the const methods may be called on the result.
+  static StatsTable* Open(const std::string& name);
+
   // For convenience, we create a static table.  This is generally
   // used automatically by the counters.
   static StatsTable* current() { return global_table_; }
@@ -132,7 +142,18 @@ class BASE_EXPORT StatsTable {
  private:
   class Private;
   struct TLSData;
-  typedef hash_map<std::string, int> CountersMap;
+
+  // Used by Open().
+  explicit StatsTable(Private* impl);
+
+  // Sizes |counter_ids_| for the table.
+  void InitCounterIds();
+
+  // Looks |name| up in |counter_ids_|.  Returns 0 if it is not there.
+  int FindCachedCounter(const std::string& name) const;
+
+  // Adds |counter_id|, the row named |name|, to |counter_ids_|.
+  void CacheCounter(const std::string& name, int counter_id);
 
   // Returns the space occupied by a thread in the table.  Generally used
   // if a thread terminates but the process continues.  This function
@@ -159,10 +180,10 @@ class BASE_EXPORT StatsTable {
   int FindCounterOrEmptyRow(const std::string& name) const;
 
   // Internal function to add a counter to the StatsTable.  Assumes that
-  // the counter does not already exist in the table.
+  // the counter is not in |counter_ids_|, though it may be in the table.
   //
-  // name is a unique identifier for this counter, and will be truncated
-  // to kMaxCounterNameLength-1 characters.
+  // name is a unique identifier for this counter, and must already be
+  // truncated to kMaxCounterNameLength-1 characters.
   //
   // On success, returns the counter_id for the newly added counter.
   // On failure, returns 0.
@@ -174,15 +195,16 @@ class BASE_EXPORT StatsTable {
 
   Private* impl_;
 
-  // The counters_lock_ protects the counters_ hash table.
-  base::Lock counters_lock_;
+  // An in-memory, open-addressed hash of the counter ids this process has
+  // looked up, keyed by their names in the table.  An entry only ever goes
+  // from 0 to the id of a counter whose name is already in the table, so it
+  // is read without a lock.  It has room for twice as many counters as the
+  // table, so it never fills up.  It cannot be used as a substitute for
+  // what is in the shared memory: even though we don't have a counter in
+  // our hash, another process may have created it.
+  scoped_array<subtle::Atomic32> counter_ids_;
+  uint32 counter_ids_mask_;
 
-  // The counters_ hash map is an in-memory hash of the counters.
-  // It is used for quick lookup of counters, but is cannot be used
-  // as a substitute for what is in the shared memory.  Even though
-  // we don't have a counter in our hash table, another process may
-  // have created it.
-  CountersMap counters_;
   ThreadLocalStorage::Slot tls_index_;
 
   static StatsTable* global_table_;
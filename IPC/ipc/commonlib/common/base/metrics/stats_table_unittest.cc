@@ -2,8 +2,10 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include "base/memory/scoped_ptr.h"
 #include "base/metrics/stats_counters.h"
 #include "base/metrics/stats_table.h"
+#include "base/process_util.h"
 #include "base/shared_memory.h"
 #include "base/stringprintf.h"
 #include "base/string_piece.h"
@@ -58,6 +60,52 @@ TEST_F(StatsTableTest, VerifySlots) {
   DeleteShmem(kTableName);
 }
 
+// Open one table three times, as several processes would, and verify that
+// counters added through one StatsTable are found through the others.
+TEST_F(StatsTableTest, SharedCounters) {
+  const std::string kTableName = "SharedCountersStatTable";
+  const int kMaxThreads = 2;
+  const int kMaxCounter = 5;
+  DeleteShmem(kTableName);
+  StatsTable table(kTableName, kMaxThreads, kMaxCounter);
+
+  int counter_id = table.FindCounter("counter");
+  EXPECT_GT(counter_id, 0);
+  EXPECT_EQ(counter_id, table.FindCounter("counter"));
+
+  // Long names are found by the truncated names the table keeps.
+  std::string long_name(StatsTable::kMaxCounterNameLength + 10, 'x');
+  int long_counter_id = table.FindCounter(long_name);
+  EXPECT_GT(long_counter_id, 0);
+  EXPECT_NE(counter_id, long_counter_id);
+  EXPECT_EQ(long_counter_id, table.FindCounter(long_name));
+  EXPECT_EQ(long_counter_id, table.FindCounter(
+      long_name.substr(0, StatsTable::kMaxCounterNameLength - 1)));
+
+  int slot_id = table.RegisterThread("mainThread");
+  EXPECT_GT(slot_id, 0);
+  *table.GetLocation(counter_id, slot_id) = 42;
+
+  // The sizes given for a table that exists are ignored.
+  StatsTable other_table(kTableName, 1, 1);
+  EXPECT_EQ(kMaxCounter, other_table.GetMaxCounters());
+  EXPECT_EQ(counter_id, other_table.FindCounter("counter"));
+  EXPECT_EQ(42, other_table.GetCounterValue("counter"));
+
+  scoped_ptr<StatsTable> viewer(StatsTable::Open(kTableName));
+  ASSERT_TRUE(viewer.get());
+  EXPECT_EQ(kMaxThreads, viewer->GetMaxThreads());
+  EXPECT_EQ(kMaxCounter, viewer->GetMaxCounters());
+  EXPECT_STREQ("counter", viewer->GetRowName(counter_id));
+  EXPECT_EQ(42, viewer->GetRowValue(counter_id));
+  EXPECT_EQ(42, viewer->GetRowValue(counter_id, GetCurrentProcId()));
+  EXPECT_EQ(0, viewer->GetRowValue(counter_id, GetCurrentProcId() + 1));
+
+  EXPECT_FALSE(StatsTable::Open("NoSuchStatTable"));
+
+  DeleteShmem(kTableName);
+}
+
 // CounterZero will continually be set to 0.
 const std::string kCounterZero = "CounterZero";
 // Counter1313 will continually be set to 1313.
@@ -0,0 +1,111 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Attaches to the StatsTable of running processes, and prints the value of
+// each counter, and how fast it changed, once per interval.  The processes
+// keep counting without any IPC or locking; this only reads their shared
+// memory.
+//
+// Usage: stats_viewer --table=<name> [--interval-ms=<ms>] [--pid=<pid>]
+//                     [--count=<intervals>]
+//
+// --table names the table, as passed to the StatsTable constructor.
+// --interval-ms is the time between two reports, 1000 by default.
+// --pid only counts the threads of that process.
+// --count stops after that many reports, rather than running until killed.
+
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+#include "base/at_exit.h"
+#include "base/command_line.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/metrics/stats_table.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/threading/platform_thread.h"
+#include "base/time.h"
+
+namespace {
+
+const char kTableSwitch[] = "table";
+const char kIntervalSwitch[] = "interval-ms";
+const char kPidSwitch[] = "pid";
+const char kCountSwitch[] = "count";
+
+const int kDefaultIntervalMs = 1000;
+
+// Reads the integer value of |switch_name|, if it is there.
+bool GetIntSwitch(const CommandLine& command_line,
+                  const char* switch_name,
+                  int* value) {
+  if (!command_line.HasSwitch(switch_name))
+    return true;
+  return base::StringToInt(command_line.GetSwitchValueASCII(switch_name),
+                           value);
+}
+
+// Prints each counter of |table|, with its change since |last_values| over
+// |elapsed|, and updates |last_values|.
+void PrintCounters(const base::StatsTable& table,
+                   int pid,
+                   base::TimeDelta elapsed,
+                   std::vector<int>* last_values) {
+  double seconds = elapsed.InSecondsF();
+  printf("--- %.3f s\n", seconds);
+  for (int index = 1; index <= table.GetMaxCounters(); ++index) {
+    const char* name = table.GetRowName(index);
+    if (!*name)
+      continue;
+    int value = table.GetRowValue(index, pid);
+    int delta = value - (*last_values)[index];
+    (*last_values)[index] = value;
+    printf("%-*s %12d %14.1f/s\n", base::StatsTable::kMaxCounterNameLength,
+           name, value, seconds > 0 ? delta / seconds : 0.0);
+  }
+  fflush(stdout);
+}
+
+}  // namespace
+
+int main(int argc, const char* argv[]) {
+  base::AtExitManager at_exit;
+  CommandLine::Init(argc, argv);
+  const CommandLine& command_line = *CommandLine::ForCurrentProcess();
+
+  std::string table_name = command_line.GetSwitchValueASCII(kTableSwitch);
+  int interval_ms = kDefaultIntervalMs;
+  int pid = 0;
+  int count = 0;
+  if (table_name.empty() ||
+      !GetIntSwitch(command_line, kIntervalSwitch, &interval_ms) ||
+      !GetIntSwitch(command_line, kPidSwitch, &pid) ||
+      !GetIntSwitch(command_line, kCountSwitch, &count) ||
+      interval_ms <= 0) {
+    fprintf(stderr,
+            "Usage: %s --table=<name> [--interval-ms=<ms>] [--pid=<pid>] "
+            "[--count=<intervals>]\n", argv[0]);
+    return 1;
+  }
+
+  scoped_ptr<base::StatsTable> table(base::StatsTable::Open(table_name));
+  if (!table.get()) {
+    fprintf(stderr, "Couldn't open the stats table %s.\n",
+            table_name.c_str());
+    return 1;
+  }
+
+  // The first report counts the whole value of each counter as its change.
+  std::vector<int> last_values(table->GetMaxCounters() + 1, 0);
+  base::TimeTicks last_time = base::TimeTicks::Now();
+  base::TimeDelta interval = base::TimeDelta::FromMilliseconds(interval_ms);
+  for (int reports = 0; !count || reports < count; ++reports) {
+    base::PlatformThread::Sleep(interval);
+    base::TimeTicks now = base::TimeTicks::Now();
+    PrintCounters(*table, pid, now - last_time, &last_values);
+    last_time = now;
+  }
+  return 0;
+}
@@ -7,16 +7,18 @@
 
 #include <algorithm>
 #include <map>
+#include <vector>
 
 #include "base/basictypes.h"
 #include "base/bind.h"
 #include "base/location.h"
 #include "base/logging.h"
 #include "base/memory/ref_counted.h"
+#include "base/memory/scoped_vector.h"
 #include "base/message_loop.h"
 #include "base/message_loop_proxy.h"
 #include "base/observer_list.h"
-#include "base/stl_util.h"
+#include "base/synchronization/lock.h"
 #include "base/threading/platform_thread.h"
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -44,12 +46,25 @@
 //   whereas with the non-thread-safe observer_list, notifications happen
 //   synchronously and immediately.
 //
+//   For notifications that may fire faster than the observers' threads can
+//   keep up with, and where only the latest one matters, NotifyCoalesced()
+//   posts at most one task to each thread at a time.  A notification of a
+//   method that is still waiting to be delivered on a thread replaces the
+//   arguments of the waiting one instead of being delivered separately.
+//
 //   IMPLEMENTATION NOTES
 //   The ObserverListThreadSafe maintains an ObserverList for each thread
 //   which uses the ThreadSafeObserver.  When Notifying the observers,
 //   we simply call PostTask to each registered thread, and then each thread
 //   will notify its regular ObserverList.
 //
+//   The per-thread lists are only ever changed on their own thread, and
+//   only the first AddObserver() and the last RemoveObserver() on a thread
+//   change the set of threads.  Notify() reads that set from an immutable
+//   snapshot which those two replace with an updated copy, so notifying
+//   only holds a lock for as long as it takes to reference the snapshot,
+//   and does not wait on observers being added or removed.
+//
 ///////////////////////////////////////////////////////////////////////////////
 
 // Forward declaration for ObserverListThreadSafeTraits.
@@ -69,11 +84,23 @@ class UnboundMethod {
   void Run(T* obj) const {
     DispatchToMethod(obj, m_, p_);
   }
+  Method method() const { return m_; }
  private:
   Method m_;
   Params p_;
 };
 
+// Tells apart the types of UnboundMethods queued by
+// ObserverListThreadSafe::NotifyCoalesced().  The tag is not const so that
+// the linker cannot fold the tags of different types together.
+template <class Method, class Params>
+struct UnboundMethodTypeTag {
+  static char id;
+};
+
+template <class Method, class Params>
+char UnboundMethodTypeTag<Method, Params>::id = 0;
+
 // This class is used to work around VS2005 not accepting:
 //
 // friend class
@@ -115,9 +142,13 @@ class ObserverListThreadSafe
     base::PlatformThreadId thread_id = base::PlatformThread::CurrentId();
     {
       base::AutoLock lock(list_lock_);
-      if (observer_lists_.find(thread_id) == observer_lists_.end())
-        observer_lists_[thread_id] = new ObserverListContext(type_);
-      list = &(observer_lists_[thread_id]->list);
+      typename ObserversListMap::iterator it = observer_lists_.find(thread_id);
+      if (it == observer_lists_.end()) {
+        it = observer_lists_.insert(std::make_pair(
+            thread_id, new ObserverListContext(type_))).first;
+        UpdateSnapshot();
+      }
+      list = &it->second->list;
     }
     list->AddObserver(obs);
   }
@@ -128,8 +159,8 @@ class ObserverListThreadSafe
   // If the observer to be removed is in the list, RemoveObserver MUST
   // be called from the same thread which called AddObserver.
   void RemoveObserver(ObserverType* obs) {
-    ObserverListContext* context = NULL;
-    ObserverList<ObserverType>* list = NULL;
+    // Keeps the context alive even if it is dropped from the map below.
+    scoped_refptr<ObserverListContext> context;
     base::PlatformThreadId thread_id = base::PlatformThread::CurrentId();
     {
       base::AutoLock lock(list_lock_);
@@ -140,20 +171,16 @@ class ObserverListThreadSafe
         return;
       }
       context = it->second;
-      list = &context->list;
 
       // If we're about to remove the last observer from the list,
-      // then we can remove this observer_list entirely.
-      if (list->HasObserver(obs) && list->size() == 1)
-        observer_lists_.erase(it);
+      // then we can remove this observer_list entirely.  If
+      // RemoveObserver is called from a notification, the size will still
+      // count the removed observers, and NotifyWrapper removes the list
+      // when it finishes iterating instead.
+      if (context->list.HasObserver(obs) && context->list.size() == 1)
+        RemoveContext(it);
     }
-    list->RemoveObserver(obs);
-
-    // If RemoveObserver is called from a notification, the size will be
-    // nonzero.  Instead of deleting here, the NotifyWrapper will delete
-    // when it finishes iterating.
-    if (list->size() == 0)
-      delete context;
+    context->list.RemoveObserver(obs);
   }
 
   // Verifies that the list is currently empty (i.e. there are no observers).
@@ -202,36 +229,229 @@ class ObserverListThreadSafe
 
   // TODO(mbelshe):  Add more wrappers for Notify() with more arguments.
 
+  // Coalescing notify methods.
+  // Like Notify(), but if a notification of the same method is still
+  // waiting to be delivered on an observer's thread, it is delivered once,
+  // with the latest arguments.  Each thread has at most one notification
+  // task in flight for all of the coalesced notifications posted to it.
+  template <class Method>
+  void NotifyCoalesced(Method m) {
+    UnboundMethod<ObserverType, Method, Tuple0> method(m, MakeTuple());
+    NotifyCoalesced<Method, Tuple0>(method);
+  }
+
+  template <class Method, class A>
+  void NotifyCoalesced(Method m, const A& a) {
+    UnboundMethod<ObserverType, Method, Tuple1<A> > method(m, MakeTuple(a));
+    NotifyCoalesced<Method, Tuple1<A> >(method);
+  }
+
+  template <class Method, class A, class B>
+  void NotifyCoalesced(Method m, const A& a, const B& b) {
+    UnboundMethod<ObserverType, Method, Tuple2<A, B> > method(
+        m, MakeTuple(a, b));
+    NotifyCoalesced<Method, Tuple2<A, B> >(method);
+  }
+
+  template <class Method, class A, class B, class C>
+  void NotifyCoalesced(Method m, const A& a, const B& b, const C& c) {
+    UnboundMethod<ObserverType, Method, Tuple3<A, B, C> > method(
+        m, MakeTuple(a, b, c));
+    NotifyCoalesced<Method, Tuple3<A, B, C> >(method);
+  }
+
+  template <class Method, class A, class B, class C, class D>
+  void NotifyCoalesced(Method m, const A& a, const B& b, const C& c,
+                       const D& d) {
+    UnboundMethod<ObserverType, Method, Tuple4<A, B, C, D> > method(
+        m, MakeTuple(a, b, c, d));
+    NotifyCoalesced<Method, Tuple4<A, B, C, D> >(method);
+  }
+
  private:
   // See comment above ObserverListThreadSafeTraits' definition.
   friend struct ObserverListThreadSafeTraits<ObserverType>;
 
-  struct ObserverListContext {
+  // A notification queued by NotifyCoalesced() that has yet to be
+  // delivered.
+  class PendingNotification {
+   public:
+    explicit PendingNotification(const void* type_tag)
+        : type_tag_(type_tag) {
+    }
+    virtual ~PendingNotification() {}
+
+    // The UnboundMethodTypeTag of the method.
+    const void* type_tag() const { return type_tag_; }
+
+    virtual void Run(ObserverType* obs) const = 0;
+
+   private:
+    const void* type_tag_;
+  };
+
+  template <class Method, class Params>
+  class PendingNotificationImpl : public PendingNotification {
+   public:
+    explicit PendingNotificationImpl(
+        const UnboundMethod<ObserverType, Method, Params>& method)
+        : PendingNotification(&UnboundMethodTypeTag<Method, Params>::id),
+          method_(method) {
+    }
+
+    const UnboundMethod<ObserverType, Method, Params>& method() const {
+      return method_;
+    }
+    void set_method(
+        const UnboundMethod<ObserverType, Method, Params>& method) {
+      method_ = method;
+    }
+
+    virtual void Run(ObserverType* obs) const OVERRIDE {
+      method_.Run(obs);
+    }
+
+   private:
+    UnboundMethod<ObserverType, Method, Params> method_;
+  };
+
+  // The observers on one thread.  Referenced from the map and from the
+  // snapshot while the thread has observers, and by the notifications in
+  // flight to it.
+  class ObserverListContext
+      : public base::RefCountedThreadSafe<ObserverListContext> {
+   public:
     explicit ObserverListContext(NotificationType type)
         : loop(base::MessageLoopProxy::current()),
-          list(type) {
+          list(type),
+          removed(false) {
     }
 
     scoped_refptr<base::MessageLoopProxy> loop;
     ObserverList<ObserverType> list;
 
+    // Set once the context is dropped from the map.  Only used on the
+    // context's own thread, like |list|.
+    bool removed;
+
+    base::Lock pending_lock;  // Protects |pending|.
+    // The notifications for the FlushPendingNotifications() task in flight
+    // to |loop|, if any, in the order they were first posted.
+    ScopedVector<PendingNotification> pending;
+
+   private:
+    friend class base::RefCountedThreadSafe<ObserverListContext>;
+
+    ~ObserverListContext() {}
+
     DISALLOW_COPY_AND_ASSIGN(ObserverListContext);
   };
 
-  ~ObserverListThreadSafe() {
-    STLDeleteValues(&observer_lists_);
+  // The threads with observers, as of some point in time.  Never changed
+  // once published.
+  class Snapshot : public base::RefCountedThreadSafe<Snapshot> {
+   public:
+    Snapshot() {}
+
+    std::vector<scoped_refptr<ObserverListContext> > contexts;
+
+   private:
+    friend class base::RefCountedThreadSafe<Snapshot>;
+
+    ~Snapshot() {}
+
+    DISALLOW_COPY_AND_ASSIGN(Snapshot);
+  };
+
+  // Key by PlatformThreadId because in tests, clients can attempt to remove
+  // observers without a MessageLoop. If this were keyed by MessageLoop, that
+  // operation would be silently ignored, leaving garbage in the ObserverList.
+  typedef std::map<base::PlatformThreadId,
+                   scoped_refptr<ObserverListContext> > ObserversListMap;
+
+  ~ObserverListThreadSafe() {}
+
+  // Returns the threads to notify.
+  scoped_refptr<Snapshot> GetSnapshot() const {
+    base::AutoLock lock(snapshot_lock_);
+    return snapshot_;
+  }
+
+  // Publishes a new snapshot of |observer_lists_|.  |list_lock_| must be
+  // held.
+  void UpdateSnapshot() {
+    list_lock_.AssertAcquired();
+    scoped_refptr<Snapshot> snapshot;
+    if (!observer_lists_.empty()) {
+      snapshot = new Snapshot;
+      snapshot->contexts.reserve(observer_lists_.size());
+      for (typename ObserversListMap::const_iterator it =
+               observer_lists_.begin();
+           it != observer_lists_.end(); ++it) {
+        snapshot->contexts.push_back(it->second);
+      }
+    }
+    base::AutoLock lock(snapshot_lock_);
+    snapshot_.swap(snapshot);
+  }
+
+  // Drops the context at |it| from the map.  Must be called on the
+  // context's own thread, with |list_lock_| held.
+  void RemoveContext(typename ObserversListMap::iterator it) {
+    it->second->removed = true;
+    observer_lists_.erase(it);
+    UpdateSnapshot();
   }
 
   template <class Method, class Params>
   void Notify(const UnboundMethod<ObserverType, Method, Params>& method) {
-    base::AutoLock lock(list_lock_);
-    typename ObserversListMap::iterator it;
-    for (it = observer_lists_.begin(); it != observer_lists_.end(); ++it) {
-      ObserverListContext* context = (*it).second;
+    scoped_refptr<Snapshot> snapshot = GetSnapshot();
+    if (!snapshot)
+      return;
+    for (size_t i = 0; i < snapshot->contexts.size(); ++i) {
+      ObserverListContext* context = snapshot->contexts[i].get();
       context->loop->PostTask(
           FROM_HERE,
           base::Bind(&ObserverListThreadSafe<ObserverType>::
-              template NotifyWrapper<Method, Params>, this, context, method));
+              template NotifyWrapper<Method, Params>, this,
+              make_scoped_refptr(context), method));
+    }
+  }
+
+  template <class Method, class Params>
+  void NotifyCoalesced(
+      const UnboundMethod<ObserverType, Method, Params>& method) {
+    typedef PendingNotificationImpl<Method, Params> Impl;
+    const void* type_tag = &UnboundMethodTypeTag<Method, Params>::id;
+
+    scoped_refptr<Snapshot> snapshot = GetSnapshot();
+    if (!snapshot)
+      return;
+    for (size_t i = 0; i < snapshot->contexts.size(); ++i) {
+      ObserverListContext* context = snapshot->contexts[i].get();
+      {
+        base::AutoLock lock(context->pending_lock);
+        bool post_task = context->pending.empty();
+        bool coalesced = false;
+        for (size_t j = 0; j < context->pending.size(); ++j) {
+          if (context->pending[j]->type_tag() != type_tag)
+            continue;
+          Impl* pending = static_cast<Impl*>(context->pending[j]);
+          if (pending->method().method() == method.method()) {
+            pending->set_method(method);
+            coalesced = true;
+            break;
+          }
+        }
+        if (!coalesced)
+          context->pending.push_back(new Impl(method));
+        if (!post_task)
+          continue;
+      }
+      context->loop->PostTask(
+          FROM_HERE,
+          base::Bind(&ObserverListThreadSafe<ObserverType>::
+              FlushPendingNotifications, this, make_scoped_refptr(context)));
     }
   }
 
@@ -239,54 +459,72 @@ class ObserverListThreadSafe
   // ObserverList.  This function MUST be called on the thread which owns
   // the unsafe ObserverList.
   template <class Method, class Params>
-  void NotifyWrapper(ObserverListContext* context,
+  void NotifyWrapper(const scoped_refptr<ObserverListContext>& context,
       const UnboundMethod<ObserverType, Method, Params>& method) {
+    // The ObserverList could have been removed already.  In fact, it could
+    // have been removed and then re-added, as a different context!  Either
+    // way, we do not need to finish this notification.
+    if (context->removed)
+      return;
 
-    // Check that this list still needs notifications.
     {
-      base::AutoLock lock(list_lock_);
-      typename ObserversListMap::iterator it =
-          observer_lists_.find(base::PlatformThread::CurrentId());
-
-      // The ObserverList could have been removed already.  In fact, it could
-      // have been removed and then re-added!  If the master list's loop
-      // does not match this one, then we do not need to finish this
-      // notification.
-      if (it == observer_lists_.end() || it->second != context)
-        return;
+      typename ObserverList<ObserverType>::Iterator it(context->list);
+      ObserverType* obs;
+      while ((obs = it.GetNext()) != NULL)
+        method.Run(obs);
     }
 
+    RemoveContextIfEmpty(context.get());
+  }
+
+  // Delivers the notifications queued by NotifyCoalesced() for |context|.
+  // This function MUST be called on the thread which owns the unsafe
+  // ObserverList.
+  void FlushPendingNotifications(
+      const scoped_refptr<ObserverListContext>& context) {
+    ScopedVector<PendingNotification> pending;
     {
+      base::AutoLock lock(context->pending_lock);
+      pending.swap(context->pending);
+    }
+    if (context->removed)
+      return;
+
+    for (size_t i = 0; i < pending.size(); ++i) {
       typename ObserverList<ObserverType>::Iterator it(context->list);
       ObserverType* obs;
       while ((obs = it.GetNext()) != NULL)
-        method.Run(obs);
+        pending[i]->Run(obs);
     }
 
-    // If there are no more observers on the list, we can now delete it.
-    if (context->list.size() == 0) {
-      {
-        base::AutoLock lock(list_lock_);
-        // Remove |list| if it's not already removed.
-        // This can happen if multiple observers got removed in a notification.
-        // See http://crbug.com/55725.
-        typename ObserversListMap::iterator it =
-            observer_lists_.find(base::PlatformThread::CurrentId());
-        if (it != observer_lists_.end() && it->second == context)
-          observer_lists_.erase(it);
-      }
-      delete context;
-    }
+    RemoveContextIfEmpty(context.get());
   }
 
-  // Key by PlatformThreadId because in tests, clients can attempt to remove
-  // observers without a MessageLoop. If this were keyed by MessageLoop, that
-  // operation would be silently ignored, leaving garbage in the ObserverList.
-  typedef std::map<base::PlatformThreadId, ObserverListContext*>
-      ObserversListMap;
+  // If there are no more observers on the list of |context|, we can now
+  // remove it.
+  void RemoveContextIfEmpty(ObserverListContext* context) {
+    if (context->list.size() != 0)
+      return;
+
+    base::AutoLock lock(list_lock_);
+    // Remove |list| if it's not already removed.
+    // This can happen if multiple observers got removed in a notification.
+    // See http://crbug.com/55725.
+    if (context->removed)
+      return;
+    typename ObserversListMap::iterator it =
+        observer_lists_.find(base::PlatformThread::CurrentId());
+    DCHECK(it != observer_lists_.end() && it->second == context);
+    RemoveContext(it);
+  }
 
   mutable base::Lock list_lock_;  // Protects the observer_lists_.
   ObserversListMap observer_lists_;
+
+  mutable base::Lock snapshot_lock_;  // Protects the snapshot_.
+  // The contexts of |observer_lists_|, or NULL if there are none.
+  scoped_refptr<Snapshot> snapshot_;
+
   const NotificationType type_;
 
   DISALLOW_COPY_AND_ASSIGN(ObserverListThreadSafe);
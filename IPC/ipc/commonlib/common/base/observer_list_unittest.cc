@@ -431,6 +431,75 @@ TEST(ObserverListThreadSafeTest, OutlivesMessageLoop) {
   observer_list->Notify(&Foo::Observe, 1);
 }
 
+TEST(ObserverListThreadSafeTest, NotifyCoalesced) {
+  MessageLoop loop;
+  scoped_refptr<ObserverListThreadSafe<Foo> > observer_list(
+      new ObserverListThreadSafe<Foo>);
+  Adder a(1);
+  Adder b(-1);
+
+  observer_list->AddObserver(&a);
+  observer_list->AddObserver(&b);
+
+  // Only the last of the notifications waiting on the loop is delivered.
+  observer_list->NotifyCoalesced(&Foo::Observe, 1);
+  observer_list->NotifyCoalesced(&Foo::Observe, 2);
+  observer_list->NotifyCoalesced(&Foo::Observe, 3);
+  RunLoop().RunUntilIdle();
+
+  EXPECT_EQ(3, a.total);
+  EXPECT_EQ(-3, b.total);
+
+  // Once delivered, the next one is delivered too.
+  observer_list->NotifyCoalesced(&Foo::Observe, 10);
+  RunLoop().RunUntilIdle();
+
+  EXPECT_EQ(13, a.total);
+  EXPECT_EQ(-13, b.total);
+
+  // Plain notifications are not coalesced with them.
+  observer_list->NotifyCoalesced(&Foo::Observe, 100);
+  observer_list->Notify(&Foo::Observe, 20);
+  observer_list->Notify(&Foo::Observe, 30);
+  RunLoop().RunUntilIdle();
+
+  EXPECT_EQ(163, a.total);
+  EXPECT_EQ(-163, b.total);
+}
+
+TEST(ObserverListThreadSafeTest, NotifyCoalescedAfterRemoveObserver) {
+  MessageLoop loop;
+  scoped_refptr<ObserverListThreadSafe<Foo> > observer_list(
+      new ObserverListThreadSafe<Foo>);
+  Adder a(1);
+  Adder b(1);
+
+  observer_list->AddObserver(&a);
+  observer_list->AddObserver(&b);
+  observer_list->NotifyCoalesced(&Foo::Observe, 1);
+  observer_list->RemoveObserver(&b);
+  RunLoop().RunUntilIdle();
+
+  EXPECT_EQ(1, a.total);
+  EXPECT_EQ(0, b.total);
+
+  // The notification in flight when the last observer leaves the thread is
+  // dropped, and does not hold back those for observers added later.
+  observer_list->NotifyCoalesced(&Foo::Observe, 10);
+  observer_list->RemoveObserver(&a);
+  observer_list->AddObserver(&b);
+  RunLoop().RunUntilIdle();
+
+  EXPECT_EQ(1, a.total);
+  EXPECT_EQ(0, b.total);
+
+  observer_list->NotifyCoalesced(&Foo::Observe, 100);
+  RunLoop().RunUntilIdle();
+
+  EXPECT_EQ(1, a.total);
+  EXPECT_EQ(100, b.total);
+}
+
 TEST(ObserverListTest, Existing) {
   ObserverList<Foo> observer_list(ObserverList<Foo>::NOTIFY_EXISTING_ONLY);
   Adder a(1);
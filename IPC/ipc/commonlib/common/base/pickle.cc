@@ -8,6 +8,10 @@
 
 #include <algorithm>  // for max()
 
+#include "base/pickle_buffer_pool.h"
+
+using base::internal::PickleBufferPool;
+
 //------------------------------------------------------------------------------
 
 // static
@@ -202,7 +206,7 @@ Pickle::Pickle(const Pickle& other)
 
 Pickle::~Pickle() {
   if (capacity_ != kCapacityReadOnly)
-    free(header_);
+    PickleBufferPool::Free(header_, capacity_);
 }
 
 Pickle& Pickle::operator=(const Pickle& other) {
@@ -215,8 +219,9 @@ Pickle& Pickle::operator=(const Pickle& other) {
     capacity_ = 0;
   }
   if (header_size_ != other.header_size_) {
-    free(header_);
+    PickleBufferPool::Free(header_, capacity_);
     header_ = NULL;
+    capacity_ = 0;
     header_size_ = other.header_size_;
   }
   bool resized = Resize(other.header_size_ + other.header_->payload_size);
@@ -332,7 +337,9 @@ bool Pickle::Resize(size_t new_capacity) {
   new_capacity = AlignInt(new_capacity, kPayloadUnit);
 
   CHECK_NE(capacity_, kCapacityReadOnly);
-  void* p = realloc(header_, new_capacity);
+  size_t used = header_ ? header_size_ + header_->payload_size : 0;
+  void* p = PickleBufferPool::Reallocate(header_, capacity_, used,
+                                         &new_capacity);
   if (!p)
     return false;
 
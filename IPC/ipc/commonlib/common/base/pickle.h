@@ -311,8 +311,9 @@ class BASE_EXPORT Pickle {
 
   // Resize the capacity, note that the input value should include the size of
   // the header: new_capacity = sizeof(Header) + desired_payload_capacity.
-  // A realloc() failure will cause a Resize failure... and caller should check
-  // the return result for true (i.e., successful resizing).
+  // The buffer comes from base::internal::PickleBufferPool and may be larger
+  // than asked for. An allocation failure will cause a Resize failure... and
+  // caller should check the return result for true (i.e., successful resizing).
   bool Resize(size_t new_capacity);
 
   // Aligns 'i' by rounding it up to the next multiple of 'alignment'
@@ -0,0 +1,190 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/pickle_buffer_pool.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "base/atomicops.h"
+#include "base/lazy_instance.h"
+#include "base/logging.h"
+#include "base/metrics/stats_counters.h"
+#include "base/metrics/stats_table.h"
+#include "base/threading/thread_local_storage.h"
+
+namespace base {
+namespace internal {
+
+// static
+const size_t PickleBufferPool::kMinPooledSize = 64;
+// static
+const size_t PickleBufferPool::kMaxPooledSize = 64 * 1024;
+// static
+const size_t PickleBufferPool::kMaxCachedBytesPerThread = 256 * 1024;
+
+namespace {
+
+// kMinPooledSize << (kNumSizeClasses - 1) == kMaxPooledSize.
+const size_t kNumSizeClasses = 11;
+
+// Set by tests while other threads may be using the pool. Buffers go back to
+// free() or to the pool by their capacity either way, so a thread that sees a
+// change late is only late to start or stop pooling.
+subtle::Atomic32 g_pool_enabled = 1;
+
+bool PoolEnabled() {
+  return subtle::NoBarrier_Load(&g_pool_enabled) != 0;
+}
+
+// Overlays a buffer while it is in a free list.
+struct FreeBuffer {
+  FreeBuffer* next;
+};
+
+struct ThreadCache {
+  ThreadCache() : cached_bytes(0) {
+    memset(free_lists, 0, sizeof(free_lists));
+  }
+
+  ~ThreadCache() {
+    for (size_t i = 0; i < kNumSizeClasses; ++i) {
+      while (free_lists[i]) {
+        FreeBuffer* buffer = free_lists[i];
+        free_lists[i] = buffer->next;
+        free(buffer);
+      }
+    }
+  }
+
+  FreeBuffer* free_lists[kNumSizeClasses];
+  size_t cached_bytes;
+};
+
+void DeleteThreadCache(void* cache) {
+  delete static_cast<ThreadCache*>(cache);
+}
+
+struct ThreadCacheSlot {
+  ThreadCacheSlot() : slot(&DeleteThreadCache) {}
+
+  ThreadLocalStorage::Slot slot;
+};
+
+LazyInstance<ThreadCacheSlot>::Leaky g_thread_cache_slot =
+    LAZY_INSTANCE_INITIALIZER;
+
+ThreadCache* GetThreadCache() {
+  ThreadLocalStorage::Slot& slot = g_thread_cache_slot.Get().slot;
+  ThreadCache* cache = static_cast<ThreadCache*>(slot.Get());
+  if (!cache) {
+    cache = new ThreadCache;
+    slot.Set(cache);
+  }
+  return cache;
+}
+
+// Returns false if |size| is too large to be pooled.
+bool FindSizeClass(size_t size, size_t* size_class) {
+  size_t class_size = PickleBufferPool::kMinPooledSize;
+  for (size_t i = 0; i < kNumSizeClasses; ++i, class_size <<= 1) {
+    if (size <= class_size) {
+      *size_class = i;
+      return true;
+    }
+  }
+  return false;
+}
+
+size_t SizeOfClass(size_t size_class) {
+  return PickleBufferPool::kMinPooledSize << size_class;
+}
+
+// Looks the counter up in whichever table is current, so that counts made
+// before a table is installed, or against a table since replaced, don't
+// stick to a stale counter. Skipped without a table to keep the common path
+// free of the counter's own allocations.
+void IncrementCounter(const char* name) {
+  if (StatsTable::current())
+    SIMPLE_STATS_COUNTER(name);
+}
+
+}  // namespace
+
+// static
+void* PickleBufferPool::Reallocate(void* buffer,
+                                   size_t old_capacity,
+                                   size_t used,
+                                   size_t* capacity) {
+  DCHECK_LE(used, old_capacity);
+
+  if (!PoolEnabled())
+    return realloc(buffer, *capacity);
+
+  ThreadCache* cache = GetThreadCache();
+  size_t size_class;
+  if (!FindSizeClass(*capacity, &size_class)) {
+    // Only a buffer of the same large size could be reused, and realloc()
+    // may be able to grow it in place instead.
+    IncrementCounter("Pickle.BufferAllocs");
+    return realloc(buffer, *capacity);
+  }
+
+  size_t class_size = SizeOfClass(size_class);
+  void* new_buffer = cache->free_lists[size_class];
+  if (new_buffer) {
+    cache->free_lists[size_class] = cache->free_lists[size_class]->next;
+    cache->cached_bytes -= class_size;
+    IncrementCounter("Pickle.BufferReuses");
+  } else {
+    new_buffer = malloc(class_size);
+    if (!new_buffer)
+      return NULL;
+    IncrementCounter("Pickle.BufferAllocs");
+  }
+
+  if (buffer) {
+    memcpy(new_buffer, buffer, std::min(used, class_size));
+    Free(buffer, old_capacity);
+  }
+  *capacity = class_size;
+  return new_buffer;
+}
+
+// static
+void PickleBufferPool::Free(void* buffer, size_t capacity) {
+  if (!buffer)
+    return;
+
+  size_t size_class;
+  if (PoolEnabled() && FindSizeClass(capacity, &size_class) &&
+      SizeOfClass(size_class) == capacity) {
+    ThreadCache* cache = GetThreadCache();
+    if (cache->cached_bytes + capacity <= kMaxCachedBytesPerThread) {
+      FreeBuffer* free_buffer = static_cast<FreeBuffer*>(buffer);
+      free_buffer->next = cache->free_lists[size_class];
+      cache->free_lists[size_class] = free_buffer;
+      cache->cached_bytes += capacity;
+      return;
+    }
+  }
+  free(buffer);
+}
+
+// static
+void PickleBufferPool::SetEnabled(bool enabled) {
+  subtle::NoBarrier_Store(&g_pool_enabled, enabled ? 1 : 0);
+}
+
+// static
+size_t PickleBufferPool::GetCachedBytesForCurrentThread() {
+  ThreadCache* cache = static_cast<ThreadCache*>(
+      g_thread_cache_slot.Get().slot.Get());
+  return cache ? cache->cached_bytes : 0;
+}
+
+}  // namespace internal
+}  // namespace base
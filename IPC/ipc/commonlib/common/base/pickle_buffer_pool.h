@@ -0,0 +1,65 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_PICKLE_BUFFER_POOL_H_
+#define BASE_PICKLE_BUFFER_POOL_H_
+
+#include <stddef.h>
+
+#include "base/base_export.h"
+#include "base/basictypes.h"
+
+namespace base {
+namespace internal {
+
+// Storage for Pickle (and so IPC::Message) buffers.
+//
+// Buffers up to kMaxPooledSize bytes are rounded up to a power of two size
+// class. Freed buffers go to a free list of the freeing thread, which holds at
+// most kMaxCachedBytesPerThread bytes; the rest go back to the heap, as do the
+// cached buffers when the thread exits. Larger buffers always come from and go
+// to the heap with realloc() and free().
+//
+// A message is usually built on one thread and freed on another, e.g. sent
+// from the listener thread and freed on the IO thread after the write. The
+// messages flowing the other way feed the caches back, so a channel with
+// traffic both ways allocates from the heap only while its caches warm up.
+//
+// The "c:Pickle.BufferAllocs" and "c:Pickle.BufferReuses" StatsTable counters
+// count the buffers taken from the heap and from a free list.
+class BASE_EXPORT PickleBufferPool {
+ public:
+  // The smallest and the largest size class.
+  static const size_t kMinPooledSize;
+  static const size_t kMaxPooledSize;
+
+  static const size_t kMaxCachedBytesPerThread;
+
+  // Returns a buffer of at least |*capacity| bytes starting with the first
+  // |used| bytes of |buffer|, and updates |*capacity| to its actual size.
+  // |buffer| (of |old_capacity| bytes, may be NULL) is released unless NULL
+  // is returned.
+  static void* Reallocate(void* buffer,
+                          size_t old_capacity,
+                          size_t used,
+                          size_t* capacity);
+
+  // Releases |buffer|, which Reallocate() returned with |capacity| bytes.
+  static void Free(void* buffer, size_t capacity);
+
+  // Pooling is on by default. When it is off, buffers come from realloc()
+  // as if there were no pool.
+  static void SetEnabled(bool enabled);
+
+  // Returns the number of bytes in the free lists of the calling thread.
+  static size_t GetCachedBytesForCurrentThread();
+
+ private:
+  DISALLOW_IMPLICIT_CONSTRUCTORS(PickleBufferPool);
+};
+
+}  // namespace internal
+}  // namespace base
+
+#endif  // BASE_PICKLE_BUFFER_POOL_H_
@@ -0,0 +1,134 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/pickle_buffer_pool.h"
+
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "base/metrics/stats_table.h"
+#include "base/pickle.h"
+#include "base/shared_memory.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+namespace internal {
+namespace {
+
+class PickleBufferPoolTest : public testing::Test {
+ protected:
+  virtual void SetUp() OVERRIDE {
+    PickleBufferPool::SetEnabled(true);
+  }
+
+  virtual void TearDown() OVERRIDE {
+    PickleBufferPool::SetEnabled(true);
+  }
+};
+
+TEST_F(PickleBufferPoolTest, ReusesFreedBuffers) {
+  size_t cached_before = PickleBufferPool::GetCachedBytesForCurrentThread();
+  size_t capacity = 100;
+  void* buffer = PickleBufferPool::Reallocate(NULL, 0, 0, &capacity);
+  ASSERT_TRUE(buffer);
+  EXPECT_EQ(128u, capacity);
+
+  PickleBufferPool::Free(buffer, capacity);
+  EXPECT_EQ(cached_before + 128,
+            PickleBufferPool::GetCachedBytesForCurrentThread());
+
+  size_t same_class_capacity = 65;
+  void* reused = PickleBufferPool::Reallocate(NULL, 0, 0,
+                                              &same_class_capacity);
+  EXPECT_EQ(buffer, reused);
+  EXPECT_EQ(128u, same_class_capacity);
+  EXPECT_EQ(cached_before, PickleBufferPool::GetCachedBytesForCurrentThread());
+  PickleBufferPool::Free(reused, same_class_capacity);
+}
+
+TEST_F(PickleBufferPoolTest, GrowingKeepsContents) {
+  Pickle pickle;
+  for (int i = 0; i < 10000; ++i)
+    EXPECT_TRUE(pickle.WriteInt(i));
+
+  PickleIterator iter(pickle);
+  for (int i = 0; i < 10000; ++i) {
+    int value;
+    ASSERT_TRUE(pickle.ReadInt(&iter, &value));
+    EXPECT_EQ(i, value);
+  }
+
+  Pickle copy(pickle);
+  EXPECT_EQ(pickle.size(), copy.size());
+  EXPECT_EQ(0, memcmp(pickle.data(), copy.data(), pickle.size()));
+}
+
+TEST_F(PickleBufferPoolTest, LargeBuffersAreNotCached) {
+  size_t cached_before = PickleBufferPool::GetCachedBytesForCurrentThread();
+  size_t capacity = PickleBufferPool::kMaxPooledSize + 1;
+  void* buffer = PickleBufferPool::Reallocate(NULL, 0, 0, &capacity);
+  ASSERT_TRUE(buffer);
+  EXPECT_EQ(PickleBufferPool::kMaxPooledSize + 1, capacity);
+
+  PickleBufferPool::Free(buffer, capacity);
+  EXPECT_EQ(cached_before, PickleBufferPool::GetCachedBytesForCurrentThread());
+}
+
+TEST_F(PickleBufferPoolTest, CapsCachedBytes) {
+  std::vector<void*> buffers;
+  size_t count = 2 * PickleBufferPool::kMaxCachedBytesPerThread /
+      PickleBufferPool::kMaxPooledSize;
+  for (size_t i = 0; i < count; ++i) {
+    size_t capacity = PickleBufferPool::kMaxPooledSize;
+    buffers.push_back(PickleBufferPool::Reallocate(NULL, 0, 0, &capacity));
+    ASSERT_TRUE(buffers.back());
+  }
+  for (size_t i = 0; i < buffers.size(); ++i)
+    PickleBufferPool::Free(buffers[i], PickleBufferPool::kMaxPooledSize);
+
+  EXPECT_LE(PickleBufferPool::GetCachedBytesForCurrentThread(),
+            PickleBufferPool::kMaxCachedBytesPerThread);
+}
+
+TEST_F(PickleBufferPoolTest, Disabled) {
+  PickleBufferPool::SetEnabled(false);
+  size_t cached_before = PickleBufferPool::GetCachedBytesForCurrentThread();
+  {
+    Pickle pickle;
+    EXPECT_TRUE(pickle.WriteInt(1));
+  }
+  EXPECT_EQ(cached_before, PickleBufferPool::GetCachedBytesForCurrentThread());
+}
+
+// Allocates a buffer too large to pool, which is always counted.
+void AllocateUnpooled() {
+  size_t capacity = PickleBufferPool::kMaxPooledSize + 1;
+  void* buffer = PickleBufferPool::Reallocate(NULL, 0, 0, &capacity);
+  ASSERT_TRUE(buffer);
+  PickleBufferPool::Free(buffer, capacity);
+}
+
+int CountAllocsInNewTable(const std::string& table_name) {
+  SharedMemory().Delete(table_name);
+  StatsTable table(table_name, 2, 4);
+  StatsTable::set_current(&table);
+  AllocateUnpooled();
+  AllocateUnpooled();
+  StatsTable::set_current(NULL);
+  return table.GetCounterValue("c:Pickle.BufferAllocs");
+}
+
+TEST_F(PickleBufferPoolTest, CountsInCurrentTable) {
+  // Allocations made before a table is installed don't keep this thread from
+  // counting into the tables installed later.
+  AllocateUnpooled();
+  EXPECT_EQ(2, CountAllocsInNewTable("PickleBufferPoolStatTable1"));
+  EXPECT_EQ(2, CountAllocsInNewTable("PickleBufferPoolStatTable2"));
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace base
@@ -4,19 +4,25 @@
 
 #include "base/profiler/alternate_timer.h"
 
+#include "base/atomicops.h"
 #include "base/logging.h"
+#include "base/time/tsc_tick_clock.h"
 
 namespace {
 
 tracked_objects::NowFunction* g_time_function = NULL;
 tracked_objects::TimeSourceType g_time_source_type =
     tracked_objects::TIME_SOURCE_TYPE_WALL_TIME;
+// Read by every thread that times a task, so that SetWallClock() can be
+// called while they run.
+base::subtle::Atomic32 g_wall_clock = tracked_objects::WALL_CLOCK_DEFAULT;
 
 }  // anonymous namespace
 
 namespace tracked_objects {
 
 const char kAlternateProfilerTime[] = "CHROME_PROFILER_TIME";
+const char kProfilerWallClock[] = "CHROME_PROFILER_WALL_CLOCK";
 
 // Set an alternate timer function to replace the OS time function when
 // profiling.
@@ -34,4 +40,16 @@ TimeSourceType GetTimeSourceType() {
   return g_time_source_type;
 }
 
+bool SetWallClock(WallClockType type) {
+  if (type == WALL_CLOCK_TSC && !base::TscTickClock::IsSupported())
+    return false;
+  base::subtle::NoBarrier_Store(&g_wall_clock, type);
+  return true;
+}
+
+WallClockType GetWallClock() {
+  return static_cast<WallClockType>(
+      base::subtle::NoBarrier_Load(&g_wall_clock));
+}
+
 }  // namespace tracked_objects
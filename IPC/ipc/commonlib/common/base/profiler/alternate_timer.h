@@ -39,6 +39,28 @@ NowFunction* GetAlternateTimeSource();
 // Returns the type of the currently set time source.
 BASE_EXPORT TimeSourceType GetTimeSourceType();
 
+// The clocks that wall time profiling can read, in TrackedTime::Now().  The
+// coarse clock lags base::TimeTicks::Now() by up to a kernel tick, and the
+// TSC clock stays within a fraction of a millisecond of it.  Queue times run
+// from a TimeTicks::Now() posting time to a start read from this clock, so
+// they are clamped at zero.
+enum WallClockType {
+  WALL_CLOCK_DEFAULT,  // base::TimeTicks::Now(), or timeGetTime() on Windows.
+  WALL_CLOCK_COARSE,   // base::TimeTicks::NowCoarse().
+  WALL_CLOCK_TSC,      // base::TscTickClock, where supported.
+};
+
+// Environment variable name that selects the wall clock for profiling, when
+// set to "coarse" or "tsc".
+BASE_EXPORT extern const char kProfilerWallClock[];
+
+// Selects the wall clock for profiling.  Returns false, and leaves the clock
+// as it was, if |type| can't be used on this machine.
+BASE_EXPORT bool SetWallClock(WallClockType type);
+
+// Returns the wall clock selected for profiling.
+BASE_EXPORT WallClockType GetWallClock();
+
 }  // namespace tracked_objects
 
 #endif  // BASE_PROFILER_ALTERNATE_TIMER_H_
@@ -4,6 +4,8 @@
 
 #include "base/profiler/tracked_time.h"
 
+#include "base/profiler/alternate_timer.h"
+#include "base/time/tsc_tick_clock.h"
 #include "build/build_config.h"
 
 #if defined(OS_WIN)
@@ -51,6 +53,14 @@ TrackedTime::TrackedTime(const base::TimeTicks& time)
 
 // static
 TrackedTime TrackedTime::Now() {
+  switch (GetWallClock()) {
+    case WALL_CLOCK_COARSE:
+      return TrackedTime(base::TimeTicks::NowCoarse());
+    case WALL_CLOCK_TSC:
+      return TrackedTime(base::TscTickClock::Now());
+    case WALL_CLOCK_DEFAULT:
+      break;
+  }
 #if defined(OS_WIN)
   // Use lock-free accessor to 32 bit time.
   // Note that TimeTicks::Now() is built on this, so we have "compatible"
@@ -4,8 +4,10 @@
 
 // Test of classes in tracked_time.cc
 
+#include "base/profiler/alternate_timer.h"
 #include "base/profiler/tracked_time.h"
 #include "base/time.h"
+#include "base/time/tsc_tick_clock.h"
 #include "base/tracked_objects.h"
 #include "testing/gtest/include/gtest/gtest.h"
 
@@ -107,4 +109,27 @@ TEST(TrackedTimeTest, TrackedTimerEnabled) {
   EXPECT_GE(0, after.InMilliseconds());
 }
 
+TEST(TrackedTimeTest, WallClocks) {
+  // Whichever clock it reads, TrackedTime::Now() agrees with TimeTicks.
+  const WallClockType kClocks[] = {
+    WALL_CLOCK_COARSE,
+    WALL_CLOCK_TSC,
+    WALL_CLOCK_DEFAULT,
+  };
+  for (size_t i = 0; i < arraysize(kClocks); ++i) {
+    if (!SetWallClock(kClocks[i])) {
+      EXPECT_EQ(WALL_CLOCK_TSC, kClocks[i]);
+      EXPECT_FALSE(base::TscTickClock::IsSupported());
+      continue;
+    }
+    EXPECT_EQ(kClocks[i], GetWallClock());
+
+    TrackedTime now = TrackedTime::Now();
+    TrackedTime ticks_now(base::TimeTicks::Now());
+    EXPECT_LE((now - ticks_now).InMilliseconds(), 20);
+    EXPECT_GE((now - ticks_now).InMilliseconds(), -20);
+  }
+  EXPECT_EQ(WALL_CLOCK_DEFAULT, GetWallClock());
+}
+
 }  // namespace tracked_objects
@@ -110,8 +110,9 @@ void SystemMonitor::NotifyDevicesChanged(DeviceType device_type) {
 void SystemMonitor::NotifyPowerStateChange() {
   DVLOG(1) << "PowerStateChange: " << (BatteryPower() ? "On" : "Off")
            << " battery";
-  power_observer_list_->Notify(&PowerObserver::OnPowerStateChange,
-                               BatteryPower());
+  // Only the latest power state matters to observers that are behind.
+  power_observer_list_->NotifyCoalesced(&PowerObserver::OnPowerStateChange,
+                                        BatteryPower());
 }
 
 void SystemMonitor::NotifySuspend() {
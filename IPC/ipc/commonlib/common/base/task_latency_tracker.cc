@@ -0,0 +1,124 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/task_latency_tracker.h"
+
+#include <set>
+
+#include "base/atomic_sequence_num.h"
+#include "base/json/string_escape.h"
+#include "base/metrics/histogram.h"
+#include "base/pending_task.h"
+#include "base/stringprintf.h"
+
+namespace base {
+
+namespace {
+
+// Microseconds, from 1us to 10s; longer times land in the last bucket.
+const int kMaxMicroseconds = 10 * Time::kMicrosecondsPerSecond;
+const size_t kBucketCount = 50;
+
+// Hands out TaskLatencyTracker::id().
+StaticAtomicSequenceNumber g_next_tracker_id;
+
+HistogramBase* GetHistogram(const std::string& name) {
+  return Histogram::FactoryGet(name, 1, kMaxMicroseconds, kBucketCount,
+                               HistogramBase::kNoFlags);
+}
+
+int ToSample(TimeDelta time) {
+  int64 microseconds = time.InMicroseconds();
+  if (microseconds < 0)
+    return 0;
+  if (microseconds > kMaxMicroseconds)
+    return kMaxMicroseconds;
+  return static_cast<int>(microseconds);
+}
+
+}  // namespace
+
+TaskLatencyTracker::Histograms::Histograms()
+    : queue_time(NULL),
+      run_time(NULL) {
+}
+
+TaskLatencyTracker::TaskLatencyTracker()
+    : id_(g_next_tracker_id.GetNext()) {
+}
+
+TaskLatencyTracker::~TaskLatencyTracker() {
+}
+
+void TaskLatencyTracker::set_name(const std::string& name) {
+  AutoLock lock(lock_);
+  name_ = name;
+}
+
+void TaskLatencyTracker::RecordTask(const PendingTask& pending_task,
+                                    TimeTicks start_time,
+                                    TimeTicks end_time) {
+  // A delayed task isn't late until it's due.
+  TimeTicks ready_time = pending_task.time_posted;
+  if (pending_task.delayed_run_time > ready_time)
+    ready_time = pending_task.delayed_run_time;
+
+  const Histograms& histograms = GetHistograms(pending_task.posted_from);
+  histograms.queue_time->Add(ToSample(start_time - ready_time));
+  histograms.run_time->Add(ToSample(end_time - start_time));
+}
+
+void TaskLatencyTracker::WriteJSON(std::string* output) const {
+  AutoLock lock(lock_);
+  output->append("{\"name\":");
+  JsonDoubleQuote(name_, true, output);
+  output->append(",\"locations\":[");
+
+  // The same file may be known by different pointers, but its histograms are
+  // only written once.
+  std::set<const HistogramBase*> written;
+  for (HistogramMap::const_iterator it = histograms_.begin();
+       it != histograms_.end(); ++it) {
+    const Histograms& histograms = it->second;
+    if (!written.insert(histograms.queue_time).second)
+      continue;
+    if (written.size() > 1)
+      output->append(",");
+    output->append("{\"file_name\":");
+    JsonDoubleQuote(histograms.location.file_name(), true, output);
+    output->append(",\"function_name\":");
+    JsonDoubleQuote(histograms.location.function_name(), true, output);
+    StringAppendF(output, ",\"line\":%d,\"queue_time\":",
+                  histograms.location.line_number());
+    // WriteJSON() replaces what it's given.
+    std::string histogram_json;
+    histograms.queue_time->WriteJSON(&histogram_json);
+    output->append(histogram_json);
+    output->append(",\"run_time\":");
+    histograms.run_time->WriteJSON(&histogram_json);
+    output->append(histogram_json);
+    output->append("}");
+  }
+  output->append("]}");
+}
+
+const TaskLatencyTracker::Histograms& TaskLatencyTracker::GetHistograms(
+    const tracked_objects::Location& location) {
+  LocationKey key(location.file_name(), location.line_number());
+  HistogramMap::const_iterator it = histograms_.find(key);
+  if (it != histograms_.end())
+    return it->second;
+
+  std::string suffix =
+      StringPrintf("%s.%d.", name_.c_str(), id_) + location.ToString();
+  Histograms histograms;
+  histograms.location = location;
+  histograms.queue_time = GetHistogram("TaskLatency.QueueTime." + suffix);
+  histograms.run_time = GetHistogram("TaskLatency.RunTime." + suffix);
+
+  AutoLock lock(lock_);
+  return histograms_.insert(std::make_pair(key, histograms)).first->second;
+}
+
+}  // namespace base
@@ -0,0 +1,93 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_TASK_LATENCY_TRACKER_H_
+#define BASE_TASK_LATENCY_TRACKER_H_
+
+#include <map>
+#include <string>
+#include <utility>
+
+#include "base/base_export.h"
+#include "base/basictypes.h"
+#include "base/location.h"
+#include "base/synchronization/lock.h"
+#include "base/time.h"
+
+namespace base {
+
+class HistogramBase;
+struct PendingTask;
+
+// Keeps, for the tasks run on one thread, how long each waited to run and
+// how long it ran, in a pair of histograms per place the tasks were posted
+// from.
+//
+// The queueing delay of a task is the time from when it was posted, or from
+// when it became due if it was delayed, until it started to run. Both are in
+// microseconds, in histograms named
+//   TaskLatency.QueueTime.<name>.<id>.<function>@<file>:<line>
+//   TaskLatency.RunTime.<name>.<id>.<function>@<file>:<line>
+// which are registered with the StatisticsRecorder like any other. <id> is
+// unique to the tracker, so that threads of the same name, or unnamed ones,
+// don't share histograms.
+//
+// RecordTask() and set_name() must always be called on the same thread.
+// WriteJSON() may be called on any thread.
+class BASE_EXPORT TaskLatencyTracker {
+ public:
+  TaskLatencyTracker();
+  ~TaskLatencyTracker();
+
+  // Sets the <name> of the histograms created from now on.
+  void set_name(const std::string& name);
+
+  // Returns the <id> of the histograms.
+  int id() const { return id_; }
+
+  // Adds the queueing delay and run time of |pending_task|, which started
+  // running at |start_time| and was done at |end_time|.
+  void RecordTask(const PendingTask& pending_task,
+                  TimeTicks start_time,
+                  TimeTicks end_time);
+
+  // Writes all the histograms as a JSON object:
+  //   {"name": <name>,
+  //    "locations": [{"file_name": ..., "function_name": ..., "line": ...,
+  //                   "queue_time": <histogram>, "run_time": <histogram>},
+  //                  ...]}
+  // where each <histogram> is as HistogramBase::WriteJSON() writes it.
+  void WriteJSON(std::string* output) const;
+
+ private:
+  struct Histograms {
+    Histograms();
+
+    tracked_objects::Location location;
+    HistogramBase* queue_time;
+    HistogramBase* run_time;
+  };
+
+  // Locations are told apart by file name and line, and their strings live
+  // as long as the program.
+  typedef std::pair<const char*, int> LocationKey;
+  typedef std::map<LocationKey, Histograms> HistogramMap;
+
+  // Returns the histograms for |location|, creating them if need be.
+  const Histograms& GetHistograms(const tracked_objects::Location& location);
+
+  const int id_;
+
+  // Only changed on the recording thread, with |lock_| held, so that thread
+  // reads them without the lock.
+  std::string name_;
+  HistogramMap histograms_;
+  mutable Lock lock_;
+
+  DISALLOW_COPY_AND_ASSIGN(TaskLatencyTracker);
+};
+
+}  // namespace base
+
+#endif  // BASE_TASK_LATENCY_TRACKER_H_
@@ -0,0 +1,183 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/task_latency_tracker.h"
+
+#include <string>
+
+#include "base/bind.h"
+#include "base/json/json_reader.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/message_loop.h"
+#include "base/pending_task.h"
+#include "base/values.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+namespace {
+
+void Nop() {
+}
+
+// Parses the output of TaskLatencyTracker::WriteJSON() and returns its
+// locations.
+scoped_ptr<Value> ParseLocations(const std::string& json,
+                                 const std::string& expected_name,
+                                 ListValue** locations) {
+  scoped_ptr<Value> value(JSONReader::Read(json));
+  DictionaryValue* dict = NULL;
+  if (!value.get() || !value->GetAsDictionary(&dict)) {
+    ADD_FAILURE() << json;
+    return scoped_ptr<Value>();
+  }
+  std::string name;
+  EXPECT_TRUE(dict->GetString("name", &name));
+  EXPECT_EQ(expected_name, name);
+  if (!dict->GetList("locations", locations))
+    ADD_FAILURE() << json;
+  return value.Pass();
+}
+
+// Checks that the histogram at |path| of |location| holds one sample, in the
+// bucket that covers |microseconds|.
+void ExpectOneSample(const DictionaryValue* location,
+                     const std::string& path,
+                     int microseconds) {
+  int count = 0;
+  EXPECT_TRUE(location->GetInteger(path + ".count", &count));
+  EXPECT_EQ(1, count);
+  const ListValue* buckets = NULL;
+  ASSERT_TRUE(location->GetList(path + ".buckets", &buckets));
+  ASSERT_EQ(1u, buckets->GetSize());
+  const DictionaryValue* bucket = NULL;
+  ASSERT_TRUE(buckets->GetDictionary(0, &bucket));
+  int low = 0;
+  int high = 0;
+  EXPECT_TRUE(bucket->GetInteger("low", &low));
+  EXPECT_TRUE(bucket->GetInteger("high", &high));
+  EXPECT_LE(low, microseconds);
+  EXPECT_GT(high, microseconds);
+}
+
+TEST(TaskLatencyTrackerTest, RecordsQueueAndRunTime) {
+  TaskLatencyTracker tracker;
+  tracker.set_name("RecordsQueueAndRunTime");
+
+  tracked_objects::Location location("Function", "file.cc", 42, NULL);
+  PendingTask pending_task(location, Bind(&Nop));
+  TimeTicks start_time =
+      pending_task.time_posted + TimeDelta::FromMilliseconds(5);
+  tracker.RecordTask(pending_task, start_time,
+                     start_time + TimeDelta::FromMicroseconds(300));
+
+  std::string json;
+  tracker.WriteJSON(&json);
+  ListValue* locations = NULL;
+  scoped_ptr<Value> value =
+      ParseLocations(json, "RecordsQueueAndRunTime", &locations);
+  ASSERT_TRUE(locations);
+  ASSERT_EQ(1u, locations->GetSize());
+  DictionaryValue* entry = NULL;
+  ASSERT_TRUE(locations->GetDictionary(0, &entry));
+  std::string string_value;
+  EXPECT_TRUE(entry->GetString("file_name", &string_value));
+  EXPECT_EQ("file.cc", string_value);
+  EXPECT_TRUE(entry->GetString("function_name", &string_value));
+  EXPECT_EQ("Function", string_value);
+  int line = 0;
+  EXPECT_TRUE(entry->GetInteger("line", &line));
+  EXPECT_EQ(42, line);
+  ExpectOneSample(entry, "queue_time", 5000);
+  ExpectOneSample(entry, "run_time", 300);
+}
+
+TEST(TaskLatencyTrackerTest, DelayedTaskWaitsFromRunTime) {
+  TaskLatencyTracker tracker;
+  tracker.set_name("DelayedTaskWaitsFromRunTime");
+
+  TimeTicks now = TimeTicks::Now();
+  PendingTask pending_task(FROM_HERE, Bind(&Nop),
+                           now + TimeDelta::FromSeconds(1), true);
+  TimeTicks start_time =
+      pending_task.delayed_run_time + TimeDelta::FromMilliseconds(2);
+  tracker.RecordTask(pending_task, start_time, start_time);
+
+  std::string json;
+  tracker.WriteJSON(&json);
+  ListValue* locations = NULL;
+  scoped_ptr<Value> value =
+      ParseLocations(json, "DelayedTaskWaitsFromRunTime", &locations);
+  ASSERT_TRUE(locations);
+  ASSERT_EQ(1u, locations->GetSize());
+  DictionaryValue* entry = NULL;
+  ASSERT_TRUE(locations->GetDictionary(0, &entry));
+  ExpectOneSample(entry, "queue_time", 2000);
+}
+
+// Runs |count| tasks, all posted from one place, on the current loop with
+// tracking on, and returns the number of queue times the loop recorded.
+int RunTrackedTasks(int count) {
+  MessageLoop* loop = MessageLoop::current();
+  loop->SetTaskLatencyTracking(true);
+  for (int i = 0; i < count; ++i)
+    loop->PostTask(FROM_HERE, Bind(&Nop));
+  loop->RunUntilIdle();
+
+  std::string json;
+  loop->WriteTaskLatencyJSON(&json);
+  ListValue* locations = NULL;
+  scoped_ptr<Value> value = ParseLocations(json, "Unnamed", &locations);
+  DictionaryValue* entry = NULL;
+  if (!locations || locations->GetSize() != 1u ||
+      !locations->GetDictionary(0, &entry)) {
+    ADD_FAILURE() << json;
+    return 0;
+  }
+  int recorded = 0;
+  EXPECT_TRUE(entry->GetInteger("queue_time.count", &recorded));
+  return recorded;
+}
+
+TEST(TaskLatencyTrackerTest, UnnamedLoopsDontShareHistograms) {
+  {
+    MessageLoop loop;
+    EXPECT_EQ(3, RunTrackedTasks(3));
+  }
+  MessageLoop loop;
+  EXPECT_EQ(2, RunTrackedTasks(2));
+}
+
+TEST(TaskLatencyTrackerTest, MessageLoop) {
+  MessageLoop loop;
+  loop.set_thread_name("TaskLatencyTrackerTest");
+
+  // Only the tasks run while tracking is on are recorded.
+  loop.PostTask(FROM_HERE, Bind(&Nop));
+  loop.RunUntilIdle();
+  loop.SetTaskLatencyTracking(true);
+  for (int i = 0; i < 3; ++i)
+    loop.PostTask(FROM_HERE, Bind(&Nop));
+  loop.RunUntilIdle();
+  loop.SetTaskLatencyTracking(false);
+  loop.PostTask(FROM_HERE, Bind(&Nop));
+  loop.RunUntilIdle();
+
+  std::string json;
+  loop.WriteTaskLatencyJSON(&json);
+  ListValue* locations = NULL;
+  scoped_ptr<Value> value =
+      ParseLocations(json, "TaskLatencyTrackerTest", &locations);
+  ASSERT_TRUE(locations);
+  ASSERT_EQ(1u, locations->GetSize());
+  DictionaryValue* entry = NULL;
+  ASSERT_TRUE(locations->GetDictionary(0, &entry));
+  int count = 0;
+  EXPECT_TRUE(entry->GetInteger("queue_time.count", &count));
+  EXPECT_EQ(3, count);
+  EXPECT_TRUE(entry->GetInteger("run_time.count", &count));
+  EXPECT_EQ(3, count);
+}
+
+}  // namespace
+}  // namespace base
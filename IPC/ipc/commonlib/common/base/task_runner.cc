@@ -4,6 +4,7 @@
 
 #include "base/task_runner.h"
 
+#include "base/callback.h"
 #include "base/compiler_specific.h"
 #include "base/logging.h"
 #include "base/threading/post_task_and_reply_impl.h"
@@ -45,6 +46,15 @@ bool TaskRunner::PostTask(const tracked_objects::Location& from_here,
   return PostDelayedTask(from_here, task, base::TimeDelta());
 }
 
+bool TaskRunner::PostTasks(const tracked_objects::Location& from_here,
+                           const std::vector<Closure>& tasks) {
+  for (size_t i = 0; i < tasks.size(); ++i) {
+    if (!PostTask(from_here, tasks[i]))
+      return false;
+  }
+  return true;
+}
+
 bool TaskRunner::PostTaskAndReply(
     const tracked_objects::Location& from_here,
     const Closure& task,
@@ -5,6 +5,8 @@
 #ifndef BASE_TASK_RUNNER_H_
 #define BASE_TASK_RUNNER_H_
 
+#include <vector>
+
 #include "base/base_export.h"
 #include "base/basictypes.h"
 #include "base/callback_forward.h"
@@ -75,6 +77,16 @@ class BASE_EXPORT TaskRunner
                                const Closure& task,
                                base::TimeDelta delay) = 0;
 
+  // Posts |tasks| as PostTask() would one after the other, so that they run
+  // in order if this TaskRunner runs tasks in order.  Returns true if all of
+  // them may be run, and false if some of them definitely will not be.
+  //
+  // The default implementation calls PostTask() for each task and stops at
+  // the first one that fails.  Implementations that can queue a whole batch
+  // at once, with one lock acquisition and one wakeup, should override it.
+  virtual bool PostTasks(const tracked_objects::Location& from_here,
+                         const std::vector<Closure>& tasks);
+
   // Returns true if the current thread is a thread on which a task
   // may be run, and false if no task will be run on the current
   // thread.
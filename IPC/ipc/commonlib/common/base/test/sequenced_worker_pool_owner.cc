@@ -18,6 +18,16 @@ SequencedWorkerPoolOwner::SequencedWorkerPoolOwner(
           ALLOW_THIS_IN_INITIALIZER_LIST(this))),
       has_work_call_count_(0) {}
 
+SequencedWorkerPoolOwner::SequencedWorkerPoolOwner(
+    size_t max_threads,
+    const std::string& thread_name_prefix,
+    SequencedWorkerPool::SchedulerMode scheduler_mode)
+    : constructor_message_loop_(MessageLoop::current()),
+      pool_(new SequencedWorkerPool(
+          max_threads, thread_name_prefix, scheduler_mode,
+          ALLOW_THIS_IN_INITIALIZER_LIST(this))),
+      has_work_call_count_(0) {}
+
 SequencedWorkerPoolOwner::~SequencedWorkerPoolOwner() {
   pool_ = NULL;
   MessageLoop::current()->Run();
@@ -4,6 +4,7 @@
 
 #include "base/threading/sequenced_worker_pool.h"
 
+#include <deque>
 #include <list>
 #include <map>
 #include <set>
@@ -15,8 +16,11 @@
 #include "base/compiler_specific.h"
 #include "base/critical_closure.h"
 #include "base/debug/trace_event.h"
+#include "base/hash_tables.h"
+#include "base/lazy_instance.h"
 #include "base/logging.h"
 #include "base/memory/linked_ptr.h"
+#include "base/memory/scoped_vector.h"
 #include "base/message_loop_proxy.h"
 #include "base/metrics/histogram.h"
 #include "base/stl_util.h"
@@ -25,6 +29,7 @@
 #include "base/synchronization/lock.h"
 #include "base/threading/platform_thread.h"
 #include "base/threading/simple_thread.h"
+#include "base/threading/thread_local.h"
 #include "base/threading/thread_restrictions.h"
 #include "base/time.h"
 #include "base/tracked_objects.h"
@@ -79,6 +84,24 @@ struct SequencedTaskLessThan {
   }
 };
 
+// An entry of a worker's deque in WORK_STEALING mode: either a task without a
+// sequence token, or a sequence that has tasks ready to run.
+struct WorkItem {
+  WorkItem() : sequence_token_id(0) {}
+
+  explicit WorkItem(const SequencedTask& task)
+      : sequence_token_id(0),
+        task(task) {}
+
+  explicit WorkItem(int sequence_token_id)
+      : sequence_token_id(sequence_token_id) {}
+
+  // Nonzero for a sequence. Its tasks are kept by the pool, see
+  // Inner::sequences_.
+  int sequence_token_id;
+  SequencedTask task;
+};
+
 // SequencedWorkerPoolTaskRunner ---------------------------------------------
 // A TaskRunner which posts tasks to a SequencedWorkerPool with a
 // fixed ShutdownBehavior.
@@ -229,6 +252,9 @@ class SequencedWorkerPool::Worker : public SimpleThread {
   // SimpleThread implementation. This actually runs the background thread.
   virtual void Run() OVERRIDE;
 
+  // Returns the worker that is running on the current thread, or NULL.
+  static Worker* GetForCurrentThread();
+
   void set_running_task_info(SequenceToken token,
                              WorkerShutdown shutdown_behavior) {
     running_sequence_ = token;
@@ -243,8 +269,20 @@ class SequencedWorkerPool::Worker : public SimpleThread {
     return running_shutdown_behavior_;
   }
 
+  SequencedWorkerPool* worker_pool() const {
+    return worker_pool_.get();
+  }
+
+  // Starts at 1.
+  int thread_number() const {
+    return thread_number_;
+  }
+
  private:
+  static LazyInstance<ThreadLocalPointer<Worker> >::Leaky lazy_tls_ptr_;
+
   scoped_refptr<SequencedWorkerPool> worker_pool_;
+  const int thread_number_;
   SequenceToken running_sequence_;
   WorkerShutdown running_shutdown_behavior_;
 
@@ -259,6 +297,7 @@ class SequencedWorkerPool::Inner {
   // by it).
   Inner(SequencedWorkerPool* worker_pool, size_t max_threads,
         const std::string& thread_name_prefix,
+        SchedulerMode scheduler_mode,
         TestingObserver* observer);
 
   ~Inner();
@@ -314,6 +353,12 @@ class SequencedWorkerPool::Inner {
   // Called from within the lock, this returns the next sequence task number.
   int64 LockedGetNextSequenceTaskNumber();
 
+  // Called from within the lock once Shutdown() was called, returns whether a
+  // task with the given shutdown behavior may still be posted from the
+  // current thread. If so, it counts against
+  // |max_blocking_tasks_after_shutdown_|.
+  bool LockedCanPostTaskAfterShutdown(WorkerShutdown shutdown_behavior);
+
   // Called from within the lock, returns the shutdown behavior of the task
   // running on the currently executing worker thread. If invoked from a thread
   // that is not one of the workers, returns CONTINUE_ON_SHUTDOWN.
@@ -378,6 +423,53 @@ class SequencedWorkerPool::Inner {
   // called inside the lock.
   bool CanShutdown() const;
 
+  // WORK_STEALING mode -------------------------------------------------------
+
+  // The deque of a worker and the lock that guards it.
+  struct WorkQueue {
+    Lock lock;
+    std::deque<WorkItem> items;
+  };
+
+  // The worker loop of WORK_STEALING mode. Tasks without a delay are taken
+  // from the deques outside the lock; the rest is handled under the lock as
+  // in ThreadLoop().
+  void WorkStealingThreadLoop(Worker* this_worker);
+
+  // Posts a task without a delay in WORK_STEALING mode. Only takes the lock
+  // for a named token or once shutdown has started.
+  bool PostReadyTask(const std::string* optional_token_name,
+                     SequencedTask* task);
+
+  // Adds |task| to its sequence or to a deque: the current worker's, or the
+  // shared one if called from another thread. May be called with or without
+  // the lock.
+  void QueueReadyTask(const SequencedTask& task);
+
+  // Queues the delayed tasks of the sequence |sequence_token_id| that are
+  // due, for a worker that is about to run its next task. Must be called
+  // inside the lock.
+  void QueueDueDelayedTasks(int sequence_token_id);
+
+  void PushWorkItem(size_t queue_index, const WorkItem& item);
+
+  // Takes the oldest entry of the deque at |queue_index| or, if it's empty,
+  // of the shared deque or of another worker's. Returns false if all of them
+  // are empty.
+  bool TakeWorkItem(size_t queue_index, WorkItem* item);
+
+  // Takes the oldest entry of the deque at |queue_index| if there is one.
+  bool TakeWorkItemFromQueue(size_t queue_index, WorkItem* item);
+
+  // Runs the task of |item| or, if shutdown has started and it doesn't block
+  // shutdown, deletes it. A sequence that has more tasks goes back on the
+  // worker's deque. Called outside the lock.
+  void RunWorkItem(Worker* this_worker, WorkItem* item);
+
+  // Wakes up a waiting worker, or starts a new one if that's helpful, after a
+  // task was queued outside the lock.
+  void WakeUpWorkerForQueuedTask();
+
   SequencedWorkerPool* const worker_pool_;
 
   // The last sequence number used. Managed by GetSequenceToken, since this
@@ -385,9 +477,10 @@ class SequencedWorkerPool::Inner {
   // lock.
   volatile subtle::Atomic32 last_sequence_number_;
 
-  // This lock protects |everything in this class|. Do not read or modify
-  // anything without holding this lock. Do not block while holding this
-  // lock.
+  // This lock protects |everything in this class|, except for the atomics and
+  // the WORK_STEALING mode state which document how they are accessed. Do not
+  // read or modify anything without holding this lock. Do not block while
+  // holding this lock.
   mutable Lock lock_;
 
   // Condition variable that is waited on by worker threads until new
@@ -416,12 +509,14 @@ class SequencedWorkerPool::Inner {
   // See PrepareToStartAdditionalThreadIfHelpful for more.
   bool thread_being_created_;
 
-  // Number of threads currently waiting for work.
-  size_t waiting_thread_count_;
+  // Number of threads currently waiting for work. Only changed inside the
+  // lock; WORK_STEALING mode reads it outside the lock when posting.
+  volatile subtle::Atomic32 waiting_thread_count_;
 
   // Number of threads currently running tasks that have the BLOCK_SHUTDOWN
-  // or SKIP_ON_SHUTDOWN flag set.
-  size_t blocking_shutdown_thread_count_;
+  // or SKIP_ON_SHUTDOWN flag set. Changed outside the lock in WORK_STEALING
+  // mode.
+  volatile subtle::Atomic32 blocking_shutdown_thread_count_;
 
   // A set of all pending tasks in time-to-run order. These are tasks that are
   // either waiting for a thread to run on, waiting for their time to run,
@@ -434,15 +529,16 @@ class SequencedWorkerPool::Inner {
   // The next sequence number for a new sequenced task.
   int64 next_sequence_task_number_;
 
-  // Number of tasks in the pending_tasks_ list that are marked as blocking
-  // shutdown.
-  size_t blocking_shutdown_pending_task_count_;
+  // Number of pending tasks that are marked as blocking shutdown. Changed
+  // outside the lock in WORK_STEALING mode, where they may also be on the
+  // deques.
+  volatile subtle::Atomic32 blocking_shutdown_pending_task_count_;
 
   // Lists all sequence tokens currently executing.
   std::set<int> current_sequences_;
 
   // An ID for each posted task to distinguish the task from others in traces.
-  int trace_id_;
+  volatile subtle::Atomic32 trace_id_;
 
   // Set when Shutdown is called and no further tasks should be
   // allowed, though we may still be running existing tasks.
@@ -457,6 +553,39 @@ class SequencedWorkerPool::Inner {
   size_t cleanup_idlers_;
   ConditionVariable cleanup_cv_;
 
+  const SchedulerMode scheduler_mode_;
+
+  // The deques of WORK_STEALING mode. work_queues_[0] is shared and gets the
+  // tasks posted from threads other than the workers, in order, and worker N
+  // has work_queues_[N]. Each is guarded by its own lock.
+  ScopedVector<WorkQueue> work_queues_;
+
+  // The tasks of each sequence that is on a deque or being run, in the order
+  // they are due. A sequence goes on a deque when a task is queued for it
+  // while it has none, and leaves this map when a worker runs out of its
+  // tasks, so that one worker at a time has it. Guarded by |sequences_lock_|,
+  // which is never held while taking |lock_| or the lock of a deque.
+  typedef hash_map<int, std::deque<SequencedTask> > SequenceMap;
+  Lock sequences_lock_;
+  SequenceMap sequences_;
+
+  // The number of entries on the deques.
+  volatile subtle::Atomic32 queued_item_count_;
+
+  // The number of posts that are queueing a task outside the lock. Shutdown()
+  // waits for them, and posts after that go through the lock.
+  volatile subtle::Atomic32 posts_in_progress_;
+
+  // Set along with |shutdown_called_|, for reading outside the lock.
+  volatile subtle::Atomic32 shutdown_started_;
+
+  // The size of |threads_|, for reading outside the lock.
+  volatile subtle::Atomic32 thread_count_;
+
+  // The size of |pending_tasks_|, which only holds delayed tasks in
+  // WORK_STEALING mode, for reading outside the lock.
+  volatile subtle::Atomic32 delayed_task_count_;
+
   TestingObserver* const testing_observer_;
 
   DISALLOW_COPY_AND_ASSIGN(Inner);
@@ -471,6 +600,7 @@ SequencedWorkerPool::Worker::Worker(
     : SimpleThread(
           prefix + StringPrintf("Worker%d", thread_number).c_str()),
       worker_pool_(worker_pool),
+      thread_number_(thread_number),
       running_shutdown_behavior_(CONTINUE_ON_SHUTDOWN) {
   Start();
 }
@@ -484,17 +614,30 @@ void SequencedWorkerPool::Worker::Run() {
   // using DelegateSimpleThread and have Inner implement the Delegate to avoid
   // having these worker objects at all, but that method lacks the ability to
   // send thread-specific information easily to the thread loop.
+  lazy_tls_ptr_.Get().Set(this);
   worker_pool_->inner_->ThreadLoop(this);
+  lazy_tls_ptr_.Get().Set(NULL);
   // Release our cyclic reference once we're done.
   worker_pool_ = NULL;
 }
 
+// static
+SequencedWorkerPool::Worker*
+SequencedWorkerPool::Worker::GetForCurrentThread() {
+  return lazy_tls_ptr_.Get().Get();
+}
+
+// static
+LazyInstance<ThreadLocalPointer<SequencedWorkerPool::Worker> >::Leaky
+    SequencedWorkerPool::Worker::lazy_tls_ptr_ = LAZY_INSTANCE_INITIALIZER;
+
 // Inner definitions ---------------------------------------------------------
 
 SequencedWorkerPool::Inner::Inner(
     SequencedWorkerPool* worker_pool,
     size_t max_threads,
     const std::string& thread_name_prefix,
+    SchedulerMode scheduler_mode,
     TestingObserver* observer)
     : worker_pool_(worker_pool),
       last_sequence_number_(0),
@@ -514,7 +657,19 @@ SequencedWorkerPool::Inner::Inner(
       cleanup_state_(CLEANUP_DONE),
       cleanup_idlers_(0),
       cleanup_cv_(&lock_),
-      testing_observer_(observer) {}
+      scheduler_mode_(scheduler_mode),
+      queued_item_count_(0),
+      posts_in_progress_(0),
+      shutdown_started_(0),
+      thread_count_(0),
+      delayed_task_count_(0),
+      testing_observer_(observer) {
+  if (scheduler_mode_ == WORK_STEALING) {
+    DCHECK_GT(max_threads_, 0u);
+    for (size_t i = 0; i <= max_threads_; ++i)
+      work_queues_.push_back(new WorkQueue);
+  }
+}
 
 SequencedWorkerPool::Inner::~Inner() {
   // You must call Shutdown() before destroying the pool.
@@ -560,23 +715,17 @@ bool SequencedWorkerPool::Inner::PostTask(
       base::MakeCriticalClosure(task) : task;
   sequenced.time_to_run = TimeTicks::Now() + delay;
 
+  if (scheduler_mode_ == WORK_STEALING && delay == TimeDelta())
+    return PostReadyTask(optional_token_name, &sequenced);
+
   int create_thread_id = 0;
   {
     AutoLock lock(lock_);
-    if (shutdown_called_) {
-      if (shutdown_behavior != BLOCK_SHUTDOWN ||
-          LockedCurrentThreadShutdownBehavior() == CONTINUE_ON_SHUTDOWN) {
-        return false;
-      }
-      if (max_blocking_tasks_after_shutdown_ <= 0) {
-        DLOG(WARNING) << "BLOCK_SHUTDOWN task disallowed";
-        return false;
-      }
-      max_blocking_tasks_after_shutdown_ -= 1;
-    }
+    if (shutdown_called_ && !LockedCanPostTaskAfterShutdown(shutdown_behavior))
+      return false;
 
     // The trace_id is used for identifying the task in about:tracing.
-    sequenced.trace_id = trace_id_++;
+    sequenced.trace_id = subtle::NoBarrier_AtomicIncrement(&trace_id_, 1) - 1;
 
     TRACE_EVENT_FLOW_BEGIN0("task", "SequencedWorkerPool::PostTask",
         TRACE_ID_MANGLE(GetTaskTraceID(sequenced, static_cast<void*>(this))));
@@ -588,8 +737,13 @@ bool SequencedWorkerPool::Inner::PostTask(
       sequenced.sequence_token_id = LockedGetNamedTokenID(*optional_token_name);
 
     pending_tasks_.insert(sequenced);
+    if (scheduler_mode_ == WORK_STEALING) {
+      subtle::Release_Store(&delayed_task_count_,
+                            static_cast<int>(pending_tasks_.size()));
+    }
     if (shutdown_behavior == BLOCK_SHUTDOWN)
-      blocking_shutdown_pending_task_count_++;
+      subtle::NoBarrier_AtomicIncrement(&blocking_shutdown_pending_task_count_,
+                                        1);
 
     create_thread_id = PrepareToStartAdditionalThreadIfHelpful();
   }
@@ -626,8 +780,12 @@ void SequencedWorkerPool::Inner::CleanupForTesting() {
   CHECK_EQ(CLEANUP_DONE, cleanup_state_);
   if (shutdown_called_)
     return;
-  if (pending_tasks_.empty() && waiting_thread_count_ == threads_.size())
+  if (pending_tasks_.empty() &&
+      subtle::NoBarrier_Load(&queued_item_count_) == 0 &&
+      static_cast<size_t>(subtle::NoBarrier_Load(&waiting_thread_count_)) ==
+          threads_.size()) {
     return;
+  }
   cleanup_state_ = CLEANUP_REQUESTED;
   cleanup_idlers_ = 0;
   has_work_cv_.Signal();
@@ -651,6 +809,18 @@ void SequencedWorkerPool::Inner::Shutdown(
     shutdown_called_ = true;
     max_blocking_tasks_after_shutdown_ = max_new_blocking_tasks_after_shutdown;
 
+    if (scheduler_mode_ == WORK_STEALING) {
+      // Posts that started before they could see |shutdown_started_| may
+      // still be counting their task as blocking shutdown. Wait for them
+      // outside the lock, which they may need to wake up a worker. Any later
+      // post takes the lock and sees |shutdown_called_|.
+      subtle::NoBarrier_Store(&shutdown_started_, 1);
+      subtle::MemoryBarrier();
+      AutoUnlock unlock(lock_);
+      while (subtle::Acquire_Load(&posts_in_progress_))
+        PlatformThread::YieldCurrentThread();
+    }
+
     // Tickle the threads. This will wake up a waiting one so it will know that
     // it can exit, which in turn will wake up any other waiting ones.
     SignalHasWork();
@@ -679,6 +849,11 @@ void SequencedWorkerPool::Inner::Shutdown(
 }
 
 void SequencedWorkerPool::Inner::ThreadLoop(Worker* this_worker) {
+  if (scheduler_mode_ == WORK_STEALING) {
+    WorkStealingThreadLoop(this_worker);
+    return;
+  }
+
   {
     AutoLock lock(lock_);
     DCHECK(thread_being_created_);
@@ -768,9 +943,9 @@ void SequencedWorkerPool::Inner::ThreadLoop(Worker* this_worker) {
         // ones with the same sequence token, but additional threads won't
         // help this case.
         if (shutdown_called_ &&
-            blocking_shutdown_pending_task_count_ == 0)
+            subtle::NoBarrier_Load(&blocking_shutdown_pending_task_count_) == 0)
           break;
-        waiting_thread_count_++;
+        subtle::NoBarrier_AtomicIncrement(&waiting_thread_count_, 1);
 
         switch (status) {
           case GET_WORK_NOT_FOUND:
@@ -782,7 +957,7 @@ void SequencedWorkerPool::Inner::ThreadLoop(Worker* this_worker) {
           default:
             NOTREACHED();
         }
-        waiting_thread_count_--;
+        subtle::NoBarrier_AtomicIncrement(&waiting_thread_count_, -1);
       }
     }
   }  // Release lock_.
@@ -857,6 +1032,22 @@ int64 SequencedWorkerPool::Inner::LockedGetNextSequenceTaskNumber() {
   return next_sequence_task_number_++;
 }
 
+bool SequencedWorkerPool::Inner::LockedCanPostTaskAfterShutdown(
+    WorkerShutdown shutdown_behavior) {
+  lock_.AssertAcquired();
+  DCHECK(shutdown_called_);
+  if (shutdown_behavior != BLOCK_SHUTDOWN ||
+      LockedCurrentThreadShutdownBehavior() == CONTINUE_ON_SHUTDOWN) {
+    return false;
+  }
+  if (max_blocking_tasks_after_shutdown_ <= 0) {
+    DLOG(WARNING) << "BLOCK_SHUTDOWN task disallowed";
+    return false;
+  }
+  max_blocking_tasks_after_shutdown_ -= 1;
+  return true;
+}
+
 SequencedWorkerPool::WorkerShutdown
 SequencedWorkerPool::Inner::LockedCurrentThreadShutdownBehavior() const {
   lock_.AssertAcquired();
@@ -948,7 +1139,8 @@ SequencedWorkerPool::Inner::GetWorkStatus SequencedWorkerPool::Inner::GetWork(
     *task = *i;
     pending_tasks_.erase(i);
     if (task->shutdown_behavior == BLOCK_SHUTDOWN) {
-      blocking_shutdown_pending_task_count_--;
+      subtle::NoBarrier_AtomicIncrement(&blocking_shutdown_pending_task_count_,
+                                        -1);
     }
 
     status = GET_WORK_FOUND;
@@ -974,7 +1166,7 @@ int SequencedWorkerPool::Inner::WillRunWorkerTask(const SequencedTask& task) {
   // or BLOCK_SHUTDOWN will prevent shutdown until that task or thread
   // completes.
   if (task.shutdown_behavior != CONTINUE_ON_SHUTDOWN)
-    blocking_shutdown_thread_count_++;
+    subtle::NoBarrier_AtomicIncrement(&blocking_shutdown_thread_count_, 1);
 
   // We just picked up a task. Since StartAdditionalThreadIfHelpful only
   // creates a new thread if there is no free one, there is a race when posting
@@ -998,8 +1190,8 @@ void SequencedWorkerPool::Inner::DidRunWorkerTask(const SequencedTask& task) {
   lock_.AssertAcquired();
 
   if (task.shutdown_behavior != CONTINUE_ON_SHUTDOWN) {
-    DCHECK_GT(blocking_shutdown_thread_count_, 0u);
-    blocking_shutdown_thread_count_--;
+    DCHECK_GT(subtle::NoBarrier_Load(&blocking_shutdown_thread_count_), 0);
+    subtle::NoBarrier_AtomicIncrement(&blocking_shutdown_thread_count_, -1);
   }
 
   if (task.sequence_token_id)
@@ -1049,8 +1241,12 @@ int SequencedWorkerPool::Inner::PrepareToStartAdditionalThreadIfHelpful() {
       !thread_being_created_ &&
       cleanup_state_ == CLEANUP_DONE &&
       threads_.size() < max_threads_ &&
-      waiting_thread_count_ == 0) {
+      subtle::NoBarrier_Load(&waiting_thread_count_) == 0) {
     // We could use an additional thread if there's work to be done.
+    if (subtle::NoBarrier_Load(&queued_item_count_)) {
+      thread_being_created_ = true;
+      return static_cast<int>(threads_.size() + 1);
+    }
     for (PendingTaskSet::const_iterator i = pending_tasks_.begin();
          i != pending_tasks_.end(); ++i) {
       if (IsSequenceTokenRunnable(i->sequence_token_id)) {
@@ -1083,9 +1279,368 @@ void SequencedWorkerPool::Inner::SignalHasWork() {
 bool SequencedWorkerPool::Inner::CanShutdown() const {
   lock_.AssertAcquired();
   // See PrepareToStartAdditionalThreadIfHelpful for how thread creation works.
+  //
+  // In WORK_STEALING mode, a worker counts a BLOCK_SHUTDOWN task as running
+  // before it stops counting it as pending, outside the lock. Reading in the
+  // opposite order means the task is always seen in one of the two.
   return !thread_being_created_ &&
-         blocking_shutdown_thread_count_ == 0 &&
-         blocking_shutdown_pending_task_count_ == 0;
+         subtle::Acquire_Load(&blocking_shutdown_pending_task_count_) == 0 &&
+         subtle::Acquire_Load(&blocking_shutdown_thread_count_) == 0;
+}
+
+void SequencedWorkerPool::Inner::WorkStealingThreadLoop(Worker* this_worker) {
+  {
+    AutoLock lock(lock_);
+    DCHECK(thread_being_created_);
+    thread_being_created_ = false;
+    std::pair<ThreadMap::iterator, bool> result =
+        threads_.insert(
+            std::make_pair(this_worker->tid(), make_linked_ptr(this_worker)));
+    DCHECK(result.second);
+    subtle::NoBarrier_AtomicIncrement(&thread_count_, 1);
+  }
+
+  const size_t queue_index = this_worker->thread_number();
+  while (true) {
+#if defined(OS_MACOSX)
+    base::mac::ScopedNSAutoreleasePool autorelease_pool;
+#endif
+
+    WorkItem item;
+    if (TakeWorkItem(queue_index, &item)) {
+      RunWorkItem(this_worker, &item);
+      continue;
+    }
+
+    // The deques are empty. Look for delayed tasks that are due, help with
+    // cleanup, exit or wait, all inside the lock. See GetWork for what
+    // delete_these_outside_lock is doing; it's destroyed after the lock is
+    // released.
+    SequencedTask task;
+    TimeDelta wait_time;
+    std::vector<Closure> delete_these_outside_lock;
+    {
+      AutoLock lock(lock_);
+      HandleCleanup();
+
+      GetWorkStatus status =
+          GetWork(&task, &wait_time, &delete_these_outside_lock);
+      subtle::Release_Store(&delayed_task_count_,
+                            static_cast<int>(pending_tasks_.size()));
+      if (status != GET_WORK_FOUND) {
+        if (cleanup_state_ == CLEANUP_RUNNING) {
+          // Finish only once the tasks on the deques have been run as well.
+          if (status == GET_WORK_NOT_FOUND &&
+              !subtle::NoBarrier_Load(&queued_item_count_)) {
+            CHECK(delete_these_outside_lock.empty());
+            cleanup_state_ = CLEANUP_FINISHING;
+            cleanup_cv_.Broadcast();
+          }
+          continue;
+        }
+
+        // See ThreadLoop for when it's safe to exit.
+        if (shutdown_called_ &&
+            subtle::NoBarrier_Load(&blocking_shutdown_pending_task_count_) == 0)
+          break;
+
+        // Delete tasks before waiting, and look again since the lock is
+        // released meanwhile.
+        if (!delete_these_outside_lock.empty())
+          continue;
+
+        // Posters queue their task before they check for waiting threads, so
+        // either the task is seen here or the poster signals once this thread
+        // is waiting and has released the lock.
+        subtle::Barrier_AtomicIncrement(&waiting_thread_count_, 1);
+        if (!subtle::NoBarrier_Load(&queued_item_count_)) {
+          switch (status) {
+            case GET_WORK_NOT_FOUND:
+              has_work_cv_.Wait();
+              break;
+            case GET_WORK_WAIT:
+              has_work_cv_.TimedWait(wait_time);
+              break;
+            default:
+              NOTREACHED();
+          }
+        }
+        subtle::Barrier_AtomicIncrement(&waiting_thread_count_, -1);
+        continue;
+      }
+    }  // Release lock_.
+
+    // A delayed task is due. Those are all SKIP_ON_SHUTDOWN, so it no longer
+    // counts as pending. A sequenced one joins its sequence, behind the tasks
+    // that were due before it.
+    DCHECK_NE(BLOCK_SHUTDOWN, task.shutdown_behavior);
+    delete_these_outside_lock.clear();
+    if (task.sequence_token_id) {
+      QueueReadyTask(task);
+    } else {
+      item.task = task;
+      task.task.Reset();
+      RunWorkItem(this_worker, &item);
+    }
+  }
+
+  // We noticed we should exit. Wake up the next worker so it knows it should
+  // exit as well (because the Shutdown() code only signals once).
+  SignalHasWork();
+
+  // Possibly unblock shutdown.
+  can_shutdown_cv_.Signal();
+}
+
+bool SequencedWorkerPool::Inner::PostReadyTask(
+    const std::string* optional_token_name,
+    SequencedTask* task) {
+  if (optional_token_name) {
+    AutoLock lock(lock_);
+    task->sequence_token_id = LockedGetNamedTokenID(*optional_token_name);
+  }
+
+  // The trace_id is used for identifying the task in about:tracing.
+  task->trace_id = subtle::NoBarrier_AtomicIncrement(&trace_id_, 1) - 1;
+
+  // Shutdown() sets |shutdown_started_| before it waits for
+  // |posts_in_progress_| to drop to zero, so either it waits for this post or
+  // this post sees that shutdown has started.
+  subtle::Barrier_AtomicIncrement(&posts_in_progress_, 1);
+  if (subtle::Acquire_Load(&shutdown_started_)) {
+    subtle::Barrier_AtomicIncrement(&posts_in_progress_, -1);
+    AutoLock lock(lock_);
+    if (!LockedCanPostTaskAfterShutdown(task->shutdown_behavior))
+      return false;
+    subtle::NoBarrier_AtomicIncrement(&blocking_shutdown_pending_task_count_,
+                                      1);
+    TRACE_EVENT_FLOW_BEGIN0("task", "SequencedWorkerPool::PostTask",
+        TRACE_ID_MANGLE(GetTaskTraceID(*task, static_cast<void*>(this))));
+    QueueReadyTask(*task);
+  } else {
+    if (task->shutdown_behavior == BLOCK_SHUTDOWN) {
+      subtle::NoBarrier_AtomicIncrement(&blocking_shutdown_pending_task_count_,
+                                        1);
+    }
+    TRACE_EVENT_FLOW_BEGIN0("task", "SequencedWorkerPool::PostTask",
+        TRACE_ID_MANGLE(GetTaskTraceID(*task, static_cast<void*>(this))));
+    QueueReadyTask(*task);
+    subtle::Barrier_AtomicIncrement(&posts_in_progress_, -1);
+  }
+
+  WakeUpWorkerForQueuedTask();
+  return true;
+}
+
+void SequencedWorkerPool::Inner::QueueReadyTask(const SequencedTask& task) {
+  size_t queue_index = 0;
+  Worker* worker = Worker::GetForCurrentThread();
+  if (worker && worker->worker_pool() == worker_pool_)
+    queue_index = worker->thread_number();
+
+  if (!task.sequence_token_id) {
+    PushWorkItem(queue_index, WorkItem(task));
+    return;
+  }
+
+  {
+    AutoLock lock(sequences_lock_);
+    std::pair<SequenceMap::iterator, bool> result = sequences_.insert(
+        std::make_pair(task.sequence_token_id, std::deque<SequencedTask>()));
+    // A delayed task is queued once it is due, which can be after tasks of
+    // its sequence that were posted later; it goes ahead of those.
+    std::deque<SequencedTask>& tasks = result.first->second;
+    std::deque<SequencedTask>::iterator position = tasks.end();
+    while (position != tasks.begin() &&
+           task.time_to_run < (position - 1)->time_to_run) {
+      --position;
+    }
+    tasks.insert(position, task);
+    // Already assigned to a worker, which will get to this task.
+    if (!result.second)
+      return;
+  }
+  PushWorkItem(queue_index, WorkItem(task.sequence_token_id));
+}
+
+void SequencedWorkerPool::Inner::QueueDueDelayedTasks(int sequence_token_id) {
+  lock_.AssertAcquired();
+  // GetWork deletes them once shutdown has started.
+  if (shutdown_called_)
+    return;
+
+  const TimeTicks current_time = TimeTicks::Now();
+  PendingTaskSet::iterator i = pending_tasks_.begin();
+  while (i != pending_tasks_.end() && i->time_to_run <= current_time) {
+    if (i->sequence_token_id == sequence_token_id) {
+      QueueReadyTask(*i);
+      pending_tasks_.erase(i++);
+    } else {
+      ++i;
+    }
+  }
+  subtle::Release_Store(&delayed_task_count_,
+                        static_cast<int>(pending_tasks_.size()));
+}
+
+void SequencedWorkerPool::Inner::PushWorkItem(size_t queue_index,
+                                              const WorkItem& item) {
+  WorkQueue* queue = work_queues_[queue_index];
+  {
+    AutoLock lock(queue->lock);
+    queue->items.push_back(item);
+  }
+  subtle::Barrier_AtomicIncrement(&queued_item_count_, 1);
+}
+
+bool SequencedWorkerPool::Inner::TakeWorkItem(size_t queue_index,
+                                              WorkItem* item) {
+  // Our own deque first keeps a worker on the tasks it posted itself and on
+  // its sequence. Then the shared deque, so that tasks from other threads
+  // start in the order they were posted, and only then the other workers'.
+  if (TakeWorkItemFromQueue(queue_index, item) ||
+      TakeWorkItemFromQueue(0, item)) {
+    return true;
+  }
+  const size_t queue_count = work_queues_.size();
+  for (size_t i = 1; i < queue_count; ++i) {
+    size_t index = (queue_index + i) % queue_count;
+    if (index && TakeWorkItemFromQueue(index, item))
+      return true;
+  }
+  return false;
+}
+
+bool SequencedWorkerPool::Inner::TakeWorkItemFromQueue(size_t queue_index,
+                                                       WorkItem* item) {
+  if (!subtle::Acquire_Load(&queued_item_count_))
+    return false;
+  WorkQueue* queue = work_queues_[queue_index];
+  AutoLock lock(queue->lock);
+  if (queue->items.empty())
+    return false;
+  *item = queue->items.front();
+  queue->items.pop_front();
+  subtle::Barrier_AtomicIncrement(&queued_item_count_, -1);
+  return true;
+}
+
+void SequencedWorkerPool::Inner::RunWorkItem(Worker* this_worker,
+                                             WorkItem* item) {
+  const int sequence_token_id = item->sequence_token_id;
+  SequencedTask task;
+  if (sequence_token_id) {
+    // The workers only look for due delayed tasks once the deques are empty,
+    // and this one may have kept the sequence since its delayed task was due.
+    if (subtle::Acquire_Load(&delayed_task_count_)) {
+      AutoLock lock(lock_);
+      QueueDueDelayedTasks(sequence_token_id);
+    }
+    AutoLock lock(sequences_lock_);
+    std::deque<SequencedTask>& tasks = sequences_[sequence_token_id];
+    DCHECK(!tasks.empty());
+    task = tasks.front();
+    tasks.pop_front();
+  } else {
+    task = item->task;
+    item->task.task.Reset();
+  }
+
+  // Count the task as running before checking for shutdown, and before it
+  // stops counting as pending. Shutdown() sets the flag before it checks the
+  // counts, so it either sees this task or this task sees the flag.
+  const bool blocks_shutdown =
+      task.shutdown_behavior != CONTINUE_ON_SHUTDOWN;
+  if (blocks_shutdown)
+    subtle::Barrier_AtomicIncrement(&blocking_shutdown_thread_count_, 1);
+  if (task.shutdown_behavior == BLOCK_SHUTDOWN)
+    subtle::Barrier_AtomicIncrement(&blocking_shutdown_pending_task_count_, -1);
+
+  if (subtle::Acquire_Load(&shutdown_started_) &&
+      task.shutdown_behavior != BLOCK_SHUTDOWN) {
+    // We're shutting down and the task isn't blocking shutdown. Delete it
+    // rather than run it, like GetWork does.
+    task.task = Closure();
+  } else {
+    TRACE_EVENT_FLOW_END0("task", "SequencedWorkerPool::PostTask",
+        TRACE_ID_MANGLE(GetTaskTraceID(task, static_cast<void*>(this))));
+    TRACE_EVENT2("task", "SequencedWorkerPool::ThreadLoop",
+                 "src_file", task.posted_from.file_name(),
+                 "src_func", task.posted_from.function_name());
+
+    // See WillRunWorkerTask for why another thread is started before running
+    // the task. Waiting workers were already signaled by the posters.
+    if (subtle::NoBarrier_Load(&queued_item_count_) &&
+        !subtle::NoBarrier_Load(&waiting_thread_count_) &&
+        static_cast<size_t>(subtle::NoBarrier_Load(&thread_count_)) <
+            max_threads_) {
+      int new_thread_id;
+      {
+        AutoLock lock(lock_);
+        new_thread_id = PrepareToStartAdditionalThreadIfHelpful();
+      }
+      if (new_thread_id)
+        FinishStartingAdditionalThread(new_thread_id);
+    }
+
+    this_worker->set_running_task_info(
+        SequenceToken(task.sequence_token_id), task.shutdown_behavior);
+
+    tracked_objects::TrackedTime start_time =
+        tracked_objects::ThreadData::NowForStartOfRun(task.birth_tally);
+
+    task.task.Run();
+
+    tracked_objects::ThreadData::TallyRunOnNamedThreadIfTracking(task,
+        start_time, tracked_objects::ThreadData::NowForEndOfRun());
+
+    // Destroy the task before calling set_running_task_info(), see
+    // ThreadLoop.
+    task.task = Closure();
+
+    this_worker->set_running_task_info(SequenceToken(), CONTINUE_ON_SHUTDOWN);
+  }
+
+  if (blocks_shutdown)
+    subtle::Barrier_AtomicIncrement(&blocking_shutdown_thread_count_, -1);
+
+  if (!sequence_token_id)
+    return;
+
+  // Keep the sequence on this worker while it has tasks. Other workers can
+  // still take it from the deque if this one gets busy.
+  {
+    AutoLock lock(sequences_lock_);
+    SequenceMap::iterator found = sequences_.find(sequence_token_id);
+    DCHECK(found != sequences_.end());
+    if (found->second.empty()) {
+      sequences_.erase(found);
+      return;
+    }
+  }
+  PushWorkItem(this_worker->thread_number(), WorkItem(sequence_token_id));
+}
+
+void SequencedWorkerPool::Inner::WakeUpWorkerForQueuedTask() {
+  // See WorkStealingThreadLoop for why this doesn't miss a worker that is
+  // about to wait: it holds the lock until it does.
+  if (subtle::NoBarrier_Load(&waiting_thread_count_)) {
+    AutoLock lock(lock_);
+    SignalHasWork();
+    return;
+  }
+
+  if (static_cast<size_t>(subtle::NoBarrier_Load(&thread_count_)) >=
+      max_threads_) {
+    return;
+  }
+  int create_thread_id;
+  {
+    AutoLock lock(lock_);
+    create_thread_id = PrepareToStartAdditionalThreadIfHelpful();
+  }
+  if (create_thread_id)
+    FinishStartingAdditionalThread(create_thread_id);
 }
 
 // SequencedWorkerPool --------------------------------------------------------
@@ -1095,16 +1650,38 @@ SequencedWorkerPool::SequencedWorkerPool(
     const std::string& thread_name_prefix)
     : constructor_message_loop_(MessageLoopProxy::current()),
       inner_(new Inner(ALLOW_THIS_IN_INITIALIZER_LIST(this),
-                       max_threads, thread_name_prefix, NULL)) {
+                       max_threads, thread_name_prefix, GLOBAL_QUEUE, NULL)) {
+}
+
+SequencedWorkerPool::SequencedWorkerPool(
+    size_t max_threads,
+    const std::string& thread_name_prefix,
+    TestingObserver* observer)
+    : constructor_message_loop_(MessageLoopProxy::current()),
+      inner_(new Inner(ALLOW_THIS_IN_INITIALIZER_LIST(this),
+                       max_threads, thread_name_prefix, GLOBAL_QUEUE,
+                       observer)) {
+}
+
+SequencedWorkerPool::SequencedWorkerPool(
+    size_t max_threads,
+    const std::string& thread_name_prefix,
+    SchedulerMode scheduler_mode)
+    : constructor_message_loop_(MessageLoopProxy::current()),
+      inner_(new Inner(ALLOW_THIS_IN_INITIALIZER_LIST(this),
+                       max_threads, thread_name_prefix, scheduler_mode,
+                       NULL)) {
 }
 
 SequencedWorkerPool::SequencedWorkerPool(
     size_t max_threads,
     const std::string& thread_name_prefix,
+    SchedulerMode scheduler_mode,
     TestingObserver* observer)
     : constructor_message_loop_(MessageLoopProxy::current()),
       inner_(new Inner(ALLOW_THIS_IN_INITIALIZER_LIST(this),
-                       max_threads, thread_name_prefix, observer)) {
+                       max_threads, thread_name_prefix, scheduler_mode,
+                       observer)) {
 }
 
 SequencedWorkerPool::~SequencedWorkerPool() {}
@@ -143,6 +143,27 @@ class BASE_EXPORT SequencedWorkerPool : public TaskRunner {
     virtual void OnDestruct() = 0;
   };
 
+  // How the pool hands tasks out to its worker threads.
+  enum SchedulerMode {
+    // All pending tasks are kept in one set sorted by time to run, which the
+    // workers search under the pool's lock.
+    GLOBAL_QUEUE,
+
+    // Tasks that are ready to run are kept in deques: one for each worker,
+    // which gets the tasks posted from that worker, and one for the tasks
+    // posted from other threads. Workers run the tasks of their own deque
+    // first, then those of the shared one, and steal from the other workers
+    // when both are empty. A sequence with tasks ready to run is handed out
+    // as a whole, so it is assigned to only one worker at a time and its
+    // tasks run in order. A delayed task joins its sequence once it is due,
+    // ahead of the tasks posted after that. Posting and running tasks that
+    // have no delay only takes the lock of a deque; delayed tasks, shutdown,
+    // flushing and starting threads still go through the pool's lock.
+    //
+    // This scales better when many threads post and run short tasks.
+    WORK_STEALING,
+  };
+
   // When constructing a SequencedWorkerPool, there must be a
   // MessageLoop on the current thread unless you plan to deliberately
   // leak it.
@@ -158,6 +179,15 @@ class BASE_EXPORT SequencedWorkerPool : public TaskRunner {
                       const std::string& thread_name_prefix,
                       TestingObserver* observer);
 
+  // Like above, but with the given scheduler. The others use GLOBAL_QUEUE.
+  SequencedWorkerPool(size_t max_threads,
+                      const std::string& thread_name_prefix,
+                      SchedulerMode scheduler_mode);
+  SequencedWorkerPool(size_t max_threads,
+                      const std::string& thread_name_prefix,
+                      SchedulerMode scheduler_mode,
+                      TestingObserver* observer);
+
   // Returns a unique token that can be used to sequence tasks posted to
   // PostSequencedWorkerTask(). Valid tokens are alwys nonzero.
   SequenceToken GetSequenceToken();
@@ -176,7 +176,9 @@ class TestTracker : public base::RefCountedThreadSafe<TestTracker> {
   size_t started_events_;
 };
 
-class SequencedWorkerPoolTest : public testing::Test {
+// Runs each test with both schedulers.
+class SequencedWorkerPoolTest
+    : public testing::TestWithParam<SequencedWorkerPool::SchedulerMode> {
  public:
   SequencedWorkerPoolTest()
       : tracker_(new TestTracker) {
@@ -199,7 +201,8 @@ class SequencedWorkerPoolTest : public testing::Test {
   // Destroys the SequencedWorkerPool instance, blocking until it is fully shut
   // down, and creates a new instance.
   void ResetPool() {
-    pool_owner_.reset(new SequencedWorkerPoolOwner(kNumWorkerThreads, "test"));
+    pool_owner_.reset(
+        new SequencedWorkerPoolOwner(kNumWorkerThreads, "test", GetParam()));
   }
 
   void SetWillWaitForShutdownCallback(const Closure& callback) {
@@ -285,7 +288,7 @@ void HoldPoolReference(const scoped_refptr<base::SequencedWorkerPool>& pool,
 }
 
 // Tests that delayed tasks are deleted upon shutdown of the pool.
-TEST_F(SequencedWorkerPoolTest, DelayedTaskDuringShutdown) {
+TEST_P(SequencedWorkerPoolTest, DelayedTaskDuringShutdown) {
   // Post something to verify the pool is started up.
   EXPECT_TRUE(pool()->PostTask(
       FROM_HERE, base::Bind(&TestTracker::FastTask, tracker(), 1)));
@@ -320,7 +323,7 @@ TEST_F(SequencedWorkerPoolTest, DelayedTaskDuringShutdown) {
 }
 
 // Tests that same-named tokens have the same ID.
-TEST_F(SequencedWorkerPoolTest, NamedTokens) {
+TEST_P(SequencedWorkerPoolTest, NamedTokens) {
   const std::string name1("hello");
   SequencedWorkerPool::SequenceToken token1 =
       pool()->GetNamedSequenceToken(name1);
@@ -348,7 +351,7 @@ TEST_F(SequencedWorkerPoolTest, NamedTokens) {
 
 // Tests that posting a bunch of tasks (many more than the number of worker
 // threads) runs them all.
-TEST_F(SequencedWorkerPoolTest, LotsOfTasks) {
+TEST_P(SequencedWorkerPoolTest, LotsOfTasks) {
   pool()->PostWorkerTask(FROM_HERE,
                          base::Bind(&TestTracker::SlowTask, tracker(), 0));
 
@@ -366,9 +369,9 @@ TEST_F(SequencedWorkerPoolTest, LotsOfTasks) {
 // worker threads) to two pools simultaneously runs them all twice.
 // This test is meant to shake out any concurrency issues between
 // pools (like histograms).
-TEST_F(SequencedWorkerPoolTest, LotsOfTasksTwoPools) {
-  SequencedWorkerPoolOwner pool1(kNumWorkerThreads, "test1");
-  SequencedWorkerPoolOwner pool2(kNumWorkerThreads, "test2");
+TEST_P(SequencedWorkerPoolTest, LotsOfTasksTwoPools) {
+  SequencedWorkerPoolOwner pool1(kNumWorkerThreads, "test1", GetParam());
+  SequencedWorkerPoolOwner pool2(kNumWorkerThreads, "test2", GetParam());
 
   base::Closure slow_task = base::Bind(&TestTracker::SlowTask, tracker(), 0);
   pool1.pool()->PostWorkerTask(FROM_HERE, slow_task);
@@ -392,7 +395,7 @@ TEST_F(SequencedWorkerPoolTest, LotsOfTasksTwoPools) {
 
 // Test that tasks with the same sequence token are executed in order but don't
 // affect other tasks.
-TEST_F(SequencedWorkerPoolTest, Sequence) {
+TEST_P(SequencedWorkerPoolTest, Sequence) {
   // Fill all the worker threads except one.
   const size_t kNumBackgroundTasks = kNumWorkerThreads - 1;
   ThreadBlocker background_blocker;
@@ -451,9 +454,75 @@ TEST_F(SequencedWorkerPoolTest, Sequence) {
   EXPECT_EQ(101, result[result.size() - 1]);
 }
 
+// Tests that tasks of several sequences posted in turn each run in order.
+TEST_P(SequencedWorkerPoolTest, InterleavedSequences) {
+  const int kNumSequences = 5;
+  const int kNumTasksPerSequence = 20;
+  std::vector<SequencedWorkerPool::SequenceToken> tokens;
+  for (int i = 0; i < kNumSequences; ++i)
+    tokens.push_back(pool()->GetSequenceToken());
+  for (int task = 0; task < kNumTasksPerSequence; ++task) {
+    for (int i = 0; i < kNumSequences; ++i) {
+      pool()->PostSequencedWorkerTask(
+          tokens[i], FROM_HERE,
+          base::Bind(&TestTracker::FastTask, tracker(), i * 100 + task));
+    }
+  }
+
+  std::vector<int> result = tracker()->WaitUntilTasksComplete(
+      kNumSequences * kNumTasksPerSequence);
+  ASSERT_EQ(static_cast<size_t>(kNumSequences * kNumTasksPerSequence),
+            result.size());
+  std::vector<int> next_task(kNumSequences, 0);
+  for (size_t i = 0; i < result.size(); ++i) {
+    int sequence = result[i] / 100;
+    EXPECT_EQ(next_task[sequence], result[i] % 100);
+    next_task[sequence] = result[i] % 100 + 1;
+  }
+}
+
+// Tests that a delayed task runs before the tasks of its sequence posted
+// after it was due, even when no worker was free to queue it on time.
+TEST_P(SequencedWorkerPoolTest, DueDelayedTaskInSequence) {
+  EnsureAllWorkersCreated();
+  const size_t kNumBackgroundTasks = kNumWorkerThreads - 1;
+  ThreadBlocker background_blocker;
+  for (size_t i = 0; i < kNumBackgroundTasks; i++) {
+    pool()->PostWorkerTask(FROM_HERE,
+                           base::Bind(&TestTracker::BlockTask,
+                                      tracker(), -1, &background_blocker));
+  }
+  ThreadBlocker blocker;
+  SequencedWorkerPool::SequenceToken token = pool()->GetSequenceToken();
+  pool()->PostSequencedWorkerTask(
+      token, FROM_HERE,
+      base::Bind(&TestTracker::BlockTask, tracker(), 0, &blocker));
+  tracker()->WaitUntilTasksBlocked(kNumWorkerThreads);
+
+  // With every worker busy, the delayed task comes due before the next one
+  // is posted.
+  pool()->PostDelayedSequencedWorkerTask(
+      token, FROM_HERE, base::Bind(&TestTracker::FastTask, tracker(), 1),
+      base::TimeDelta::FromMilliseconds(10));
+  base::PlatformThread::Sleep(base::TimeDelta::FromMilliseconds(50));
+  pool()->PostSequencedWorkerTask(
+      token, FROM_HERE, base::Bind(&TestTracker::FastTask, tracker(), 2));
+
+  blocker.Unblock(1);
+  std::vector<int> result = tracker()->WaitUntilTasksComplete(3);
+  ASSERT_EQ(3u, result.size());
+  EXPECT_EQ(0, result[0]);
+  EXPECT_EQ(1, result[1]);
+  EXPECT_EQ(2, result[2]);
+
+  background_blocker.Unblock(kNumBackgroundTasks);
+  EXPECT_EQ(kNumWorkerThreads + 2,
+            tracker()->WaitUntilTasksComplete(kNumWorkerThreads + 2).size());
+}
+
 // Tests that any tasks posted after Shutdown are ignored.
 // Disabled for flakiness.  See http://crbug.com/166451.
-TEST_F(SequencedWorkerPoolTest, DISABLED_IgnoresAfterShutdown) {
+TEST_P(SequencedWorkerPoolTest, DISABLED_IgnoresAfterShutdown) {
   // Start tasks to take all the threads and block them.
   EnsureAllWorkersCreated();
   ThreadBlocker blocker;
@@ -502,7 +571,7 @@ TEST_F(SequencedWorkerPoolTest, DISABLED_IgnoresAfterShutdown) {
   ASSERT_EQ(old_has_work_call_count, has_work_call_count());
 }
 
-TEST_F(SequencedWorkerPoolTest, AllowsAfterShutdown) {
+TEST_P(SequencedWorkerPoolTest, AllowsAfterShutdown) {
   // Test that <n> new blocking tasks are allowed provided they're posted
   // by a running tasks.
   EnsureAllWorkersCreated();
@@ -549,7 +618,7 @@ TEST_F(SequencedWorkerPoolTest, AllowsAfterShutdown) {
 
 // Tests that unrun tasks are discarded properly according to their shutdown
 // mode.
-TEST_F(SequencedWorkerPoolTest, DiscardOnShutdown) {
+TEST_P(SequencedWorkerPoolTest, DiscardOnShutdown) {
   // Start tasks to take all the threads and block them.
   EnsureAllWorkersCreated();
   ThreadBlocker blocker;
@@ -595,7 +664,7 @@ TEST_F(SequencedWorkerPoolTest, DiscardOnShutdown) {
 }
 
 // Tests that CONTINUE_ON_SHUTDOWN tasks don't block shutdown.
-TEST_F(SequencedWorkerPoolTest, ContinueOnShutdown) {
+TEST_P(SequencedWorkerPoolTest, ContinueOnShutdown) {
   scoped_refptr<TaskRunner> runner(pool()->GetTaskRunnerWithShutdownBehavior(
       SequencedWorkerPool::CONTINUE_ON_SHUTDOWN));
   scoped_refptr<SequencedTaskRunner> sequenced_runner(
@@ -643,7 +712,7 @@ TEST_F(SequencedWorkerPoolTest, ContinueOnShutdown) {
 
 // Tests that SKIP_ON_SHUTDOWN tasks that have been started block Shutdown
 // until they stop, but tasks not yet started do not.
-TEST_F(SequencedWorkerPoolTest, SkipOnShutdown) {
+TEST_P(SequencedWorkerPoolTest, SkipOnShutdown) {
   // Start tasks to take all the threads and block them.
   EnsureAllWorkersCreated();
   ThreadBlocker blocker;
@@ -696,7 +765,7 @@ TEST_F(SequencedWorkerPoolTest, SkipOnShutdown) {
 // Ensure all worker threads are created, and then trigger a spurious
 // work signal. This shouldn't cause any other work signals to be
 // triggered. This is a regression test for http://crbug.com/117469.
-TEST_F(SequencedWorkerPoolTest, SpuriousWorkSignal) {
+TEST_P(SequencedWorkerPoolTest, SpuriousWorkSignal) {
   EnsureAllWorkersCreated();
   int old_has_work_call_count = has_work_call_count();
   pool()->SignalHasWorkForTesting();
@@ -721,7 +790,7 @@ void IsRunningOnCurrentThreadTask(
 }
 
 // Verify correctness of the IsRunningSequenceOnCurrentThread method.
-TEST_F(SequencedWorkerPoolTest, IsRunningOnCurrentThread) {
+TEST_P(SequencedWorkerPoolTest, IsRunningOnCurrentThread) {
   SequencedWorkerPool::SequenceToken token1 = pool()->GetSequenceToken();
   SequencedWorkerPool::SequenceToken token2 = pool()->GetSequenceToken();
   SequencedWorkerPool::SequenceToken unsequenced_token;
@@ -758,7 +827,7 @@ TEST_F(SequencedWorkerPoolTest, IsRunningOnCurrentThread) {
 }
 
 // Verify that FlushForTesting works as intended.
-TEST_F(SequencedWorkerPoolTest, FlushForTesting) {
+TEST_P(SequencedWorkerPoolTest, FlushForTesting) {
   // Should be fine to call on a new instance.
   pool()->FlushForTesting();
 
@@ -798,6 +867,12 @@ TEST_F(SequencedWorkerPoolTest, FlushForTesting) {
   pool()->FlushForTesting();
 }
 
+INSTANTIATE_TEST_CASE_P(
+    SchedulerModes, SequencedWorkerPoolTest,
+    testing::Values(SequencedWorkerPool::GLOBAL_QUEUE,
+                    SequencedWorkerPool::WORK_STEALING));
+
+template <SequencedWorkerPool::SchedulerMode kSchedulerMode>
 class SequencedWorkerPoolTaskRunnerTestDelegate {
  public:
   SequencedWorkerPoolTaskRunnerTestDelegate() {}
@@ -805,8 +880,8 @@ class SequencedWorkerPoolTaskRunnerTestDelegate {
   ~SequencedWorkerPoolTaskRunnerTestDelegate() {}
 
   void StartTaskRunner() {
-    pool_owner_.reset(
-        new SequencedWorkerPoolOwner(10, "SequencedWorkerPoolTaskRunnerTest"));
+    pool_owner_.reset(new SequencedWorkerPoolOwner(
+        10, "SequencedWorkerPoolTaskRunnerTest", kSchedulerMode));
   }
 
   scoped_refptr<SequencedWorkerPool> GetTaskRunner() {
@@ -831,10 +906,18 @@ class SequencedWorkerPoolTaskRunnerTestDelegate {
   scoped_ptr<SequencedWorkerPoolOwner> pool_owner_;
 };
 
+typedef testing::Types<
+    SequencedWorkerPoolTaskRunnerTestDelegate<
+        SequencedWorkerPool::GLOBAL_QUEUE>,
+    SequencedWorkerPoolTaskRunnerTestDelegate<
+        SequencedWorkerPool::WORK_STEALING> >
+    SequencedWorkerPoolTaskRunnerTestDelegates;
+
 INSTANTIATE_TYPED_TEST_CASE_P(
     SequencedWorkerPool, TaskRunnerTest,
-    SequencedWorkerPoolTaskRunnerTestDelegate);
+    SequencedWorkerPoolTaskRunnerTestDelegates);
 
+template <SequencedWorkerPool::SchedulerMode kSchedulerMode>
 class SequencedWorkerPoolTaskRunnerWithShutdownBehaviorTestDelegate {
  public:
   SequencedWorkerPoolTaskRunnerWithShutdownBehaviorTestDelegate() {}
@@ -843,8 +926,8 @@ class SequencedWorkerPoolTaskRunnerWithShutdownBehaviorTestDelegate {
   }
 
   void StartTaskRunner() {
-    pool_owner_.reset(
-        new SequencedWorkerPoolOwner(10, "SequencedWorkerPoolTaskRunnerTest"));
+    pool_owner_.reset(new SequencedWorkerPoolOwner(
+        10, "SequencedWorkerPoolTaskRunnerTest", kSchedulerMode));
     task_runner_ = pool_owner_->pool()->GetTaskRunnerWithShutdownBehavior(
         SequencedWorkerPool::BLOCK_SHUTDOWN);
   }
@@ -872,10 +955,18 @@ class SequencedWorkerPoolTaskRunnerWithShutdownBehaviorTestDelegate {
   scoped_refptr<TaskRunner> task_runner_;
 };
 
+typedef testing::Types<
+    SequencedWorkerPoolTaskRunnerWithShutdownBehaviorTestDelegate<
+        SequencedWorkerPool::GLOBAL_QUEUE>,
+    SequencedWorkerPoolTaskRunnerWithShutdownBehaviorTestDelegate<
+        SequencedWorkerPool::WORK_STEALING> >
+    SequencedWorkerPoolTaskRunnerWithShutdownBehaviorTestDelegates;
+
 INSTANTIATE_TYPED_TEST_CASE_P(
     SequencedWorkerPoolTaskRunner, TaskRunnerTest,
-    SequencedWorkerPoolTaskRunnerWithShutdownBehaviorTestDelegate);
+    SequencedWorkerPoolTaskRunnerWithShutdownBehaviorTestDelegates);
 
+template <SequencedWorkerPool::SchedulerMode kSchedulerMode>
 class SequencedWorkerPoolSequencedTaskRunnerTestDelegate {
  public:
   SequencedWorkerPoolSequencedTaskRunnerTestDelegate() {}
@@ -885,7 +976,7 @@ class SequencedWorkerPoolSequencedTaskRunnerTestDelegate {
 
   void StartTaskRunner() {
     pool_owner_.reset(new SequencedWorkerPoolOwner(
-        10, "SequencedWorkerPoolSequencedTaskRunnerTest"));
+        10, "SequencedWorkerPoolSequencedTaskRunnerTest", kSchedulerMode));
     task_runner_ = pool_owner_->pool()->GetSequencedTaskRunner(
         pool_owner_->pool()->GetSequenceToken());
   }
@@ -913,13 +1004,20 @@ class SequencedWorkerPoolSequencedTaskRunnerTestDelegate {
   scoped_refptr<SequencedTaskRunner> task_runner_;
 };
 
+typedef testing::Types<
+    SequencedWorkerPoolSequencedTaskRunnerTestDelegate<
+        SequencedWorkerPool::GLOBAL_QUEUE>,
+    SequencedWorkerPoolSequencedTaskRunnerTestDelegate<
+        SequencedWorkerPool::WORK_STEALING> >
+    SequencedWorkerPoolSequencedTaskRunnerTestDelegates;
+
 INSTANTIATE_TYPED_TEST_CASE_P(
     SequencedWorkerPoolSequencedTaskRunner, TaskRunnerTest,
-    SequencedWorkerPoolSequencedTaskRunnerTestDelegate);
+    SequencedWorkerPoolSequencedTaskRunnerTestDelegates);
 
 INSTANTIATE_TYPED_TEST_CASE_P(
     SequencedWorkerPoolSequencedTaskRunner, SequencedTaskRunnerTest,
-    SequencedWorkerPoolSequencedTaskRunnerTestDelegate);
+    SequencedWorkerPoolSequencedTaskRunnerTestDelegates);
 
 }  // namespace
 
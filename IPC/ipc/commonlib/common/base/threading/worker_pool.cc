@@ -100,6 +100,17 @@ base::LazyInstance<TaskRunnerHolder>::Leaky
 
 }  // namespace
 
+WorkerPool::Stats::Stats()
+    : num_threads(0),
+      num_idle_threads(0),
+      peak_num_threads(0),
+      num_pending_tasks(0),
+      peak_num_pending_tasks(0),
+      num_tasks_run(0),
+      num_rejected_tasks(0),
+      num_blocked_posts(0) {
+}
+
 bool WorkerPool::PostTaskAndReply(const tracked_objects::Location& from_here,
                                   const Closure& task,
                                   const Closure& reply,
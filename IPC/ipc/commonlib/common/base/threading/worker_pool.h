@@ -8,6 +8,7 @@
 #include "base/base_export.h"
 #include "base/callback_forward.h"
 #include "base/memory/ref_counted.h"
+#include "base/time.h"
 
 class Task;
 
@@ -29,10 +30,48 @@ class TaskRunner;
 // exist.
 class BASE_EXPORT WorkerPool {
  public:
+  // What PostTask() does when the pool already holds its maximum number of
+  // pending tasks.
+  enum OverflowPolicy {
+    // Drop the task and return false.
+    REJECT_WHEN_FULL,
+
+    // Wait until a worker thread takes a task off the queue. Tasks posted
+    // from a worker thread are queued regardless, since waiting there could
+    // deadlock the pool. With no worker thread to wait for, as when none could
+    // be started, the task is dropped as with REJECT_WHEN_FULL.
+    BLOCK_WHEN_FULL,
+  };
+
+  // A snapshot of the pool's state and of what it has done so far.
+  struct BASE_EXPORT Stats {
+    Stats();
+
+    // Worker threads that are alive, and how many of them wait for work.
+    size_t num_threads;
+    size_t num_idle_threads;
+    size_t peak_num_threads;
+
+    // Tasks that were posted but not picked up by a worker thread yet.
+    size_t num_pending_tasks;
+    size_t peak_num_pending_tasks;
+
+    // Tasks handed to worker threads, and the time they spent queued.
+    int64 num_tasks_run;
+    TimeDelta total_queue_time;
+    TimeDelta max_queue_time;
+
+    // Tasks dropped by REJECT_WHEN_FULL, and posts that had to wait with
+    // BLOCK_WHEN_FULL.
+    int64 num_rejected_tasks;
+    int64 num_blocked_posts;
+  };
+
   // This function posts |task| to run on a worker thread.  |task_is_slow|
   // should be used for tasks that will take a long time to execute.  Returns
-  // false if |task| could not be posted to a worker thread.  Regardless of
-  // return value, ownership of |task| is transferred to the worker pool.
+  // false if |task| could not be posted to a worker thread, e.g. because the
+  // queue is full.  Regardless of return value, ownership of |task| is
+  // transferred to the worker pool.
   static bool PostTask(const tracked_objects::Location& from_here,
                        const base::Closure& task, bool task_is_slow);
 
@@ -53,6 +92,19 @@ class BASE_EXPORT WorkerPool {
   // Get a TaskRunner wrapper which posts to the WorkerPool using the given
   // |task_is_slow| behavior.
   static const scoped_refptr<TaskRunner>& GetTaskRunner(bool task_is_slow);
+
+  // Bounds the pool to |max_threads| worker threads and |max_pending_tasks|
+  // queued tasks, 0 meaning no limit, which is the default. Tasks beyond
+  // |max_threads| wait in the queue. Lowering |max_threads| doesn't stop
+  // threads that are already running; they exit once idle. Only the POSIX
+  // pool can be bounded: on Windows this does nothing.
+  static void SetLimits(size_t max_threads,
+                        size_t max_pending_tasks,
+                        OverflowPolicy overflow_policy);
+
+  // Fills |stats| and returns true, or returns false where the pool doesn't
+  // keep statistics (Windows).
+  static bool GetStats(Stats* stats);
 };
 
 }  // namespace base
@@ -4,12 +4,15 @@
 
 #include "base/threading/worker_pool_posix.h"
 
+#include <algorithm>
+
 #include "base/bind.h"
 #include "base/callback.h"
 #include "base/debug/trace_event.h"
 #include "base/lazy_instance.h"
 #include "base/logging.h"
 #include "base/memory/ref_counted.h"
+#include "base/metrics/histogram.h"
 #include "base/stringprintf.h"
 #include "base/threading/platform_thread.h"
 #include "base/threading/thread_local.h"
@@ -40,9 +43,11 @@ class WorkerPoolImpl {
   WorkerPoolImpl();
   ~WorkerPoolImpl();
 
-  void PostTask(const tracked_objects::Location& from_here,
+  bool PostTask(const tracked_objects::Location& from_here,
                 const base::Closure& task, bool task_is_slow);
 
+  base::PosixDynamicThreadPool* pool() { return pool_.get(); }
+
  private:
   scoped_refptr<base::PosixDynamicThreadPool> pool_;
 };
@@ -56,9 +61,9 @@ WorkerPoolImpl::~WorkerPoolImpl() {
   pool_->Terminate();
 }
 
-void WorkerPoolImpl::PostTask(const tracked_objects::Location& from_here,
+bool WorkerPoolImpl::PostTask(const tracked_objects::Location& from_here,
                               const base::Closure& task, bool task_is_slow) {
-  pool_->PostTask(from_here, task);
+  return pool_->PostTask(from_here, task);
 }
 
 base::LazyInstance<WorkerPoolImpl> g_lazy_worker_pool =
@@ -114,8 +119,7 @@ void WorkerThread::ThreadMain() {
 // static
 bool WorkerPool::PostTask(const tracked_objects::Location& from_here,
                           const base::Closure& task, bool task_is_slow) {
-  g_lazy_worker_pool.Pointer()->PostTask(from_here, task, task_is_slow);
-  return true;
+  return g_lazy_worker_pool.Pointer()->PostTask(from_here, task, task_is_slow);
 }
 
 // static
@@ -123,6 +127,20 @@ bool WorkerPool::RunsTasksOnCurrentThread() {
   return g_worker_pool_running_on_this_thread.Get().Get();
 }
 
+// static
+void WorkerPool::SetLimits(size_t max_threads,
+                           size_t max_pending_tasks,
+                           OverflowPolicy overflow_policy) {
+  g_lazy_worker_pool.Pointer()->pool()->SetLimits(
+      max_threads, max_pending_tasks, overflow_policy);
+}
+
+// static
+bool WorkerPool::GetStats(Stats* stats) {
+  g_lazy_worker_pool.Pointer()->pool()->GetStats(stats);
+  return true;
+}
+
 PosixDynamicThreadPool::PosixDynamicThreadPool(
     const std::string& name_prefix,
     int idle_seconds_before_exit)
@@ -131,6 +149,16 @@ PosixDynamicThreadPool::PosixDynamicThreadPool(
       pending_tasks_available_cv_(&lock_),
       num_idle_threads_(0),
       terminated_(false),
+      max_threads_(0),
+      max_pending_tasks_(0),
+      overflow_policy_(WorkerPool::REJECT_WHEN_FULL),
+      queue_space_available_cv_(&lock_),
+      num_threads_(0),
+      peak_num_threads_(0),
+      peak_num_pending_tasks_(0),
+      num_tasks_run_(0),
+      num_rejected_tasks_(0),
+      num_blocked_posts_(0),
       num_idle_threads_cv_(NULL) {}
 
 PosixDynamicThreadPool::~PosixDynamicThreadPool() {
@@ -145,59 +173,153 @@ void PosixDynamicThreadPool::Terminate() {
     terminated_ = true;
   }
   pending_tasks_available_cv_.Broadcast();
+  queue_space_available_cv_.Broadcast();
 }
 
-void PosixDynamicThreadPool::PostTask(
+void PosixDynamicThreadPool::SetLimits(
+    size_t max_threads,
+    size_t max_pending_tasks,
+    WorkerPool::OverflowPolicy overflow_policy) {
+  {
+    AutoLock locked(lock_);
+    max_threads_ = max_threads;
+    max_pending_tasks_ = max_pending_tasks;
+    overflow_policy_ = overflow_policy;
+  }
+  // Let blocked posters look at the new limits.
+  queue_space_available_cv_.Broadcast();
+}
+
+bool PosixDynamicThreadPool::PostTask(
     const tracked_objects::Location& from_here,
     const base::Closure& task) {
   PendingTask pending_task(from_here, task);
-  AddTask(&pending_task);
+  return AddTask(&pending_task);
 }
 
-void PosixDynamicThreadPool::AddTask(PendingTask* pending_task) {
+void PosixDynamicThreadPool::GetStats(WorkerPool::Stats* stats) {
   AutoLock locked(lock_);
-  DCHECK(!terminated_) <<
-      "This thread pool is already terminated.  Do not post new tasks.";
-
-  pending_tasks_.push(*pending_task);
-  pending_task->task.Reset();
-
-  // We have enough worker threads.
-  if (static_cast<size_t>(num_idle_threads_) >= pending_tasks_.size()) {
-    pending_tasks_available_cv_.Signal();
-  } else {
-    // The new PlatformThread will take ownership of the WorkerThread object,
-    // which will delete itself on exit.
-    WorkerThread* worker =
-        new WorkerThread(name_prefix_, this);
-    PlatformThread::CreateNonJoinable(kWorkerThreadStackSize, worker);
+  stats->num_threads = num_threads_;
+  stats->num_idle_threads = static_cast<size_t>(num_idle_threads_);
+  stats->peak_num_threads = peak_num_threads_;
+  stats->num_pending_tasks = pending_tasks_.size();
+  stats->peak_num_pending_tasks = peak_num_pending_tasks_;
+  stats->num_tasks_run = num_tasks_run_;
+  stats->total_queue_time = total_queue_time_;
+  stats->max_queue_time = max_queue_time_;
+  stats->num_rejected_tasks = num_rejected_tasks_;
+  stats->num_blocked_posts = num_blocked_posts_;
+}
+
+bool PosixDynamicThreadPool::AddTask(PendingTask* pending_task) {
+  // Histograms are recorded once |lock_| is released: the first sample of
+  // each takes the StatisticsRecorder lock and allocates.
+  size_t queue_depth;
+  size_t num_threads = 0;
+  {
+    AutoLock locked(lock_);
+    DCHECK(!terminated_) <<
+        "This thread pool is already terminated.  Do not post new tasks.";
+
+    // Worker threads never wait for room: if they all did, nothing would make
+    // any. Nor does anyone while there is no worker thread, which happens
+    // when none could be started; the task is rejected instead.
+    if (QueueIsFull() && overflow_policy_ == WorkerPool::BLOCK_WHEN_FULL &&
+        !g_worker_pool_running_on_this_thread.Get().Get()) {
+      if (num_threads_)
+        num_blocked_posts_++;
+      while (QueueIsFull() &&
+             overflow_policy_ == WorkerPool::BLOCK_WHEN_FULL &&
+             num_threads_ && !terminated_) {
+        queue_space_available_cv_.Wait();
+      }
+      if (terminated_)
+        return false;
+      if (QueueIsFull() && !num_threads_) {
+        num_rejected_tasks_++;
+        return false;
+      }
+    }
+    if (QueueIsFull() && overflow_policy_ == WorkerPool::REJECT_WHEN_FULL) {
+      num_rejected_tasks_++;
+      return false;
+    }
+
+    pending_tasks_.push(*pending_task);
+    pending_task->task.Reset();
+    queue_depth = pending_tasks_.size();
+    peak_num_pending_tasks_ = std::max(peak_num_pending_tasks_, queue_depth);
+
+    // We have enough worker threads, or as many as we may have.
+    if (static_cast<size_t>(num_idle_threads_) >= pending_tasks_.size() ||
+        (max_threads_ && num_threads_ >= max_threads_)) {
+      pending_tasks_available_cv_.Signal();
+    } else {
+      // The new PlatformThread will take ownership of the WorkerThread object,
+      // which will delete itself on exit.
+      WorkerThread* worker =
+          new WorkerThread(name_prefix_, this);
+      if (PlatformThread::CreateNonJoinable(kWorkerThreadStackSize, worker)) {
+        num_threads = ++num_threads_;
+        peak_num_threads_ = std::max(peak_num_threads_, num_threads_);
+      } else {
+        // The task waits for a running thread, if any.
+        delete worker;
+      }
+    }
   }
+
+  UMA_HISTOGRAM_COUNTS_10000("WorkerPool.QueueDepth", queue_depth);
+  if (num_threads)
+    UMA_HISTOGRAM_COUNTS_100("WorkerPool.ThreadCount", num_threads);
+  return true;
+}
+
+bool PosixDynamicThreadPool::QueueIsFull() const {
+  return max_pending_tasks_ && pending_tasks_.size() >= max_pending_tasks_;
 }
 
 PendingTask PosixDynamicThreadPool::WaitForTask() {
-  AutoLock locked(lock_);
+  PendingTask pending_task(FROM_HERE, base::Closure());
+  TimeDelta queue_time;
+  {
+    AutoLock locked(lock_);
+
+    if (terminated_) {
+      num_threads_--;
+      return pending_task;
+    }
 
-  if (terminated_)
-    return PendingTask(FROM_HERE, base::Closure());
-
-  if (pending_tasks_.empty()) {  // No work available, wait for work.
-    num_idle_threads_++;
-    if (num_idle_threads_cv_.get())
-      num_idle_threads_cv_->Signal();
-    pending_tasks_available_cv_.TimedWait(
-        TimeDelta::FromSeconds(idle_seconds_before_exit_));
-    num_idle_threads_--;
-    if (num_idle_threads_cv_.get())
-      num_idle_threads_cv_->Signal();
-    if (pending_tasks_.empty()) {
-      // We waited for work, but there's still no work.  Return NULL to signal
-      // the thread to terminate.
-      return PendingTask(FROM_HERE, base::Closure());
+    if (pending_tasks_.empty()) {  // No work available, wait for work.
+      num_idle_threads_++;
+      if (num_idle_threads_cv_.get())
+        num_idle_threads_cv_->Signal();
+      pending_tasks_available_cv_.TimedWait(
+          TimeDelta::FromSeconds(idle_seconds_before_exit_));
+      num_idle_threads_--;
+      if (num_idle_threads_cv_.get())
+        num_idle_threads_cv_->Signal();
+      if (pending_tasks_.empty()) {
+        // We waited for work, but there's still no work.  Return NULL to
+        // signal the thread to terminate.
+        num_threads_--;
+        return pending_task;
+      }
     }
+
+    bool was_full = QueueIsFull();
+    pending_task = pending_tasks_.front();
+    pending_tasks_.pop();
+    if (was_full)
+      queue_space_available_cv_.Signal();
+
+    queue_time = TimeTicks::Now() - pending_task.time_posted;
+    num_tasks_run_++;
+    total_queue_time_ += queue_time;
+    max_queue_time_ = std::max(max_queue_time_, queue_time);
   }
 
-  PendingTask pending_task = pending_tasks_.front();
-  pending_tasks_.pop();
+  UMA_HISTOGRAM_TIMES("WorkerPool.TaskQueueTime", queue_time);
   return pending_task;
 }
 
@@ -17,6 +17,11 @@
 // worker threads exit.  The owner of PosixDynamicThreadPool should likewise
 // maintain a scoped_refptr to the PosixDynamicThreadPool instance.
 //
+// The pool can be bounded.  With a maximum number of threads, tasks that find
+// no idle thread wait in the queue for one to free up instead of starting a
+// new thread.  With a maximum number of pending tasks, PostTask() either drops
+// the task or waits for room, depending on the overflow policy.
+//
 // NOTE: The classes defined in this file are only meant for use by the POSIX
 // implementation of WorkerPool.  No one else should be using these classes.
 // These symbols are exported in a header purely for testing purposes.
@@ -36,6 +41,8 @@
 #include "base/synchronization/condition_variable.h"
 #include "base/synchronization/lock.h"
 #include "base/threading/platform_thread.h"
+#include "base/threading/worker_pool.h"
+#include "base/time.h"
 #include "base/tracked_objects.h"
 
 class Task;
@@ -53,13 +60,23 @@ class BASE_EXPORT PosixDynamicThreadPool
                          int idle_seconds_before_exit);
 
   // Indicates that the thread pool is going away.  Stops handing out tasks to
-  // worker threads.  Wakes up all the idle threads to let them exit.
+  // worker threads.  Wakes up all the idle threads to let them exit, and the
+  // threads blocked in PostTask().
   void Terminate();
 
-  // Adds |task| to the thread pool.
-  void PostTask(const tracked_objects::Location& from_here,
+  // See WorkerPool::SetLimits().  0 means no limit.
+  void SetLimits(size_t max_threads,
+                 size_t max_pending_tasks,
+                 WorkerPool::OverflowPolicy overflow_policy);
+
+  // Adds |task| to the thread pool.  Returns false if the task was dropped
+  // because the queue is full or the pool was terminated while waiting for
+  // room.
+  bool PostTask(const tracked_objects::Location& from_here,
                 const Closure& task);
 
+  void GetStats(WorkerPool::Stats* stats);
+
   // Worker thread method to wait for up to |idle_seconds_before_exit| for more
   // work from the thread pool.  Returns NULL if no work is available.
   PendingTask WaitForTask();
@@ -71,8 +88,11 @@ class BASE_EXPORT PosixDynamicThreadPool
   ~PosixDynamicThreadPool();
 
   // Adds pending_task to the thread pool.  This function will clear
-  // |pending_task->task|.
-  void AddTask(PendingTask* pending_task);
+  // |pending_task->task| if it was added.
+  bool AddTask(PendingTask* pending_task);
+
+  // Whether |pending_tasks_| holds |max_pending_tasks_| tasks.
+  bool QueueIsFull() const;
 
   const std::string name_prefix_;
   const int idle_seconds_before_exit_;
@@ -86,6 +106,27 @@ class BASE_EXPORT PosixDynamicThreadPool
   int num_idle_threads_;
   TaskQueue pending_tasks_;
   bool terminated_;
+
+  size_t max_threads_;
+  size_t max_pending_tasks_;
+  WorkerPool::OverflowPolicy overflow_policy_;
+
+  // Signal()s threads blocked in AddTask() when a task is taken off a full
+  // queue.
+  ConditionVariable queue_space_available_cv_;
+
+  // Worker threads that were started and haven't exited yet.
+  size_t num_threads_;
+
+  // Counters for GetStats().
+  size_t peak_num_threads_;
+  size_t peak_num_pending_tasks_;
+  int64 num_tasks_run_;
+  TimeDelta total_queue_time_;
+  TimeDelta max_queue_time_;
+  int64 num_rejected_tasks_;
+  int64 num_blocked_posts_;
+
   // Only used for tests to ensure correct thread ordering.  It will always be
   // NULL in non-test code.
   scoped_ptr<ConditionVariable> num_idle_threads_cv_;
@@ -11,6 +11,7 @@
 #include "base/synchronization/condition_variable.h"
 #include "base/synchronization/lock.h"
 #include "base/threading/platform_thread.h"
+#include "base/threading/simple_thread.h"
 #include "base/synchronization/waitable_event.h"
 #include "testing/gtest/include/gtest/gtest.h"
 
@@ -30,6 +31,7 @@ class PosixDynamicThreadPool::PosixDynamicThreadPoolPeer {
     return pool_->pending_tasks_;
   }
   int num_idle_threads() const { return pool_->num_idle_threads_; }
+  size_t num_threads() const { return pool_->num_threads_; }
   ConditionVariable* num_idle_threads_cv() {
     return pool_->num_idle_threads_cv_.get();
   }
@@ -87,6 +89,26 @@ void BlockingIncrementingTask(const BlockingIncrementingTaskArgs& args) {
                    args.unique_threads);
 }
 
+// Posts |task| to |pool| from its own thread, for posts that block.
+class PostTaskThread : public DelegateSimpleThread::Delegate {
+ public:
+  PostTaskThread(PosixDynamicThreadPool* pool, const base::Closure& task)
+      : pool_(pool), task_(task), result_(false) {}
+
+  virtual void Run() OVERRIDE {
+    result_ = pool_->PostTask(FROM_HERE, task_);
+  }
+
+  bool result() const { return result_; }
+
+ private:
+  PosixDynamicThreadPool* pool_;
+  base::Closure task_;
+  bool result_;
+
+  DISALLOW_COPY_AND_ASSIGN(PostTaskThread);
+};
+
 class PosixDynamicThreadPoolTest : public testing::Test {
  protected:
   PosixDynamicThreadPoolTest()
@@ -120,6 +142,12 @@ class PosixDynamicThreadPoolTest : public testing::Test {
     }
   }
 
+  WorkerPool::Stats GetStats() {
+    WorkerPool::Stats stats;
+    pool_->GetStats(&stats);
+    return stats;
+  }
+
   base::Closure CreateNewIncrementingTaskCallback() {
     return base::Bind(&IncrementingTask, &counter_lock_, &counter_,
                       &unique_threads_lock_, &unique_threads_);
@@ -251,4 +279,115 @@ TEST_F(PosixDynamicThreadPoolTest, Complex) {
   EXPECT_EQ(4, counter_);
 }
 
+TEST_F(PosixDynamicThreadPoolTest, MaxThreads) {
+  pool_->SetLimits(1, 0, WorkerPool::REJECT_WHEN_FULL);
+
+  // The second task waits for the only thread instead of starting another.
+  EXPECT_TRUE(pool_->PostTask(FROM_HERE,
+                              CreateNewBlockingIncrementingTaskCallback()));
+  EXPECT_TRUE(pool_->PostTask(FROM_HERE,
+                              CreateNewBlockingIncrementingTaskCallback()));
+
+  WaitForTasksToStart(1);
+  {
+    base::AutoLock locked(*peer_.lock());
+    EXPECT_EQ(1U, peer_.num_threads());
+    EXPECT_EQ(1U, peer_.pending_tasks().size());
+  }
+  start_.Signal();
+  WaitForIdleThreads(1);
+
+  EXPECT_EQ(2, counter_);
+  EXPECT_EQ(1U, unique_threads_.size());
+  WorkerPool::Stats stats = GetStats();
+  EXPECT_EQ(1U, stats.num_threads);
+  EXPECT_EQ(1U, stats.peak_num_threads);
+  EXPECT_LE(1U, stats.peak_num_pending_tasks);
+  EXPECT_EQ(2, stats.num_tasks_run);
+  EXPECT_LE(stats.max_queue_time, stats.total_queue_time);
+}
+
+TEST_F(PosixDynamicThreadPoolTest, RejectWhenFull) {
+  pool_->SetLimits(1, 1, WorkerPool::REJECT_WHEN_FULL);
+
+  // One task runs and one waits in the queue, which is then full.
+  EXPECT_TRUE(pool_->PostTask(FROM_HERE,
+                              CreateNewBlockingIncrementingTaskCallback()));
+  WaitForTasksToStart(1);
+  EXPECT_TRUE(pool_->PostTask(FROM_HERE,
+                              CreateNewBlockingIncrementingTaskCallback()));
+  EXPECT_FALSE(pool_->PostTask(FROM_HERE,
+                               CreateNewIncrementingTaskCallback()));
+
+  start_.Signal();
+  WaitForIdleThreads(1);
+
+  EXPECT_EQ(2, counter_);
+  WorkerPool::Stats stats = GetStats();
+  EXPECT_EQ(1, stats.num_rejected_tasks);
+  EXPECT_EQ(0, stats.num_blocked_posts);
+  EXPECT_EQ(2, stats.num_tasks_run);
+}
+
+TEST_F(PosixDynamicThreadPoolTest, BlockWhenFull) {
+  pool_->SetLimits(1, 1, WorkerPool::BLOCK_WHEN_FULL);
+
+  EXPECT_TRUE(pool_->PostTask(FROM_HERE,
+                              CreateNewBlockingIncrementingTaskCallback()));
+  WaitForTasksToStart(1);
+  EXPECT_TRUE(pool_->PostTask(FROM_HERE,
+                              CreateNewBlockingIncrementingTaskCallback()));
+
+  // The third post waits until the thread takes the second task.
+  PostTaskThread poster(pool_.get(), CreateNewIncrementingTaskCallback());
+  DelegateSimpleThread poster_thread(&poster, "poster");
+  poster_thread.Start();
+  while (GetStats().num_blocked_posts == 0)
+    PlatformThread::YieldCurrentThread();
+  EXPECT_EQ(0, counter_);
+
+  start_.Signal();
+  poster_thread.Join();
+  EXPECT_TRUE(poster.result());
+  WaitForIdleThreads(1);
+
+  EXPECT_EQ(3, counter_);
+  WorkerPool::Stats stats = GetStats();
+  EXPECT_EQ(0, stats.num_rejected_tasks);
+  EXPECT_EQ(1, stats.num_blocked_posts);
+  EXPECT_EQ(3, stats.num_tasks_run);
+}
+
+TEST_F(PosixDynamicThreadPoolTest, TerminateWakesBlockedPost) {
+  pool_->SetLimits(1, 1, WorkerPool::BLOCK_WHEN_FULL);
+
+  EXPECT_TRUE(pool_->PostTask(FROM_HERE,
+                              CreateNewBlockingIncrementingTaskCallback()));
+  WaitForTasksToStart(1);
+  EXPECT_TRUE(pool_->PostTask(FROM_HERE,
+                              CreateNewBlockingIncrementingTaskCallback()));
+
+  PostTaskThread poster(pool_.get(), CreateNewIncrementingTaskCallback());
+  DelegateSimpleThread poster_thread(&poster, "poster");
+  poster_thread.Start();
+  while (GetStats().num_blocked_posts == 0)
+    PlatformThread::YieldCurrentThread();
+
+  pool_->Terminate();
+  poster_thread.Join();
+  EXPECT_FALSE(poster.result());
+
+  // Let the running task finish. The queued one is dropped with the pool.
+  start_.Signal();
+  for (;;) {
+    {
+      base::AutoLock locked(counter_lock_);
+      if (counter_ == 1)
+        break;
+    }
+    PlatformThread::YieldCurrentThread();
+  }
+  pool_ = NULL;
+}
+
 }  // namespace base
@@ -70,4 +70,16 @@ bool WorkerPool::RunsTasksOnCurrentThread() {
   return g_worker_pool_running_on_this_thread.Get().Get();
 }
 
+// static
+void WorkerPool::SetLimits(size_t max_threads,
+                           size_t max_pending_tasks,
+                           OverflowPolicy overflow_policy) {
+  // The system thread pool sizes itself.
+}
+
+// static
+bool WorkerPool::GetStats(Stats* stats) {
+  return false;
+}
+
 }  // namespace base
@@ -533,6 +533,13 @@ class BASE_EXPORT TimeTicks {
   // SHOULD ONLY BE USED WHEN IT IS REALLY NEEDED.
   static TimeTicks HighResNow();
 
+  // Returns the same clock as Now(), but possibly read at a coarser
+  // resolution (a few milliseconds) in exchange for being cheaper.  Where
+  // there is no cheaper way to read it, this is Now().  Use it for
+  // timestamps taken on every task or message that only need to be good
+  // to a few milliseconds.
+  static TimeTicks NowCoarse();
+
   // Returns the current system trace time or, if none is defined, the current
   // high-res time (i.e. HighResNow()). On systems where a global trace clock
   // is defined, timestamping TraceEvents's with this value guarantees
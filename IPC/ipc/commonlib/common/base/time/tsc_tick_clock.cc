@@ -0,0 +1,216 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/time/tsc_tick_clock.h"
+
+#include "base/atomicops.h"
+#include "base/lazy_instance.h"
+#include "base/logging.h"
+#include "base/synchronization/lock.h"
+#include "build/build_config.h"
+
+// NaCl doesn't let untrusted code read the counter, and doesn't build
+// base::CPU; the clock is never supported there.
+#if defined(ARCH_CPU_X86_FAMILY) && !defined(OS_NACL)
+#define TSC_TICK_CLOCK_AVAILABLE
+#endif
+
+#if defined(TSC_TICK_CLOCK_AVAILABLE)
+#include "base/cpu.h"
+#include "base/threading/platform_thread.h"
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif  // defined(TSC_TICK_CLOCK_AVAILABLE)
+
+namespace base {
+
+namespace {
+
+#if defined(TSC_TICK_CLOCK_AVAILABLE)
+
+// How long to measure the counter against TimeTicks::HighResNow() for.
+const int kCalibrationMilliseconds = 20;
+
+// How long an anchor is extrapolated from before Now() takes a new one.
+const int kReanchorMilliseconds = 1000;
+
+// How many times to read a clock between two counter reads.
+const int kClockReadAttempts = 5;
+
+uint64 ReadTimeStampCounter() {
+#if defined(_MSC_VER)
+  return __rdtsc();
+#else
+  uint32 low;
+  uint32 high;
+  __asm__ __volatile__("rdtsc" : "=a"(low), "=d"(high));
+  return (static_cast<uint64>(high) << 32) | low;
+#endif
+}
+
+// Reads |clock| between two counter reads, a few times over, and keeps the
+// read bracketed most tightly, the one least disturbed by an interrupt or a
+// preemption.  Sets |counter| to the middle of its bracket.  Returns a null
+// TimeTicks if every bracket was broken by a move to a core that is behind.
+TimeTicks ReadClockAndCounter(TimeTicks (*clock)(), uint64* counter) {
+  TimeTicks best_time;
+  uint64 best_width = kuint64max;
+  for (int i = 0; i < kClockReadAttempts; ++i) {
+    uint64 before = ReadTimeStampCounter();
+    TimeTicks time = clock();
+    uint64 after = ReadTimeStampCounter();
+    if (after < before || after - before >= best_width)
+      continue;
+    best_time = time;
+    best_width = after - before;
+    *counter = before + best_width / 2;
+  }
+  return best_time;
+}
+
+#endif  // defined(TSC_TICK_CLOCK_AVAILABLE)
+
+// A point at which the counter was read together with TimeTicks, and the
+// rate at which to extrapolate from it.
+struct Anchor {
+  Anchor()
+      : counter(0),
+        high_res_counter(0),
+        microseconds_per_tick(0),
+        reanchor_ticks(0) {}
+
+  // TimeTicks::Now() at |counter|, for the offset.
+  TimeTicks time;
+  uint64 counter;
+
+  // TimeTicks::HighResNow() at |high_res_counter|, for the rate measured
+  // over the time to the next anchor.
+  TimeTicks high_res_time;
+  uint64 high_res_counter;
+
+  double microseconds_per_tick;
+
+  // How far past |counter| the anchor is replaced.
+  int64 reanchor_ticks;
+};
+
+// How to turn counter values into TimeTicks.  The rate is measured once at
+// first use, then again over each re-anchoring period, which is long enough
+// for the error of a clock read to be negligible.
+struct Calibration {
+  Calibration() : supported(false), current(0) {
+#if defined(TSC_TICK_CLOCK_AVAILABLE)
+    if (!CPU().has_non_stop_time_stamp_counter())
+      return;
+
+    uint64 start_counter = 0;
+    TimeTicks start_time =
+        ReadClockAndCounter(&TimeTicks::HighResNow, &start_counter);
+    PlatformThread::Sleep(
+        TimeDelta::FromMilliseconds(kCalibrationMilliseconds));
+    Anchor& anchor = anchors[0];
+    anchor.high_res_time =
+        ReadClockAndCounter(&TimeTicks::HighResNow, &anchor.high_res_counter);
+    if (start_time.is_null() || anchor.high_res_time <= start_time ||
+        anchor.high_res_counter <= start_counter) {
+      return;
+    }
+    anchor.microseconds_per_tick =
+        (anchor.high_res_time - start_time).InMicroseconds() /
+        static_cast<double>(anchor.high_res_counter - start_counter);
+    supported = SetOffset(&anchor);
+#endif  // defined(TSC_TICK_CLOCK_AVAILABLE)
+  }
+
+  const Anchor& CurrentAnchor() const {
+    return anchors[subtle::Acquire_Load(&current)];
+  }
+
+#if defined(TSC_TICK_CLOCK_AVAILABLE)
+  // Lines |anchor| up with TimeTicks::Now(), at its rate.
+  static bool SetOffset(Anchor* anchor) {
+    anchor->time = ReadClockAndCounter(&TimeTicks::Now, &anchor->counter);
+    anchor->reanchor_ticks = static_cast<int64>(
+        kReanchorMilliseconds * Time::kMicrosecondsPerMillisecond /
+        anchor->microseconds_per_tick);
+    return !anchor->time.is_null();
+  }
+
+  // Replaces the current anchor, unless another thread is already doing so.
+  // Readers never block: the new anchor is built in the other slot and then
+  // published.  A reader copies out of the anchor it loaded in far less than
+  // a re-anchoring period, so the slot is never rewritten under it.
+  void Reanchor() {
+    if (!lock.Try())
+      return;
+    int old_index = subtle::NoBarrier_Load(&current);
+    const Anchor& old_anchor = anchors[old_index];
+    if (static_cast<int64>(ReadTimeStampCounter() - old_anchor.counter) >=
+        old_anchor.reanchor_ticks) {
+      Anchor& anchor = anchors[1 - old_index];
+      anchor.high_res_time = ReadClockAndCounter(&TimeTicks::HighResNow,
+                                                 &anchor.high_res_counter);
+      anchor.microseconds_per_tick = old_anchor.microseconds_per_tick;
+      if (anchor.high_res_time > old_anchor.high_res_time &&
+          anchor.high_res_counter > old_anchor.high_res_counter) {
+        anchor.microseconds_per_tick =
+            (anchor.high_res_time - old_anchor.high_res_time).InMicroseconds() /
+            static_cast<double>(anchor.high_res_counter -
+                                old_anchor.high_res_counter);
+      }
+      if (SetOffset(&anchor))
+        subtle::Release_Store(&current, 1 - old_index);
+    }
+    lock.Release();
+  }
+#endif  // defined(TSC_TICK_CLOCK_AVAILABLE)
+
+  bool supported;
+
+  // Indexes |anchors|.
+  subtle::Atomic32 current;
+  Anchor anchors[2];
+
+  // Held while re-anchoring.
+  Lock lock;
+};
+
+LazyInstance<Calibration>::Leaky g_calibration = LAZY_INSTANCE_INITIALIZER;
+
+}  // namespace
+
+TscTickClock::TscTickClock() {}
+
+TscTickClock::~TscTickClock() {}
+
+// static
+bool TscTickClock::IsSupported() {
+  return g_calibration.Get().supported;
+}
+
+// static
+TimeTicks TscTickClock::Now() {
+#if defined(TSC_TICK_CLOCK_AVAILABLE)
+  Calibration& calibration = g_calibration.Get();
+  DCHECK(calibration.supported);
+  const Anchor& anchor = calibration.CurrentAnchor();
+  // Signed, in case another core's counter is a little behind.
+  int64 ticks = static_cast<int64>(ReadTimeStampCounter() - anchor.counter);
+  TimeTicks now = anchor.time + TimeDelta::FromMicroseconds(
+      static_cast<int64>(ticks * anchor.microseconds_per_tick));
+  if (ticks >= anchor.reanchor_ticks)
+    calibration.Reanchor();
+  return now;
+#else
+  NOTREACHED();
+  return TimeTicks::Now();
+#endif  // defined(TSC_TICK_CLOCK_AVAILABLE)
+}
+
+TimeTicks TscTickClock::NowTicks() {
+  return Now();
+}
+
+}  // namespace base
@@ -0,0 +1,46 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_TIME_TSC_TICK_CLOCK_H_
+#define BASE_TIME_TSC_TICK_CLOCK_H_
+
+#include "base/base_export.h"
+#include "base/compiler_specific.h"
+#include "base/time/tick_clock.h"
+
+namespace base {
+
+// TscTickClock is a TickClock that reads the CPU's time stamp counter, which
+// costs a few cycles instead of a trip through the OS.  Its ticks are
+// converted to TimeTicks with a rate measured against TimeTicks::HighResNow()
+// and an offset that lines them up with TimeTicks::Now(), so that they can
+// be compared with TimeTicks from either.  Once a second, the next Now()
+// re-measures the rate and lines the clock up again, so that it doesn't
+// drift; it may step by a few microseconds when it does.
+//
+// It is only usable on x86 CPUs with an invariant counter, one that ticks at
+// the same rate in every power state and on every core, and never under NaCl.
+// Check IsSupported() first; the first call measures the rate, which takes
+// about 20ms.
+class BASE_EXPORT TscTickClock : public TickClock {
+ public:
+  TscTickClock();
+  virtual ~TscTickClock();
+
+  // Returns whether the counter can be used as a clock on this machine.
+  static bool IsSupported();
+
+  // Returns the counter as TimeTicks.  IsSupported() must be true.
+  static TimeTicks Now();
+
+  // Returns Now().
+  virtual TimeTicks NowTicks() OVERRIDE;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(TscTickClock);
+};
+
+}  // namespace base
+
+#endif  // BASE_TIME_TSC_TICK_CLOCK_H_
@@ -0,0 +1,60 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/time/tsc_tick_clock.h"
+
+#include "base/threading/platform_thread.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+namespace {
+
+TEST(TscTickClockTest, AgreesWithTimeTicks) {
+  if (!TscTickClock::IsSupported())
+    return;
+
+  // The clock is lined up with TimeTicks::Now(), which may itself only move
+  // every 15ms.
+  const TimeDelta kTolerance = TimeDelta::FromMilliseconds(20);
+  for (int i = 0; i < 10; ++i) {
+    TimeTicks before = TimeTicks::Now();
+    TimeTicks tsc = TscTickClock::Now();
+    TimeTicks after = TimeTicks::Now();
+    EXPECT_TRUE(tsc >= before - kTolerance);
+    EXPECT_TRUE(tsc <= after + kTolerance);
+  }
+}
+
+TEST(TscTickClockTest, AgreesWithTimeTicksAfterReanchoring) {
+  if (!TscTickClock::IsSupported())
+    return;
+
+  // Long enough for the next read to take a new anchor.
+  TscTickClock::Now();
+  PlatformThread::Sleep(TimeDelta::FromMilliseconds(1100));
+  const TimeDelta kTolerance = TimeDelta::FromMilliseconds(20);
+  for (int i = 0; i < 10; ++i) {
+    TimeTicks before = TimeTicks::Now();
+    TimeTicks tsc = TscTickClock::Now();
+    TimeTicks after = TimeTicks::Now();
+    EXPECT_TRUE(tsc >= before - kTolerance);
+    EXPECT_TRUE(tsc <= after + kTolerance);
+  }
+}
+
+TEST(TscTickClockTest, Advances) {
+  if (!TscTickClock::IsSupported())
+    return;
+
+  TscTickClock clock;
+  TimeTicks start = clock.NowTicks();
+  PlatformThread::Sleep(TimeDelta::FromMilliseconds(50));
+  TimeDelta elapsed = clock.NowTicks() - start;
+  EXPECT_GE(elapsed.InMilliseconds(), 40);
+  // Generous, for loaded bots.
+  EXPECT_LT(elapsed.InMilliseconds(), 1000);
+}
+
+}  // namespace
+}  // namespace base
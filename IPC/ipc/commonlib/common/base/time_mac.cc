@@ -191,6 +191,11 @@ TimeTicks TimeTicks::HighResNow() {
   return Now();
 }
 
+// static
+TimeTicks TimeTicks::NowCoarse() {
+  return Now();
+}
+
 // static
 TimeTicks TimeTicks::NowFromSystemTraceTime() {
   return HighResNow();
@@ -0,0 +1,72 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <string>
+
+#include "base/perftimer.h"
+#include "base/profiler/alternate_timer.h"
+#include "base/profiler/tracked_time.h"
+#include "base/time.h"
+#include "base/time/tsc_tick_clock.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+// Measures the cost of reading each clock the profiler and MessageLoop can
+// use, and of TrackedTime::Now() over each wall clock.
+
+namespace base {
+namespace {
+
+const int kCalls = 1000000;
+
+typedef TimeTicks (*TicksFunction)();
+
+// Keeps the calls below from being optimized away.
+int64 g_sink = 0;
+
+void MeasureTicks(const std::string& name, TicksFunction now) {
+  int64 sum = 0;
+  PerfTimer timer;
+  for (int i = 0; i < kCalls; ++i)
+    sum += now().ToInternalValue();
+  TimeDelta elapsed = timer.Elapsed();
+  g_sink += sum;
+
+  LogPerfResult(("Clock_" + name).c_str(),
+                elapsed.InMicroseconds() * 1000.0 / kCalls, "ns/call");
+}
+
+void MeasureTrackedTime(const std::string& name,
+                        tracked_objects::WallClockType wall_clock) {
+  ASSERT_TRUE(tracked_objects::SetWallClock(wall_clock));
+  int64 sum = 0;
+  PerfTimer timer;
+  for (int i = 0; i < kCalls; ++i) {
+    sum += (tracked_objects::TrackedTime::Now() -
+            tracked_objects::TrackedTime()).InMilliseconds();
+  }
+  TimeDelta elapsed = timer.Elapsed();
+  g_sink += sum;
+  tracked_objects::SetWallClock(tracked_objects::WALL_CLOCK_DEFAULT);
+
+  LogPerfResult(("TrackedTime_" + name).c_str(),
+                elapsed.InMicroseconds() * 1000.0 / kCalls, "ns/call");
+}
+
+TEST(TimePerfTest, Clocks) {
+  MeasureTicks("Now", &TimeTicks::Now);
+  MeasureTicks("HighResNow", &TimeTicks::HighResNow);
+  MeasureTicks("NowCoarse", &TimeTicks::NowCoarse);
+  if (TscTickClock::IsSupported())
+    MeasureTicks("Tsc", &TscTickClock::Now);
+}
+
+TEST(TimePerfTest, TrackedTime) {
+  MeasureTrackedTime("Default", tracked_objects::WALL_CLOCK_DEFAULT);
+  MeasureTrackedTime("Coarse", tracked_objects::WALL_CLOCK_COARSE);
+  if (TscTickClock::IsSupported())
+    MeasureTrackedTime("Tsc", tracked_objects::WALL_CLOCK_TSC);
+}
+
+}  // namespace
+}  // namespace base
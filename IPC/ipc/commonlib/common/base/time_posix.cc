@@ -247,6 +247,23 @@ TimeTicks TimeTicks::Now() {
 
   return TimeTicks(absolute_micro);
 }
+
+// static
+TimeTicks TimeTicks::NowCoarse() {
+#if defined(CLOCK_MONOTONIC_COARSE)
+  // Read from the kernel's last tick rather than the hardware, so it never
+  // leaves the vDSO.
+  struct timespec ts;
+  if (clock_gettime(CLOCK_MONOTONIC_COARSE, &ts) != 0)
+    return Now();
+
+  return TimeTicks(
+      (static_cast<int64>(ts.tv_sec) * Time::kMicrosecondsPerSecond) +
+      (static_cast<int64>(ts.tv_nsec) / Time::kNanosecondsPerMicrosecond));
+#else
+  return Now();
+#endif
+}
 #else  // _POSIX_MONOTONIC_CLOCK
 #error No usable tick clock function on this platform.
 #endif  // _POSIX_MONOTONIC_CLOCK
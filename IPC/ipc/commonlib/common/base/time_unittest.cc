@@ -568,6 +568,19 @@ TEST(TimeTicks, Deltas) {
   }
 }
 
+TEST(TimeTicks, NowCoarse) {
+  // The coarse clock is Now() as of the last timer tick, so it may lag, but
+  // never leads.
+  const TimeDelta kMaxLag = TimeDelta::FromMilliseconds(50);
+  for (int index = 0; index < 50; index++) {
+    TimeTicks before = TimeTicks::Now();
+    TimeTicks coarse = TimeTicks::NowCoarse();
+    TimeTicks after = TimeTicks::Now();
+    EXPECT_TRUE(coarse <= after);
+    EXPECT_TRUE(coarse >= before - kMaxLag);
+  }
+}
+
 static void HighResClockTest(TimeTicks (*GetTicks)()) {
 #if defined(OS_WIN)
   // HighResNow doesn't work on some systems.  Since the product still works
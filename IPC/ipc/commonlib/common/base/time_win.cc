@@ -456,6 +456,12 @@ TimeTicks TimeTicks::HighResNow() {
   return TimeTicks() + HighResNowSingleton::GetInstance()->Now();
 }
 
+// static
+TimeTicks TimeTicks::NowCoarse() {
+  // timeGetTime() is as cheap as it gets.
+  return Now();
+}
+
 // static
 TimeTicks TimeTicks::NowFromSystemTraceTime() {
   return HighResNow();
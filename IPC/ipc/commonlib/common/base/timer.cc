@@ -5,6 +5,7 @@
 #include "base/timer.h"
 
 #include "base/logging.h"
+#include "base/message_loop.h"
 #include "base/single_thread_task_runner.h"
 #include "base/thread_task_runner_handle.h"
 #include "base/threading/platform_thread.h"
@@ -38,6 +39,7 @@ class BaseTimerTaskInternal {
     // *this will be deleted by the task runner, so Timer needs to
     // forget us:
     timer_->scheduled_task_ = NULL;
+    timer_->scheduled_task_loop_id_ = 0;
 
     // Although Timer should not call back into *this, let's clear
     // the timer_ member first to be pedantic.
@@ -58,6 +60,8 @@ class BaseTimerTaskInternal {
 
 Timer::Timer(bool retain_user_task, bool is_repeating)
     : scheduled_task_(NULL),
+      scheduled_task_loop_id_(0),
+      scheduled_task_id_(0),
       thread_id_(0),
       is_repeating_(is_repeating),
       retain_user_task_(retain_user_task),
@@ -69,6 +73,8 @@ Timer::Timer(const tracked_objects::Location& posted_from,
              const base::Closure& user_task,
              bool is_repeating)
     : scheduled_task_(NULL),
+      scheduled_task_loop_id_(0),
+      scheduled_task_id_(0),
       posted_from_(posted_from),
       delay_(delay),
       user_task_(user_task),
@@ -93,6 +99,10 @@ void Timer::Stop() {
   is_running_ = false;
   if (!retain_user_task_)
     user_task_.Reset();
+
+  // Take the task off the queue rather than leave it to run for nothing.
+  if (scheduled_task_loop_id_)
+    AbandonScheduledTask();
 }
 
 void Timer::Reset() {
@@ -131,9 +141,20 @@ void Timer::PostNewScheduledTask(TimeDelta delay) {
   DCHECK(scheduled_task_ == NULL);
   is_running_ = true;
   scheduled_task_ = new BaseTimerTaskInternal(this);
-  ThreadTaskRunnerHandle::Get()->PostDelayedTask(posted_from_,
-      base::Bind(&BaseTimerTaskInternal::Run, base::Owned(scheduled_task_)),
-      delay);
+  base::Closure task =
+      base::Bind(&BaseTimerTaskInternal::Run, base::Owned(scheduled_task_));
+
+  // Post to the MessageLoop's delayed work queue directly when there is one,
+  // so that the task can be cancelled when the timer is stopped. Zero delays
+  // go through the task runner to keep their place among posted tasks.
+  MessageLoop* loop = MessageLoop::current();
+  if (loop && delay > TimeDelta()) {
+    scheduled_task_loop_id_ = loop->id();
+    scheduled_task_id_ =
+        loop->PostCancelableDelayedTask(posted_from_, task, delay);
+  } else {
+    ThreadTaskRunnerHandle::Get()->PostDelayedTask(posted_from_, task, delay);
+  }
   scheduled_run_time_ = desired_run_time_ = TimeTicks::Now() + delay;
   // Remember the thread ID that posts the first task -- this will be verified
   // later when the task is abandoned to detect misuse from multiple threads.
@@ -147,6 +168,13 @@ void Timer::AbandonScheduledTask() {
   if (scheduled_task_) {
     scheduled_task_->Abandon();
     scheduled_task_ = NULL;
+
+    // The loop deletes the task, which no longer refers back to us. If the
+    // loop is gone, so is the task.
+    MessageLoop* loop = MessageLoop::current();
+    if (loop && loop->id() == scheduled_task_loop_id_)
+      loop->CancelDelayedTask(scheduled_task_id_);
+    scheduled_task_loop_id_ = 0;
   }
 }
 
@@ -99,7 +99,8 @@ class BASE_EXPORT Timer {
              const base::Closure& user_task);
 
   // Call this method to stop and cancel the timer.  It is a no-op if the timer
-  // is not running.
+  // is not running.  A task scheduled on the current MessageLoop is taken off
+  // its delayed work queue.
   void Stop();
 
   // Call this method to reset the timer delay. The user_task_ must be set. If
@@ -125,7 +126,8 @@ class BASE_EXPORT Timer {
   void PostNewScheduledTask(TimeDelta delay);
 
   // Disable scheduled_task_ and abandon it so that it no longer refers back to
-  // this object.
+  // this object. If it was posted with
+  // MessageLoop::PostCancelableDelayedTask, it's also cancelled.
   void AbandonScheduledTask();
 
   // Called by BaseTimerTaskInternal when the MessageLoop runs it.
@@ -141,6 +143,13 @@ class BASE_EXPORT Timer {
   // RunScheduledTask() at scheduled_run_time_.
   BaseTimerTaskInternal* scheduled_task_;
 
+  // The MessageLoop::id() of the loop that scheduled_task_ was posted to as a
+  // cancelable task, and the id to cancel it with. 0 if it went through the
+  // thread's task runner instead. The loop is looked up by id rather than
+  // kept, as it may be gone and another one allocated in its place.
+  int scheduled_task_loop_id_;
+  int scheduled_task_id_;
+
   // Location in user code.
   tracked_objects::Location posted_from_;
   // Delay requested by user.
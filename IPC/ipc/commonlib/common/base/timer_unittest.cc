@@ -3,6 +3,7 @@
 // found in the LICENSE file.
 
 #include "base/memory/scoped_ptr.h"
+#include "base/memory/scoped_vector.h"
 #include "base/message_loop.h"
 #include "base/timer.h"
 #include "testing/gtest/include/gtest/gtest.h"
@@ -485,4 +486,40 @@ TEST(TimerTest, ContinuationReset) {
   }
 }
 
+void CountCallback(int* count) {
+  ++*count;
+}
+
+// Many armed timers can be stopped and restarted, and stopped ones don't
+// run.
+TEST(TimerTest, ManyArmedTimers) {
+  const int kNumTimers = 100;
+  MessageLoop loop(MessageLoop::TYPE_DEFAULT);
+  int count = 0;
+  ScopedVector<base::Timer> timers;
+  for (int i = 0; i < kNumTimers; ++i) {
+    timers.push_back(new base::Timer(true, false));
+    // 1 to 120 seconds, in an order that jumps around.
+    TimeDelta delay = TimeDelta::FromMilliseconds(
+        1000 + (i * GG_INT64_C(7919)) % 119000);
+    timers[i]->Start(FROM_HERE, delay,
+                     base::Bind(&CountCallback, base::Unretained(&count)));
+  }
+  loop.RunUntilIdle();
+  EXPECT_EQ(0, count);
+
+  for (int i = 0; i < kNumTimers; ++i)
+    timers[i]->Stop();
+  for (int i = 0; i < kNumTimers; i += 2) {
+    timers[i]->Start(FROM_HERE, TimeDelta(),
+                     base::Bind(&CountCallback, base::Unretained(&count)));
+  }
+  loop.RunUntilIdle();
+  EXPECT_EQ(kNumTimers / 2, count);
+
+  timers.clear();
+  loop.RunUntilIdle();
+  EXPECT_EQ(kNumTimers / 2, count);
+}
+
 }  // namespace
@@ -0,0 +1,360 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/timer_wheel.h"
+
+#include <algorithm>
+
+#include "base/logging.h"
+
+#if defined(COMPILER_MSVC)
+#include <intrin.h>
+#endif
+
+namespace base {
+
+namespace {
+
+// Node::level of the nodes in the ready heap.
+const int kReadyLevel = -1;
+
+int64 TickOf(TimeTicks time) {
+  return time.ToInternalValue() / Time::kMicrosecondsPerMillisecond;
+}
+
+TimeTicks StartOfTick(int64 tick) {
+  return TimeTicks::FromInternalValue(tick * Time::kMicrosecondsPerMillisecond);
+}
+
+// |bits| must not be 0.
+int CountTrailingZeros(uint64 bits) {
+#if defined(COMPILER_MSVC)
+  unsigned long index;
+  if (_BitScanForward(&index, static_cast<uint32>(bits)))
+    return static_cast<int>(index);
+  _BitScanForward(&index, static_cast<uint32>(bits >> 32));
+  return 32 + static_cast<int>(index);
+#else
+  return __builtin_ctzll(bits);
+#endif
+}
+
+// Returns how many slots after |from| the first bit set in |bits| is, going
+// round from the last slot to the first one. |bits| must not be 0.
+int SlotsUntilOccupied(uint64 bits, int from) {
+  if (from)
+    bits = (bits >> from) | (bits << (64 - from));
+  return CountTrailingZeros(bits);
+}
+
+}  // namespace
+
+struct TimerWheel::Node {
+  Node(const PendingTask& pending_task, bool cancelable)
+      : pending_task(pending_task),
+        tick(TickOf(pending_task.delayed_run_time)),
+        prev(NULL),
+        next(NULL),
+        level(kReadyLevel),
+        slot(0),
+        cancelable(cancelable),
+        cancelled(false) {
+  }
+
+  PendingTask pending_task;
+  int64 tick;
+
+  // The links of the slot or overflow list the node is on.
+  Node* prev;
+  Node* next;
+
+  // 0 to kLevels - 1 for a slot, kLevels for the overflow list, or
+  // kReadyLevel.
+  int level;
+  int slot;
+
+  bool cancelable;
+
+  // Set by Cancel() while the node is in the ready heap.
+  bool cancelled;
+};
+
+bool TimerWheel::NodeLess::operator()(const Node* a, const Node* b) const {
+  // PendingTask::operator< is reversed so that the earliest task is the
+  // largest one, as std::push_heap() wants.
+  return a->pending_task < b->pending_task;
+}
+
+TimerWheel::TimerWheel()
+    : tick_(0),
+      overflow_(NULL),
+      wheel_count_(0),
+      size_(0) {
+  for (int level = 0; level < kLevels; ++level) {
+    for (int slot = 0; slot < kSlots; ++slot)
+      slots_[level][slot] = NULL;
+    occupied_[level] = 0;
+  }
+}
+
+TimerWheel::~TimerWheel() {
+  Clear();
+}
+
+void TimerWheel::Push(const PendingTask& pending_task, bool cancelable) {
+  DCHECK(!pending_task.delayed_run_time.is_null());
+  Node* node = new Node(pending_task, cancelable);
+  if (cancelable) {
+    std::pair<CancelableMap::iterator, bool> result = cancelable_.insert(
+        std::make_pair(pending_task.sequence_num, node));
+    DCHECK(result.second) << "Duplicate sequence number";
+  }
+  ++size_;
+
+  // With nothing on the wheel, start it over from the current time rather
+  // than cascade through the time it sat idle.
+  if (!wheel_count_ && node->tick > tick_) {
+    tick_ = std::max(tick_,
+                     std::min(node->tick, TickOf(TimeTicks::Now())));
+  }
+  Insert(node);
+}
+
+bool TimerWheel::Cancel(int sequence_num) {
+  CancelableMap::iterator it = cancelable_.find(sequence_num);
+  if (it == cancelable_.end())
+    return false;
+  Node* node = it->second;
+  cancelable_.erase(it);
+  --size_;
+
+  if (node->level == kReadyLevel) {
+    // Leave the node in the heap, but let go of the task now. Its destructor
+    // may call back into the wheel, so only once the heap is consistent.
+    Closure task = node->pending_task.task;
+    node->pending_task.task.Reset();
+    node->cancelled = true;
+    PruneReady();
+    return true;
+  }
+
+  Unlink(node);
+  delete node;
+  return true;
+}
+
+TimeTicks TimerWheel::GetNextRunTime() const {
+  DCHECK(!empty());
+  if (!ready_.empty())
+    return ready_.front()->pending_task.delayed_run_time;
+
+  int level;
+  int64 tick = GetNextWheelTick(&level);
+  if (level != 0)
+    return StartOfTick(tick);
+
+  // The slot holds the tasks of that very tick.
+  return earliest_[tick & kSlotMask];
+}
+
+bool TimerWheel::AdvanceTo(TimeTicks now) {
+  int64 target = TickOf(now);
+  while (wheel_count_) {
+    int level;
+    int64 tick = GetNextWheelTick(&level);
+    if (tick > target)
+      break;
+    tick_ = tick;
+    Cascade();
+    DrainSlot(0, tick_ & kSlotMask, false);
+    ++tick_;
+  }
+  if (tick_ <= target)
+    tick_ = target + 1;
+
+  return !ready_.empty() &&
+      ready_.front()->pending_task.delayed_run_time <= now;
+}
+
+PendingTask TimerWheel::Pop() {
+  DCHECK(!ready_.empty());
+  std::pop_heap(ready_.begin(), ready_.end(), NodeLess());
+  Node* node = ready_.back();
+  ready_.pop_back();
+  DCHECK(!node->cancelled);
+  if (node->cancelable)
+    cancelable_.erase(node->pending_task.sequence_num);
+  --size_;
+  PruneReady();
+
+  // The copy keeps the task alive past the node.
+  PendingTask pending_task(node->pending_task);
+  delete node;
+  return pending_task;
+}
+
+void TimerWheel::Clear() {
+  // Deleting a task may add more.
+  while (!empty()) {
+    MoveAllToReady();
+    while (!ready_.empty())
+      Pop();
+  }
+  DCHECK(ready_.empty());
+  DCHECK(cancelable_.empty());
+}
+
+int64 TimerWheel::GetNextWheelTick(int* level_out) const {
+  DCHECK(wheel_count_);
+  int64 next_tick = kint64max;
+  *level_out = kLevels;
+
+  // Level 0 holds the next kSlots ticks, one per slot.
+  if (occupied_[0]) {
+    next_tick = tick_ + SlotsUntilOccupied(occupied_[0], tick_ & kSlotMask);
+    *level_out = 0;
+  }
+
+  // A slot of an upper level is due when it's cascaded: when |tick_| reaches
+  // the start of the slot's span.
+  for (int level = 1; level < kLevels; ++level) {
+    if (!occupied_[level])
+      continue;
+    int shift = kSlotBits * level;
+    int64 span = GG_INT64_C(1) << shift;
+    int64 first_span = (tick_ + span - 1) >> shift;
+    int64 tick = (first_span + SlotsUntilOccupied(
+        occupied_[level], static_cast<int>(first_span & kSlotMask))) << shift;
+    if (tick < next_tick) {
+      next_tick = tick;
+      *level_out = level;
+    }
+  }
+
+  if (overflow_) {
+    int shift = kSlotBits * kLevels;
+    int64 span = GG_INT64_C(1) << shift;
+    int64 tick = ((tick_ + span - 1) >> shift) << shift;
+    if (tick < next_tick) {
+      next_tick = tick;
+      *level_out = kLevels;
+    }
+  }
+  return next_tick;
+}
+
+void TimerWheel::Insert(Node* node) {
+  if (node->tick < tick_) {
+    PushReady(node);
+    return;
+  }
+
+  int64 delta = node->tick - tick_;
+  int level = 0;
+  while (level < kLevels &&
+         delta >= (GG_INT64_C(1) << (kSlotBits * (level + 1)))) {
+    ++level;
+  }
+
+  node->level = level;
+  node->prev = NULL;
+  Node** list;
+  if (level == kLevels) {
+    node->slot = 0;
+    list = &overflow_;
+  } else {
+    node->slot = static_cast<int>((node->tick >> (kSlotBits * level)) &
+                                  kSlotMask);
+    list = &slots_[level][node->slot];
+    occupied_[level] |= GG_UINT64_C(1) << node->slot;
+    if (level == 0 &&
+        (!*list ||
+         node->pending_task.delayed_run_time < earliest_[node->slot])) {
+      earliest_[node->slot] = node->pending_task.delayed_run_time;
+    }
+  }
+  node->next = *list;
+  if (node->next)
+    node->next->prev = node;
+  *list = node;
+  ++wheel_count_;
+}
+
+void TimerWheel::Unlink(Node* node) {
+  DCHECK_NE(kReadyLevel, node->level);
+  Node** list = node->level == kLevels ?
+      &overflow_ : &slots_[node->level][node->slot];
+  if (node->prev)
+    node->prev->next = node->next;
+  else
+    *list = node->next;
+  if (node->next)
+    node->next->prev = node->prev;
+  if (!*list && node->level < kLevels)
+    occupied_[node->level] &= ~(GG_UINT64_C(1) << node->slot);
+  node->prev = node->next = NULL;
+  node->level = kReadyLevel;
+  --wheel_count_;
+}
+
+void TimerWheel::DrainSlot(int level, int slot, bool reinsert) {
+  Node** list = level == kLevels ? &overflow_ : &slots_[level][slot];
+  Node* node = *list;
+  if (!node)
+    return;
+  *list = NULL;
+  if (level < kLevels)
+    occupied_[level] &= ~(GG_UINT64_C(1) << slot);
+
+  while (node) {
+    Node* next = node->next;
+    node->prev = node->next = NULL;
+    node->level = kReadyLevel;
+    --wheel_count_;
+    if (reinsert)
+      Insert(node);
+    else
+      PushReady(node);
+    node = next;
+  }
+}
+
+void TimerWheel::Cascade() {
+  // Higher levels first, so that what they hand down is cascaded further if
+  // the lower slot is due as well.
+  int64 tick = tick_;
+  int shift = kSlotBits * kLevels;
+  if (!(tick & ((GG_INT64_C(1) << shift) - 1)))
+    DrainSlot(kLevels, 0, true);
+  for (int level = kLevels - 1; level > 0; --level) {
+    shift = kSlotBits * level;
+    if (tick & ((GG_INT64_C(1) << shift) - 1))
+      continue;
+    DrainSlot(level, static_cast<int>((tick >> shift) & kSlotMask), true);
+  }
+}
+
+void TimerWheel::PushReady(Node* node) {
+  node->level = kReadyLevel;
+  ready_.push_back(node);
+  std::push_heap(ready_.begin(), ready_.end(), NodeLess());
+}
+
+void TimerWheel::PruneReady() {
+  while (!ready_.empty() && ready_.front()->cancelled) {
+    std::pop_heap(ready_.begin(), ready_.end(), NodeLess());
+    delete ready_.back();
+    ready_.pop_back();
+  }
+}
+
+void TimerWheel::MoveAllToReady() {
+  for (int level = 0; level < kLevels; ++level) {
+    while (occupied_[level])
+      DrainSlot(level, CountTrailingZeros(occupied_[level]), false);
+  }
+  DrainSlot(kLevels, 0, false);
+}
+
+}  // namespace base
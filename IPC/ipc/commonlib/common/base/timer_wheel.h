@@ -0,0 +1,140 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_TIMER_WHEEL_H_
+#define BASE_TIMER_WHEEL_H_
+
+#include <vector>
+
+#include "base/base_export.h"
+#include "base/basictypes.h"
+#include "base/hash_tables.h"
+#include "base/pending_task.h"
+#include "base/time.h"
+
+namespace base {
+
+// Holds the delayed tasks of a MessageLoop until they are due, in a
+// hierarchical timing wheel.
+//
+// The wheel has kLevels levels of kSlots slots. A slot of level 0 holds the
+// tasks due within one millisecond, and a slot of level n covers kSlots times
+// the span of a slot of level n - 1. A task goes into the lowest level that
+// covers its delay, and moves down a level each time the wheel reaches the
+// start of its slot. Tasks due more than kSlots^kLevels milliseconds out wait
+// on a separate list until the top level wraps around.
+//
+// Adding a task, cancelling it and GetNextRunTime() are O(1). The tasks of the current
+// millisecond are kept in a small heap so that they still run in the order
+// of PendingTask::operator<, i.e. by |delayed_run_time| and then by
+// |sequence_num|.
+//
+// Not thread-safe. A task's destructor may add and cancel other tasks.
+class BASE_EXPORT TimerWheel {
+ public:
+  TimerWheel();
+  ~TimerWheel();
+
+  // Adds |pending_task|, which must have a |delayed_run_time|. If
+  // |cancelable| is true, Cancel() can remove it by its |sequence_num|.
+  void Push(const PendingTask& pending_task, bool cancelable);
+
+  // Removes and deletes the cancelable task with |sequence_num|. Returns false
+  // if there is none, e.g. because it was already popped.
+  bool Cancel(int sequence_num);
+
+  bool empty() const { return size_ == 0; }
+  size_t size() const { return size_; }
+
+  // Returns the run time of the next task, or an earlier time at which the
+  // wheel needs to be advanced to find out. Must not be empty.
+  TimeTicks GetNextRunTime() const;
+
+  // Moves the wheel forward to |now|. Returns true if the next task is due.
+  bool AdvanceTo(TimeTicks now);
+
+  // Removes and returns the next task. Must only be called after AdvanceTo()
+  // returned true.
+  PendingTask Pop();
+
+  // Deletes all the tasks, in the order in which they would have run.
+  void Clear();
+
+ private:
+  enum {
+    kSlotBits = 6,
+    kSlots = 1 << kSlotBits,
+    kSlotMask = kSlots - 1,
+    kLevels = 4,
+  };
+
+  struct Node;
+  struct NodeLess {
+    bool operator()(const Node* a, const Node* b) const;
+  };
+
+  // Puts |node| in the slot for its run time, or in the ready heap if that
+  // slot was already passed.
+  void Insert(Node* node);
+
+  // Removes |node| from its slot or from the overflow list.
+  void Unlink(Node* node);
+
+  // Empties a slot, or the overflow list if |level| is kLevels, into the
+  // ready heap, or re-inserts its nodes if |reinsert|.
+  void DrainSlot(int level, int slot, bool reinsert);
+
+  // Returns the first tick at which a slot has to be cascaded or drained, and
+  // sets |*level| to the slot's level. The wheel must not be empty.
+  int64 GetNextWheelTick(int* level) const;
+
+  // Moves the tasks of the upper levels down when |tick_| reaches the start
+  // of their slot.
+  void Cascade();
+
+  void PushReady(Node* node);
+
+  // Pops cancelled nodes off the top of the ready heap.
+  void PruneReady();
+
+  // Moves every task to the ready heap.
+  void MoveAllToReady();
+
+  // The next millisecond tick to process. The slots of earlier ticks are
+  // empty.
+  int64 tick_;
+
+  // Doubly-linked lists of nodes, and a bitmap of the non-empty slots of
+  // each level.
+  Node* slots_[kLevels][kSlots];
+  uint64 occupied_[kLevels];
+
+  // The earliest run time of the tasks put in each slot of level 0 since it
+  // was last empty. Once a task is cancelled, it is only a lower bound, but
+  // still within the slot's tick.
+  TimeTicks earliest_[kSlots];
+
+  // Tasks beyond the top level.
+  Node* overflow_;
+
+  // The number of nodes in the slots and on |overflow_|.
+  size_t wheel_count_;
+
+  // Tasks whose slot was passed, as a heap ordered by NodeLess. Cancelled
+  // nodes stay in it until they reach the top.
+  std::vector<Node*> ready_;
+
+  // The cancelable tasks by sequence number.
+  typedef hash_map<int, Node*> CancelableMap;
+  CancelableMap cancelable_;
+
+  // The number of tasks that were neither popped nor cancelled.
+  size_t size_;
+
+  DISALLOW_COPY_AND_ASSIGN(TimerWheel);
+};
+
+}  // namespace base
+
+#endif  // BASE_TIMER_WHEEL_H_
@@ -0,0 +1,227 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/timer_wheel.h"
+
+#include <vector>
+
+#include "base/bind.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+namespace {
+
+void Nop() {
+}
+
+// Records its number when it's deleted.
+class DeletionRecorder {
+ public:
+  DeletionRecorder(std::vector<int>* deleted, int number)
+      : deleted_(deleted), number_(number) {}
+  ~DeletionRecorder() { deleted_->push_back(number_); }
+
+  void Run() {}
+
+ private:
+  std::vector<int>* deleted_;
+  int number_;
+};
+
+PendingTask MakeTask(TimeTicks run_time, int sequence_num) {
+  PendingTask pending_task(FROM_HERE, Bind(&Nop), run_time, true);
+  pending_task.sequence_num = sequence_num;
+  return pending_task;
+}
+
+// Pops everything that's due at |now| and returns the sequence numbers.
+std::vector<int> PopDue(TimerWheel* wheel, TimeTicks now) {
+  std::vector<int> popped;
+  while (wheel->AdvanceTo(now))
+    popped.push_back(wheel->Pop().sequence_num);
+  return popped;
+}
+
+TEST(TimerWheelTest, RunsInOrderOfRunTimeThenSequence) {
+  TimeTicks start = TimeTicks::Now();
+  TimerWheel wheel;
+  EXPECT_TRUE(wheel.empty());
+
+  // Within one tick, across ticks, and ties broken by sequence number.
+  wheel.Push(MakeTask(start + TimeDelta::FromMicroseconds(1500), 0), false);
+  wheel.Push(MakeTask(start + TimeDelta::FromMicroseconds(1200), 1), false);
+  wheel.Push(MakeTask(start + TimeDelta::FromMicroseconds(300), 2), false);
+  wheel.Push(MakeTask(start + TimeDelta::FromMicroseconds(1200), 3), false);
+  EXPECT_EQ(4u, wheel.size());
+  EXPECT_EQ(start + TimeDelta::FromMicroseconds(300), wheel.GetNextRunTime());
+
+  EXPECT_TRUE(PopDue(&wheel, start).empty());
+  std::vector<int> popped =
+      PopDue(&wheel, start + TimeDelta::FromMilliseconds(2));
+  ASSERT_EQ(4u, popped.size());
+  EXPECT_EQ(2, popped[0]);
+  EXPECT_EQ(1, popped[1]);
+  EXPECT_EQ(3, popped[2]);
+  EXPECT_EQ(0, popped[3]);
+  EXPECT_TRUE(wheel.empty());
+}
+
+TEST(TimerWheelTest, NeverRunsEarly) {
+  TimeTicks start = TimeTicks::Now();
+  TimerWheel wheel;
+  wheel.Push(MakeTask(start + TimeDelta::FromMicroseconds(10500), 0), false);
+
+  EXPECT_TRUE(PopDue(&wheel,
+                     start + TimeDelta::FromMicroseconds(10499)).empty());
+  EXPECT_EQ(start + TimeDelta::FromMicroseconds(10500),
+            wheel.GetNextRunTime());
+  EXPECT_EQ(1u, PopDue(&wheel,
+                       start + TimeDelta::FromMicroseconds(10500)).size());
+}
+
+TEST(TimerWheelTest, CascadesFromEveryLevel) {
+  TimeTicks start = TimeTicks::Now();
+  TimerWheel wheel;
+
+  // Delays that land on each level of the wheel and beyond it.
+  const int64 kDelaysMs[] = {
+    GG_INT64_C(5) * 3600 * 1000,  // Past the top level.
+    GG_INT64_C(3) * 3600 * 1000,
+    300 * 1000,
+    5 * 1000,
+    70,
+    3,
+  };
+  for (size_t i = 0; i < arraysize(kDelaysMs); ++i) {
+    wheel.Push(MakeTask(start + TimeDelta::FromMilliseconds(kDelaysMs[i]),
+                        static_cast<int>(i)),
+               false);
+  }
+
+  // Each task comes out on its own, at its time and not before, in order.
+  TimeTicks now = start;
+  for (int i = arraysize(kDelaysMs) - 1; i >= 0; --i) {
+    TimeTicks run_time = start + TimeDelta::FromMilliseconds(kDelaysMs[i]);
+    ASSERT_FALSE(wheel.empty());
+    EXPECT_LE(wheel.GetNextRunTime(), run_time);
+    EXPECT_TRUE(PopDue(&wheel, run_time - TimeDelta::FromMicroseconds(1))
+                    .empty());
+    now = run_time;
+    std::vector<int> popped = PopDue(&wheel, now);
+    ASSERT_EQ(1u, popped.size());
+    EXPECT_EQ(i, popped[0]);
+  }
+  EXPECT_TRUE(wheel.empty());
+}
+
+TEST(TimerWheelTest, Cancel) {
+  TimeTicks start = TimeTicks::Now();
+  TimerWheel wheel;
+  wheel.Push(MakeTask(start + TimeDelta::FromMilliseconds(10), 0), true);
+  wheel.Push(MakeTask(start + TimeDelta::FromSeconds(100), 1), true);
+  wheel.Push(MakeTask(start + TimeDelta::FromMilliseconds(20), 2), false);
+
+  // Tasks can only be cancelled once, and only if they were pushed as
+  // cancelable.
+  EXPECT_TRUE(wheel.Cancel(1));
+  EXPECT_FALSE(wheel.Cancel(1));
+  EXPECT_FALSE(wheel.Cancel(2));
+  EXPECT_EQ(2u, wheel.size());
+
+  std::vector<int> popped =
+      PopDue(&wheel, start + TimeDelta::FromSeconds(200));
+  ASSERT_EQ(2u, popped.size());
+  EXPECT_EQ(0, popped[0]);
+  EXPECT_EQ(2, popped[1]);
+
+  // A task that already ran can't be cancelled.
+  EXPECT_FALSE(wheel.Cancel(0));
+  EXPECT_TRUE(wheel.empty());
+}
+
+// Many tasks due within one millisecond share one slot, which must still
+// give the earliest of them without going through all of them.
+TEST(TimerWheelTest, ManyTasksInOneTick) {
+  const int kTasks = 10000;
+  const int kTimes = 1000;
+  TimeTicks start = TimeTicks::Now();
+  TimeTicks tick_start = TimeTicks::FromInternalValue(
+      (start.ToInternalValue() / Time::kMicrosecondsPerMillisecond + 5) *
+      Time::kMicrosecondsPerMillisecond);
+  TimerWheel wheel;
+  for (int i = 0; i < kTasks; ++i) {
+    wheel.Push(MakeTask(tick_start + TimeDelta::FromMicroseconds(
+        kTimes - 1 - i % kTimes), i), true);
+  }
+  EXPECT_EQ(tick_start, wheel.GetNextRunTime());
+
+  // Cancelling the earliest tasks may leave an earlier bound, but never a
+  // later one.
+  for (int i = kTimes - 1; i < kTasks; i += kTimes)
+    EXPECT_TRUE(wheel.Cancel(i));
+  EXPECT_GE(wheel.GetNextRunTime(), tick_start);
+  EXPECT_LE(wheel.GetNextRunTime(),
+            tick_start + TimeDelta::FromMicroseconds(1));
+
+  EXPECT_TRUE(PopDue(&wheel,
+                     tick_start - TimeDelta::FromMicroseconds(1)).empty());
+  std::vector<int> popped = PopDue(
+      &wheel, tick_start + TimeDelta::FromMicroseconds(kTimes - 1));
+  ASSERT_EQ(static_cast<size_t>(kTasks - kTasks / kTimes), popped.size());
+  for (size_t i = 1; i < popped.size(); ++i) {
+    int previous_time = kTimes - 1 - popped[i - 1] % kTimes;
+    int time = kTimes - 1 - popped[i] % kTimes;
+    EXPECT_TRUE(previous_time < time ||
+                (previous_time == time && popped[i - 1] < popped[i]));
+  }
+  EXPECT_TRUE(wheel.empty());
+}
+
+TEST(TimerWheelTest, CancelDueTask) {
+  TimeTicks start = TimeTicks::Now();
+  TimerWheel wheel;
+  wheel.Push(MakeTask(start + TimeDelta::FromMilliseconds(1), 0), true);
+  wheel.Push(MakeTask(start + TimeDelta::FromMilliseconds(2), 1), true);
+  wheel.Push(MakeTask(start + TimeDelta::FromMilliseconds(3), 2), true);
+
+  // Both are moved off the wheel, and one is cancelled before it's popped.
+  TimeTicks now = start + TimeDelta::FromMilliseconds(5);
+  EXPECT_TRUE(wheel.AdvanceTo(now));
+  EXPECT_TRUE(wheel.Cancel(0));
+  EXPECT_TRUE(wheel.Cancel(2));
+  EXPECT_EQ(1u, wheel.size());
+  EXPECT_EQ(start + TimeDelta::FromMilliseconds(2), wheel.GetNextRunTime());
+
+  std::vector<int> popped = PopDue(&wheel, now);
+  ASSERT_EQ(1u, popped.size());
+  EXPECT_EQ(1, popped[0]);
+  EXPECT_TRUE(wheel.empty());
+}
+
+TEST(TimerWheelTest, ClearDeletesInRunOrder) {
+  TimeTicks start = TimeTicks::Now();
+  std::vector<int> deleted;
+  {
+    TimerWheel wheel;
+    const int kDelaysMs[] = { 50, 10, 100000, 30 };
+    for (size_t i = 0; i < arraysize(kDelaysMs); ++i) {
+      PendingTask pending_task(
+          FROM_HERE,
+          Bind(&DeletionRecorder::Run,
+               Owned(new DeletionRecorder(&deleted, static_cast<int>(i)))),
+          start + TimeDelta::FromMilliseconds(kDelaysMs[i]), true);
+      pending_task.sequence_num = static_cast<int>(i);
+      wheel.Push(pending_task, i % 2 == 0);
+    }
+    EXPECT_TRUE(deleted.empty());
+  }
+  ASSERT_EQ(4u, deleted.size());
+  EXPECT_EQ(1, deleted[0]);
+  EXPECT_EQ(3, deleted[1]);
+  EXPECT_EQ(0, deleted[2]);
+  EXPECT_EQ(2, deleted[3]);
+}
+
+}  // namespace
+}  // namespace base
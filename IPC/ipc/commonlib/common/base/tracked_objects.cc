@@ -8,6 +8,7 @@
 #include <stdlib.h>
 
 #include "base/compiler_specific.h"
+#include "base/environment.h"
 #include "base/format_macros.h"
 #include "base/memory/scoped_ptr.h"
 #include "base/process_util.h"
@@ -415,6 +416,12 @@ void ThreadData::TallyADeath(const Births& birth,
   if (kAllowAlternateTimeSourceHandling && now_function_)
     queue_duration = 0;
 
+  // Posting times come from TimeTicks::Now(), but the start of the run may
+  // come from a wall clock that lags it (see SetWallClock()).  A task can't
+  // wait less than no time.
+  if (queue_duration < 0)
+    queue_duration = 0;
+
   DeathMap::iterator it = death_map_.find(&birth);
   DeathData* death_data;
   if (it != death_map_.end()) {
@@ -654,6 +661,18 @@ static void OptionallyInitializeAlternateTimer() {
   NowFunction* alternate_time_source = GetAlternateTimeSource();
   if (alternate_time_source)
     ThreadData::SetAlternateTimeSource(alternate_time_source);
+
+  // Read wall time from a cheaper clock if the environment calls for it.
+  scoped_ptr<base::Environment> env(base::Environment::Create());
+  std::string wall_clock;
+  if (!env->GetVar(kProfilerWallClock, &wall_clock))
+    return;
+  if (wall_clock == "coarse") {
+    SetWallClock(WALL_CLOCK_COARSE);
+  } else if (wall_clock == "tsc") {
+    if (!SetWallClock(WALL_CLOCK_TSC))
+      DLOG(WARNING) << "No usable time stamp counter; keeping the default.";
+  }
 }
 
 bool ThreadData::Initialize() {
@@ -49,9 +49,12 @@
         'ipc_channel_posix_unittest.cc',
         'ipc_channel_unittest.cc',
         'ipc_fuzzing_tests.cc',
+        'ipc_message_filter_router_unittest.cc',
         'ipc_message_unittest.cc',
         'ipc_message_utils_unittest.cc',
+        'ipc_output_queue_unittest.cc',
         'ipc_send_fds_test.cc',
+        'ipc_shared_memory_ring_linux_unittest.cc',
         'ipc_sync_channel_unittest.cc',
         'ipc_sync_message_unittest.cc',
         'ipc_sync_message_unittest.h',
@@ -104,6 +107,8 @@
         '..'
       ],
       'sources': [
+        'ipc_perf_result.cc',
+        'ipc_perf_result.h',
         'ipc_perftests.cc',
         'ipc_test_base.cc',
         'ipc_test_base.h',
@@ -10,6 +10,7 @@
 #include "base/process_util.h"
 #include "base/rand_util.h"
 #include "base/stringprintf.h"
+#include "ipc/ipc_channel_reader.h"
 
 #if !defined(OS_NACL)
 namespace {
@@ -39,5 +40,10 @@ std::string Channel::GenerateUniqueRandomChannelID() {
       base::RandInt(0, INT_MAX));
 }
 
+// static
+void Channel::SetLargeMessageBufferEnabled(bool enabled) {
+  internal::ChannelReader::SetLargeMessageBufferEnabled(enabled);
+}
+
 }  // namespace IPC
 
@@ -86,6 +86,18 @@ class IPC_EXPORT Channel : public Sender {
                                      // constants starting from 0.
   };
 
+  // Other messages internal to the Channel class. Like the Hello message they
+  // have the routing_id MSG_ROUTING_NONE and are never handed to the listener.
+  enum {
+    // Sent by a POSIX channel to offer the peer a shared memory ring to write
+    // into. See SetSharedMemoryRingEnabled().
+    SHARED_MEMORY_RING_OFFER_MESSAGE_TYPE = kuint16max - 1,
+    // Sent in reply to the offer. It is the last message written to the
+    // socket; everything after it goes through the ring.
+    SHARED_MEMORY_RING_ACCEPT_MESSAGE_TYPE = kuint16max - 2,
+    FIRST_INTERNAL_MESSAGE_TYPE = SHARED_MEMORY_RING_ACCEPT_MESSAGE_TYPE
+  };
+
   // The maximum message size in bytes. Attempting to receive a message of this
   // size or bigger results in a channel error.
   static const size_t kMaximumMessageSize = 128 * 1024 * 1024;
@@ -142,6 +154,14 @@ class IPC_EXPORT Channel : public Sender {
   // deleted once the contents of the Message have been sent.
   virtual bool Send(Message* message) OVERRIDE;
 
+  // Lets a newer message of |type| replace a queued one with the same
+  // priority and routing id that has not started going out yet, instead of
+  // being queued behind it. Use this for messages that only carry the latest
+  // state of something, such as input or progress updates. Independently of
+  // this, messages are written in priority order: a message overtakes queued
+  // messages of lower priority that have not started going out.
+  void AddCoalescedMessageType(uint32 type);
+
 #if defined(OS_POSIX)
   // On POSIX an IPC::Channel wraps a socketpair(), this method returns the
   // FD # for the client end of the socket.
@@ -173,6 +193,13 @@ class IPC_EXPORT Channel : public Sender {
   // Closes any currently connected socket, and returns to a listening state
   // for more connections.
   void ResetToAcceptingConnectionState();
+
+  // Enables or disables batched writes for channels created afterwards. When
+  // enabled, messages that queue up while the socket is full are flushed with
+  // a single vectored write rather than one write per message. Messages
+  // carrying file descriptors are still sent on their own, in order.
+  // This should be called before any channel is created.
+  static void SetBatchedWritesEnabled(bool enabled);
 #endif  // defined(OS_POSIX) && !defined(OS_NACL)
 
   // Returns true if a named server channel is initialized on the given channel
@@ -190,11 +217,25 @@ class IPC_EXPORT Channel : public Sender {
   static std::string GenerateVerifiedChannelID(const std::string& prefix);
 #endif
 
+  // Enables or disables reading messages larger than kReadBufferSize straight
+  // into a buffer sized from their header, instead of reassembling them from
+  // kReadBufferSize chunks. Enabled by default. Affects channels created
+  // afterwards; this should be called before any channel is created.
+  static void SetLargeMessageBufferEnabled(bool enabled);
+
 #if defined(OS_LINUX)
   // Sandboxed processes live in a PID namespace, so when sending the IPC hello
   // message from client to server we need to send the PID from the global
   // PID namespace.
   static void SetGlobalPid(int pid);
+
+  // Enables or disables the shared memory ring transport for channels created
+  // afterwards. Once connected, two channels that both have it enabled move
+  // their message bytes through a base::SharedMemory ring per direction, with
+  // an eventfd as doorbell, instead of through the socket. File descriptors
+  // still travel over the socketpair dedicated to them. This should be called
+  // before any channel is created.
+  static void SetSharedMemoryRingEnabled(bool enabled);
 #endif
 
  protected:
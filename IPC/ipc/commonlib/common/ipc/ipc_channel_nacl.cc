@@ -341,10 +341,11 @@ bool Channel::ChannelImpl::DidEmptyInputBuffers() {
   return input_fds_.empty();
 }
 
-void Channel::ChannelImpl::HandleHelloMessage(const Message& msg) {
+bool Channel::ChannelImpl::HandleHelloMessage(const Message& msg) {
   // The trusted side IPC::Channel should handle the "hello" handshake; we
   // should not receive the "Hello" message.
   NOTREACHED();
+  return false;
 }
 
 //------------------------------------------------------------------------------
@@ -378,4 +379,9 @@ bool Channel::Send(Message* message) {
   return channel_impl_->Send(message);
 }
 
+void Channel::AddCoalescedMessageType(uint32 type) {
+  // Messages are handed to the trusted side as soon as they are sent, so they
+  // never queue up long enough to be coalesced.
+}
+
 }  // namespace IPC
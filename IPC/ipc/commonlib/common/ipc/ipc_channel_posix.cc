@@ -10,13 +10,10 @@
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <sys/un.h>
 #include <unistd.h>
 
-#if defined(OS_OPENBSD)
-#include <sys/uio.h>
-#endif
-
 #include <map>
 #include <string>
 
@@ -40,6 +37,9 @@
 #include "ipc/ipc_logging.h"
 #include "ipc/ipc_message_utils.h"
 #include "ipc/ipc_switches.h"
+#if defined(OS_LINUX)
+#include "ipc/ipc_shared_memory_ring_linux.h"
+#endif
 #include "ipc/unix_domain_socket_util.h"
 
 namespace IPC {
@@ -158,13 +158,20 @@ bool SocketWriteErrorIsRecoverable() {
 #endif  // OS_MACOSX
 }
 
+// Upper bound on the number of messages gathered into one vectored write.
+// Well below IOV_MAX on every POSIX platform we support.
+const size_t kMaxIOVecsPerWrite = 64;
+
 }  // namespace
 //------------------------------------------------------------------------------
 
 #if defined(OS_LINUX)
 int Channel::ChannelImpl::global_pid_ = 0;
+base::subtle::Atomic32 Channel::ChannelImpl::shared_memory_ring_enabled_ = 0;
 #endif  // OS_LINUX
 
+base::subtle::Atomic32 Channel::ChannelImpl::batched_writes_enabled_ = 0;
+
 Channel::ChannelImpl::ChannelImpl(const IPC::ChannelHandle& channel_handle,
                                   Mode mode, Listener* listener)
     : ChannelReader(listener),
@@ -181,6 +188,21 @@ Channel::ChannelImpl::ChannelImpl(const IPC::ChannelHandle& channel_handle,
       remote_fd_pipe_(-1),
 #endif  // IPC_USES_READWRITE
       pipe_name_(channel_handle.name),
+      use_batched_writes_(
+          base::subtle::NoBarrier_Load(&batched_writes_enabled_) != 0),
+      send_syscall_counter_("IPC.SendSyscalls"),
+      sent_message_counter_("IPC.MessagesSent"),
+#if defined(OS_LINUX)
+      use_shared_memory_ring_(
+          base::subtle::NoBarrier_Load(&shared_memory_ring_enabled_) != 0),
+      receive_data_doorbell_(-1),
+      receive_space_doorbell_(-1),
+      receive_ring_active_(false),
+      send_data_doorbell_(-1),
+      send_space_doorbell_(-1),
+      send_ring_active_(false),
+      ring_accept_message_(NULL),
+#endif  // OS_LINUX
       must_unlink_(false) {
   memset(input_cmsg_buf_, 0, sizeof(input_cmsg_buf_));
   if (!CreatePipe(channel_handle)) {
@@ -359,7 +381,23 @@ bool Channel::ChannelImpl::ProcessOutgoingMessages() {
   // Write out all the messages we can till the write blocks or there are no
   // more outgoing messages.
   while (!output_queue_.empty()) {
+#if defined(OS_LINUX)
+    if (send_ring_active_)
+      return WriteMessagesToRing();
+#endif  // OS_LINUX
     Message* msg = output_queue_.front();
+    output_queue_.MarkFrontStarted();
+
+    if (use_batched_writes_ && !HasUnsentDescriptors(msg, true)) {
+      bool blocked = false;
+      if (!WriteBatchedMessages(&blocked))
+        return false;
+      if (blocked) {
+        WaitForWrite();
+        return true;
+      }
+      continue;
+    }
 
     size_t amt_to_write = msg->size() - message_send_bytes_written_;
     DCHECK_NE(0U, amt_to_write);
@@ -416,6 +454,7 @@ bool Channel::ChannelImpl::ProcessOutgoingMessages() {
         msgh.msg_iov = &fd_pipe_iov;
         fd_written = fd_pipe_;
         bytes_written = HANDLE_EINTR(sendmsg(fd_pipe_, &msgh, MSG_DONTWAIT));
+        send_syscall_counter_.Increment();
         msgh.msg_iov = &iov;
         msgh.msg_controllen = 0;
         if (bytes_written > 0) {
@@ -438,26 +477,13 @@ bool Channel::ChannelImpl::ProcessOutgoingMessages() {
       {
         bytes_written = HANDLE_EINTR(sendmsg(pipe_, &msgh, MSG_DONTWAIT));
       }
+      send_syscall_counter_.Increment();
     }
     if (bytes_written > 0)
       msg->file_descriptor_set()->CommitAll();
 
     if (bytes_written < 0 && !SocketWriteErrorIsRecoverable()) {
-#if defined(OS_MACOSX)
-      // On OSX writing to a pipe with no listener returns EPERM.
-      if (errno == EPERM) {
-        Close();
-        return false;
-      }
-#endif  // OS_MACOSX
-      if (errno == EPIPE) {
-        Close();
-        return false;
-      }
-      PLOG(ERROR) << "pipe error on "
-                  << fd_written
-                  << " Currently writing message of size: "
-                  << msg->size();
+      HandleWriteError(fd_written, msg->size());
       return false;
     }
 
@@ -467,28 +493,142 @@ bool Channel::ChannelImpl::ProcessOutgoingMessages() {
         message_send_bytes_written_ += bytes_written;
       }
 
-      // Tell libevent to call us back once things are unblocked.
-      is_blocked_on_write_ = true;
-      base::MessageLoopForIO::current()->WatchFileDescriptor(
-          pipe_,
-          false,  // One shot
-          base::MessageLoopForIO::WATCH_WRITE,
-          &write_watcher_,
-          this);
+      WaitForWrite();
       return true;
     } else {
       message_send_bytes_written_ = 0;
+      PopSentMessage();
+    }
+  }
+  return true;
+}
+
+void Channel::ChannelImpl::PopSentMessage() {
+  Message* msg = output_queue_.front();
+  // Message sent OK!
+  DVLOG(2) << "sent message @" << msg << " on channel @" << this
+           << " with type " << msg->type() << " on fd " << pipe_;
+  sent_message_counter_.Increment();
+#if defined(OS_LINUX)
+  if (msg == ring_accept_message_) {
+    // Everything after the accept message goes through the ring.
+    ring_accept_message_ = NULL;
+    send_ring_active_ = true;
+  }
+#endif  // OS_LINUX
+  delete msg;
+  output_queue_.pop_front();
+}
+
+bool Channel::ChannelImpl::WriteBatchedMessages(bool* blocked) {
+  DCHECK(!output_queue_.empty());
+  *blocked = false;
+
+  struct iovec iov[kMaxIOVecsPerWrite];
+  size_t iov_count = 0;
+  size_t amt_to_write = 0;
+  for (internal::OutputQueue::const_iterator it = output_queue_.begin();
+       it != output_queue_.end() && iov_count < kMaxIOVecsPerWrite; ++it) {
+    bool is_front = it == output_queue_.begin();
+    // Descriptors must go out with (or just ahead of) the first byte of their
+    // message, so stop gathering at the next message that carries any. It
+    // will be picked up by the single-message path on the next iteration.
+    if (HasUnsentDescriptors(*it, is_front))
+      break;
+
+    size_t offset = is_front ? message_send_bytes_written_ : 0;
+    const char* out_bytes =
+        reinterpret_cast<const char*>((*it)->data()) + offset;
+    iov[iov_count].iov_base = const_cast<char*>(out_bytes);
+    iov[iov_count].iov_len = (*it)->size() - offset;
+    DCHECK_NE(0U, iov[iov_count].iov_len);
+    amt_to_write += iov[iov_count].iov_len;
+    ++iov_count;
+#if defined(OS_LINUX)
+    // Nothing may follow the accept message on |pipe_|.
+    if (*it == ring_accept_message_)
+      break;
+#endif  // OS_LINUX
+  }
+  DCHECK_NE(0U, iov_count);
 
-      // Message sent OK!
-      DVLOG(2) << "sent message @" << msg << " on channel @" << this
-               << " with type " << msg->type() << " on fd " << pipe_;
-      delete output_queue_.front();
-      output_queue_.pop();
+#if defined(IPC_USES_READWRITE)
+  // Stay on the cheap read/write family of calls; see IPC_USES_READWRITE.
+  ssize_t bytes_written = HANDLE_EINTR(writev(pipe_, iov, iov_count));
+#else
+  struct msghdr msgh = {0};
+  msgh.msg_iov = iov;
+  msgh.msg_iovlen = iov_count;
+  ssize_t bytes_written = HANDLE_EINTR(sendmsg(pipe_, &msgh, MSG_DONTWAIT));
+#endif  // IPC_USES_READWRITE
+  send_syscall_counter_.Increment();
+
+  if (bytes_written < 0) {
+    if (!SocketWriteErrorIsRecoverable()) {
+      HandleWriteError(pipe_, output_queue_.front()->size());
+      return false;
     }
+    *blocked = true;
+    return true;
   }
+
+  // Retire every message that made it out completely and remember how far we
+  // got into the one that did not.
+  size_t remaining = static_cast<size_t>(bytes_written);
+  while (remaining > 0) {
+    Message* msg = output_queue_.front();
+    size_t amt_left = msg->size() - message_send_bytes_written_;
+    if (remaining < amt_left) {
+      message_send_bytes_written_ += remaining;
+      output_queue_.MarkFrontStarted();
+      break;
+    }
+    remaining -= amt_left;
+    message_send_bytes_written_ = 0;
+    PopSentMessage();
+  }
+
+  *blocked = static_cast<size_t>(bytes_written) != amt_to_write;
   return true;
 }
 
+bool Channel::ChannelImpl::HasUnsentDescriptors(Message* msg,
+                                                bool is_front) const {
+  if (is_front && message_send_bytes_written_ != 0)
+    return false;
+  return !msg->file_descriptor_set()->empty();
+}
+
+void Channel::ChannelImpl::HandleWriteError(int fd_written,
+                                            size_t message_size) {
+#if defined(OS_MACOSX)
+  // On OSX writing to a pipe with no listener returns EPERM.
+  if (errno == EPERM) {
+    Close();
+    return;
+  }
+#endif  // OS_MACOSX
+  if (errno == EPIPE) {
+    Close();
+    return;
+  }
+  PLOG(ERROR) << "pipe error on "
+              << fd_written
+              << " Currently writing message of size: "
+              << message_size;
+}
+
+void Channel::ChannelImpl::WaitForWrite() {
+  // Tell libevent to call us back once things are unblocked.
+  is_blocked_on_write_ = true;
+  base::MessageLoopForIO::current()->WatchFileDescriptor(
+      pipe_,
+      false,  // One shot
+      base::MessageLoopForIO::WATCH_WRITE,
+      &write_watcher_,
+      this);
+}
+
 bool Channel::ChannelImpl::Send(Message* message) {
   DVLOG(2) << "sending message @" << message << " on channel @" << this
            << " with type " << message->type()
@@ -499,7 +639,7 @@ bool Channel::ChannelImpl::Send(Message* message) {
 #endif  // IPC_MESSAGE_LOG_ENABLED
 
   message->TraceMessageBegin();
-  output_queue_.push(message);
+  output_queue_.Push(message);
   if (!is_blocked_on_write_ && !waiting_connect_) {
     return ProcessOutgoingMessages();
   }
@@ -549,6 +689,9 @@ void Channel::ChannelImpl::ResetToAcceptingConnectionState() {
   // Unregister libevent for the unix domain socket and close it.
   read_watcher_.StopWatchingFileDescriptor();
   write_watcher_.StopWatchingFileDescriptor();
+#if defined(OS_LINUX)
+  CloseSharedMemoryRings();
+#endif  // OS_LINUX
   if (pipe_ != -1) {
     if (HANDLE_EINTR(close(pipe_)) < 0)
       PLOG(ERROR) << "close pipe_ " << pipe_name_;
@@ -567,11 +710,7 @@ void Channel::ChannelImpl::ResetToAcceptingConnectionState() {
   }
 #endif  // IPC_USES_READWRITE
 
-  while (!output_queue_.empty()) {
-    Message* m = output_queue_.front();
-    output_queue_.pop();
-    delete m;
-  }
+  output_queue_.Clear();
 
   // Close any outstanding, received file descriptors.
   ClearInputFDs();
@@ -588,8 +727,22 @@ bool Channel::ChannelImpl::IsNamedServerInitialized(
 void Channel::ChannelImpl::SetGlobalPid(int pid) {
   global_pid_ = pid;
 }
+
+// static
+void Channel::ChannelImpl::SetSharedMemoryRingEnabled(bool enabled) {
+  base::subtle::NoBarrier_Store(&shared_memory_ring_enabled_, enabled ? 1 : 0);
+}
 #endif  // OS_LINUX
 
+// static
+void Channel::ChannelImpl::SetBatchedWritesEnabled(bool enabled) {
+  base::subtle::NoBarrier_Store(&batched_writes_enabled_, enabled ? 1 : 0);
+}
+
+void Channel::ChannelImpl::AddCoalescedMessageType(uint32 type) {
+  output_queue_.AddCoalescedType(type);
+}
+
 // Called by libevent when we can read from the pipe without blocking.
 void Channel::ChannelImpl::OnFileCanReadWithoutBlocking(int fd) {
   bool send_server_hello_msg = false;
@@ -643,7 +796,25 @@ void Channel::ChannelImpl::OnFileCanReadWithoutBlocking(int fd) {
       // ProcessOutgoingMessages.
       send_server_hello_msg = false;
       ClosePipeOnError();
+#if defined(OS_LINUX)
+    } else if (receive_ring_active_ && !CheckPipeWhileReadingRing()) {
+      send_server_hello_msg = false;
+      ClosePipeOnError();
+#endif  // OS_LINUX
     }
+#if defined(OS_LINUX)
+  } else if (fd == receive_data_doorbell_) {
+    internal::DrainDoorbell(fd);
+    if (!ProcessIncomingMessages())
+      ClosePipeOnError();
+    return;
+  } else if (fd == send_space_doorbell_) {
+    internal::DrainDoorbell(fd);
+    is_blocked_on_write_ = false;
+    if (!ProcessOutgoingMessages())
+      ClosePipeOnError();
+    return;
+#endif  // OS_LINUX
   } else {
     NOTREACHED() << "Unknown pipe " << fd;
   }
@@ -659,7 +830,12 @@ void Channel::ChannelImpl::OnFileCanReadWithoutBlocking(int fd) {
 
 // Called by libevent when we can write to the pipe without blocking.
 void Channel::ChannelImpl::OnFileCanWriteWithoutBlocking(int fd) {
+#if defined(OS_LINUX)
+  // Once writing through the ring, only |fd_pipe_| can fill up.
+  DCHECK(fd == pipe_ || fd == fd_pipe_);
+#else
   DCHECK_EQ(pipe_, fd);
+#endif  // OS_LINUX
   is_blocked_on_write_ = false;
   if (!ProcessOutgoingMessages()) {
     ClosePipeOnError();
@@ -729,7 +905,7 @@ void Channel::ChannelImpl::QueueHelloMessage() {
     DCHECK_EQ(msg->file_descriptor_set()->size(), 1U);
   }
 #endif  // IPC_USES_READWRITE
-  output_queue_.push(msg.release());
+  output_queue_.Push(msg.release());
 }
 
 Channel::ChannelImpl::ReadState Channel::ChannelImpl::ReadData(
@@ -738,6 +914,10 @@ Channel::ChannelImpl::ReadState Channel::ChannelImpl::ReadData(
     int* bytes_read) {
   if (pipe_ == -1)
     return READ_FAILED;
+#if defined(OS_LINUX)
+  if (receive_ring_active_)
+    return ReadDataFromRing(buffer, buffer_len, bytes_read);
+#endif  // OS_LINUX
 
   struct msghdr msg = {0};
 
@@ -902,7 +1082,7 @@ void Channel::ChannelImpl::ClearInputFDs() {
   input_fds_.clear();
 }
 
-void Channel::ChannelImpl::HandleHelloMessage(const Message& msg) {
+bool Channel::ChannelImpl::HandleHelloMessage(const Message& msg) {
   // The Hello message contains only the process id.
   PickleIterator iter(msg);
   int pid;
@@ -924,9 +1104,287 @@ void Channel::ChannelImpl::HandleHelloMessage(const Message& msg) {
   }
 #endif  // IPC_USES_READWRITE
   peer_pid_ = pid;
+#if defined(OS_LINUX)
+  if (use_shared_memory_ring_ && !QueueSharedMemoryRingOffer())
+    return false;
+#endif  // OS_LINUX
   listener()->OnChannelConnected(pid);
+  return true;
+}
+
+bool Channel::ChannelImpl::HandleInternalMessage(const Message& msg) {
+  switch (msg.type()) {
+#if defined(OS_LINUX)
+    case SHARED_MEMORY_RING_OFFER_MESSAGE_TYPE:
+      return AcceptSharedMemoryRing(msg);
+    case SHARED_MEMORY_RING_ACCEPT_MESSAGE_TYPE:
+      ActivateReceiveRing();
+      return true;
+#endif  // OS_LINUX
+    default:
+      return ChannelReader::HandleInternalMessage(msg);
+  }
+}
+
+#if defined(OS_LINUX)
+bool Channel::ChannelImpl::QueueSharedMemoryRingOffer() {
+  DCHECK(!receive_ring_);
+  receive_ring_ = internal::SharedMemoryRing::Create(
+      internal::SharedMemoryRing::kDefaultCapacity);
+  if (!receive_ring_ ||
+      !internal::CreateDoorbell(&receive_data_doorbell_) ||
+      !internal::CreateDoorbell(&receive_space_doorbell_)) {
+    // Keep using the socket.
+    CloseSharedMemoryRings();
+    return true;
+  }
+
+  // The offer carries the segment and both doorbells. We keep our copies of
+  // the descriptors, so they are not closed once sent.
+  scoped_ptr<Message> msg(new Message(MSG_ROUTING_NONE,
+                                      SHARED_MEMORY_RING_OFFER_MESSAGE_TYPE,
+                                      IPC::Message::PRIORITY_NORMAL));
+  base::FileDescriptor segment = receive_ring_->handle();
+  segment.auto_close = false;
+  if (!msg->WriteUInt32(static_cast<uint32>(receive_ring_->mapped_size())) ||
+      !msg->WriteFileDescriptor(segment) ||
+      !msg->WriteFileDescriptor(
+          base::FileDescriptor(receive_data_doorbell_, false)) ||
+      !msg->WriteFileDescriptor(
+          base::FileDescriptor(receive_space_doorbell_, false))) {
+    NOTREACHED() << "Unable to pickle shared memory ring offer";
+  }
+  output_queue_.Push(msg.release());
+  if (!is_blocked_on_write_ && !waiting_connect_)
+    return ProcessOutgoingMessages();
+  return true;
 }
 
+bool Channel::ChannelImpl::AcceptSharedMemoryRing(const Message& msg) {
+  PickleIterator iter(msg);
+  uint32 mapped_size = 0;
+  base::FileDescriptor segment;
+  base::FileDescriptor data_doorbell;
+  base::FileDescriptor space_doorbell;
+  bool valid = msg.ReadUInt32(&iter, &mapped_size) &&
+               msg.ReadFileDescriptor(&iter, &segment) &&
+               msg.ReadFileDescriptor(&iter, &data_doorbell) &&
+               msg.ReadFileDescriptor(&iter, &space_doorbell);
+  // Take ownership of whatever descriptors we got.
+  file_util::ScopedFD scoped_data_doorbell(
+      data_doorbell.fd >= 0 ? &data_doorbell.fd : NULL);
+  file_util::ScopedFD scoped_space_doorbell(
+      space_doorbell.fd >= 0 ? &space_doorbell.fd : NULL);
+  if (!valid) {
+    LOG(ERROR) << "Invalid shared memory ring offer";
+    if (segment.fd >= 0 && HANDLE_EINTR(close(segment.fd)) < 0)
+      PLOG(ERROR) << "close";
+    return true;
+  }
+  if (!use_shared_memory_ring_ || send_ring_) {
+    // Not interested; the peer keeps reading from the socket.
+    if (HANDLE_EINTR(close(segment.fd)) < 0)
+      PLOG(ERROR) << "close";
+    return true;
+  }
+
+  send_ring_ = internal::SharedMemoryRing::Open(segment, mapped_size);
+  if (!send_ring_)
+    return true;
+  send_data_doorbell_ = *scoped_data_doorbell.release();
+  send_space_doorbell_ = *scoped_space_doorbell.release();
+  base::MessageLoopForIO::current()->WatchFileDescriptor(
+      send_space_doorbell_,
+      true,
+      base::MessageLoopForIO::WATCH_READ,
+      &send_doorbell_watcher_,
+      this);
+
+  scoped_ptr<Message> accept(new Message(MSG_ROUTING_NONE,
+                                         SHARED_MEMORY_RING_ACCEPT_MESSAGE_TYPE,
+                                         IPC::Message::PRIORITY_NORMAL));
+  ring_accept_message_ = accept.get();
+  output_queue_.Push(accept.release());
+  if (!is_blocked_on_write_ && !waiting_connect_)
+    return ProcessOutgoingMessages();
+  return true;
+}
+
+void Channel::ChannelImpl::ActivateReceiveRing() {
+  if (!receive_ring_ || receive_ring_active_) {
+    LOG(ERROR) << "Unexpected shared memory ring accept message";
+    return;
+  }
+  receive_ring_active_ = true;
+  base::MessageLoopForIO::current()->WatchFileDescriptor(
+      receive_data_doorbell_,
+      true,
+      base::MessageLoopForIO::WATCH_READ,
+      &receive_doorbell_watcher_,
+      this);
+}
+
+bool Channel::ChannelImpl::WriteMessagesToRing() {
+  bool wrote = false;
+  bool blocked = false;
+  while (!output_queue_.empty()) {
+    Message* msg = output_queue_.front();
+    output_queue_.MarkFrontStarted();
+    if (message_send_bytes_written_ == 0 &&
+        !msg->file_descriptor_set()->empty()) {
+      if (!SendDescriptorsOnFDPipe(msg, &blocked))
+        return false;
+      if (blocked)
+        break;
+    }
+
+    const char* out_bytes = reinterpret_cast<const char*>(msg->data()) +
+        message_send_bytes_written_;
+    int bytes_written = send_ring_->Write(
+        out_bytes, msg->size() - message_send_bytes_written_);
+    if (bytes_written < 0) {
+      LOG(ERROR) << "Corrupt shared memory ring on channel @" << this;
+      return false;
+    }
+    if (bytes_written > 0)
+      wrote = true;
+    message_send_bytes_written_ += bytes_written;
+    if (message_send_bytes_written_ == msg->size()) {
+      message_send_bytes_written_ = 0;
+      PopSentMessage();
+      continue;
+    }
+
+    // The ring is full. Make sure the reader is draining it, then wait for
+    // it to make room unless it already has.
+    if (wrote && send_ring_->TakeReaderWaiting() &&
+        !internal::RingDoorbell(send_data_doorbell_)) {
+      return false;
+    }
+    wrote = false;
+    if (send_ring_->WaitForSpace()) {
+      blocked = true;
+      break;
+    }
+  }
+
+  if (wrote && send_ring_->TakeReaderWaiting() &&
+      !internal::RingDoorbell(send_data_doorbell_)) {
+    return false;
+  }
+  // We are woken up through |send_space_doorbell_| or, if the descriptors
+  // did not fit, through |write_watcher_|.
+  if (blocked)
+    is_blocked_on_write_ = true;
+  return true;
+}
+
+bool Channel::ChannelImpl::SendDescriptorsOnFDPipe(Message* msg,
+                                                   bool* blocked) {
+  const unsigned num_fds = msg->file_descriptor_set()->size();
+  DCHECK(num_fds <= FileDescriptorSet::kMaxDescriptorsPerMessage);
+  if (msg->file_descriptor_set()->ContainsDirectoryDescriptor()) {
+    LOG(FATAL) << "Panic: attempting to transport directory descriptor over"
+                  " IPC. Aborting to maintain sandbox isolation.";
+  }
+
+  char buf[CMSG_SPACE(
+      sizeof(int) * FileDescriptorSet::kMaxDescriptorsPerMessage)];
+  struct iovec fd_pipe_iov = { const_cast<char *>(""), 1 };
+  struct msghdr msgh = {0};
+  msgh.msg_iov = &fd_pipe_iov;
+  msgh.msg_iovlen = 1;
+  msgh.msg_control = buf;
+  msgh.msg_controllen = CMSG_SPACE(sizeof(int) * num_fds);
+  struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msgh);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(int) * num_fds);
+  msg->file_descriptor_set()->GetDescriptors(
+      reinterpret_cast<int*>(CMSG_DATA(cmsg)));
+  msgh.msg_controllen = cmsg->cmsg_len;
+  msg->header()->num_fds = static_cast<uint16>(num_fds);
+
+  ssize_t bytes_written = HANDLE_EINTR(sendmsg(fd_pipe_, &msgh, MSG_DONTWAIT));
+  send_syscall_counter_.Increment();
+  if (bytes_written < 0) {
+    if (!SocketWriteErrorIsRecoverable()) {
+      HandleWriteError(fd_pipe_, msg->size());
+      return false;
+    }
+    *blocked = true;
+    base::MessageLoopForIO::current()->WatchFileDescriptor(
+        fd_pipe_,
+        false,  // One shot
+        base::MessageLoopForIO::WATCH_WRITE,
+        &write_watcher_,
+        this);
+    return true;
+  }
+  msg->file_descriptor_set()->CommitAll();
+  return true;
+}
+
+Channel::ChannelImpl::ReadState Channel::ChannelImpl::ReadDataFromRing(
+    char* buffer,
+    int buffer_len,
+    int* bytes_read) {
+  int result = receive_ring_->Read(buffer, buffer_len);
+  // Only wait if the ring is still empty once our flag is up; otherwise the
+  // writer may have missed it.
+  if (result == 0 && !receive_ring_->WaitForData())
+    result = receive_ring_->Read(buffer, buffer_len);
+  if (result < 0) {
+    LOG(ERROR) << "Corrupt shared memory ring on channel @" << this;
+    return READ_FAILED;
+  }
+  if (result == 0)
+    return READ_PENDING;
+
+  // We found data, so the writer needn't ring for more until we wait again.
+  receive_ring_->StopWaitingForData();
+  if (receive_ring_->TakeWriterWaiting() &&
+      !internal::RingDoorbell(receive_space_doorbell_)) {
+    return READ_FAILED;
+  }
+  *bytes_read = result;
+  return READ_SUCCEEDED;
+}
+
+bool Channel::ChannelImpl::CheckPipeWhileReadingRing() {
+  char dummy;
+  ssize_t result =
+      HANDLE_EINTR(recv(pipe_, &dummy, 1, MSG_PEEK | MSG_DONTWAIT));
+  if (result < 0)
+    return errno == EAGAIN;
+  if (result > 0)
+    LOG(ERROR) << "Unexpected data on the socket of channel @" << this
+               << " after switching to the shared memory ring";
+  // Otherwise the peer hung up.
+  return false;
+}
+
+void Channel::ChannelImpl::CloseSharedMemoryRings() {
+  receive_doorbell_watcher_.StopWatchingFileDescriptor();
+  send_doorbell_watcher_.StopWatchingFileDescriptor();
+  int* doorbells[] = { &receive_data_doorbell_, &receive_space_doorbell_,
+                       &send_data_doorbell_, &send_space_doorbell_ };
+  for (size_t i = 0; i < arraysize(doorbells); ++i) {
+    if (*doorbells[i] == -1)
+      continue;
+    if (HANDLE_EINTR(close(*doorbells[i])) < 0)
+      PLOG(ERROR) << "close doorbell " << pipe_name_;
+    *doorbells[i] = -1;
+  }
+  receive_ring_.reset();
+  send_ring_.reset();
+  receive_ring_active_ = false;
+  send_ring_active_ = false;
+  // The message itself is deleted along with |output_queue_|.
+  ring_accept_message_ = NULL;
+}
+#endif  // OS_LINUX
+
 void Channel::ChannelImpl::Close() {
   // Close can be called multiple time, so we need to make sure we're
   // idempotent.
@@ -1023,6 +1481,20 @@ std::string Channel::GenerateVerifiedChannelID(const std::string& prefix) {
 void Channel::SetGlobalPid(int pid) {
   ChannelImpl::SetGlobalPid(pid);
 }
+
+// static
+void Channel::SetSharedMemoryRingEnabled(bool enabled) {
+  ChannelImpl::SetSharedMemoryRingEnabled(enabled);
+}
 #endif  // OS_LINUX
 
+// static
+void Channel::SetBatchedWritesEnabled(bool enabled) {
+  ChannelImpl::SetBatchedWritesEnabled(enabled);
+}
+
+void Channel::AddCoalescedMessageType(uint32 type) {
+  channel_impl_->AddCoalescedMessageType(type);
+}
+
 }  // namespace IPC
@@ -9,14 +9,21 @@
 
 #include <sys/socket.h>  // for CMSG macros
 
-#include <queue>
 #include <string>
 #include <vector>
 
+#include "base/atomicops.h"
 #include "base/message_loop.h"
+#include "base/metrics/stats_counters.h"
 #include "base/process.h"
 #include "ipc/file_descriptor_set_posix.h"
 #include "ipc/ipc_channel_reader.h"
+#include "ipc/ipc_output_queue.h"
+
+#if defined(OS_LINUX)
+#include "base/memory/scoped_ptr.h"
+#include "ipc/ipc_shared_memory_ring_linux.h"
+#endif
 
 #if !defined(OS_MACOSX)
 // On Linux, the seccomp sandbox makes it very expensive to call
@@ -65,29 +72,93 @@ class Channel::ChannelImpl : public internal::ChannelReader,
   bool HasAcceptedConnection() const;
   bool GetPeerEuid(uid_t* peer_euid) const;
   void ResetToAcceptingConnectionState();
+  void AddCoalescedMessageType(uint32 type);
   base::ProcessId peer_pid() const { return peer_pid_; }
   static bool IsNamedServerInitialized(const std::string& channel_id);
 #if defined(OS_LINUX)
   static void SetGlobalPid(int pid);
+  static void SetSharedMemoryRingEnabled(bool enabled);
 #endif  // OS_LINUX
+  static void SetBatchedWritesEnabled(bool enabled);
 
  private:
   bool CreatePipe(const IPC::ChannelHandle& channel_handle);
 
   bool ProcessOutgoingMessages();
 
+  // Gathers the messages at the head of |output_queue_| (up to, but not
+  // including, the next message that still has descriptors to send) into a
+  // single vectored write on |pipe_|. Fully written messages are removed from
+  // the queue and a partially written one is tracked through
+  // |message_send_bytes_written_|. |blocked| is set if the socket could not
+  // take everything. Returns false on an unrecoverable error.
+  bool WriteBatchedMessages(bool* blocked);
+
+  // Returns true if |msg| still has file descriptors that must be sent ahead
+  // of (or, in IPC_USES_READWRITE mode, alongside) its first byte.
+  bool HasUnsentDescriptors(Message* msg, bool is_front) const;
+
+  // Handles a non-recoverable error from writing to |fd_written|.
+  void HandleWriteError(int fd_written, size_t message_size);
+
+  // Asks the message loop to call us back once |pipe_| is writable again.
+  void WaitForWrite();
+
   bool AcceptConnection();
   void ClosePipeOnError();
   int GetHelloMessageProcId();
   void QueueHelloMessage();
 
+  // Removes the fully written message at the head of |output_queue_|.
+  void PopSentMessage();
+
+#if defined(OS_LINUX)
+  // Shared memory ring transport, see Channel::SetSharedMemoryRingEnabled().
+  // The side that receives through a ring creates it and offers it to the
+  // peer once the hello messages have been exchanged. The peer switches to
+  // writing into the ring after its accept message has gone out on |pipe_|,
+  // and we switch to reading from the ring when that message is dispatched.
+
+  // Creates |receive_ring_| and its doorbells and queues the offer message.
+  // Returns false if the offer could not be written to |pipe_|, which is a
+  // channel error; failing to set up the ring just keeps the socket.
+  bool QueueSharedMemoryRingOffer();
+
+  // Maps the ring offered in |msg| as |send_ring_| and queues the accept
+  // message. Returns false if the accept message could not be written.
+  bool AcceptSharedMemoryRing(const Message& msg);
+
+  // Starts reading from |receive_ring_| after the peer accepted it.
+  void ActivateReceiveRing();
+
+  // ProcessOutgoingMessages() once |send_ring_| is active.
+  bool WriteMessagesToRing();
+
+  // Sends the descriptors of |msg| on |fd_pipe_| ahead of its bytes.
+  // |blocked| is set if the socket is full. Returns false on an unrecoverable
+  // error.
+  bool SendDescriptorsOnFDPipe(Message* msg, bool* blocked);
+
+  // ReadData() once |receive_ring_| is active.
+  ReadState ReadDataFromRing(char* buffer, int buffer_len, int* bytes_read);
+
+  // Called when |pipe_| becomes readable while reading from the ring. Nothing
+  // but EOF is expected there any more. Returns false if the channel should
+  // be closed.
+  bool CheckPipeWhileReadingRing();
+
+  // Tears down both rings and closes their doorbells.
+  void CloseSharedMemoryRings();
+#endif  // OS_LINUX
+
   // ChannelReader implementation.
   virtual ReadState ReadData(char* buffer,
                              int buffer_len,
                              int* bytes_read) OVERRIDE;
   virtual bool WillDispatchInputMessage(Message* msg) OVERRIDE;
   virtual bool DidEmptyInputBuffers() OVERRIDE;
-  virtual void HandleHelloMessage(const Message& msg) OVERRIDE;
+  virtual bool HandleHelloMessage(const Message& msg) OVERRIDE;
+  virtual bool HandleInternalMessage(const Message& msg) OVERRIDE;
 
 #if defined(IPC_USES_READWRITE)
   // Reads the next message from the fd_pipe_ and appends them to the
@@ -154,7 +225,17 @@ class Channel::ChannelImpl : public internal::ChannelReader,
   std::string pipe_name_;
 
   // Messages to be sent are queued here.
-  std::queue<Message*> output_queue_;
+  internal::OutputQueue output_queue_;
+
+  // If true, ProcessOutgoingMessages() coalesces queued messages into one
+  // vectored write instead of issuing a write per message. Latched from
+  // |batched_writes_enabled_| when the channel is created.
+  bool use_batched_writes_;
+
+  // Number of write/sendmsg calls issued on |pipe_| and |fd_pipe_|, and the
+  // number of messages they carried. Only recorded when a StatsTable is set.
+  base::StatsCounter send_syscall_counter_;
+  base::StatsCounter sent_message_counter_;
 
   // We assume a worst case: kReadBufferSize bytes of messages, where each
   // message has no payload and a full complement of descriptors.
@@ -184,14 +265,46 @@ class Channel::ChannelImpl : public internal::ChannelReader,
   // implementation!
   std::vector<int> input_fds_;
 
+#if defined(OS_LINUX)
+  // Latched from |shared_memory_ring_enabled_| when the channel is created.
+  bool use_shared_memory_ring_;
+
+  // The ring the peer writes into, with the doorbell it rings after writing
+  // and the one we ring after making room.
+  scoped_ptr<internal::SharedMemoryRing> receive_ring_;
+  int receive_data_doorbell_;
+  int receive_space_doorbell_;
+  bool receive_ring_active_;
+  base::MessageLoopForIO::FileDescriptorWatcher receive_doorbell_watcher_;
+
+  // The ring the peer offered us to write into, and its doorbells.
+  scoped_ptr<internal::SharedMemoryRing> send_ring_;
+  int send_data_doorbell_;
+  int send_space_doorbell_;
+  bool send_ring_active_;
+  base::MessageLoopForIO::FileDescriptorWatcher send_doorbell_watcher_;
+
+  // The queued accept message. |send_ring_| becomes active once it has been
+  // written to |pipe_|.
+  Message* ring_accept_message_;
+#endif  // OS_LINUX
+
   // True if we are responsible for unlinking the unix domain socket file.
   bool must_unlink_;
 
 #if defined(OS_LINUX)
   // If non-zero, overrides the process ID sent in the hello message.
   static int global_pid_;
+
+  // Default for |use_shared_memory_ring_| of newly created channels, which
+  // may be created on another thread than the one that sets it.
+  static base::subtle::Atomic32 shared_memory_ring_enabled_;
 #endif  // OS_LINUX
 
+  // Default for |use_batched_writes_| of newly created channels, which may
+  // be created on another thread than the one that sets it.
+  static base::subtle::Atomic32 batched_writes_enabled_;
+
   DISALLOW_IMPLICIT_CONSTRUCTORS(ChannelImpl);
 };
 
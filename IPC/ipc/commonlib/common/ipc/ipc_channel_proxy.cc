@@ -2,6 +2,8 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <algorithm>
+
 #include "base/bind.h"
 #include "base/compiler_specific.h"
 #include "base/debug/trace_event.h"
@@ -13,6 +15,7 @@
 #include "ipc/ipc_channel_proxy.h"
 #include "ipc/ipc_listener.h"
 #include "ipc/ipc_logging.h"
+#include "ipc/ipc_message_filter_router.h"
 #include "ipc/ipc_message_macros.h"
 #include "ipc/ipc_message_utils.h"
 
@@ -36,6 +39,11 @@ bool ChannelProxy::MessageFilter::OnMessageReceived(const Message& message) {
   return false;
 }
 
+bool ChannelProxy::MessageFilter::GetSupportedMessageClasses(
+    std::vector<uint32>* supported_message_classes) const {
+  return false;
+}
+
 void ChannelProxy::MessageFilter::OnDestruct() const {
   delete this;
 }
@@ -44,17 +52,38 @@ ChannelProxy::MessageFilter::~MessageFilter() {}
 
 //------------------------------------------------------------------------------
 
+struct ChannelProxy::Context::PendingFilter {
+  explicit PendingFilter(MessageFilter* filter)
+      : filter(filter),
+        next(NULL) {
+  }
+
+  scoped_refptr<MessageFilter> filter;
+  PendingFilter* next;
+};
+
 ChannelProxy::Context::Context(Listener* listener,
                                base::SingleThreadTaskRunner* ipc_task_runner)
     : listener_task_runner_(base::ThreadTaskRunnerHandle::Get()),
       listener_(listener),
+      message_filter_router_(new MessageFilterRouter),
       ipc_task_runner_(ipc_task_runner),
       channel_connected_called_(false),
+      pending_filters_(0),
       peer_pid_(base::kNullProcessId) {
   DCHECK(ipc_task_runner_.get());
 }
 
 ChannelProxy::Context::~Context() {
+  // Filters added after the channel closed never made it to the IPC thread.
+  PendingFilter* pending = reinterpret_cast<PendingFilter*>(
+      base::subtle::NoBarrier_AtomicExchange(&pending_filters_, 0));
+  base::subtle::MemoryBarrier();
+  while (pending) {
+    PendingFilter* next = pending->next;
+    delete pending;
+    pending = next;
+  }
 }
 
 void ChannelProxy::Context::ClearIPCTaskRunner() {
@@ -75,14 +104,12 @@ bool ChannelProxy::Context::TryFilters(const Message& message) {
     logger->OnPreDispatchMessage(message);
 #endif
 
-  for (size_t i = 0; i < filters_.size(); ++i) {
-    if (filters_[i]->OnMessageReceived(message)) {
+  if (message_filter_router_->TryFilters(message)) {
 #ifdef IPC_MESSAGE_LOG_ENABLED
-      if (logger->Enabled())
-        logger->OnPostDispatchMessage(message, channel_id_);
+    if (logger->Enabled())
+      logger->OnPostDispatchMessage(message, channel_id_);
 #endif
-      return true;
-    }
+    return true;
   }
   return false;
 }
@@ -142,6 +169,11 @@ void ChannelProxy::Context::OnChannelOpened() {
   // will be released when we are closed.
   AddRef();
 
+  for (std::set<uint32>::const_iterator it = coalesced_message_types_.begin();
+       it != coalesced_message_types_.end(); ++it) {
+    channel_->AddCoalescedMessageType(*it);
+  }
+
   if (!channel_->Connect()) {
     OnChannelError();
     return;
@@ -164,6 +196,7 @@ void ChannelProxy::Context::OnChannelClosed() {
   }
 
   // We don't need the filters anymore.
+  message_filter_router_->Clear();
   filters_.clear();
 
   channel_.reset();
@@ -189,14 +222,25 @@ void ChannelProxy::Context::OnSendMessage(scoped_ptr<Message> message) {
 
 // Called on the IPC::Channel thread
 void ChannelProxy::Context::OnAddFilter() {
+  PendingFilter* pending = reinterpret_cast<PendingFilter*>(
+      base::subtle::NoBarrier_AtomicExchange(&pending_filters_, 0));
+  // Pairs with the release in AddFilter().
+  base::subtle::MemoryBarrier();
+
+  // The stack has the newest filter on top; add them in the order they were
+  // added on the listener thread.
   std::vector<scoped_refptr<MessageFilter> > new_filters;
-  {
-    base::AutoLock auto_lock(pending_filters_lock_);
-    new_filters.swap(pending_filters_);
+  while (pending) {
+    new_filters.push_back(pending->filter);
+    PendingFilter* next = pending->next;
+    delete pending;
+    pending = next;
   }
+  std::reverse(new_filters.begin(), new_filters.end());
 
   for (size_t i = 0; i < new_filters.size(); ++i) {
     filters_.push_back(new_filters[i]);
+    message_filter_router_->AddFilter(new_filters[i].get());
 
     // If the channel has already been created, then we need to send this
     // message so that the filter gets access to the Channel.
@@ -208,10 +252,18 @@ void ChannelProxy::Context::OnAddFilter() {
   }
 }
 
+// Called on the IPC::Channel thread
+void ChannelProxy::Context::OnAddCoalescedMessageType(uint32 type) {
+  coalesced_message_types_.insert(type);
+  if (channel_.get())
+    channel_->AddCoalescedMessageType(type);
+}
+
 // Called on the IPC::Channel thread
 void ChannelProxy::Context::OnRemoveFilter(MessageFilter* filter) {
   for (size_t i = 0; i < filters_.size(); ++i) {
     if (filters_[i].get() == filter) {
+      message_filter_router_->RemoveFilter(filter);
       filter->OnFilterRemoved();
       filters_.erase(filters_.begin() + i);
       return;
@@ -223,8 +275,14 @@ void ChannelProxy::Context::OnRemoveFilter(MessageFilter* filter) {
 
 // Called on the listener's thread
 void ChannelProxy::Context::AddFilter(MessageFilter* filter) {
-  base::AutoLock auto_lock(pending_filters_lock_);
-  pending_filters_.push_back(make_scoped_refptr(filter));
+  PendingFilter* pending = new PendingFilter(filter);
+  base::subtle::AtomicWord head;
+  do {
+    head = base::subtle::NoBarrier_Load(&pending_filters_);
+    pending->next = reinterpret_cast<PendingFilter*>(head);
+  } while (base::subtle::Release_CompareAndSwap(
+               &pending_filters_, head,
+               reinterpret_cast<base::subtle::AtomicWord>(pending)) != head);
   ipc_task_runner_->PostTask(
       FROM_HERE, base::Bind(&Context::OnAddFilter, this));
 }
@@ -387,6 +445,14 @@ void ChannelProxy::RemoveFilter(MessageFilter* filter) {
                             make_scoped_refptr(filter)));
 }
 
+void ChannelProxy::AddCoalescedMessageType(uint32 type) {
+  DCHECK(CalledOnValidThread());
+
+  context_->ipc_task_runner()->PostTask(
+      FROM_HERE, base::Bind(&Context::OnAddCoalescedMessageType,
+                            context_.get(), type));
+}
+
 void ChannelProxy::ClearIPCTaskRunner() {
   DCHECK(CalledOnValidThread());
 
@@ -5,11 +5,12 @@
 #ifndef IPC_IPC_CHANNEL_PROXY_H_
 #define IPC_IPC_CHANNEL_PROXY_H_
 
+#include <set>
 #include <vector>
 
+#include "base/atomicops.h"
 #include "base/memory/ref_counted.h"
 #include "base/memory/scoped_ptr.h"
-#include "base/synchronization/lock.h"
 #include "base/threading/non_thread_safe.h"
 #include "ipc/ipc_channel.h"
 #include "ipc/ipc_channel_handle.h"
@@ -22,6 +23,7 @@ class SingleThreadTaskRunner;
 
 namespace IPC {
 
+class MessageFilterRouter;
 class SendCallbackHelper;
 
 //-----------------------------------------------------------------------------
@@ -89,6 +91,13 @@ class IPC_EXPORT ChannelProxy : public Sender, public base::NonThreadSafe {
     // the message be handled in the default way.
     virtual bool OnMessageReceived(const Message& message);
 
+    // Called on the background thread when the filter is added. Return true
+    // and fill in the message classes (IPC_MESSAGE_ID_CLASS) of the messages
+    // the filter handles to have OnMessageReceived called only for those.
+    // The default returns false, which offers the filter every message.
+    virtual bool GetSupportedMessageClasses(
+        std::vector<uint32>* supported_message_classes) const;
+
     // Called when the message filter is about to be deleted.  This gives
     // derived classes the option of controlling which thread they're deleted
     // on etc.
@@ -166,6 +175,12 @@ class IPC_EXPORT ChannelProxy : public Sender, public base::NonThreadSafe {
   void AddFilter(MessageFilter* filter);
   void RemoveFilter(MessageFilter* filter);
 
+  // Lets a newer outgoing message of |type| replace one with the same
+  // priority and routing id that is still queued on the IPC thread. See
+  // Channel::AddCoalescedMessageType(). Like AddFilter(), this takes effect
+  // asynchronously; call it before sending messages of |type|.
+  void AddCoalescedMessageType(uint32 type);
+
   void set_outgoing_message_filter(OutgoingMessageFilter* filter) {
     outgoing_message_filter_ = filter;
   }
@@ -241,6 +256,7 @@ class IPC_EXPORT ChannelProxy : public Sender, public base::NonThreadSafe {
     void OnSendMessage(scoped_ptr<Message> message_ptr);
     void OnAddFilter();
     void OnRemoveFilter(MessageFilter* filter);
+    void OnAddCoalescedMessageType(uint32 type);
 
     // Methods called on the listener thread.
     void AddFilter(MessageFilter* filter);
@@ -252,20 +268,27 @@ class IPC_EXPORT ChannelProxy : public Sender, public base::NonThreadSafe {
 
     // List of filters.  This is only accessed on the IPC thread.
     std::vector<scoped_refptr<MessageFilter> > filters_;
+    // Dispatch table for filters_.  Also only accessed on the IPC thread.
+    scoped_ptr<MessageFilterRouter> message_filter_router_;
     scoped_refptr<base::SingleThreadTaskRunner> ipc_task_runner_;
     scoped_ptr<Channel> channel_;
     std::string channel_id_;
     bool channel_connected_called_;
 
     // Holds filters between the AddFilter call on the listerner thread and the
-    // IPC thread when they're added to filters_.
-    std::vector<scoped_refptr<MessageFilter> > pending_filters_;
-    // Lock for pending_filters_.
-    base::Lock pending_filters_lock_;
+    // IPC thread when they're added to filters_.  This is a PendingFilter*
+    // pointing to a lock-free stack: AddFilter pushes with a compare-and-swap
+    // and OnAddFilter takes the whole stack with an exchange.
+    struct PendingFilter;
+    base::subtle::AtomicWord pending_filters_;
 
     // Cached copy of the peer process ID. Set on IPC but read on both IPC and
     // listener threads.
     base::ProcessId peer_pid_;
+
+    // Message types passed to AddCoalescedMessageType(), kept to configure
+    // the channel once it is opened. Only accessed on the IPC thread.
+    std::set<uint32> coalesced_message_types_;
   };
 
   Context* context() { return context_.get(); }
@@ -4,6 +4,7 @@
 
 #include "ipc/ipc_channel_reader.h"
 
+#include "base/atomicops.h"
 #include "ipc/ipc_listener.h"
 #include "ipc/ipc_logging.h"
 #include "ipc/ipc_message_macros.h"
@@ -11,7 +12,25 @@
 namespace IPC {
 namespace internal {
 
-ChannelReader::ChannelReader(Listener* listener) : listener_(listener) {
+namespace {
+
+// Default for ChannelReader::use_large_message_buf_. Channels are created on
+// any thread, so it may be read while SetLargeMessageBufferEnabled() runs.
+base::subtle::Atomic32 g_large_message_buffer_enabled = 1;
+
+// A large message buffer that grew past this size is released after its
+// message has been dispatched rather than kept for reuse.
+const size_t kMaxRetainedLargeMessageBufSize = 1024 * 1024;
+
+}  // namespace
+
+ChannelReader::ChannelReader(Listener* listener)
+    : listener_(listener),
+      use_large_message_buf_(
+          base::subtle::NoBarrier_Load(&g_large_message_buffer_enabled) != 0),
+      large_message_buf_capacity_(0),
+      large_message_size_(0),
+      large_message_bytes_read_(0) {
   memset(input_buf_, 0, sizeof(input_buf_));
 }
 
@@ -21,7 +40,7 @@ ChannelReader::~ChannelReader() {
 bool ChannelReader::ProcessIncomingMessages() {
   while (true) {
     int bytes_read = 0;
-    ReadState read_state = ReadData(input_buf_, Channel::kReadBufferSize,
+    ReadState read_state = ReadData(read_target(), read_target_len(),
                                     &bytes_read);
     if (read_state == READ_FAILED)
       return false;
@@ -29,12 +48,16 @@ bool ChannelReader::ProcessIncomingMessages() {
       return true;
 
     DCHECK(bytes_read > 0);
-    if (!DispatchInputData(input_buf_, bytes_read))
+    if (!AsyncReadComplete(bytes_read))
       return false;
   }
 }
 
 bool ChannelReader::AsyncReadComplete(int bytes_read) {
+  // A read is issued into |large_message_buf_| only while a large message is
+  // in progress, and that state does not change until the read completes.
+  if (large_message_size_)
+    return LargeMessageReadComplete(bytes_read);
   return DispatchInputData(input_buf_, bytes_read);
 }
 
@@ -43,6 +66,23 @@ bool ChannelReader::IsHelloMessage(const Message& m) const {
          m.type() == Channel::HELLO_MESSAGE_TYPE;
 }
 
+bool ChannelReader::IsInternalMessage(const Message& m) const {
+  return m.routing_id() == MSG_ROUTING_NONE &&
+         m.type() >= Channel::FIRST_INTERNAL_MESSAGE_TYPE &&
+         m.type() < Channel::HELLO_MESSAGE_TYPE;
+}
+
+bool ChannelReader::HandleInternalMessage(const Message& msg) {
+  DLOG(WARNING) << "Dropping internal message of type " << msg.type();
+  return true;
+}
+
+// static
+void ChannelReader::SetLargeMessageBufferEnabled(bool enabled) {
+  base::subtle::NoBarrier_Store(&g_large_message_buffer_enabled,
+                                enabled ? 1 : 0);
+}
+
 bool ChannelReader::DispatchInputData(const char* input_data,
                                       int input_data_len) {
   const char* p;
@@ -70,24 +110,8 @@ bool ChannelReader::DispatchInputData(const char* input_data,
     if (message_tail) {
       int len = static_cast<int>(message_tail - p);
       Message m(p, len);
-      if (!WillDispatchInputMessage(&m))
+      if (!DispatchMessage(&m))
         return false;
-
-#ifdef IPC_MESSAGE_LOG_ENABLED
-      Logging* logger = Logging::GetInstance();
-      std::string name;
-      logger->GetMessageText(m.type(), &name, &m, NULL);
-      TRACE_EVENT1("ipc", "ChannelReader::DispatchInputData", "name", name);
-#else
-      TRACE_EVENT2("ipc", "ChannelReader::DispatchInputData",
-                   "class", IPC_MESSAGE_ID_CLASS(m.type()),
-                   "line", IPC_MESSAGE_ID_LINE(m.type()));
-#endif
-      m.TraceMessageEnd();
-      if (IsHelloMessage(m))
-        HandleHelloMessage(m);
-      else
-        listener_->OnMessageReceived(m);
       p = message_tail;
     } else {
       // Last message is partial.
@@ -95,6 +119,13 @@ bool ChannelReader::DispatchInputData(const char* input_data,
     }
   }
 
+  // Move the beginning of a large message to its own buffer so the rest of it
+  // can be read in place. Anything else partial goes to the overflow buffer.
+  if (p < end && BeginLargeMessage(p, end - p)) {
+    input_overflow_buf_.clear();
+    return true;
+  }
+
   // Save any partial data in the overflow buffer.
   input_overflow_buf_.assign(p, end - p);
 
@@ -103,6 +134,95 @@ bool ChannelReader::DispatchInputData(const char* input_data,
   return true;
 }
 
+bool ChannelReader::DispatchMessage(Message* m) {
+  if (!WillDispatchInputMessage(m))
+    return false;
+
+#ifdef IPC_MESSAGE_LOG_ENABLED
+  Logging* logger = Logging::GetInstance();
+  std::string name;
+  logger->GetMessageText(m->type(), &name, m, NULL);
+  TRACE_EVENT1("ipc", "ChannelReader::DispatchInputData", "name", name);
+#else
+  TRACE_EVENT2("ipc", "ChannelReader::DispatchInputData",
+               "class", IPC_MESSAGE_ID_CLASS(m->type()),
+               "line", IPC_MESSAGE_ID_LINE(m->type()));
+#endif
+  m->TraceMessageEnd();
+  if (IsHelloMessage(*m))
+    return HandleHelloMessage(*m);
+  if (IsInternalMessage(*m))
+    return HandleInternalMessage(*m);
+  listener_->OnMessageReceived(*m);
+  return true;
+}
+
+bool ChannelReader::BeginLargeMessage(const char* data, size_t len) {
+  DCHECK(!large_message_size_);
+  if (!use_large_message_buf_)
+    return false;
+
+  size_t message_size = Message::GetMessageSize(data, data + len);
+  // Let the overflow path deal with small messages, with sizes it is going to
+  // reject anyway, and with data that does not even hold a header yet.
+  if (message_size <= Channel::kReadBufferSize ||
+      message_size > Channel::kMaximumMessageSize ||
+      message_size <= len) {
+    return false;
+  }
+
+  if (large_message_buf_capacity_ < message_size) {
+    // The old contents are not needed, so don't bother with a realloc().
+    large_message_buf_.reset(new char[message_size]);
+    large_message_buf_capacity_ = message_size;
+  }
+  memcpy(large_message_buf_.get(), data, len);
+  large_message_size_ = message_size;
+  large_message_bytes_read_ = len;
+  return true;
+}
+
+bool ChannelReader::LargeMessageReadComplete(int bytes_read) {
+  DCHECK(large_message_size_);
+  DCHECK_LE(large_message_bytes_read_ + bytes_read, large_message_size_);
+  large_message_bytes_read_ += bytes_read;
+  if (large_message_bytes_read_ < large_message_size_)
+    return true;
+
+  size_t message_size = large_message_size_;
+  large_message_size_ = 0;
+  large_message_bytes_read_ = 0;
+
+  {
+    // The message only references |large_message_buf_|, so it has to go away
+    // before the buffer can be released.
+    Message m(large_message_buf_.get(), static_cast<int>(message_size));
+    if (!DispatchMessage(&m))
+      return false;
+  }
+
+  if (large_message_buf_capacity_ > kMaxRetainedLargeMessageBufSize) {
+    large_message_buf_.reset();
+    large_message_buf_capacity_ = 0;
+  }
+
+  // Reads into |large_message_buf_| never go past the end of the message,
+  // so both input buffers are empty now.
+  return DidEmptyInputBuffers();
+}
+
+char* ChannelReader::read_target() {
+  if (large_message_size_)
+    return large_message_buf_.get() + large_message_bytes_read_;
+  return input_buf_;
+}
+
+int ChannelReader::read_target_len() const {
+  if (large_message_size_)
+    return static_cast<int>(large_message_size_ - large_message_bytes_read_);
+  return Channel::kReadBufferSize;
+}
+
 
 }  // namespace internal
 }  // namespace IPC
@@ -6,6 +6,7 @@
 #define IPC_IPC_CHANNEL_READER_H_
 
 #include "base/basictypes.h"
+#include "base/memory/scoped_ptr.h"
 #include "ipc/ipc_channel.h"
 
 namespace IPC {
@@ -46,6 +47,16 @@ class ChannelReader {
   // set-up.
   bool IsHelloMessage(const Message& m) const;
 
+  // Returns true if the given message is one of the other messages channels
+  // exchange among themselves (see Channel::FIRST_INTERNAL_MESSAGE_TYPE).
+  bool IsInternalMessage(const Message& m) const;
+
+  // Enables or disables reading messages larger than the read buffer straight
+  // into a buffer sized from their header (see |large_message_buf_|). When
+  // disabled, such messages are reassembled in |input_overflow_buf_|. Enabled
+  // by default; affects readers created afterwards.
+  static void SetLargeMessageBufferEnabled(bool enabled);
+
  protected:
   enum ReadState { READ_SUCCEEDED, READ_FAILED, READ_PENDING };
 
@@ -77,7 +88,12 @@ class ChannelReader {
   virtual bool DidEmptyInputBuffers() = 0;
 
   // Handles the first message sent over the pipe which contains setup info.
-  virtual void HandleHelloMessage(const Message& msg) = 0;
+  // Returns false on a fatal channel error.
+  virtual bool HandleHelloMessage(const Message& msg) = 0;
+
+  // Handles a message for which IsInternalMessage() is true. Returns false on
+  // a fatal channel error. The default implementation drops it.
+  virtual bool HandleInternalMessage(const Message& msg);
 
  private:
   // Takes the given data received from the IPC channel and dispatches any
@@ -86,6 +102,25 @@ class ChannelReader {
   // Returns true on success. False means channel error.
   bool DispatchInputData(const char* input_data, int input_data_len);
 
+  // Runs a single complete message through WillDispatchInputMessage() and
+  // hands it to the listener. Returns false on channel error.
+  bool DispatchMessage(Message* m);
+
+  // Called when |len| bytes starting at |data| hold the beginning of a message
+  // that does not fit in the read buffer. Sizes |large_message_buf_| from the
+  // header and copies the bytes there so the rest of the message can be read
+  // in place. Returns false if |data| should stay in |input_overflow_buf_|.
+  bool BeginLargeMessage(const char* data, size_t len);
+
+  // Accounts for |bytes_read| bytes that were read into |large_message_buf_|
+  // and dispatches the message once it is complete. Returns false on channel
+  // error.
+  bool LargeMessageReadComplete(int bytes_read);
+
+  // Where the next ReadData() call should put its data.
+  char* read_target();
+  int read_target_len() const;
+
   Listener* listener_;
 
   // We read from the pipe into this buffer. Managed by DispatchInputData, do
@@ -96,6 +131,22 @@ class ChannelReader {
   // this buffer.
   std::string input_overflow_buf_;
 
+  // Whether messages larger than the read buffer go to |large_message_buf_|.
+  bool use_large_message_buf_;
+
+  // Contiguous storage for a message larger than |input_buf_|. It is sized
+  // from the message header, the pipe is read straight into it and the
+  // message is dispatched from it without being copied again. The buffer is
+  // kept around for the next large message unless it grew past
+  // kMaxRetainedLargeMessageBufSize.
+  scoped_ptr<char[]> large_message_buf_;
+  size_t large_message_buf_capacity_;
+
+  // Total size of the message being read into |large_message_buf_| (0 if
+  // none) and the number of its bytes received so far.
+  size_t large_message_size_;
+  size_t large_message_bytes_read_;
+
   DISALLOW_COPY_AND_ASSIGN(ChannelReader);
 };
 
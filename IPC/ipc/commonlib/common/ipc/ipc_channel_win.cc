@@ -73,11 +73,7 @@ void Channel::ChannelImpl::Close() {
     MessageLoopForIO::current()->WaitForIOCompletion(INFINITE, this);
   }
 
-  while (!output_queue_.empty()) {
-    Message* m = output_queue_.front();
-    output_queue_.pop();
-    delete m;
-  }
+  output_queue_.Clear();
 }
 
 bool Channel::ChannelImpl::Send(Message* message) {
@@ -91,7 +87,7 @@ bool Channel::ChannelImpl::Send(Message* message) {
 #endif
 
   message->TraceMessageBegin();
-  output_queue_.push(message);
+  output_queue_.Push(message);
   // ensure waiting to write
   if (!waiting_connect_) {
     if (!output_state_.is_pending) {
@@ -103,6 +99,10 @@ bool Channel::ChannelImpl::Send(Message* message) {
   return true;
 }
 
+void Channel::ChannelImpl::AddCoalescedMessageType(uint32 type) {
+  output_queue_.AddCoalescedType(type);
+}
+
 // static
 bool Channel::ChannelImpl::IsNamedServerInitialized(
     const std::string& channel_id) {
@@ -152,7 +152,7 @@ bool Channel::ChannelImpl::WillDispatchInputMessage(Message* msg) {
   return true;
 }
 
-void Channel::ChannelImpl::HandleHelloMessage(const Message& msg) {
+bool Channel::ChannelImpl::HandleHelloMessage(const Message& msg) {
   // The hello message contains one parameter containing the PID.
   PickleIterator it(msg);
   int32 claimed_pid;
@@ -167,13 +167,14 @@ void Channel::ChannelImpl::HandleHelloMessage(const Message& msg) {
     NOTREACHED();
     Close();
     listener()->OnChannelError();
-    return;
+    return false;
   }
 
   peer_pid_ = claimed_pid;
   // Validation completed.
   validate_client_ = false;
   listener()->OnChannelConnected(claimed_pid);
+  return true;
 }
 
 bool Channel::ChannelImpl::DidEmptyInputBuffers() {
@@ -281,7 +282,7 @@ bool Channel::ChannelImpl::CreatePipe(const IPC::ChannelHandle &channel_handle,
     return false;
   }
 
-  output_queue_.push(m.release());
+  output_queue_.Push(m.release());
   return true;
 }
 
@@ -373,7 +374,7 @@ bool Channel::ChannelImpl::ProcessOutgoingMessages(
     // Message was sent.
     DCHECK(!output_queue_.empty());
     Message* m = output_queue_.front();
-    output_queue_.pop();
+    output_queue_.pop_front();
     delete m;
   }
 
@@ -385,6 +386,7 @@ bool Channel::ChannelImpl::ProcessOutgoingMessages(
 
   // Write to pipe...
   Message* m = output_queue_.front();
+  output_queue_.MarkFrontStarted();
   DCHECK(m->size() <= INT_MAX);
   BOOL ok = WriteFile(pipe_,
                       m->data(),
@@ -489,6 +491,10 @@ bool Channel::Send(Message* message) {
   return channel_impl_->Send(message);
 }
 
+void Channel::AddCoalescedMessageType(uint32 type) {
+  channel_impl_->AddCoalescedMessageType(type);
+}
+
 // static
 bool Channel::IsNamedServerInitialized(const std::string& channel_id) {
   return ChannelImpl::IsNamedServerInitialized(channel_id);
@@ -7,13 +7,13 @@
 
 #include "ipc/ipc_channel.h"
 
-#include <queue>
 #include <string>
 
 #include "base/memory/scoped_ptr.h"
 #include "base/memory/weak_ptr.h"
 #include "base/message_loop.h"
 #include "ipc/ipc_channel_reader.h"
+#include "ipc/ipc_output_queue.h"
 
 namespace base {
 class ThreadChecker;
@@ -31,6 +31,7 @@ class Channel::ChannelImpl : public internal::ChannelReader,
   bool Connect();
   void Close();
   bool Send(Message* message);
+  void AddCoalescedMessageType(uint32 type);
   static bool IsNamedServerInitialized(const std::string& channel_id);
   base::ProcessId peer_pid() const { return peer_pid_; }
 
@@ -41,7 +42,7 @@ class Channel::ChannelImpl : public internal::ChannelReader,
                              int* bytes_read) OVERRIDE;
   virtual bool WillDispatchInputMessage(Message* msg) OVERRIDE;
   bool DidEmptyInputBuffers() OVERRIDE;
-  virtual void HandleHelloMessage(const Message& msg) OVERRIDE;
+  virtual bool HandleHelloMessage(const Message& msg) OVERRIDE;
 
   static const string16 PipeName(const std::string& channel_id,
                                  int32* secret);
@@ -72,7 +73,7 @@ class Channel::ChannelImpl : public internal::ChannelReader,
   base::ProcessId peer_pid_;
 
   // Messages to be sent are queued here.
-  std::queue<Message*> output_queue_;
+  internal::OutputQueue output_queue_;
 
   // In server-mode, we have to wait for the client to connect before we
   // can begin reading.  We make use of the input_state_ when performing
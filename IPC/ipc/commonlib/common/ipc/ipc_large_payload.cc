@@ -0,0 +1,147 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ipc/ipc_large_payload.h"
+
+#include <string.h>
+
+#include <vector>
+
+#include "base/atomicops.h"
+#include "base/logging.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/shared_memory.h"
+
+namespace IPC {
+
+namespace {
+
+// Read by every thread that creates a LargePayload, so that
+// SetOutOfBandThreshold() can be called while they run.
+base::subtle::AtomicWord g_out_of_band_threshold =
+    LargePayload::kDefaultOutOfBandThreshold;
+
+size_t OutOfBandThreshold() {
+  return static_cast<size_t>(
+      base::subtle::NoBarrier_Load(&g_out_of_band_threshold));
+}
+
+}  // namespace
+
+// Holds the bytes of a payload, either on the heap or in a mapped shared
+// memory segment.
+class LargePayload::Storage : public base::RefCountedThreadSafe<Storage> {
+ public:
+  Storage(const char* data, size_t size)
+      : heap_data_(data, data + size),
+        size_(size) {
+  }
+
+  Storage(base::SharedMemory* shared_memory, size_t size)
+      : shared_memory_(shared_memory),
+        size_(size) {
+    DCHECK(shared_memory_->memory());
+  }
+
+  const char* data() const {
+    if (shared_memory_)
+      return static_cast<const char*>(shared_memory_->memory());
+    return heap_data_.empty() ? NULL : &heap_data_.front();
+  }
+
+  size_t size() const { return size_; }
+
+  base::SharedMemory* shared_memory() const { return shared_memory_.get(); }
+
+ private:
+  friend class base::RefCountedThreadSafe<Storage>;
+
+  ~Storage() {}
+
+  std::vector<char> heap_data_;
+  scoped_ptr<base::SharedMemory> shared_memory_;
+  size_t size_;
+
+  DISALLOW_COPY_AND_ASSIGN(Storage);
+};
+
+LargePayload::LargePayload() {
+}
+
+LargePayload::LargePayload(const char* data, size_t size) {
+#if defined(OS_POSIX)
+  if (size && size >= OutOfBandThreshold()) {
+    scoped_ptr<base::SharedMemory> shared_memory(new base::SharedMemory);
+    if (shared_memory->CreateAndMapAnonymous(size)) {
+      memcpy(shared_memory->memory(), data, size);
+      storage_ = new Storage(shared_memory.release(), size);
+      return;
+    }
+    // Fall back to sending the bytes inline.
+    DLOG(WARNING) << "Unable to put a payload of " << size
+                  << " bytes in shared memory";
+  }
+#endif  // defined(OS_POSIX)
+  storage_ = new Storage(data, size);
+}
+
+LargePayload::LargePayload(const std::string& data) {
+  *this = LargePayload(data.data(), data.size());
+}
+
+LargePayload::LargePayload(const LargePayload& other)
+    : storage_(other.storage_) {
+}
+
+LargePayload::LargePayload(Storage* storage) : storage_(storage) {
+}
+
+LargePayload::~LargePayload() {
+}
+
+LargePayload& LargePayload::operator=(const LargePayload& other) {
+  storage_ = other.storage_;
+  return *this;
+}
+
+const char* LargePayload::data() const {
+  return storage_ ? storage_->data() : NULL;
+}
+
+size_t LargePayload::size() const {
+  return storage_ ? storage_->size() : 0;
+}
+
+bool LargePayload::is_shared() const {
+  return shared_memory() != NULL;
+}
+
+// static
+void LargePayload::SetOutOfBandThreshold(size_t threshold) {
+  base::subtle::NoBarrier_Store(
+      &g_out_of_band_threshold,
+      static_cast<base::subtle::AtomicWord>(threshold));
+}
+
+// static
+size_t LargePayload::out_of_band_threshold() {
+  return OutOfBandThreshold();
+}
+
+// static
+LargePayload LargePayload::CopyToHeap(const char* data, size_t size) {
+  return LargePayload(new Storage(data, size));
+}
+
+// static
+LargePayload LargePayload::WrapSharedMemory(base::SharedMemory* shared_memory,
+                                            size_t size) {
+  return LargePayload(new Storage(shared_memory, size));
+}
+
+base::SharedMemory* LargePayload::shared_memory() const {
+  return storage_ ? storage_->shared_memory() : NULL;
+}
+
+}  // namespace IPC
@@ -0,0 +1,82 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef IPC_IPC_LARGE_PAYLOAD_H_
+#define IPC_IPC_LARGE_PAYLOAD_H_
+
+#include <string>
+
+#include "base/basictypes.h"
+#include "base/memory/ref_counted.h"
+#include "ipc/ipc_export.h"
+#include "ipc/ipc_param_traits.h"
+
+namespace base {
+class SharedMemory;
+}
+
+namespace IPC {
+
+// An immutable byte buffer for bulky message parameters.
+//
+// On POSIX, a payload of at least out_of_band_threshold() bytes is copied
+// into an anonymous base::SharedMemory segment when it is created, and
+// sending it only passes the segment's descriptor along with the message.
+// The receiver maps the segment read-only, so the bytes are never copied
+// through the socket or out of the message. Smaller payloads, and all
+// payloads on other platforms, are written inline like a std::vector<char>.
+//
+// The sender keeps its mapping of the segment. A receiver that does not
+// trust the sender must copy out whatever it validates before relying on it.
+//
+// Copies of a LargePayload share the same bytes.
+class IPC_EXPORT LargePayload {
+ public:
+  // Default value of out_of_band_threshold().
+  static const size_t kDefaultOutOfBandThreshold = 64 * 1024;
+
+  LargePayload();
+  LargePayload(const char* data, size_t size);
+  explicit LargePayload(const std::string& data);
+  LargePayload(const LargePayload& other);
+  ~LargePayload();
+
+  LargePayload& operator=(const LargePayload& other);
+
+  const char* data() const;
+  size_t size() const;
+  bool empty() const { return size() == 0; }
+
+  // Returns true if the bytes are held in shared memory and will be sent out
+  // of band.
+  bool is_shared() const;
+
+  // Sets the size from which payloads created afterwards are put in shared
+  // memory.
+  static void SetOutOfBandThreshold(size_t threshold);
+  static size_t out_of_band_threshold();
+
+ private:
+  friend struct ParamTraits<LargePayload>;
+  class Storage;
+
+  explicit LargePayload(Storage* storage);
+
+  // Copies |size| bytes from |data| into a heap buffer, whatever their size.
+  static LargePayload CopyToHeap(const char* data, size_t size);
+
+  // Wraps a mapped segment received from the peer. Takes ownership of
+  // |shared_memory|.
+  static LargePayload WrapSharedMemory(base::SharedMemory* shared_memory,
+                                       size_t size);
+
+  // The shared memory the bytes live in, or NULL.
+  base::SharedMemory* shared_memory() const;
+
+  scoped_refptr<Storage> storage_;
+};
+
+}  // namespace IPC
+
+#endif  // IPC_IPC_LARGE_PAYLOAD_H_
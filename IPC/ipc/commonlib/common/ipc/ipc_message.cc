@@ -152,6 +152,12 @@ bool Message::HasFileDescriptors() const {
   return file_descriptor_set_.get() && !file_descriptor_set_->empty();
 }
 
+bool Message::CanWriteFileDescriptor() const {
+  return !file_descriptor_set_.get() ||
+         file_descriptor_set_->size() <
+             FileDescriptorSet::kMaxDescriptorsPerMessage;
+}
+
 void Message::EnsureFileDescriptorSet() {
   if (file_descriptor_set_.get() == NULL)
     file_descriptor_set_ = new FileDescriptorSet;
@@ -179,6 +179,17 @@ class IPC_EXPORT Message : public Pickle {
     return Pickle::FindNext(sizeof(Header), range_start, range_end);
   }
 
+  // Returns the total size, header included, of the message that starts at
+  // range_start, as announced by its header. Returns 0 if the range is too
+  // short to hold a header.
+  static size_t GetMessageSize(const char* range_start,
+                               const char* range_end) {
+    if (static_cast<size_t>(range_end - range_start) < sizeof(Header))
+      return 0;
+    return sizeof(Header) +
+        reinterpret_cast<const Header*>(range_start)->payload_size;
+  }
+
 #if defined(OS_POSIX)
   // On POSIX, a message supports reading / writing FileDescriptor objects.
   // This is used to pass a file descriptor to the peer of an IPC channel.
@@ -193,6 +204,9 @@ class IPC_EXPORT Message : public Pickle {
 
   // Returns true if there are any file descriptors in this message.
   bool HasFileDescriptors() const;
+
+  // Returns true if WriteFileDescriptor() has room for another descriptor.
+  bool CanWriteFileDescriptor() const;
 #endif
 
 #ifdef IPC_MESSAGE_LOG_ENABLED
@@ -0,0 +1,81 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ipc/ipc_message_filter_router.h"
+
+#include <algorithm>
+
+#include "base/logging.h"
+#include "ipc/ipc_message_macros.h"
+
+namespace IPC {
+
+namespace {
+
+bool TryFiltersImpl(const std::vector<ChannelProxy::MessageFilter*>& filters,
+                    const Message& message) {
+  for (size_t i = 0; i < filters.size(); ++i) {
+    if (filters[i]->OnMessageReceived(message))
+      return true;
+  }
+  return false;
+}
+
+void RemoveFilterImpl(std::vector<ChannelProxy::MessageFilter*>* filters,
+                      ChannelProxy::MessageFilter* filter) {
+  filters->erase(std::remove(filters->begin(), filters->end(), filter),
+                 filters->end());
+}
+
+}  // namespace
+
+MessageFilterRouter::MessageFilterRouter() {
+}
+
+MessageFilterRouter::~MessageFilterRouter() {
+}
+
+void MessageFilterRouter::AddFilter(MessageFilter* filter) {
+  filters_.push_back(filter);
+
+  std::vector<uint32> supported_message_classes;
+  if (!filter->GetSupportedMessageClasses(&supported_message_classes)) {
+    for (size_t i = 0; i < arraysize(message_class_filters_); ++i)
+      message_class_filters_[i].push_back(filter);
+    return;
+  }
+
+  for (size_t i = 0; i < supported_message_classes.size(); ++i) {
+    uint32 message_class = supported_message_classes[i];
+    if (message_class >= arraysize(message_class_filters_)) {
+      NOTREACHED() << "Unknown message class " << message_class;
+      continue;
+    }
+    MessageFilters& class_filters = message_class_filters_[message_class];
+    // Tolerate a class listed twice.
+    if (class_filters.empty() || class_filters.back() != filter)
+      class_filters.push_back(filter);
+  }
+}
+
+void MessageFilterRouter::RemoveFilter(MessageFilter* filter) {
+  RemoveFilterImpl(&filters_, filter);
+  for (size_t i = 0; i < arraysize(message_class_filters_); ++i)
+    RemoveFilterImpl(&message_class_filters_[i], filter);
+}
+
+bool MessageFilterRouter::TryFilters(const Message& message) {
+  uint32 message_class = IPC_MESSAGE_ID_CLASS(message.type());
+  if (message_class >= arraysize(message_class_filters_))
+    return TryFiltersImpl(filters_, message);
+  return TryFiltersImpl(message_class_filters_[message_class], message);
+}
+
+void MessageFilterRouter::Clear() {
+  filters_.clear();
+  for (size_t i = 0; i < arraysize(message_class_filters_); ++i)
+    message_class_filters_[i].clear();
+}
+
+}  // namespace IPC
@@ -0,0 +1,55 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef IPC_IPC_MESSAGE_FILTER_ROUTER_H_
+#define IPC_IPC_MESSAGE_FILTER_ROUTER_H_
+
+#include <vector>
+
+#include "base/basictypes.h"
+#include "ipc/ipc_channel_proxy.h"
+#include "ipc/ipc_message_start.h"
+
+namespace IPC {
+
+// Routes incoming messages to the ChannelProxy::MessageFilters interested in
+// their message class (IPC_MESSAGE_ID_CLASS).
+//
+// A filter whose GetSupportedMessageClasses() returns false is offered every
+// message. The filters interested in a message are still tried in the order
+// they were added, so routing never changes which filter handles a message.
+//
+// Doesn't hold references to the filters; the owner keeps them alive while
+// they are added.
+class IPC_EXPORT MessageFilterRouter {
+ public:
+  typedef ChannelProxy::MessageFilter MessageFilter;
+
+  MessageFilterRouter();
+  ~MessageFilterRouter();
+
+  void AddFilter(MessageFilter* filter);
+  void RemoveFilter(MessageFilter* filter);
+
+  // Offers |message| to the filters interested in it until one handles it.
+  // Returns true if one did.
+  bool TryFilters(const Message& message);
+
+  void Clear();
+
+ private:
+  typedef std::vector<MessageFilter*> MessageFilters;
+
+  // Every filter, for messages outside of the known message classes.
+  MessageFilters filters_;
+
+  // The filters to try for each message class.
+  MessageFilters message_class_filters_[LastIPCMsgStart];
+
+  DISALLOW_COPY_AND_ASSIGN(MessageFilterRouter);
+};
+
+}  // namespace IPC
+
+#endif  // IPC_IPC_MESSAGE_FILTER_ROUTER_H_
@@ -0,0 +1,120 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ipc/ipc_message_filter_router.h"
+
+#include "ipc/ipc_message.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace IPC {
+namespace {
+
+uint32 TypeOf(IPCMessageStart message_class) {
+  return (static_cast<uint32>(message_class) << 16) | 1;
+}
+
+class CountingFilter : public ChannelProxy::MessageFilter {
+ public:
+  // Handles the messages of |handled_class|; LastIPCMsgStart for none.
+  explicit CountingFilter(IPCMessageStart handled_class)
+      : handled_class_(handled_class),
+        restrict_classes_(false),
+        supported_class_(LastIPCMsgStart),
+        received_count_(0) {
+  }
+
+  // Only asks for the messages of |supported_class|.
+  void RestrictTo(IPCMessageStart supported_class) {
+    restrict_classes_ = true;
+    supported_class_ = supported_class;
+  }
+
+  virtual bool OnMessageReceived(const Message& message) OVERRIDE {
+    ++received_count_;
+    return (message.type() >> 16) == static_cast<uint32>(handled_class_);
+  }
+
+  virtual bool GetSupportedMessageClasses(
+      std::vector<uint32>* supported_message_classes) const OVERRIDE {
+    if (!restrict_classes_)
+      return false;
+    supported_message_classes->push_back(supported_class_);
+    return true;
+  }
+
+  int received_count() const { return received_count_; }
+
+ private:
+  virtual ~CountingFilter() {}
+
+  IPCMessageStart handled_class_;
+  bool restrict_classes_;
+  IPCMessageStart supported_class_;
+  int received_count_;
+};
+
+TEST(MessageFilterRouterTest, RoutesByMessageClass) {
+  scoped_refptr<CountingFilter> view_filter(new CountingFilter(ViewMsgStart));
+  view_filter->RestrictTo(ViewMsgStart);
+  scoped_refptr<CountingFilter> gpu_filter(new CountingFilter(GpuMsgStart));
+  gpu_filter->RestrictTo(GpuMsgStart);
+  scoped_refptr<CountingFilter> catch_all(new CountingFilter(LastIPCMsgStart));
+
+  MessageFilterRouter router;
+  router.AddFilter(view_filter.get());
+  router.AddFilter(gpu_filter.get());
+  router.AddFilter(catch_all.get());
+
+  Message view_message(MSG_ROUTING_CONTROL, TypeOf(ViewMsgStart),
+                       Message::PRIORITY_NORMAL);
+  EXPECT_TRUE(router.TryFilters(view_message));
+  EXPECT_EQ(1, view_filter->received_count());
+  EXPECT_EQ(0, gpu_filter->received_count());
+  EXPECT_EQ(0, catch_all->received_count());
+
+  Message input_message(MSG_ROUTING_CONTROL, TypeOf(InputMsgStart),
+                        Message::PRIORITY_NORMAL);
+  EXPECT_FALSE(router.TryFilters(input_message));
+  EXPECT_EQ(1, view_filter->received_count());
+  EXPECT_EQ(0, gpu_filter->received_count());
+  EXPECT_EQ(1, catch_all->received_count());
+
+  // Types outside of the known classes go to every filter.
+  Message unknown_message(MSG_ROUTING_CONTROL, 0xFFFF0001,
+                          Message::PRIORITY_NORMAL);
+  EXPECT_FALSE(router.TryFilters(unknown_message));
+  EXPECT_EQ(2, view_filter->received_count());
+  EXPECT_EQ(1, gpu_filter->received_count());
+  EXPECT_EQ(2, catch_all->received_count());
+}
+
+TEST(MessageFilterRouterTest, KeepsFilterOrder) {
+  // |first| is offered every message and handles the view class, so it
+  // must still take view messages before |second| sees them.
+  scoped_refptr<CountingFilter> first(new CountingFilter(ViewMsgStart));
+  scoped_refptr<CountingFilter> second(new CountingFilter(ViewMsgStart));
+  second->RestrictTo(ViewMsgStart);
+
+  MessageFilterRouter router;
+  router.AddFilter(first.get());
+  router.AddFilter(second.get());
+
+  Message message(MSG_ROUTING_CONTROL, TypeOf(ViewMsgStart),
+                  Message::PRIORITY_NORMAL);
+  EXPECT_TRUE(router.TryFilters(message));
+  EXPECT_EQ(1, first->received_count());
+  EXPECT_EQ(0, second->received_count());
+
+  router.RemoveFilter(first.get());
+  EXPECT_TRUE(router.TryFilters(message));
+  EXPECT_EQ(1, first->received_count());
+  EXPECT_EQ(1, second->received_count());
+
+  router.Clear();
+  EXPECT_FALSE(router.TryFilters(message));
+  EXPECT_EQ(1, second->received_count());
+}
+
+}  // namespace
+}  // namespace IPC
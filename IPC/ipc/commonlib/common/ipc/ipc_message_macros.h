@@ -141,7 +141,9 @@
 // class (whose own traits are already defined). Note that
 // IPC_STRUCT_TRAITS_MEMBER() and IPC_STRUCT_TRAITS_PARENT are only permitted
 // inside matching calls to IPC_STRUCT_TRAITS_BEGIN() /
-// IPC_STRUCT_TRAITS_END().
+// IPC_STRUCT_TRAITS_END(). POD structs without padding whose members need no
+// validation can instead be registered with IPC_STRUCT_TRAITS_BLITTABLE(),
+// which serializes them as their raw bytes.
 //
 // Enum types are registered with a single IPC_ENUM_TRAITS_VALIDATE() macro.
 // There is no need to enumerate each value to the IPC mechanism. Instead,
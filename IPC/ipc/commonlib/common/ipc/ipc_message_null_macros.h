@@ -13,6 +13,7 @@
 #undef IPC_STRUCT_TRAITS_MEMBER
 #undef IPC_STRUCT_TRAITS_PARENT
 #undef IPC_STRUCT_TRAITS_END
+#undef IPC_STRUCT_TRAITS_BLITTABLE
 #undef IPC_ENUM_TRAITS_VALIDATE
 #undef IPC_MESSAGE_DECL
 
@@ -23,6 +24,7 @@
 #define IPC_STRUCT_TRAITS_MEMBER(name)
 #define IPC_STRUCT_TRAITS_PARENT(type)
 #define IPC_STRUCT_TRAITS_END()
+#define IPC_STRUCT_TRAITS_BLITTABLE(struct_name)
 #define IPC_ENUM_TRAITS_VALIDATE(enum_name, validation_expression)
 #define IPC_MESSAGE_DECL(sync, kind, msg_class, \
                          in_cnt, out_cnt, in_list, out_list)
@@ -8,13 +8,18 @@
 #include "base/json/json_writer.h"
 #include "base/memory/scoped_ptr.h"
 #include "base/nullable_string16.h"
+#include "base/shared_memory.h"
 #include "base/string_number_conversions.h"
 #include "base/time.h"
 #include "base/utf_string_conversions.h"
 #include "base/values.h"
 #include "ipc/ipc_channel_handle.h"
+#include "ipc/ipc_large_payload.h"
 
 #if defined(OS_POSIX)
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include "ipc/file_descriptor_set_posix.h"
 #elif defined(OS_WIN)
 #include <tchar.h>
@@ -680,6 +685,72 @@ void ParamTraits<IPC::ChannelHandle>::Log(const param_type& p,
   l->append(")");
 }
 
+void ParamTraits<LargePayload>::Write(Message* m, const param_type& p) {
+#if defined(OS_POSIX)
+  // The payload may be sent more than once, so each message gets its own
+  // descriptor. Fall back to sending the bytes inline if the message cannot
+  // take another one.
+  if (p.is_shared() && m->CanWriteFileDescriptor()) {
+    int fd = dup(p.shared_memory()->handle().fd);
+    if (fd >= 0) {
+      WriteParam(m, true);
+      m->WriteUInt64(p.size());
+      if (!m->WriteFileDescriptor(base::FileDescriptor(fd, true)))
+        NOTREACHED();
+      return;
+    }
+    DPLOG(ERROR) << "dup";
+  }
+#endif  // defined(OS_POSIX)
+  WriteParam(m, false);
+  m->WriteData(p.data(), static_cast<int>(p.size()));
+}
+
+bool ParamTraits<LargePayload>::Read(const Message* m,
+                                     PickleIterator* iter,
+                                     param_type* r) {
+  bool out_of_band;
+  if (!ReadParam(m, iter, &out_of_band))
+    return false;
+
+  if (!out_of_band) {
+    const char* data;
+    int data_size = 0;
+    if (!m->ReadData(iter, &data, &data_size) || data_size < 0)
+      return false;
+    *r = LargePayload::CopyToHeap(data, data_size);
+    return true;
+  }
+
+#if defined(OS_POSIX)
+  uint64 size;
+  base::FileDescriptor descriptor;
+  if (!m->ReadUInt64(iter, &size) || !m->ReadFileDescriptor(iter, &descriptor))
+    return false;
+  scoped_ptr<base::SharedMemory> shared_memory(
+      new base::SharedMemory(descriptor, true));
+  // Touching a mapping past the end of the segment would fault, so make sure
+  // the segment is as large as the sender claims.
+  struct stat st;
+  if (size == 0 || static_cast<uint64>(static_cast<size_t>(size)) != size ||
+      fstat(descriptor.fd, &st) != 0 ||
+      static_cast<uint64>(st.st_size) < size ||
+      !shared_memory->Map(static_cast<size_t>(size))) {
+    return false;
+  }
+  *r = LargePayload::WrapSharedMemory(shared_memory.release(),
+                                      static_cast<size_t>(size));
+  return true;
+#else
+  return false;
+#endif  // defined(OS_POSIX)
+}
+
+void ParamTraits<LargePayload>::Log(const param_type& p, std::string* l) {
+  l->append(base::StringPrintf("LargePayload(%" PRIuS " bytes%s)", p.size(),
+                               p.is_shared() ? ", shared" : ""));
+}
+
 void ParamTraits<LogData>::Write(Message* m, const param_type& p) {
   WriteParam(m, p.channel);
   WriteParam(m, p.routing_id);
@@ -5,6 +5,9 @@
 #ifndef IPC_IPC_MESSAGE_UTILS_H_
 #define IPC_IPC_MESSAGE_UTILS_H_
 
+#include <limits.h>
+#include <string.h>
+
 #include <algorithm>
 #include <map>
 #include <set>
@@ -17,6 +20,7 @@
 #include "base/string16.h"
 #include "base/stringprintf.h"
 #include "base/string_util.h"
+#include "base/template_util.h"
 #include "base/tuple.h"
 #include "ipc/ipc_message_start.h"
 #include "ipc/ipc_param_traits.h"
@@ -59,6 +63,7 @@ struct FileDescriptor;
 
 namespace IPC {
 
+class LargePayload;
 struct ChannelHandle;
 
 // -----------------------------------------------------------------------------
@@ -203,6 +208,100 @@ struct IPC_EXPORT ParamTraits<unsigned short> {
   static void Log(const param_type& p, std::string* l);
 };
 
+// Blittable types -------------------------------------------------------------
+
+// IsBlittable<P>::value is true if ParamTraits<P> writes the sizeof(P) bytes of
+// the value as they are, sizeof(P) is a multiple of the pickle alignment (4
+// bytes), and Read() accepts any bit pattern. Vectors and Tuples of such types
+// are then written and read with one bounds-checked WriteBytes()/ReadBytes()
+// call instead of one per element, producing the very same bytes.
+//
+// bool, float, double and 16 bit types don't qualify, since their encoding is
+// not their bytes packed back to back. POD structs opt in with
+// IPC_STRUCT_TRAITS_BLITTABLE() (see param_traits_macros.h).
+template <class P> struct IsBlittable : base::false_type {};
+template <class P> struct IsBlittable<const P> : IsBlittable<P> {};
+template <class P> struct IsBlittable<P&> : IsBlittable<P> {};
+template <> struct IsBlittable<int> : base::true_type {};
+template <> struct IsBlittable<unsigned int> : base::true_type {};
+template <> struct IsBlittable<long> : base::true_type {};
+template <> struct IsBlittable<unsigned long> : base::true_type {};
+template <> struct IsBlittable<long long> : base::true_type {};
+template <> struct IsBlittable<unsigned long long> : base::true_type {};
+
+// ParamTraits for a POD struct registered with IPC_STRUCT_TRAITS_BLITTABLE().
+// The struct must not have padding, which would leak uninitialized memory to
+// the receiver, and every bit pattern must be a valid value: nothing is
+// validated when reading.
+template <class P>
+struct BlittableParamTraits {
+  COMPILE_ASSERT(__is_pod(P), blittable_struct_must_be_pod);
+  COMPILE_ASSERT(sizeof(P) % sizeof(uint32) == 0,
+                 blittable_struct_size_must_be_a_multiple_of_4);
+
+  typedef P param_type;
+  static void Write(Message* m, const param_type& p) {
+    m->WriteBytes(&p, sizeof(P));
+  }
+  static bool Read(const Message* m, PickleIterator* iter, param_type* r) {
+    const char* data;
+    if (!m->ReadBytes(iter, &data, sizeof(P)))
+      return false;
+    memcpy(r, data, sizeof(P));
+    return true;
+  }
+  static void Log(const param_type& p, std::string* l) {
+    l->append(base::StringPrintf("<%" PRIuS " bytes>", sizeof(P)));
+  }
+};
+
+namespace internal {
+
+// Packs blittable values back to back into a buffer of |kSize| bytes and
+// writes them with a single WriteBytes().
+template <size_t kSize>
+class PackedWriter {
+ public:
+  PackedWriter() : size_(0) {}
+
+  template <class P>
+  void Put(const P& p) {
+    memcpy(buffer_ + size_, reinterpret_cast<const char*>(&p), sizeof(P));
+    size_ += sizeof(P);
+  }
+
+  void WriteTo(Message* m) {
+    DCHECK_EQ(kSize, size_);
+    m->WriteBytes(buffer_, kSize);
+  }
+
+ private:
+  char buffer_[kSize];
+  size_t size_;
+};
+
+// Reads |size| bytes with a single bounds-checked ReadBytes() and unpacks
+// blittable values from them.
+class PackedReader {
+ public:
+  PackedReader() : data_(NULL) {}
+
+  bool ReadFrom(const Message* m, PickleIterator* iter, size_t size) {
+    return m->ReadBytes(iter, &data_, static_cast<int>(size));
+  }
+
+  template <class P>
+  void Get(P* p) {
+    memcpy(reinterpret_cast<char*>(p), data_, sizeof(P));
+    data_ += sizeof(P);
+  }
+
+ private:
+  const char* data_;
+};
+
+}  // namespace internal
+
 // Note that the IPC layer doesn't sanitize NaNs and +/- INF values.  Clients
 // should be sure to check the sanity of these values after receiving them over
 // IPC.
@@ -291,8 +390,10 @@ struct IPC_EXPORT ParamTraits<std::vector<bool> > {
   static void Log(const param_type& p, std::string* l);
 };
 
-template <class P>
-struct ParamTraits<std::vector<P> > {
+namespace internal {
+
+template <class P, bool kBlittable = IsBlittable<P>::value>
+struct VectorParamTraits {
   typedef std::vector<P> param_type;
   static void Write(Message* m, const param_type& p) {
     WriteParam(m, static_cast<int>(p.size()));
@@ -324,6 +425,51 @@ struct ParamTraits<std::vector<P> > {
   }
 };
 
+// Vectors of blittable types are written as their length followed by all the
+// elements in one block, which is byte for byte what the generic version
+// writes.
+template <class P>
+struct VectorParamTraits<P, true> {
+  typedef std::vector<P> param_type;
+  static void Write(Message* m, const param_type& p) {
+    if (p.size() > INT_MAX / sizeof(P)) {
+      // Too big for WriteBytes(); let the generic version fail.
+      VectorParamTraits<P, false>::Write(m, p);
+      return;
+    }
+    WriteParam(m, static_cast<int>(p.size()));
+    if (!p.empty())
+      m->WriteBytes(&p[0], static_cast<int>(p.size() * sizeof(P)));
+  }
+  static bool Read(const Message* m, PickleIterator* iter,
+                   param_type* r) {
+    int size;
+    // ReadLength() checks for < 0 itself.
+    if (!m->ReadLength(iter, &size))
+      return false;
+    if (INT_MAX / sizeof(P) <= static_cast<size_t>(size))
+      return false;
+    // ReadBytes() checks that the message holds all the elements, so it is
+    // safe to resize afterwards.
+    const char* data;
+    if (!m->ReadBytes(iter, &data, size * static_cast<int>(sizeof(P))))
+      return false;
+    r->resize(size);
+    if (size)
+      memcpy(&(*r)[0], data, size * sizeof(P));
+    return true;
+  }
+  static void Log(const param_type& p, std::string* l) {
+    VectorParamTraits<P, false>::Log(p, l);
+  }
+};
+
+}  // namespace internal
+
+template <class P>
+struct ParamTraits<std::vector<P> > : internal::VectorParamTraits<P> {
+};
+
 template <class P>
 struct ParamTraits<std::set<P> > {
   typedef std::set<P> param_type;
@@ -532,8 +678,15 @@ struct ParamTraits< Tuple1<A> > {
   }
 };
 
-template <class A, class B>
-struct ParamTraits< Tuple2<A, B> > {
+// Tuples of blittable types (which is what the parameters of many messages
+// are) are packed and written with one WriteBytes(), which produces the same
+// bytes as writing each member.
+
+namespace internal {
+
+template <class A, class B,
+          bool kBlittable = IsBlittable<A>::value && IsBlittable<B>::value>
+struct Tuple2ParamTraits {
   typedef Tuple2<A, B> param_type;
   static void Write(Message* m, const param_type& p) {
     WriteParam(m, p.a);
@@ -550,8 +703,33 @@ struct ParamTraits< Tuple2<A, B> > {
   }
 };
 
-template <class A, class B, class C>
-struct ParamTraits< Tuple3<A, B, C> > {
+template <class A, class B>
+struct Tuple2ParamTraits<A, B, true> {
+  typedef Tuple2<A, B> param_type;
+  static const size_t kPackedSize = sizeof(A) + sizeof(B);
+  static void Write(Message* m, const param_type& p) {
+    PackedWriter<kPackedSize> writer;
+    writer.Put(p.a);
+    writer.Put(p.b);
+    writer.WriteTo(m);
+  }
+  static bool Read(const Message* m, PickleIterator* iter, param_type* r) {
+    PackedReader reader;
+    if (!reader.ReadFrom(m, iter, kPackedSize))
+      return false;
+    reader.Get(&r->a);
+    reader.Get(&r->b);
+    return true;
+  }
+  static void Log(const param_type& p, std::string* l) {
+    Tuple2ParamTraits<A, B, false>::Log(p, l);
+  }
+};
+
+template <class A, class B, class C,
+          bool kBlittable = IsBlittable<A>::value && IsBlittable<B>::value &&
+                            IsBlittable<C>::value>
+struct Tuple3ParamTraits {
   typedef Tuple3<A, B, C> param_type;
   static void Write(Message* m, const param_type& p) {
     WriteParam(m, p.a);
@@ -572,8 +750,35 @@ struct ParamTraits< Tuple3<A, B, C> > {
   }
 };
 
-template <class A, class B, class C, class D>
-struct ParamTraits< Tuple4<A, B, C, D> > {
+template <class A, class B, class C>
+struct Tuple3ParamTraits<A, B, C, true> {
+  typedef Tuple3<A, B, C> param_type;
+  static const size_t kPackedSize = sizeof(A) + sizeof(B) + sizeof(C);
+  static void Write(Message* m, const param_type& p) {
+    PackedWriter<kPackedSize> writer;
+    writer.Put(p.a);
+    writer.Put(p.b);
+    writer.Put(p.c);
+    writer.WriteTo(m);
+  }
+  static bool Read(const Message* m, PickleIterator* iter, param_type* r) {
+    PackedReader reader;
+    if (!reader.ReadFrom(m, iter, kPackedSize))
+      return false;
+    reader.Get(&r->a);
+    reader.Get(&r->b);
+    reader.Get(&r->c);
+    return true;
+  }
+  static void Log(const param_type& p, std::string* l) {
+    Tuple3ParamTraits<A, B, C, false>::Log(p, l);
+  }
+};
+
+template <class A, class B, class C, class D,
+          bool kBlittable = IsBlittable<A>::value && IsBlittable<B>::value &&
+                            IsBlittable<C>::value && IsBlittable<D>::value>
+struct Tuple4ParamTraits {
   typedef Tuple4<A, B, C, D> param_type;
   static void Write(Message* m, const param_type& p) {
     WriteParam(m, p.a);
@@ -598,8 +803,39 @@ struct ParamTraits< Tuple4<A, B, C, D> > {
   }
 };
 
-template <class A, class B, class C, class D, class E>
-struct ParamTraits< Tuple5<A, B, C, D, E> > {
+template <class A, class B, class C, class D>
+struct Tuple4ParamTraits<A, B, C, D, true> {
+  typedef Tuple4<A, B, C, D> param_type;
+  static const size_t kPackedSize =
+      sizeof(A) + sizeof(B) + sizeof(C) + sizeof(D);
+  static void Write(Message* m, const param_type& p) {
+    PackedWriter<kPackedSize> writer;
+    writer.Put(p.a);
+    writer.Put(p.b);
+    writer.Put(p.c);
+    writer.Put(p.d);
+    writer.WriteTo(m);
+  }
+  static bool Read(const Message* m, PickleIterator* iter, param_type* r) {
+    PackedReader reader;
+    if (!reader.ReadFrom(m, iter, kPackedSize))
+      return false;
+    reader.Get(&r->a);
+    reader.Get(&r->b);
+    reader.Get(&r->c);
+    reader.Get(&r->d);
+    return true;
+  }
+  static void Log(const param_type& p, std::string* l) {
+    Tuple4ParamTraits<A, B, C, D, false>::Log(p, l);
+  }
+};
+
+template <class A, class B, class C, class D, class E,
+          bool kBlittable = IsBlittable<A>::value && IsBlittable<B>::value &&
+                            IsBlittable<C>::value && IsBlittable<D>::value &&
+                            IsBlittable<E>::value>
+struct Tuple5ParamTraits {
   typedef Tuple5<A, B, C, D, E> param_type;
   static void Write(Message* m, const param_type& p) {
     WriteParam(m, p.a);
@@ -628,6 +864,56 @@ struct ParamTraits< Tuple5<A, B, C, D, E> > {
   }
 };
 
+template <class A, class B, class C, class D, class E>
+struct Tuple5ParamTraits<A, B, C, D, E, true> {
+  typedef Tuple5<A, B, C, D, E> param_type;
+  static const size_t kPackedSize =
+      sizeof(A) + sizeof(B) + sizeof(C) + sizeof(D) + sizeof(E);
+  static void Write(Message* m, const param_type& p) {
+    PackedWriter<kPackedSize> writer;
+    writer.Put(p.a);
+    writer.Put(p.b);
+    writer.Put(p.c);
+    writer.Put(p.d);
+    writer.Put(p.e);
+    writer.WriteTo(m);
+  }
+  static bool Read(const Message* m, PickleIterator* iter, param_type* r) {
+    PackedReader reader;
+    if (!reader.ReadFrom(m, iter, kPackedSize))
+      return false;
+    reader.Get(&r->a);
+    reader.Get(&r->b);
+    reader.Get(&r->c);
+    reader.Get(&r->d);
+    reader.Get(&r->e);
+    return true;
+  }
+  static void Log(const param_type& p, std::string* l) {
+    Tuple5ParamTraits<A, B, C, D, E, false>::Log(p, l);
+  }
+};
+
+}  // namespace internal
+
+template <class A, class B>
+struct ParamTraits< Tuple2<A, B> > : internal::Tuple2ParamTraits<A, B> {
+};
+
+template <class A, class B, class C>
+struct ParamTraits< Tuple3<A, B, C> > : internal::Tuple3ParamTraits<A, B, C> {
+};
+
+template <class A, class B, class C, class D>
+struct ParamTraits< Tuple4<A, B, C, D> >
+    : internal::Tuple4ParamTraits<A, B, C, D> {
+};
+
+template <class A, class B, class C, class D, class E>
+struct ParamTraits< Tuple5<A, B, C, D, E> >
+    : internal::Tuple5ParamTraits<A, B, C, D, E> {
+};
+
 template<class P>
 struct ParamTraits<ScopedVector<P> > {
   typedef ScopedVector<P> param_type;
@@ -672,6 +958,18 @@ struct IPC_EXPORT ParamTraits<IPC::ChannelHandle> {
   static void Log(const param_type& p, std::string* l);
 };
 
+// LargePayloads of at least LargePayload::out_of_band_threshold() bytes are
+// sent as a shared memory descriptor (which counts against
+// FileDescriptorSet::kMaxDescriptorsPerMessage) and mapped read-only by the
+// receiver. See ipc_large_payload.h.
+template <>
+struct IPC_EXPORT ParamTraits<LargePayload> {
+  typedef LargePayload param_type;
+  static void Write(Message* m, const param_type& p);
+  static bool Read(const Message* m, PickleIterator* iter, param_type* r);
+  static void Log(const param_type& p, std::string* l);
+};
+
 template <>
 struct IPC_EXPORT ParamTraits<LogData> {
   typedef LogData param_type;
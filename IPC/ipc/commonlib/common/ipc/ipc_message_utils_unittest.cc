@@ -4,13 +4,41 @@
 
 #include "ipc/ipc_message_utils.h"
 
+#include <string.h>
+
+#include <string>
+#include <vector>
+
 #include "base/files/file_path.h"
+#include "ipc/ipc_large_payload.h"
 #include "ipc/ipc_message.h"
+#include "ipc/ipc_message_macros.h"
 #include "testing/gtest/include/gtest/gtest.h"
 
+#if defined(OS_POSIX)
+#include "ipc/file_descriptor_set_posix.h"
+#endif
+
+namespace {
+
+struct BlittableTestPoint {
+  int32 x;
+  int32 y;
+};
+
+}  // namespace
+
+IPC_STRUCT_TRAITS_BLITTABLE(BlittableTestPoint)
+
 namespace IPC {
 namespace {
 
+// Compares payloads only; each message's header has its own reference number.
+bool SameBytes(const Message& a, const Message& b) {
+  return a.payload_size() == b.payload_size() &&
+         memcmp(a.payload(), b.payload(), a.payload_size()) == 0;
+}
+
 // Tests nesting of messages as parameters to other messages.
 TEST(IPCMessageUtilsTest, NestedMessages) {
   int32 nested_routing = 12;
@@ -70,5 +98,183 @@ TEST(IPCMessageUtilsTest, ParameterValidation) {
   ASSERT_FALSE(ParamTraits<base::FilePath>::Read(&message, &iter, &bad_path));
 }
 
+// Small payloads are written inline.
+TEST(IPCMessageUtilsTest, LargePayloadInline) {
+  std::string bytes(100, 'x');
+  LargePayload payload(bytes);
+  EXPECT_FALSE(payload.is_shared());
+
+  Message message;
+  ParamTraits<LargePayload>::Write(&message, payload);
+#if defined(OS_POSIX)
+  EXPECT_FALSE(message.HasFileDescriptors());
+#endif
+
+  PickleIterator iter(message);
+  LargePayload result;
+  ASSERT_TRUE(ParamTraits<LargePayload>::Read(&message, &iter, &result));
+  EXPECT_FALSE(result.is_shared());
+  EXPECT_EQ(bytes, std::string(result.data(), result.size()));
+}
+
+#if defined(OS_POSIX)
+// Payloads above the threshold travel as a shared memory descriptor.
+TEST(IPCMessageUtilsTest, LargePayloadOutOfBand) {
+  const size_t kSize = 1024 * 1024 + 3;
+  std::string bytes(kSize, 'y');
+  bytes[kSize - 1] = 'z';
+  LargePayload payload(bytes);
+  ASSERT_TRUE(payload.is_shared());
+
+  // Each write carries its own descriptor, so the payload can be sent twice.
+  Message message;
+  ParamTraits<LargePayload>::Write(&message, payload);
+  ParamTraits<LargePayload>::Write(&message, payload);
+  EXPECT_TRUE(message.HasFileDescriptors());
+  // The bytes are not in the message.
+  EXPECT_LT(message.size(), 1024U);
+
+  PickleIterator iter(message);
+  for (int i = 0; i < 2; ++i) {
+    LargePayload result;
+    ASSERT_TRUE(ParamTraits<LargePayload>::Read(&message, &iter, &result));
+    EXPECT_TRUE(result.is_shared());
+    ASSERT_EQ(kSize, result.size());
+    EXPECT_TRUE(bytes == std::string(result.data(), result.size()));
+  }
+}
+
+// A message that is out of descriptor slots carries the bytes inline.
+TEST(IPCMessageUtilsTest, LargePayloadWithoutDescriptorSlots) {
+  std::string bytes(LargePayload::out_of_band_threshold(), 'w');
+  LargePayload payload(bytes);
+  ASSERT_TRUE(payload.is_shared());
+
+  Message message;
+  for (size_t i = 0; i < FileDescriptorSet::kMaxDescriptorsPerMessage; ++i)
+    ASSERT_TRUE(message.WriteFileDescriptor(base::FileDescriptor(0, false)));
+  EXPECT_FALSE(message.CanWriteFileDescriptor());
+  ParamTraits<LargePayload>::Write(&message, payload);
+  EXPECT_GT(message.size(), bytes.size());
+}
+#endif  // defined(OS_POSIX)
+
+// Vectors of blittable types are written in one block, with the same bytes as
+// writing each element.
+TEST(IPCMessageUtilsTest, BlittableVector) {
+  std::vector<int> input;
+  for (int i = 0; i < 10; ++i)
+    input.push_back(i * 3 - 7);
+
+  Message bulk(1, 2, Message::PRIORITY_NORMAL);
+  WriteParam(&bulk, input);
+  Message per_element(1, 2, Message::PRIORITY_NORMAL);
+  per_element.WriteInt(static_cast<int>(input.size()));
+  for (size_t i = 0; i < input.size(); ++i)
+    per_element.WriteInt(input[i]);
+  EXPECT_TRUE(SameBytes(bulk, per_element));
+
+  std::vector<int> output;
+  PickleIterator iter(bulk);
+  EXPECT_TRUE(ReadParam(&bulk, &iter, &output));
+  EXPECT_EQ(input, output);
+
+  std::vector<uint64> empty_input;
+  Message empty(1, 2, Message::PRIORITY_NORMAL);
+  WriteParam(&empty, empty_input);
+  std::vector<uint64> empty_output(3);
+  iter = PickleIterator(empty);
+  EXPECT_TRUE(ReadParam(&empty, &iter, &empty_output));
+  EXPECT_TRUE(empty_output.empty());
+}
+
+// A length larger than what the message holds must fail before resizing.
+TEST(IPCMessageUtilsTest, BlittableVectorTruncated) {
+  Message message(1, 2, Message::PRIORITY_NORMAL);
+  message.WriteInt(1000);
+  message.WriteInt(1);
+  message.WriteInt(2);
+
+  std::vector<int> output;
+  PickleIterator iter(message);
+  EXPECT_FALSE(ReadParam(&message, &iter, &output));
+  EXPECT_TRUE(output.empty());
+
+  Message huge(1, 2, Message::PRIORITY_NORMAL);
+  huge.WriteInt(INT_MAX / 4);
+  iter = PickleIterator(huge);
+  EXPECT_FALSE(ReadParam(&huge, &iter, &output));
+}
+
+TEST(IPCMessageUtilsTest, BlittableTuple) {
+  Tuple3<int, int64, uint32> input(-5, GG_INT64_C(0x123456789), 77U);
+
+  Message bulk(1, 2, Message::PRIORITY_NORMAL);
+  WriteParam(&bulk, input);
+  Message per_member(1, 2, Message::PRIORITY_NORMAL);
+  WriteParam(&per_member, input.a);
+  WriteParam(&per_member, input.b);
+  WriteParam(&per_member, input.c);
+  EXPECT_TRUE(SameBytes(bulk, per_member));
+
+  Tuple3<int, int64, uint32> output;
+  PickleIterator iter(bulk);
+  EXPECT_TRUE(ReadParam(&bulk, &iter, &output));
+  EXPECT_EQ(input.a, output.a);
+  EXPECT_EQ(input.b, output.b);
+  EXPECT_EQ(input.c, output.c);
+
+  // Not enough bytes for the whole tuple.
+  Message truncated(1, 2, Message::PRIORITY_NORMAL);
+  truncated.WriteInt(1);
+  iter = PickleIterator(truncated);
+  EXPECT_FALSE(ReadParam(&truncated, &iter, &output));
+}
+
+TEST(IPCMessageUtilsTest, MixedTuple) {
+  // A member that isn't blittable sends the whole tuple member by member.
+  Tuple3<int, std::string, uint32> input(-5, "mixed", 77U);
+
+  Message message(1, 2, Message::PRIORITY_NORMAL);
+  WriteParam(&message, input);
+  Message per_member(1, 2, Message::PRIORITY_NORMAL);
+  WriteParam(&per_member, input.a);
+  WriteParam(&per_member, input.b);
+  WriteParam(&per_member, input.c);
+  EXPECT_TRUE(SameBytes(message, per_member));
+
+  Tuple3<int, std::string, uint32> output;
+  PickleIterator iter(message);
+  EXPECT_TRUE(ReadParam(&message, &iter, &output));
+  EXPECT_EQ(input.a, output.a);
+  EXPECT_EQ(input.b, output.b);
+  EXPECT_EQ(input.c, output.c);
+}
+
+TEST(IPCMessageUtilsTest, BlittableStruct) {
+  std::vector<BlittableTestPoint> input(2);
+  input[0].x = 1;
+  input[0].y = -2;
+  input[1].x = 300;
+  input[1].y = 400;
+
+  Message message(1, 2, Message::PRIORITY_NORMAL);
+  WriteParam(&message, input);
+  Message per_element(1, 2, Message::PRIORITY_NORMAL);
+  per_element.WriteInt(2);
+  WriteParam(&per_element, input[0]);
+  WriteParam(&per_element, input[1]);
+  EXPECT_TRUE(SameBytes(message, per_element));
+
+  std::vector<BlittableTestPoint> output;
+  PickleIterator iter(message);
+  ASSERT_TRUE(ReadParam(&message, &iter, &output));
+  ASSERT_EQ(2U, output.size());
+  EXPECT_EQ(1, output[0].x);
+  EXPECT_EQ(-2, output[0].y);
+  EXPECT_EQ(300, output[1].x);
+  EXPECT_EQ(400, output[1].y);
+}
+
 }  // namespace
 }  // namespace IPC
@@ -0,0 +1,108 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ipc/ipc_output_queue.h"
+
+#include "base/logging.h"
+#include "base/stl_util.h"
+
+namespace IPC {
+namespace internal {
+
+namespace {
+
+// Messages built without a valid priority go in the normal lane.
+int LaneOf(const Message* message) {
+  int priority = message->priority();
+  if (priority < Message::PRIORITY_LOW || priority > Message::PRIORITY_HIGH)
+    return Message::PRIORITY_NORMAL;
+  return priority;
+}
+
+}  // namespace
+
+OutputQueue::OutputQueue()
+    : reorderable_count_(0),
+      coalesced_count_(0) {
+  for (size_t i = 0; i < arraysize(lane_counts_); ++i)
+    lane_counts_[i] = 0;
+}
+
+OutputQueue::~OutputQueue() {
+  Clear();
+}
+
+void OutputQueue::Push(Message* message) {
+  if (message->routing_id() == MSG_ROUTING_NONE) {
+    // Nothing may overtake an internal message.
+    queue_.push_back(message);
+    reorderable_count_ = 0;
+    for (size_t i = 0; i < arraysize(lane_counts_); ++i)
+      lane_counts_[i] = 0;
+    return;
+  }
+
+  if (!coalesced_types_.empty() && Coalesce(message))
+    return;
+
+  // Queue it behind every reorderable message of the same or a higher
+  // priority.
+  int lane = LaneOf(message);
+  size_t lower_priority_count = 0;
+  for (int i = Message::PRIORITY_LOW; i < lane; ++i)
+    lower_priority_count += lane_counts_[i];
+  queue_.insert(queue_.end() - lower_priority_count, message);
+  ++lane_counts_[lane];
+  ++reorderable_count_;
+}
+
+void OutputQueue::MarkFrontStarted() {
+  if (queue_.empty() || reorderable_count_ != queue_.size())
+    return;
+  --lane_counts_[LaneOf(queue_.front())];
+  --reorderable_count_;
+}
+
+void OutputQueue::pop_front() {
+  DCHECK(!queue_.empty());
+  MarkFrontStarted();
+  queue_.pop_front();
+}
+
+void OutputQueue::Clear() {
+  STLDeleteElements(&queue_);
+  reorderable_count_ = 0;
+  for (size_t i = 0; i < arraysize(lane_counts_); ++i)
+    lane_counts_[i] = 0;
+}
+
+void OutputQueue::AddCoalescedType(uint32 type) {
+  coalesced_types_.insert(type);
+}
+
+bool OutputQueue::Coalesce(Message* message) {
+  if (message->is_sync() || message->is_reply() ||
+      coalesced_types_.find(message->type()) == coalesced_types_.end()) {
+    return false;
+  }
+
+  for (std::deque<Message*>::iterator it = queue_.end() - reorderable_count_;
+       it != queue_.end(); ++it) {
+    Message* queued = *it;
+    if (queued->routing_id() == message->routing_id() &&
+        queued->type() == message->type() &&
+        LaneOf(queued) == LaneOf(message)) {
+      DVLOG(2) << "coalesced message @" << queued << " with type "
+               << queued->type() << " into message @" << message;
+      delete queued;
+      *it = message;
+      ++coalesced_count_;
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace internal
+}  // namespace IPC
@@ -0,0 +1,86 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef IPC_IPC_OUTPUT_QUEUE_H_
+#define IPC_IPC_OUTPUT_QUEUE_H_
+
+#include <deque>
+#include <set>
+
+#include "base/basictypes.h"
+#include "ipc/ipc_export.h"
+#include "ipc/ipc_message.h"
+
+namespace IPC {
+namespace internal {
+
+// The messages a channel has yet to write, in the order it should write them.
+//
+// A message overtakes the queued messages of lower priority (see
+// Message::PriorityValue) that the channel has not started writing; messages
+// of the same priority keep their order. Messages with the routing id
+// MSG_ROUTING_NONE, such as the hello message, are internal to the channel:
+// they are never overtaken and nothing queued before them is either.
+//
+// Messages of a type passed to AddCoalescedType() are coalesced: such a
+// message replaces a queued message of the same priority, routing id and type
+// that the channel has not started writing, instead of being queued behind
+// it. Use this for messages that only carry the latest state of something.
+// Sync messages and replies are never coalesced.
+class IPC_EXPORT OutputQueue {
+ public:
+  typedef std::deque<Message*>::const_iterator const_iterator;
+
+  OutputQueue();
+  // Deletes the messages still queued.
+  ~OutputQueue();
+
+  // Queues |message|, taking ownership.
+  void Push(Message* message);
+
+  // Tells the queue that the channel started writing the message at the
+  // front, so that it must not be overtaken or replaced any more. Calling it
+  // again for the same message is harmless.
+  void MarkFrontStarted();
+
+  bool empty() const { return queue_.empty(); }
+  size_t size() const { return queue_.size(); }
+  Message* front() const { return queue_.front(); }
+  const_iterator begin() const { return queue_.begin(); }
+  const_iterator end() const { return queue_.end(); }
+
+  // Removes the message at the front without deleting it.
+  void pop_front();
+
+  // Deletes all queued messages.
+  void Clear();
+
+  void AddCoalescedType(uint32 type);
+
+  // Number of messages that were replaced by a newer one.
+  size_t coalesced_count() const { return coalesced_count_; }
+
+ private:
+  // Replaces the queued message |message| coalesces with, if any. Returns
+  // true if it did.
+  bool Coalesce(Message* message);
+
+  std::deque<Message*> queue_;
+
+  // The last |reorderable_count_| messages of |queue_| may still be overtaken
+  // or replaced. They are sorted by priority, and |lane_counts_| has the
+  // number of messages of each priority among them.
+  size_t reorderable_count_;
+  size_t lane_counts_[Message::PRIORITY_HIGH + 1];
+
+  std::set<uint32> coalesced_types_;
+  size_t coalesced_count_;
+
+  DISALLOW_COPY_AND_ASSIGN(OutputQueue);
+};
+
+}  // namespace internal
+}  // namespace IPC
+
+#endif  // IPC_IPC_OUTPUT_QUEUE_H_
@@ -0,0 +1,128 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ipc/ipc_output_queue.h"
+
+#include <vector>
+
+#include "ipc/ipc_channel.h"
+#include "ipc/ipc_message.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace IPC {
+namespace internal {
+namespace {
+
+const int32 kRoutingId = 5;
+const uint32 kBulkType = 1;
+const uint32 kInputType = 2;
+
+Message* NewMessage(int32 routing_id,
+                    uint32 type,
+                    Message::PriorityValue priority,
+                    int tag) {
+  Message* message = new Message(routing_id, type, priority);
+  message->WriteInt(tag);
+  return message;
+}
+
+int TagOf(const Message* message) {
+  PickleIterator iter(*message);
+  int tag = -1;
+  EXPECT_TRUE(message->ReadInt(&iter, &tag));
+  return tag;
+}
+
+// Empties |queue| and returns the tags of its messages in order.
+std::vector<int> Drain(OutputQueue* queue) {
+  std::vector<int> tags;
+  while (!queue->empty()) {
+    Message* message = queue->front();
+    queue->pop_front();
+    tags.push_back(TagOf(message));
+    delete message;
+  }
+  return tags;
+}
+
+std::vector<int> Tags(int a, int b, int c, int d) {
+  std::vector<int> tags;
+  tags.push_back(a);
+  tags.push_back(b);
+  tags.push_back(c);
+  tags.push_back(d);
+  return tags;
+}
+
+TEST(OutputQueueTest, HighPriorityOvertakesBulk) {
+  OutputQueue queue;
+  queue.Push(NewMessage(kRoutingId, kBulkType, Message::PRIORITY_LOW, 1));
+  queue.Push(NewMessage(kRoutingId, kBulkType, Message::PRIORITY_NORMAL, 2));
+  queue.Push(NewMessage(kRoutingId, kInputType, Message::PRIORITY_HIGH, 3));
+  queue.Push(NewMessage(kRoutingId, kInputType, Message::PRIORITY_HIGH, 4));
+  EXPECT_EQ(Tags(3, 4, 2, 1), Drain(&queue));
+}
+
+TEST(OutputQueueTest, StartedMessageIsNotOvertaken) {
+  OutputQueue queue;
+  queue.Push(NewMessage(kRoutingId, kBulkType, Message::PRIORITY_NORMAL, 1));
+  queue.Push(NewMessage(kRoutingId, kBulkType, Message::PRIORITY_NORMAL, 2));
+  queue.MarkFrontStarted();
+  queue.MarkFrontStarted();
+  queue.Push(NewMessage(kRoutingId, kInputType, Message::PRIORITY_HIGH, 3));
+  queue.Push(NewMessage(kRoutingId, kBulkType, Message::PRIORITY_LOW, 4));
+  EXPECT_EQ(Tags(1, 3, 2, 4), Drain(&queue));
+}
+
+TEST(OutputQueueTest, InternalMessageIsNotOvertaken) {
+  OutputQueue queue;
+  queue.Push(NewMessage(kRoutingId, kBulkType, Message::PRIORITY_NORMAL, 1));
+  queue.Push(NewMessage(MSG_ROUTING_NONE, Channel::HELLO_MESSAGE_TYPE,
+                        Message::PRIORITY_NORMAL, 2));
+  queue.Push(NewMessage(kRoutingId, kBulkType, Message::PRIORITY_LOW, 3));
+  queue.Push(NewMessage(kRoutingId, kInputType, Message::PRIORITY_HIGH, 4));
+  EXPECT_EQ(Tags(1, 2, 4, 3), Drain(&queue));
+}
+
+TEST(OutputQueueTest, Coalescing) {
+  OutputQueue queue;
+  queue.AddCoalescedType(kInputType);
+  queue.Push(NewMessage(kRoutingId, kInputType, Message::PRIORITY_HIGH, 1));
+  queue.Push(NewMessage(kRoutingId, kBulkType, Message::PRIORITY_NORMAL, 2));
+  queue.Push(NewMessage(kRoutingId + 1, kInputType, Message::PRIORITY_HIGH, 3));
+  // Replaces 1 in place.
+  queue.Push(NewMessage(kRoutingId, kInputType, Message::PRIORITY_HIGH, 4));
+  // Bulk messages are not coalesced.
+  queue.Push(NewMessage(kRoutingId, kBulkType, Message::PRIORITY_NORMAL, 5));
+  EXPECT_EQ(1U, queue.coalesced_count());
+  EXPECT_EQ(4U, queue.size());
+
+  // Once the front is being written it is no longer replaced.
+  queue.MarkFrontStarted();
+  queue.Push(NewMessage(kRoutingId, kInputType, Message::PRIORITY_HIGH, 6));
+  EXPECT_EQ(1U, queue.coalesced_count());
+
+  std::vector<int> expected = Tags(4, 3, 6, 2);
+  expected.push_back(5);
+  EXPECT_EQ(expected, Drain(&queue));
+}
+
+TEST(OutputQueueTest, SyncMessagesAreNotCoalesced) {
+  OutputQueue queue;
+  queue.AddCoalescedType(kInputType);
+  Message* sync = NewMessage(kRoutingId, kInputType,
+                             Message::PRIORITY_NORMAL, 1);
+  sync->set_sync();
+  queue.Push(sync);
+  Message* sync2 = NewMessage(kRoutingId, kInputType,
+                              Message::PRIORITY_NORMAL, 2);
+  sync2->set_sync();
+  queue.Push(sync2);
+  EXPECT_EQ(0U, queue.coalesced_count());
+  EXPECT_EQ(2U, queue.size());
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace IPC
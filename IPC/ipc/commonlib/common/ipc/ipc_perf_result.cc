@@ -0,0 +1,155 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ipc/ipc_perf_result.h"
+
+#include <algorithm>
+
+#include "base/command_line.h"
+#include "base/file_util.h"
+#include "base/files/file_path.h"
+#include "base/format_macros.h"
+#include "base/json/json_writer.h"
+#include "base/logging.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/metrics/histogram.h"
+#include "base/metrics/histogram_samples.h"
+#include "base/perftimer.h"
+#include "base/stringprintf.h"
+#include "base/values.h"
+
+namespace {
+
+const char kCsvOutputSwitch[] = "ipc-perf-csv";
+const char kJsonOutputSwitch[] = "ipc-perf-json";
+
+const char kCsvHeader[] =
+    "name,messages,payload_bytes,elapsed_ms,messages_per_second,"
+    "mb_per_second,latency_samples,latency_p50_us,latency_p90_us,"
+    "latency_p99_us,latency_p999_us\n";
+
+const size_t kLatencyBucketCount = 200;
+
+// Appends |data| to |path|, creating the file if needed.
+void AppendOrCreate(const base::FilePath& path, const std::string& data) {
+  int size = static_cast<int>(data.size());
+  int written = file_util::PathExists(path) ?
+      file_util::AppendToFile(path, data.data(), size) :
+      file_util::WriteFile(path, data.data(), size);
+  LOG_IF(ERROR, written != size) << "Failed to write " << path.value();
+}
+
+}  // namespace
+
+// static
+const int IPCPerfResult::kMaxLatencyMicroseconds = 10 * 1000 * 1000;
+
+IPCPerfResult::IPCPerfResult(const std::string& name)
+    : name_(name),
+      latency_histogram_(base::Histogram::FactoryGet(
+          "IPC.Perf." + name, 1, kMaxLatencyMicroseconds, kLatencyBucketCount,
+          base::HistogramBase::kNoFlags)),
+      message_count_(0),
+      payload_bytes_(0) {
+}
+
+IPCPerfResult::~IPCPerfResult() {
+}
+
+void IPCPerfResult::AddLatency(base::TimeDelta latency) {
+  int64 microseconds = std::max(static_cast<int64>(0), latency.InMicroseconds());
+  latency_histogram_->Add(static_cast<base::HistogramBase::Sample>(
+      std::min(microseconds, static_cast<int64>(kMaxLatencyMicroseconds))));
+}
+
+void IPCPerfResult::SetTotals(int message_count, int64 payload_bytes,
+                              base::TimeDelta elapsed) {
+  message_count_ = message_count;
+  payload_bytes_ = payload_bytes;
+  elapsed_ = elapsed;
+}
+
+double IPCPerfResult::GetLatencyPercentile(double fraction) const {
+  scoped_ptr<base::HistogramSamples> samples =
+      latency_histogram_->SnapshotSamples();
+  base::HistogramBase::Count total = samples->TotalCount();
+  if (total <= 0)
+    return 0;
+
+  double rank = fraction * total;
+  double seen = 0;
+  for (scoped_ptr<base::SampleCountIterator> it = samples->Iterator();
+       !it->Done(); it->Next()) {
+    base::HistogramBase::Sample min;
+    base::HistogramBase::Sample max;
+    base::HistogramBase::Count count;
+    it->Get(&min, &max, &count);
+    if (count <= 0)
+      continue;
+    if (seen + count >= rank) {
+      // The overflow bucket has no meaningful upper bound.
+      max = std::max(min, std::min(max, kMaxLatencyMicroseconds));
+      return min + (max - min) * (rank - seen) / count;
+    }
+    seen += count;
+  }
+  return kMaxLatencyMicroseconds;
+}
+
+void IPCPerfResult::Report() const {
+  double seconds = elapsed_.InSecondsF();
+  double messages_per_second = seconds > 0 ? message_count_ / seconds : 0;
+  double mb_per_second =
+      seconds > 0 ? payload_bytes_ / 1048576.0 / seconds : 0;
+  int latency_samples = latency_histogram_->SnapshotSamples()->TotalCount();
+  double p50 = GetLatencyPercentile(0.5);
+  double p90 = GetLatencyPercentile(0.9);
+  double p99 = GetLatencyPercentile(0.99);
+  double p999 = GetLatencyPercentile(0.999);
+
+  LogPerfResult(name_.c_str(), elapsed_.InMillisecondsF(), "ms");
+  LogPerfResult((name_ + "_throughput").c_str(), messages_per_second,
+                "msgs/s");
+  LogPerfResult((name_ + "_bandwidth").c_str(), mb_per_second, "MB/s");
+  if (latency_samples) {
+    LogPerfResult((name_ + "_p50").c_str(), p50, "us");
+    LogPerfResult((name_ + "_p99").c_str(), p99, "us");
+    LogPerfResult((name_ + "_p999").c_str(), p999, "us");
+  }
+
+  const CommandLine& command_line = *CommandLine::ForCurrentProcess();
+
+  base::FilePath csv_path = command_line.GetSwitchValuePath(kCsvOutputSwitch);
+  if (!csv_path.empty()) {
+    std::string row = base::StringPrintf(
+        "%s,%d,%" PRId64 ",%.3f,%.1f,%.3f,%d,%.1f,%.1f,%.1f,%.1f\n",
+        name_.c_str(), message_count_, payload_bytes_,
+        elapsed_.InMillisecondsF(), messages_per_second, mb_per_second,
+        latency_samples, p50, p90, p99, p999);
+    if (!file_util::PathExists(csv_path))
+      row = kCsvHeader + row;
+    AppendOrCreate(csv_path, row);
+  }
+
+  base::FilePath json_path =
+      command_line.GetSwitchValuePath(kJsonOutputSwitch);
+  if (!json_path.empty()) {
+    base::DictionaryValue result;
+    result.SetString("name", name_);
+    result.SetInteger("messages", message_count_);
+    // DictionaryValue has no 64-bit integers.
+    result.SetDouble("payload_bytes", static_cast<double>(payload_bytes_));
+    result.SetDouble("elapsed_ms", elapsed_.InMillisecondsF());
+    result.SetDouble("messages_per_second", messages_per_second);
+    result.SetDouble("mb_per_second", mb_per_second);
+    result.SetInteger("latency_samples", latency_samples);
+    result.SetDouble("latency_p50_us", p50);
+    result.SetDouble("latency_p90_us", p90);
+    result.SetDouble("latency_p99_us", p99);
+    result.SetDouble("latency_p999_us", p999);
+    std::string line;
+    base::JSONWriter::Write(&result, &line);
+    AppendOrCreate(json_path, line + "\n");
+  }
+}
@@ -0,0 +1,60 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef IPC_IPC_PERF_RESULT_H_
+#define IPC_IPC_PERF_RESULT_H_
+
+#include <string>
+
+#include "base/basictypes.h"
+#include "base/time.h"
+
+namespace base {
+class HistogramBase;
+}
+
+// The result of one run of an IPC benchmark: the latency of each message or
+// round trip, kept in a base::Histogram named "IPC.Perf.<name>", and the
+// totals of the run.
+//
+// Report() logs the result with LogPerfResult() and, for comparing runs
+// across releases, appends it to the files named by the switches below:
+//   --ipc-perf-csv=<path>   one CSV row per result, after a header row if
+//                           the file is new.
+//   --ipc-perf-json=<path>  one JSON object per line.
+class IPCPerfResult {
+ public:
+  // Latencies are recorded in microseconds up to this many.
+  static const int kMaxLatencyMicroseconds;
+
+  // |name| must be unique within the process, e.g. "PingPong_Channel_1728".
+  explicit IPCPerfResult(const std::string& name);
+  ~IPCPerfResult();
+
+  void AddLatency(base::TimeDelta latency);
+
+  // Sets the totals of the run: |message_count| messages carrying
+  // |payload_bytes| bytes in total were sent in |elapsed|.
+  void SetTotals(int message_count, int64 payload_bytes,
+                 base::TimeDelta elapsed);
+
+  // Returns the latency, in microseconds, below which |fraction| of the
+  // samples fall, interpolated within its histogram bucket. Returns 0 if
+  // there are no samples.
+  double GetLatencyPercentile(double fraction) const;
+
+  void Report() const;
+
+ private:
+  std::string name_;
+  base::HistogramBase* latency_histogram_;
+
+  int message_count_;
+  int64 payload_bytes_;
+  base::TimeDelta elapsed_;
+
+  DISALLOW_COPY_AND_ASSIGN(IPCPerfResult);
+};
+
+#endif  // IPC_IPC_PERF_RESULT_H_
@@ -4,33 +4,51 @@
 
 #include "build/build_config.h"
 
+#if defined(OS_POSIX)
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
 #include <algorithm>
 #include <string>
+#include <vector>
 
 #include "base/basictypes.h"
 #include "base/logging.h"
 #include "base/memory/scoped_ptr.h"
+#include "base/memory/scoped_vector.h"
+#include "base/metrics/stats_table.h"
 #include "base/perftimer.h"
 #include "base/pickle.h"
+#include "base/pickle_buffer_pool.h"
+#include "base/process_util.h"
 #include "base/stringprintf.h"
+#include "base/synchronization/waitable_event.h"
 #include "base/threading/thread.h"
 #include "base/time.h"
 #include "ipc/ipc_descriptors.h"
 #include "ipc/ipc_channel.h"
 #include "ipc/ipc_channel_proxy.h"
 #include "ipc/ipc_message_utils.h"
+#include "ipc/ipc_perf_result.h"
 #include "ipc/ipc_sender.h"
+#include "ipc/ipc_sync_channel.h"
+#include "ipc/ipc_sync_message.h"
 #include "ipc/ipc_test_base.h"
 
+#if defined(OS_POSIX)
+#include "base/file_descriptor_posix.h"
+#include "base/posix/eintr_wrapper.h"
+#endif
+
 namespace {
 
-// This test times the roundtrip IPC message cycle.
+// The ping-pong tests below time the roundtrip IPC message cycle through a
+// Channel, a ChannelProxy and a SyncChannel.
 //
 // TODO(brettw): Make this test run by default.
 
-class IPCChannelPerfTest : public IPCTestBase {
-};
-
 // This class simply collects stats about abstract "events" (each of which has a
 // start time and an end time).
 class EventTimeTracker {
@@ -75,9 +93,28 @@ class EventTimeTracker {
   DISALLOW_COPY_AND_ASSIGN(EventTimeTracker);
 };
 
+// Type of the sync messages that the sync tests send. They are answered with
+// an empty reply.
+const uint32 kSyncPingMessageType = 4;
+
+class NullReplyDeserializer : public IPC::MessageReplyDeserializer {
+ private:
+  virtual bool SerializeOutputParameters(const IPC::Message& msg,
+                                         PickleIterator iter) OVERRIDE {
+    return true;
+  }
+};
+
+class NullListener : public IPC::Listener {
+ public:
+  virtual bool OnMessageReceived(const IPC::Message& message) OVERRIDE {
+    return false;
+  }
+};
+
 // This channel listener just replies to all messages with the exact same
 // message. It assumes each message has one string parameter. When the string
-// "quit" is sent, it will exit.
+// "quit" is sent, it will exit. Sync messages get an empty reply.
 class ChannelReflectorListener : public IPC::Listener {
  public:
   ChannelReflectorListener()
@@ -99,6 +136,11 @@ class ChannelReflectorListener : public IPC::Listener {
   virtual bool OnMessageReceived(const IPC::Message& message) OVERRIDE {
     CHECK(channel_);
 
+    if (message.is_sync()) {
+      channel_->Send(IPC::SyncMessage::GenerateReply(&message));
+      return true;
+    }
+
     PickleIterator iter(message);
     int64 time_internal;
     EXPECT_TRUE(iter.ReadInt64(&time_internal));
@@ -122,8 +164,9 @@ class ChannelReflectorListener : public IPC::Listener {
           base::TimeTicks::FromInternalValue(time_internal), now);
     }
 
+    // Echo the send time so that the server sees the round trip.
     IPC::Message* msg = new IPC::Message(0, 2, IPC::Message::PRIORITY_NORMAL);
-    msg->WriteInt64(base::TimeTicks::Now().ToInternalValue());
+    msg->WriteInt64(time_internal);
     msg->WriteInt(msgid);
     msg->WriteString(payload);
     channel_->Send(msg);
@@ -135,37 +178,39 @@ class ChannelReflectorListener : public IPC::Listener {
   EventTimeTracker latency_tracker_;
 };
 
-class PerformanceChannelListener : public IPC::Listener {
+// Drives the ping-pong benchmarks against the PerformanceClient reflector:
+// sends a message, and when it comes back records the round trip and sends
+// the next one. Several of these can run at once, one per channel.
+class PingPongListener : public IPC::Listener {
  public:
-  PerformanceChannelListener()
-      : channel_(NULL),
-        msg_count_(0),
-        msg_size_(0),
-        count_down_(0),
-        latency_tracker_("Server messages") {
-    VLOG(1) << "Server listener up";
+  PingPongListener()
+      : sender_(NULL),
+        result_(NULL),
+        running_count_(NULL),
+        count_down_(0) {
   }
 
-  virtual ~PerformanceChannelListener() {
-    VLOG(1) << "Server listener down";
+  void Init(IPC::Sender* sender) {
+    DCHECK(!sender_);
+    sender_ = sender;
   }
 
-  void Init(IPC::Channel* channel) {
-    DCHECK(!channel_);
-    channel_ = channel;
-  }
-
-  // Call this before running the message loop.
-  void SetTestParams(int msg_count, size_t msg_size) {
+  // Sends the first of |msg_count| messages of |msg_size| bytes. Round trips
+  // are recorded in |result|. |*running_count| is decremented when the last
+  // message comes back, and the current message loop quits when it hits 0.
+  void Start(int msg_count, size_t msg_size, IPCPerfResult* result,
+             int* running_count) {
     DCHECK_EQ(0, count_down_);
-    msg_count_ = msg_count;
-    msg_size_ = msg_size;
-    count_down_ = msg_count_;
-    payload_ = std::string(msg_size_, 'a');
+    DCHECK_GT(msg_count, 0);
+    count_down_ = msg_count;
+    payload_ = std::string(msg_size, 'a');
+    result_ = result;
+    running_count_ = running_count;
+    SendPing();
   }
 
   virtual bool OnMessageReceived(const IPC::Message& message) OVERRIDE {
-    CHECK(channel_);
+    CHECK(sender_);
 
     PickleIterator iter(message);
     int64 time_internal;
@@ -174,84 +219,824 @@ class PerformanceChannelListener : public IPC::Listener {
     EXPECT_TRUE(iter.ReadInt(&msgid));
     std::string reflected_payload;
     EXPECT_TRUE(iter.ReadString(&reflected_payload));
+    DCHECK_EQ(payload_.size(), reflected_payload.size());
 
     // Include message deserialization in latency.
-    base::TimeTicks now = base::TimeTicks::Now();
-
-    if (reflected_payload == "hello") {
-      // Start timing on hello.
-      latency_tracker_.Reset();
-      DCHECK(!perf_logger_.get());
-      std::string test_name = base::StringPrintf(
-          "IPC_Perf_%dx_%u", msg_count_, static_cast<unsigned>(msg_size_));
-      perf_logger_.reset(new PerfTimeLogger(test_name.c_str()));
-    } else {
-      DCHECK_EQ(payload_.size(), reflected_payload.size());
+    result_->AddLatency(base::TimeTicks::Now() -
+                        base::TimeTicks::FromInternalValue(time_internal));
 
-      latency_tracker_.AddEvent(
-          base::TimeTicks::FromInternalValue(time_internal), now);
-
-      CHECK(count_down_ > 0);
-      count_down_--;
-      if (count_down_ == 0) {
-        perf_logger_.reset();  // Stop the perf timer now.
-        latency_tracker_.ShowResults();
+    CHECK(count_down_ > 0);
+    if (--count_down_ == 0) {
+      if (--*running_count_ == 0)
         base::MessageLoop::current()->QuitWhenIdle();
-        return true;
-      }
+      return true;
     }
+    SendPing();
+    return true;
+  }
 
+ private:
+  void SendPing() {
     IPC::Message* msg = new IPC::Message(0, 2, IPC::Message::PRIORITY_NORMAL);
     msg->WriteInt64(base::TimeTicks::Now().ToInternalValue());
     msg->WriteInt(count_down_);
     msg->WriteString(payload_);
-    channel_->Send(msg);
-    return true;
+    sender_->Send(msg);
   }
 
- private:
-  IPC::Channel* channel_;
-  int msg_count_;
-  size_t msg_size_;
+  IPC::Sender* sender_;
+  IPCPerfResult* result_;
+  int* running_count_;
 
   int count_down_;
   std::string payload_;
-  EventTimeTracker latency_tracker_;
-  scoped_ptr<PerfTimeLogger> perf_logger_;
+
+  DISALLOW_COPY_AND_ASSIGN(PingPongListener);
+};
+
+class IPCChannelPerfTest : public IPCTestBase {
+ protected:
+  // Ping-pongs |msg_count| messages of 12 bytes to 248 KB through sender()
+  // and reports each size as "PingPong_<mode>_<size>".
+  void RunPingPong(PingPongListener* listener, const char* mode,
+                   int msg_count) {
+    const size_t kMsgSizeBase = 12;
+    const int kMsgSizeMaxExp = 5;
+    size_t msg_size = kMsgSizeBase;
+    for (int i = 1; i <= kMsgSizeMaxExp; i++) {
+      IPCPerfResult result(base::StringPrintf(
+          "PingPong_%s_%u", mode, static_cast<unsigned>(msg_size)));
+      int running_count = 1;
+      PerfTimer timer;
+      listener->Start(msg_count, msg_size, &result, &running_count);
+      base::MessageLoop::current()->Run();
+      result.SetTotals(msg_count, static_cast<int64>(msg_count) * msg_size,
+                       timer.Elapsed());
+      result.Report();
+
+      msg_size *= kMsgSizeBase;
+    }
+  }
+
+  void SendQuit() {
+    IPC::Message* message =
+        new IPC::Message(0, 2, IPC::Message::PRIORITY_NORMAL);
+    message->WriteInt64(base::TimeTicks::Now().ToInternalValue());
+    message->WriteInt(-1);
+    message->WriteString("quit");
+    sender()->Send(message);
+  }
 };
 
 TEST_F(IPCChannelPerfTest, Performance) {
   Init("PerformanceClient");
 
   // Set up IPC channel and start client.
-  PerformanceChannelListener listener;
+  PingPongListener listener;
   CreateChannel(&listener);
   listener.Init(channel());
   ASSERT_TRUE(ConnectChannel());
   ASSERT_TRUE(StartClient());
 
+  RunPingPong(&listener, "Channel", 100000);
+
+  SendQuit();
+  EXPECT_TRUE(WaitForClientShutdown());
+  DestroyChannel();
+}
+
+// Same as above through a ChannelProxy, which adds a thread hop each way.
+TEST_F(IPCChannelPerfTest, ChannelProxy) {
+  Init("PerformanceClient");
+
+  base::Thread io_thread("PingPongIO");
+  base::Thread::Options options(base::MessageLoop::TYPE_IO, 0);
+  ASSERT_TRUE(io_thread.StartWithOptions(options));
+
+  PingPongListener listener;
+  CreateChannelProxy(&listener, io_thread.message_loop_proxy());
+  listener.Init(channel_proxy());
+  ASSERT_TRUE(StartClient());
+
+  RunPingPong(&listener, "ChannelProxy", 20000);
+
+  SendQuit();
+  EXPECT_TRUE(WaitForClientShutdown());
+  DestroyChannelProxy();
+}
+
+// Sends sync messages through a SyncChannel, which the client answers right
+// away, and records how long each Send() blocks.
+TEST_F(IPCChannelPerfTest, SyncChannel) {
+  Init("PerformanceClient");
+
+  base::Thread io_thread("PingPongIO");
+  base::Thread::Options options(base::MessageLoop::TYPE_IO, 0);
+  ASSERT_TRUE(io_thread.StartWithOptions(options));
+
+  base::WaitableEvent shutdown_event(true, false);
+  NullListener listener;
+  CreateSyncChannel(&listener, io_thread.message_loop_proxy(),
+                    &shutdown_event);
+  ASSERT_TRUE(StartClient());
+
+  const int kMsgCount = 20000;
   const size_t kMsgSizeBase = 12;
   const int kMsgSizeMaxExp = 5;
-  int msg_count = 100000;
   size_t msg_size = kMsgSizeBase;
   for (int i = 1; i <= kMsgSizeMaxExp; i++) {
-    listener.SetTestParams(msg_count, msg_size);
+    IPCPerfResult result(base::StringPrintf(
+        "PingPong_SyncChannel_%u", static_cast<unsigned>(msg_size)));
+    std::string payload(msg_size, 'a');
+    PerfTimer timer;
+    for (int j = 0; j < kMsgCount; j++) {
+      IPC::SyncMessage* message = new IPC::SyncMessage(
+          0, kSyncPingMessageType, IPC::Message::PRIORITY_NORMAL,
+          new NullReplyDeserializer);
+      message->WriteString(payload);
+      base::TimeTicks start = base::TimeTicks::Now();
+      ASSERT_TRUE(sender()->Send(message));
+      result.AddLatency(base::TimeTicks::Now() - start);
+    }
+    result.SetTotals(kMsgCount, static_cast<int64>(kMsgCount) * msg_size,
+                     timer.Elapsed());
+    result.Report();
+
+    msg_size *= kMsgSizeBase;
+  }
+
+  SendQuit();
+  EXPECT_TRUE(WaitForClientShutdown());
+  DestroyChannelProxy();
+}
+
+// This message loop bounces all messages back to the sender.
+MULTIPROCESS_IPC_TEST_CLIENT_MAIN(PerformanceClient) {
+  base::MessageLoopForIO main_message_loop;
+  ChannelReflectorListener listener;
+  IPC::Channel channel(IPCTestBase::GetChannelName("PerformanceClient"),
+                       IPC::Channel::MODE_CLIENT,
+                       &listener);
+  listener.Init(&channel);
+  CHECK(channel.Connect());
+
+  base::MessageLoop::current()->Run();
+  return 0;
+}
+
+// The one-way tests below measure throughput and the latency of messages that
+// queue up behind each other: the server asks the client for a window of
+// messages, records when each one arrives, and asks for the next window until
+// it has received them all. Messages can carry a file descriptor.
+
+const int kOneWayRequestType = 6;
+const int kOneWayMessageType = 7;
+
+// Cap on the number of payload bytes, and of messages, sent per message size.
+const size_t kOneWayBytes = 64 * 1024 * 1024;
+const int kMaxOneWayCount = 100000;
+
+// Messages carrying descriptors are requested in small windows, so that the
+// descriptors in flight stay well below the open file limit.
+const int kOneWayFdCount = 20000;
+const int kOneWayFdWindow = 100;
+
+class OneWayReceiverListener : public IPC::Listener {
+ public:
+  OneWayReceiverListener()
+      : sender_(NULL),
+        result_(NULL),
+        msg_size_(0),
+        window_(0),
+        pass_fds_(false),
+        to_request_(0),
+        count_down_(0) {
+  }
+
+  void Init(IPC::Sender* sender) {
+    DCHECK(!sender_);
+    sender_ = sender;
+  }
+
+  // Requests |msg_count| messages of |msg_size| bytes, |window| at a time,
+  // and records their latencies in |result|. The current message loop quits
+  // after the last one.
+  void Start(int msg_count, size_t msg_size, int window, bool pass_fds,
+             IPCPerfResult* result) {
+    DCHECK_EQ(0, to_request_);
+    DCHECK_EQ(0, count_down_);
+    msg_size_ = msg_size;
+    window_ = window;
+    pass_fds_ = pass_fds;
+    result_ = result;
+    to_request_ = msg_count;
+    RequestWindow();
+  }
+
+  virtual bool OnMessageReceived(const IPC::Message& message) OVERRIDE {
+    CHECK_EQ(kOneWayMessageType, static_cast<int>(message.type()));
+
+    PickleIterator iter(message);
+    int64 time_internal;
+    EXPECT_TRUE(iter.ReadInt64(&time_internal));
+    const char* data;
+    int length;
+    EXPECT_TRUE(message.ReadData(&iter, &data, &length));
+    EXPECT_EQ(msg_size_, static_cast<size_t>(length));
+#if defined(OS_POSIX)
+    if (pass_fds_) {
+      base::FileDescriptor descriptor;
+      EXPECT_TRUE(message.ReadFileDescriptor(&iter, &descriptor));
+      if (HANDLE_EINTR(close(descriptor.fd)) < 0)
+        PLOG(ERROR) << "close";
+    }
+#endif
+
+    result_->AddLatency(base::TimeTicks::Now() -
+                        base::TimeTicks::FromInternalValue(time_internal));
+
+    CHECK(count_down_ > 0);
+    if (--count_down_ == 0) {
+      if (to_request_ == 0)
+        base::MessageLoop::current()->QuitWhenIdle();
+      else
+        RequestWindow();
+    }
+    return true;
+  }
+
+ private:
+  void RequestWindow() {
+    count_down_ = std::min(window_, to_request_);
+    to_request_ -= count_down_;
+
+    IPC::Message* message = new IPC::Message(0, kOneWayRequestType,
+                                             IPC::Message::PRIORITY_NORMAL);
+    message->WriteInt(count_down_);
+    message->WriteInt(static_cast<int>(msg_size_));
+    message->WriteBool(pass_fds_);
+    sender_->Send(message);
+  }
+
+  IPC::Sender* sender_;
+  IPCPerfResult* result_;
+  size_t msg_size_;
+  int window_;
+  bool pass_fds_;
+
+  // Messages not requested yet, and still to come in the current window.
+  int to_request_;
+  int count_down_;
+
+  DISALLOW_COPY_AND_ASSIGN(OneWayReceiverListener);
+};
+
+class OneWaySenderListener : public IPC::Listener {
+ public:
+  OneWaySenderListener() : channel_(NULL), fd_(-1) {}
+
+  // |fd| is attached to every message that asks for a descriptor.
+  void Init(IPC::Channel* channel, int fd) {
+    DCHECK(!channel_);
+    channel_ = channel;
+    fd_ = fd;
+  }
+
+  virtual bool OnMessageReceived(const IPC::Message& message) OVERRIDE {
+    CHECK(channel_);
+    CHECK_EQ(kOneWayRequestType, static_cast<int>(message.type()));
+
+    PickleIterator iter(message);
+    int msg_count;
+    EXPECT_TRUE(iter.ReadInt(&msg_count));
+    int msg_size;
+    EXPECT_TRUE(iter.ReadInt(&msg_size));
+    bool pass_fds;
+    EXPECT_TRUE(iter.ReadBool(&pass_fds));
+
+    if (msg_count < 0) {
+      base::MessageLoop::current()->QuitWhenIdle();
+      return true;
+    }
+
+    std::string payload(msg_size, 'a');
+    for (int i = 0; i < msg_count; i++) {
+      IPC::Message* msg = new IPC::Message(0, kOneWayMessageType,
+                                           IPC::Message::PRIORITY_NORMAL);
+      msg->WriteInt64(base::TimeTicks::Now().ToInternalValue());
+      msg->WriteData(payload.data(), msg_size);
+#if defined(OS_POSIX)
+      if (pass_fds)
+        msg->WriteFileDescriptor(base::FileDescriptor(fd_, false));
+#else
+      CHECK(!pass_fds);
+#endif
+      channel_->Send(msg);
+    }
+    return true;
+  }
+
+ private:
+  IPC::Channel* channel_;
+  int fd_;
+
+  DISALLOW_COPY_AND_ASSIGN(OneWaySenderListener);
+};
+
+class IPCChannelOneWayPerfTest : public IPCTestBase {
+ protected:
+  // Receives messages of 12 bytes to 20 KB and reports each size as
+  // "OneWay_<size>", or "OneWay_fd_<size>" if they carry a descriptor.
+  void RunOneWayTest(bool pass_fds) {
+    Init("OneWayClient");
+    OneWayReceiverListener listener;
+    CreateChannel(&listener);
+    listener.Init(channel());
+    ASSERT_TRUE(ConnectChannel());
+    ASSERT_TRUE(StartClient());
+
+    const size_t kMsgSizeBase = 12;
+    const int kMsgSizeMaxExp = 4;
+    size_t msg_size = kMsgSizeBase;
+    for (int i = 1; i <= kMsgSizeMaxExp; i++) {
+      int msg_count = pass_fds ? kOneWayFdCount : static_cast<int>(
+          std::min(kOneWayBytes / msg_size,
+                   static_cast<size_t>(kMaxOneWayCount)));
+      int window = pass_fds ? kOneWayFdWindow : msg_count;
+
+      IPCPerfResult result(base::StringPrintf(
+          "OneWay_%s%u", pass_fds ? "fd_" : "",
+          static_cast<unsigned>(msg_size)));
+      PerfTimer timer;
+      listener.Start(msg_count, msg_size, window, pass_fds, &result);
+      base::MessageLoop::current()->Run();
+      result.SetTotals(msg_count, static_cast<int64>(msg_count) * msg_size,
+                       timer.Elapsed());
+      result.Report();
+
+      msg_size *= kMsgSizeBase;
+    }
+
+    IPC::Message* message = new IPC::Message(0, kOneWayRequestType,
+                                             IPC::Message::PRIORITY_NORMAL);
+    message->WriteInt(-1);
+    message->WriteInt(0);
+    message->WriteBool(false);
+    sender()->Send(message);
+
+    EXPECT_TRUE(WaitForClientShutdown());
+    DestroyChannel();
+  }
+};
+
+TEST_F(IPCChannelOneWayPerfTest, Throughput) {
+  RunOneWayTest(false);
+}
+
+#if defined(OS_POSIX)
+TEST_F(IPCChannelOneWayPerfTest, FileDescriptors) {
+  RunOneWayTest(true);
+}
+#endif
+
+MULTIPROCESS_IPC_TEST_CLIENT_MAIN(OneWayClient) {
+  base::MessageLoopForIO main_message_loop;
+  int fd = -1;
+#if defined(OS_POSIX)
+  fd = HANDLE_EINTR(open("/dev/null", O_RDONLY));
+  CHECK_GE(fd, 0);
+#endif
+  OneWaySenderListener listener;
+  IPC::Channel channel(IPCTestBase::GetChannelName("OneWayClient"),
+                       IPC::Channel::MODE_CLIENT,
+                       &listener);
+  listener.Init(&channel, fd);
+  CHECK(channel.Connect());
+
+  base::MessageLoop::current()->Run();
+#if defined(OS_POSIX)
+  if (HANDLE_EINTR(close(fd)) < 0)
+    PLOG(ERROR) << "close";
+#endif
+  return 0;
+}
+
+// The large message tests below measure receive cost for messages that are
+// many times Channel::kReadBufferSize. The server asks the client for a burst
+// of large messages and times how long it takes to receive all of them.
+
+const int kLargeMessageRequestType = 4;
+const int kLargeMessageType = 5;
+
+// Cap on the number of payload bytes requested per burst.
+const size_t kLargeMessageBurstBytes = 64 * 1024 * 1024;
+
+class LargeMessageReceiverListener : public IPC::Listener {
+ public:
+  LargeMessageReceiverListener() : expected_size_(0), count_down_(0) {}
+
+  // Call this before running the message loop.
+  void SetTestParams(int msg_count, size_t msg_size) {
+    DCHECK_EQ(0, count_down_);
+    count_down_ = msg_count;
+    expected_size_ = msg_size;
+  }
+
+  virtual bool OnMessageReceived(const IPC::Message& message) OVERRIDE {
+    CHECK_EQ(kLargeMessageType, static_cast<int>(message.type()));
+
+    PickleIterator iter(message);
+    const char* data;
+    int length;
+    EXPECT_TRUE(message.ReadData(&iter, &data, &length));
+    EXPECT_EQ(expected_size_, static_cast<size_t>(length));
+
+    CHECK(count_down_ > 0);
+    if (--count_down_ == 0)
+      base::MessageLoop::current()->QuitWhenIdle();
+    return true;
+  }
+
+ private:
+  size_t expected_size_;
+  int count_down_;
+
+  DISALLOW_COPY_AND_ASSIGN(LargeMessageReceiverListener);
+};
+
+class LargeMessageSenderListener : public IPC::Listener {
+ public:
+  LargeMessageSenderListener() : channel_(NULL) {}
+
+  void Init(IPC::Channel* channel) {
+    DCHECK(!channel_);
+    channel_ = channel;
+  }
+
+  virtual bool OnMessageReceived(const IPC::Message& message) OVERRIDE {
+    CHECK(channel_);
+    CHECK_EQ(kLargeMessageRequestType, static_cast<int>(message.type()));
+
+    PickleIterator iter(message);
+    int msg_count;
+    EXPECT_TRUE(iter.ReadInt(&msg_count));
+    int msg_size;
+    EXPECT_TRUE(iter.ReadInt(&msg_size));
+
+    if (msg_count < 0) {
+      base::MessageLoop::current()->QuitWhenIdle();
+      return true;
+    }
+
+    std::string payload(msg_size, 'a');
+    for (int i = 0; i < msg_count; i++) {
+      IPC::Message* msg = new IPC::Message(0, kLargeMessageType,
+                                           IPC::Message::PRIORITY_NORMAL);
+      msg->WriteData(payload.data(), msg_size);
+      channel_->Send(msg);
+    }
+    return true;
+  }
+
+ private:
+  IPC::Channel* channel_;
+
+  DISALLOW_COPY_AND_ASSIGN(LargeMessageSenderListener);
+};
+
+class IPCChannelLargeMessagePerfTest : public IPCTestBase {
+ protected:
+  void RunLargeMessageTest(bool large_message_buffer) {
+    IPC::Channel::SetLargeMessageBufferEnabled(large_message_buffer);
+
+    Init("LargeMessageClient");
+    LargeMessageReceiverListener listener;
+    CreateChannel(&listener);
+    ASSERT_TRUE(ConnectChannel());
+    ASSERT_TRUE(StartClient());
+
+    const char* mode = large_message_buffer ? "direct" : "overflow";
+    const size_t kMsgSizes[] = { 64 * 1024, 512 * 1024, 4 * 1024 * 1024 };
+    for (size_t i = 0; i < arraysize(kMsgSizes); i++) {
+      size_t msg_size = kMsgSizes[i];
+      int msg_count = static_cast<int>(kLargeMessageBurstBytes / msg_size);
+      listener.SetTestParams(msg_count, msg_size);
+
+      std::string test_name = base::StringPrintf(
+          "IPC_LargeMessage_%s_%dx_%u", mode, msg_count,
+          static_cast<unsigned>(msg_size));
+      PerfTimeLogger logger(test_name.c_str());
+
+      IPC::Message* message = new IPC::Message(
+          0, kLargeMessageRequestType, IPC::Message::PRIORITY_NORMAL);
+      message->WriteInt(msg_count);
+      message->WriteInt(static_cast<int>(msg_size));
+      sender()->Send(message);
+      base::MessageLoop::current()->Run();
+    }
+
+    IPC::Message* message = new IPC::Message(
+        0, kLargeMessageRequestType, IPC::Message::PRIORITY_NORMAL);
+    message->WriteInt(-1);
+    message->WriteInt(0);
+    sender()->Send(message);
+
+    EXPECT_TRUE(WaitForClientShutdown());
+    DestroyChannel();
+
+    IPC::Channel::SetLargeMessageBufferEnabled(true);
+  }
+};
+
+TEST_F(IPCChannelLargeMessagePerfTest, OverflowBuffer) {
+  RunLargeMessageTest(false);
+}
+
+TEST_F(IPCChannelLargeMessagePerfTest, LargeMessageBuffer) {
+  RunLargeMessageTest(true);
+}
+
+MULTIPROCESS_IPC_TEST_CLIENT_MAIN(LargeMessageClient) {
+  base::MessageLoopForIO main_message_loop;
+  LargeMessageSenderListener listener;
+  IPC::Channel channel(IPCTestBase::GetChannelName("LargeMessageClient"),
+                       IPC::Channel::MODE_CLIENT,
+                       &listener);
+  listener.Init(&channel);
+  CHECK(channel.Connect());
+
+  base::MessageLoop::current()->Run();
+  return 0;
+}
+
+#if defined(OS_POSIX)
+// The burst tests below measure one-way throughput: the server queues a burst
+// of messages back to back and the client acknowledges the last one. Unlike
+// the ping-pong test above this lets messages pile up in the channel's output
+// queue, which is where batched (vectored) writes make a difference.
+
+// Total number of payload bytes sent per burst, and the cap on the number of
+// messages in a burst.
+const size_t kBurstBytes = 64 * 1024 * 1024;
+const int kMaxBurstCount = 100000;
+
+// Type of the message the client sends back after the last message of a
+// burst.
+const int kBurstAckMessageType = 3;
+
+class BurstAckListener : public IPC::Listener {
+ public:
+  BurstAckListener() {}
+
+  virtual bool OnMessageReceived(const IPC::Message& message) OVERRIDE {
+    CHECK_EQ(kBurstAckMessageType, static_cast<int>(message.type()));
+    base::MessageLoop::current()->QuitWhenIdle();
+    return true;
+  }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(BurstAckListener);
+};
+
+// Client side of the burst tests. Every message carries the number of
+// messages still to come in its burst; the one carrying 0 is acknowledged.
+class BurstReceiverListener : public IPC::Listener {
+ public:
+  BurstReceiverListener() : channel_(NULL) {}
+
+  void Init(IPC::Channel* channel) {
+    DCHECK(!channel_);
+    channel_ = channel;
+  }
+
+  virtual bool OnMessageReceived(const IPC::Message& message) OVERRIDE {
+    CHECK(channel_);
+
+    PickleIterator iter(message);
+    int remaining;
+    EXPECT_TRUE(iter.ReadInt(&remaining));
+    std::string payload;
+    EXPECT_TRUE(iter.ReadString(&payload));
+
+    if (payload == "quit") {
+      base::MessageLoop::current()->QuitWhenIdle();
+      return true;
+    }
+    if (remaining == 0) {
+      channel_->Send(new IPC::Message(0, kBurstAckMessageType,
+                                      IPC::Message::PRIORITY_NORMAL));
+    }
+    return true;
+  }
+
+ private:
+  IPC::Channel* channel_;
+
+  DISALLOW_COPY_AND_ASSIGN(BurstReceiverListener);
+};
+
+class IPCChannelBurstPerfTest : public IPCTestBase {
+ protected:
+  // Sends bursts of 12 byte to 248 KB messages and logs the elapsed time,
+  // the throughput and the number of send syscalls per message.
+  void RunBurstTest(bool batched_writes) {
+    IPC::Channel::SetBatchedWritesEnabled(batched_writes);
+
+    // The channel counts its send syscalls in the current StatsTable.
+    const std::string kTableName = base::StringPrintf(
+        "IPCBurstPerfStats_%d", static_cast<int>(base::GetCurrentProcId()));
+    base::StatsTable table(kTableName, 4, 10);
+    base::StatsTable::set_current(&table);
+
+    Init("BurstClient");
+    BurstAckListener listener;
+    CreateChannel(&listener);
+    ASSERT_TRUE(ConnectChannel());
+    ASSERT_TRUE(StartClient());
+
+    const char* mode = batched_writes ? "batched" : "unbatched";
+    const size_t kMsgSizeBase = 12;
+    const int kMsgSizeMaxExp = 5;
+    size_t msg_size = kMsgSizeBase;
+    for (int i = 1; i <= kMsgSizeMaxExp; i++) {
+      int msg_count = static_cast<int>(
+          std::min(kBurstBytes / msg_size, static_cast<size_t>(kMaxBurstCount)));
+      std::string payload(msg_size, 'a');
+      int syscalls_before = table.GetCounterValue("c:IPC.SendSyscalls");
+
+      std::string test_name = base::StringPrintf(
+          "IPC_Burst_%s_%dx_%u", mode, msg_count,
+          static_cast<unsigned>(msg_size));
+      PerfTimer timer;
+      for (int j = msg_count - 1; j >= 0; j--) {
+        IPC::Message* message =
+            new IPC::Message(0, 2, IPC::Message::PRIORITY_NORMAL);
+        message->WriteInt(j);
+        message->WriteString(payload);
+        sender()->Send(message);
+      }
+      base::MessageLoop::current()->Run();
+      base::TimeDelta elapsed = timer.Elapsed();
+
+      int syscalls = table.GetCounterValue("c:IPC.SendSyscalls") -
+          syscalls_before;
+      LogPerfResult(test_name.c_str(), elapsed.InMillisecondsF(), "ms");
+      LogPerfResult((test_name + "_throughput").c_str(),
+                    msg_count * msg_size / 1048576.0 / elapsed.InSecondsF(),
+                    "MB/s");
+      LogPerfResult((test_name + "_syscalls").c_str(),
+                    static_cast<double>(syscalls) / msg_count, "syscalls/msg");
+
+      msg_size *= kMsgSizeBase;
+    }
 
-    // This initial message will kick-start the ping-pong of messages.
     IPC::Message* message =
         new IPC::Message(0, 2, IPC::Message::PRIORITY_NORMAL);
-    message->WriteInt64(base::TimeTicks::Now().ToInternalValue());
     message->WriteInt(-1);
-    message->WriteString("hello");
+    message->WriteString("quit");
     sender()->Send(message);
 
-    // Run message loop.
-    base::MessageLoop::current()->Run();
+    EXPECT_TRUE(WaitForClientShutdown());
+    DestroyChannel();
 
-    msg_size *= kMsgSizeBase;
+    base::StatsTable::set_current(NULL);
+    IPC::Channel::SetBatchedWritesEnabled(false);
+  }
+};
+
+TEST_F(IPCChannelBurstPerfTest, Unbatched) {
+  RunBurstTest(false);
+}
+
+TEST_F(IPCChannelBurstPerfTest, Batched) {
+  RunBurstTest(true);
+}
+
+MULTIPROCESS_IPC_TEST_CLIENT_MAIN(BurstClient) {
+  base::MessageLoopForIO main_message_loop;
+  BurstReceiverListener listener;
+  IPC::Channel channel(IPCTestBase::GetChannelName("BurstClient"),
+                       IPC::Channel::MODE_CLIENT,
+                       &listener);
+  listener.Init(&channel);
+  CHECK(channel.Connect());
+
+  base::MessageLoop::current()->Run();
+  return 0;
+}
+
+// The concurrent test below ping-pongs on several channels at once between
+// the same two processes, all served by one IO thread on each side. The extra
+// channels are socketpairs whose client ends are passed over the first one.
+
+// Type of the message carrying the client end of an extra channel.
+const int kConnectChannelMessageType = 8;
+
+const int kConcurrentChannelCounts[] = { 1, 4, 16 };
+const int kConcurrentMsgCount = 20000;
+const size_t kConcurrentMsgSize = 144;
+
+bool CreateNonBlockingSocketPair(int* fd1, int* fd2) {
+  int fds[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+    PLOG(ERROR) << "socketpair";
+    return false;
+  }
+  if (fcntl(fds[0], F_SETFL, O_NONBLOCK) == -1 ||
+      fcntl(fds[1], F_SETFL, O_NONBLOCK) == -1) {
+    PLOG(ERROR) << "fcntl(O_NONBLOCK)";
+    ignore_result(HANDLE_EINTR(close(fds[0])));
+    ignore_result(HANDLE_EINTR(close(fds[1])));
+    return false;
+  }
+  *fd1 = fds[0];
+  *fd2 = fds[1];
+  return true;
+}
+
+// Reflects messages like ChannelReflectorListener, and opens a reflecting
+// channel for every descriptor it is sent.
+class ConcurrentClientListener : public ChannelReflectorListener {
+ public:
+  ConcurrentClientListener() {}
+
+  virtual bool OnMessageReceived(const IPC::Message& message) OVERRIDE {
+    if (static_cast<int>(message.type()) != kConnectChannelMessageType)
+      return ChannelReflectorListener::OnMessageReceived(message);
+
+    PickleIterator iter(message);
+    base::FileDescriptor descriptor;
+    EXPECT_TRUE(message.ReadFileDescriptor(&iter, &descriptor));
+    std::string name = base::StringPrintf(
+        "ConcurrentChannel_%u", static_cast<unsigned>(channels_.size()));
+    reflectors_.push_back(new ChannelReflectorListener);
+    channels_.push_back(new IPC::Channel(
+        IPC::ChannelHandle(name, base::FileDescriptor(descriptor.fd, false)),
+        IPC::Channel::MODE_CLIENT, reflectors_.back()));
+    reflectors_.back()->Init(channels_.back());
+    CHECK(channels_.back()->Connect());
+    return true;
+  }
+
+ private:
+  // Declared first, so the channels are destroyed first.
+  ScopedVector<ChannelReflectorListener> reflectors_;
+  ScopedVector<IPC::Channel> channels_;
+
+  DISALLOW_COPY_AND_ASSIGN(ConcurrentClientListener);
+};
+
+class IPCChannelConcurrentPerfTest : public IPCTestBase {
+};
+
+TEST_F(IPCChannelConcurrentPerfTest, PingPong) {
+  Init("ConcurrentClient");
+  NullListener primary_listener;
+  CreateChannel(&primary_listener);
+  ASSERT_TRUE(ConnectChannel());
+  ASSERT_TRUE(StartClient());
+
+  const int kMaxChannelCount = kConcurrentChannelCounts[
+      arraysize(kConcurrentChannelCounts) - 1];
+  ScopedVector<PingPongListener> listeners;
+  ScopedVector<IPC::Channel> channels;
+  for (int i = 0; i < kMaxChannelCount; i++) {
+    int server_fd, client_fd;
+    ASSERT_TRUE(CreateNonBlockingSocketPair(&server_fd, &client_fd));
+
+    IPC::Message* message = new IPC::Message(0, kConnectChannelMessageType,
+                                             IPC::Message::PRIORITY_NORMAL);
+    message->WriteFileDescriptor(base::FileDescriptor(client_fd, true));
+    sender()->Send(message);
+
+    std::string name = base::StringPrintf("ConcurrentChannel_%d", i);
+    listeners.push_back(new PingPongListener);
+    channels.push_back(new IPC::Channel(
+        IPC::ChannelHandle(name, base::FileDescriptor(server_fd, false)),
+        IPC::Channel::MODE_SERVER, listeners.back()));
+    listeners.back()->Init(channels.back());
+    ASSERT_TRUE(channels.back()->Connect());
+  }
+
+  for (size_t i = 0; i < arraysize(kConcurrentChannelCounts); i++) {
+    int channel_count = kConcurrentChannelCounts[i];
+    IPCPerfResult result(base::StringPrintf(
+        "Concurrent_%dch_%u", channel_count,
+        static_cast<unsigned>(kConcurrentMsgSize)));
+    int running_count = channel_count;
+    PerfTimer timer;
+    for (int j = 0; j < channel_count; j++) {
+      listeners[j]->Start(kConcurrentMsgCount, kConcurrentMsgSize, &result,
+                          &running_count);
+    }
+    base::MessageLoop::current()->Run();
+    int total_count = kConcurrentMsgCount * channel_count;
+    result.SetTotals(total_count,
+                     static_cast<int64>(total_count) * kConcurrentMsgSize,
+                     timer.Elapsed());
+    result.Report();
   }
 
-  // Send quit message.
   IPC::Message* message = new IPC::Message(0, 2, IPC::Message::PRIORITY_NORMAL);
   message->WriteInt64(base::TimeTicks::Now().ToInternalValue());
   message->WriteInt(-1);
@@ -259,14 +1044,14 @@ TEST_F(IPCChannelPerfTest, Performance) {
   sender()->Send(message);
 
   EXPECT_TRUE(WaitForClientShutdown());
+  channels.clear();
   DestroyChannel();
 }
 
-// This message loop bounces all messages back to the sender.
-MULTIPROCESS_IPC_TEST_CLIENT_MAIN(PerformanceClient) {
+MULTIPROCESS_IPC_TEST_CLIENT_MAIN(ConcurrentClient) {
   base::MessageLoopForIO main_message_loop;
-  ChannelReflectorListener listener;
-  IPC::Channel channel(IPCTestBase::GetChannelName("PerformanceClient"),
+  ConcurrentClientListener listener;
+  IPC::Channel channel(IPCTestBase::GetChannelName("ConcurrentClient"),
                        IPC::Channel::MODE_CLIENT,
                        &listener);
   listener.Init(&channel);
@@ -275,5 +1060,289 @@ MULTIPROCESS_IPC_TEST_CLIENT_MAIN(PerformanceClient) {
   base::MessageLoop::current()->Run();
   return 0;
 }
+#endif  // defined(OS_POSIX)
+
+// The serialization tests below compare the per element cost of writing and
+// reading vectors and tuples of blittable types one element at a time (how
+// ParamTraits used to do it) and in bulk (how they do it now).
+
+const int kSerializationElementCount = 1000000;
+const int kSerializationRepeatCount = 20;
+
+void LogNsPerElement(const std::string& test_name,
+                     const base::TimeDelta& elapsed,
+                     int element_count) {
+  LogPerfResult(test_name.c_str(),
+                elapsed.InMillisecondsF() * 1000000.0 / element_count,
+                "ns/element");
+}
+
+TEST(IPCSerializationPerfTest, IntVector) {
+  std::vector<int> input(kSerializationElementCount);
+  for (size_t i = 0; i < input.size(); ++i)
+    input[i] = static_cast<int>(i);
+  const int kTotal = kSerializationElementCount * kSerializationRepeatCount;
+
+  // Writes and reads the elements one by one.
+  base::TimeDelta write_elapsed;
+  base::TimeDelta read_elapsed;
+  for (int i = 0; i < kSerializationRepeatCount; ++i) {
+    IPC::Message message(0, 2, IPC::Message::PRIORITY_NORMAL);
+    PerfTimer write_timer;
+    message.WriteInt(static_cast<int>(input.size()));
+    for (size_t j = 0; j < input.size(); ++j)
+      IPC::WriteParam(&message, input[j]);
+    write_elapsed += write_timer.Elapsed();
+
+    std::vector<int> output;
+    PickleIterator iter(message);
+    PerfTimer read_timer;
+    int size;
+    ASSERT_TRUE(message.ReadLength(&iter, &size));
+    output.resize(size);
+    for (int j = 0; j < size; ++j)
+      ASSERT_TRUE(IPC::ReadParam(&message, &iter, &output[j]));
+    read_elapsed += read_timer.Elapsed();
+  }
+  LogNsPerElement("IPC_Serialize_IntVector_Write_per_element", write_elapsed,
+                  kTotal);
+  LogNsPerElement("IPC_Serialize_IntVector_Read_per_element", read_elapsed,
+                  kTotal);
+
+  write_elapsed = base::TimeDelta();
+  read_elapsed = base::TimeDelta();
+  for (int i = 0; i < kSerializationRepeatCount; ++i) {
+    IPC::Message message(0, 2, IPC::Message::PRIORITY_NORMAL);
+    PerfTimer write_timer;
+    IPC::WriteParam(&message, input);
+    write_elapsed += write_timer.Elapsed();
+
+    std::vector<int> output;
+    PickleIterator iter(message);
+    PerfTimer read_timer;
+    ASSERT_TRUE(IPC::ReadParam(&message, &iter, &output));
+    read_elapsed += read_timer.Elapsed();
+    ASSERT_EQ(input, output);
+  }
+  LogNsPerElement("IPC_Serialize_IntVector_Write_bulk", write_elapsed, kTotal);
+  LogNsPerElement("IPC_Serialize_IntVector_Read_bulk", read_elapsed, kTotal);
+}
+
+TEST(IPCSerializationPerfTest, Tuple) {
+  typedef Tuple5<int, int, uint32, int64, uint64> TupleType;
+  TupleType input(1, -2, 3U, GG_INT64_C(-4), GG_UINT64_C(5));
+  const int kTotal = kSerializationElementCount;
+
+  // One message per tuple, like the parameters of a message.
+  IPC::Message message(0, 2, IPC::Message::PRIORITY_NORMAL);
+  PerfTimer per_member_timer;
+  for (int i = 0; i < kSerializationElementCount; ++i) {
+    message = IPC::Message(0, 2, IPC::Message::PRIORITY_NORMAL);
+    IPC::WriteParam(&message, input.a);
+    IPC::WriteParam(&message, input.b);
+    IPC::WriteParam(&message, input.c);
+    IPC::WriteParam(&message, input.d);
+    IPC::WriteParam(&message, input.e);
+  }
+  LogNsPerElement("IPC_Serialize_Tuple5_Write_per_member",
+                  per_member_timer.Elapsed(), kTotal);
+
+  PerfTimer bulk_timer;
+  for (int i = 0; i < kSerializationElementCount; ++i) {
+    message = IPC::Message(0, 2, IPC::Message::PRIORITY_NORMAL);
+    IPC::WriteParam(&message, input);
+  }
+  LogNsPerElement("IPC_Serialize_Tuple5_Write_bulk", bulk_timer.Elapsed(),
+                  kTotal);
+
+  TupleType output;
+  PerfTimer read_per_member_timer;
+  for (int i = 0; i < kSerializationElementCount; ++i) {
+    PickleIterator iter(message);
+    ASSERT_TRUE(IPC::ReadParam(&message, &iter, &output.a) &&
+                IPC::ReadParam(&message, &iter, &output.b) &&
+                IPC::ReadParam(&message, &iter, &output.c) &&
+                IPC::ReadParam(&message, &iter, &output.d) &&
+                IPC::ReadParam(&message, &iter, &output.e));
+  }
+  LogNsPerElement("IPC_Serialize_Tuple5_Read_per_member",
+                  read_per_member_timer.Elapsed(), kTotal);
+
+  PerfTimer read_bulk_timer;
+  for (int i = 0; i < kSerializationElementCount; ++i) {
+    PickleIterator iter(message);
+    ASSERT_TRUE(IPC::ReadParam(&message, &iter, &output));
+  }
+  LogNsPerElement("IPC_Serialize_Tuple5_Read_bulk", read_bulk_timer.Elapsed(),
+                  kTotal);
+}
+
+// The buffer pool test below builds, copies and destroys messages the way a
+// channel does: the sender builds one, the IPC thread copies an incoming one
+// for the listener thread. It compares base::internal::PickleBufferPool with
+// plain realloc().
+
+const int kBufferPoolMessageCount = 1000000;
+
+void RunBufferPoolTest(bool pooled) {
+  const std::string kTableName = base::StringPrintf(
+      "IPCBufferPoolPerfStats_%d", static_cast<int>(base::GetCurrentProcId()));
+  base::StatsTable table(kTableName, 4, 10);
+  base::StatsTable::set_current(&table);
+  base::internal::PickleBufferPool::SetEnabled(pooled);
+
+  const char* mode = pooled ? "pooled" : "unpooled";
+  const size_t kMsgSizeBase = 12;
+  const int kMsgSizeMaxExp = 4;
+  size_t msg_size = kMsgSizeBase;
+  for (int i = 1; i <= kMsgSizeMaxExp; i++) {
+    std::string payload(msg_size, 'a');
+    int allocs_before = table.GetCounterValue("c:Pickle.BufferAllocs");
+
+    PerfTimer timer;
+    for (int j = 0; j < kBufferPoolMessageCount; ++j) {
+      IPC::Message message(0, 2, IPC::Message::PRIORITY_NORMAL);
+      message.WriteInt(j);
+      message.WriteString(payload);
+      IPC::Message copy(message);
+    }
+    base::TimeDelta elapsed = timer.Elapsed();
+
+    std::string test_name = base::StringPrintf(
+        "IPC_BufferPool_%s_%u", mode, static_cast<unsigned>(msg_size));
+    LogPerfResult(test_name.c_str(),
+                  elapsed.InMillisecondsF() * 1000000.0 /
+                      kBufferPoolMessageCount,
+                  "ns/msg");
+    if (pooled) {
+      int allocs = table.GetCounterValue("c:Pickle.BufferAllocs") -
+          allocs_before;
+      LogPerfResult((test_name + "_heap_allocs").c_str(),
+                    static_cast<double>(allocs) / kBufferPoolMessageCount,
+                    "allocs/msg");
+    }
+
+    msg_size *= kMsgSizeBase;
+  }
+
+  base::internal::PickleBufferPool::SetEnabled(true);
+  base::StatsTable::set_current(NULL);
+}
+
+TEST(IPCBufferPoolPerfTest, Unpooled) {
+  RunBufferPoolTest(false);
+}
+
+TEST(IPCBufferPoolPerfTest, Pooled) {
+  RunBufferPoolTest(true);
+}
+
+// The sync round trip test below measures the latency of SyncChannel::Send()
+// in process. The peer answers on its IPC thread from a MessageFilter, so the
+// measurement is dominated by the sync send path: handing the message to the
+// IPC thread, matching the reply and waking the sending thread.
+
+class SyncPingReplyFilter : public IPC::ChannelProxy::MessageFilter {
+ public:
+  SyncPingReplyFilter() : channel_(NULL) {}
+
+  virtual void OnFilterAdded(IPC::Channel* channel) OVERRIDE {
+    channel_ = channel;
+  }
+
+  virtual void OnFilterRemoved() OVERRIDE {
+    channel_ = NULL;
+  }
+
+  virtual bool OnMessageReceived(const IPC::Message& message) OVERRIDE {
+    if (message.type() != kSyncPingMessageType)
+      return false;
+    CHECK(channel_);
+    channel_->Send(IPC::SyncMessage::GenerateReply(&message));
+    return true;
+  }
+
+ private:
+  virtual ~SyncPingReplyFilter() {}
+
+  IPC::Channel* channel_;
+
+  DISALLOW_COPY_AND_ASSIGN(SyncPingReplyFilter);
+};
+
+class IPCSyncChannelPerfTest : public testing::Test {
+ protected:
+  // Sends sync messages one after the other and logs the 50th, 99th and
+  // 99.9th percentiles of the round trip times. |pump| makes the sends run
+  // a nested message loop while they wait.
+  void RunSyncRoundTripTest(bool pump) {
+    const int kWarmUpCount = 1000;
+    const int kRoundTripCount = 100000;
+
+    base::Thread io_thread("SyncPerfIO");
+    base::Thread::Options options(base::MessageLoop::TYPE_IO, 0);
+    ASSERT_TRUE(io_thread.StartWithOptions(options));
+
+    std::string channel_name =
+        IPC::Channel::GenerateUniqueRandomChannelID();
+    base::WaitableEvent shutdown_event(true, false);
+    NullListener listener;
+    scoped_ptr<IPC::SyncChannel> sender(new IPC::SyncChannel(
+        channel_name, IPC::Channel::MODE_SERVER, &listener,
+        io_thread.message_loop_proxy(), true, &shutdown_event));
+    scoped_ptr<IPC::ChannelProxy> replier(new IPC::ChannelProxy(
+        channel_name, IPC::Channel::MODE_CLIENT, &listener,
+        io_thread.message_loop_proxy()));
+    replier->AddFilter(new SyncPingReplyFilter);
+
+    std::vector<double> latencies_us;
+    latencies_us.reserve(kRoundTripCount);
+    for (int i = 0; i < kWarmUpCount + kRoundTripCount; ++i) {
+      IPC::SyncMessage* message = new IPC::SyncMessage(
+          MSG_ROUTING_CONTROL, kSyncPingMessageType,
+          IPC::Message::PRIORITY_NORMAL, new NullReplyDeserializer);
+      if (pump)
+        message->EnableMessagePumping();
+      base::TimeTicks start = base::TimeTicks::HighResNow();
+      ASSERT_TRUE(sender->Send(message));
+      base::TimeDelta elapsed = base::TimeTicks::HighResNow() - start;
+      if (i >= kWarmUpCount)
+        latencies_us.push_back(elapsed.InMillisecondsF() * 1000.0);
+    }
+
+    std::sort(latencies_us.begin(), latencies_us.end());
+    const char* mode = pump ? "pump" : "wait";
+    const struct {
+      const char* name;
+      double fraction;
+    } kPercentiles[] = {
+      { "p50", 0.5 },
+      { "p99", 0.99 },
+      { "p999", 0.999 },
+    };
+    for (size_t i = 0; i < arraysize(kPercentiles); ++i) {
+      size_t index = static_cast<size_t>(
+          kPercentiles[i].fraction * (latencies_us.size() - 1));
+      std::string test_name = base::StringPrintf(
+          "IPC_SyncRoundTrip_%s_%s", mode, kPercentiles[i].name);
+      LogPerfResult(test_name.c_str(), latencies_us[index], "us");
+    }
+
+    replier.reset();
+    sender.reset();
+    io_thread.Stop();
+  }
+
+ private:
+  base::MessageLoopForIO message_loop_;
+};
+
+TEST_F(IPCSyncChannelPerfTest, RoundTripLatency) {
+  RunSyncRoundTripTest(false);
+}
+
+TEST_F(IPCSyncChannelPerfTest, RoundTripLatencyWithPumping) {
+  RunSyncRoundTripTest(true);
+}
 
 }  // namespace
@@ -0,0 +1,245 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ipc/ipc_shared_memory_ring_linux.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "base/atomicops.h"
+#include "base/logging.h"
+#include "base/posix/eintr_wrapper.h"
+
+namespace IPC {
+namespace internal {
+
+namespace {
+
+// Identifies a segment set up by SharedMemoryRing::Create().
+const uint32 kRingMagic = 0x52494e47;  // 'RING'
+
+// Rings larger than this could not express a full ring in an int.
+const size_t kMaxCapacity = 1 << 30;
+
+}  // namespace
+
+// Lives at the start of the shared memory segment. The producer and consumer
+// fields are kept on separate cache lines so that the two sides do not keep
+// stealing the same line from each other.
+struct SharedMemoryRing::Header {
+  uint32 magic;
+  uint32 capacity;
+  char padding0[56];
+
+  // Written by the producer.
+  base::subtle::Atomic32 write_pos;
+  // Raised by the consumer, lowered by the producer.
+  base::subtle::Atomic32 reader_waiting;
+  char padding1[56];
+
+  // Written by the consumer.
+  base::subtle::Atomic32 read_pos;
+  // Raised by the producer, lowered by the consumer.
+  base::subtle::Atomic32 writer_waiting;
+  char padding2[56];
+};
+
+SharedMemoryRing::SharedMemoryRing()
+    : header_(NULL),
+      data_(NULL),
+      capacity_(0),
+      position_(0) {
+}
+
+SharedMemoryRing::~SharedMemoryRing() {
+}
+
+// static
+scoped_ptr<SharedMemoryRing> SharedMemoryRing::Create(size_t capacity) {
+  DCHECK(capacity && !(capacity & (capacity - 1))) << "not a power of two";
+  DCHECK_LE(capacity, kMaxCapacity);
+
+  scoped_ptr<SharedMemoryRing> ring(new SharedMemoryRing);
+  size_t mapped_size = sizeof(Header) + capacity;
+  ring->shared_memory_.reset(new base::SharedMemory);
+  if (!ring->shared_memory_->CreateAnonymous(mapped_size) ||
+      !ring->shared_memory_->Map(mapped_size)) {
+    DLOG(ERROR) << "Unable to create shared memory ring of " << capacity
+                << " bytes";
+    return scoped_ptr<SharedMemoryRing>();
+  }
+
+  // The segment starts out zeroed. The consumer starts out waiting so that the
+  // first write rings the doorbell.
+  Header* header = static_cast<Header*>(ring->shared_memory_->memory());
+  header->magic = kRingMagic;
+  header->capacity = static_cast<uint32>(capacity);
+  base::subtle::Release_Store(&header->reader_waiting, 1);
+
+  if (!ring->Init(mapped_size))
+    return scoped_ptr<SharedMemoryRing>();
+  return ring.Pass();
+}
+
+// static
+scoped_ptr<SharedMemoryRing> SharedMemoryRing::Open(
+    const base::SharedMemoryHandle& handle,
+    size_t mapped_size) {
+  scoped_ptr<SharedMemoryRing> ring(new SharedMemoryRing);
+  // Takes ownership of |handle|, even if mapping fails below.
+  ring->shared_memory_.reset(new base::SharedMemory(handle, false));
+  if (mapped_size <= sizeof(Header) ||
+      mapped_size > sizeof(Header) + kMaxCapacity ||
+      !ring->shared_memory_->Map(mapped_size)) {
+    DLOG(ERROR) << "Unable to map shared memory ring of " << mapped_size
+                << " bytes";
+    return scoped_ptr<SharedMemoryRing>();
+  }
+
+  if (!ring->Init(mapped_size))
+    return scoped_ptr<SharedMemoryRing>();
+  // We are the producer; pick up where the (empty) ring stands.
+  ring->position_ = static_cast<uint32>(
+      base::subtle::Acquire_Load(&ring->header_->write_pos));
+  return ring.Pass();
+}
+
+bool SharedMemoryRing::Init(size_t mapped_size) {
+  header_ = static_cast<Header*>(shared_memory_->memory());
+  size_t capacity = header_->capacity;
+  if (header_->magic != kRingMagic ||
+      !capacity || (capacity & (capacity - 1)) ||
+      sizeof(Header) + capacity != mapped_size) {
+    LOG(ERROR) << "Invalid shared memory ring header";
+    header_ = NULL;
+    return false;
+  }
+  // Latch the capacity; the copy in shared memory is not looked at again.
+  capacity_ = capacity;
+  data_ = reinterpret_cast<char*>(header_ + 1);
+  return true;
+}
+
+base::SharedMemoryHandle SharedMemoryRing::handle() const {
+  return shared_memory_->handle();
+}
+
+size_t SharedMemoryRing::mapped_size() const {
+  return sizeof(Header) + capacity_;
+}
+
+int SharedMemoryRing::Write(const char* data, size_t len) {
+  uint32 read_pos = static_cast<uint32>(
+      base::subtle::Acquire_Load(&header_->read_pos));
+  uint32 used = position_ - read_pos;
+  if (used > capacity_)
+    return -1;
+
+  size_t amt_to_write = std::min(len, capacity_ - used);
+  size_t offset = position_ & (capacity_ - 1);
+  size_t first_chunk = std::min(amt_to_write, capacity_ - offset);
+  memcpy(data_ + offset, data, first_chunk);
+  memcpy(data_, data + first_chunk, amt_to_write - first_chunk);
+
+  position_ += static_cast<uint32>(amt_to_write);
+  base::subtle::Release_Store(&header_->write_pos,
+                              static_cast<base::subtle::Atomic32>(position_));
+  return static_cast<int>(amt_to_write);
+}
+
+bool SharedMemoryRing::WaitForSpace() {
+  base::subtle::NoBarrier_Store(&header_->writer_waiting, 1);
+  // Pairs with the barrier in TakeWriterWaiting(): either the consumer sees
+  // our flag, or we see the space it freed.
+  base::subtle::MemoryBarrier();
+  uint32 read_pos = static_cast<uint32>(
+      base::subtle::Acquire_Load(&header_->read_pos));
+  if (position_ - read_pos == capacity_)
+    return true;
+  // We won't sleep after all, so the consumer needn't ring.
+  base::subtle::NoBarrier_Store(&header_->writer_waiting, 0);
+  return false;
+}
+
+bool SharedMemoryRing::TakeReaderWaiting() {
+  base::subtle::MemoryBarrier();
+  return base::subtle::NoBarrier_CompareAndSwap(
+      &header_->reader_waiting, 1, 0) == 1;
+}
+
+int SharedMemoryRing::Read(char* buffer, size_t len) {
+  uint32 write_pos = static_cast<uint32>(
+      base::subtle::Acquire_Load(&header_->write_pos));
+  uint32 available = write_pos - position_;
+  if (available > capacity_)
+    return -1;
+
+  size_t amt_to_read = std::min(len, static_cast<size_t>(available));
+  size_t offset = position_ & (capacity_ - 1);
+  size_t first_chunk = std::min(amt_to_read, capacity_ - offset);
+  memcpy(buffer, data_ + offset, first_chunk);
+  memcpy(buffer + first_chunk, data_, amt_to_read - first_chunk);
+
+  position_ += static_cast<uint32>(amt_to_read);
+  base::subtle::Release_Store(&header_->read_pos,
+                              static_cast<base::subtle::Atomic32>(position_));
+  return static_cast<int>(amt_to_read);
+}
+
+bool SharedMemoryRing::WaitForData() {
+  base::subtle::NoBarrier_Store(&header_->reader_waiting, 1);
+  // Pairs with the barrier in TakeReaderWaiting().
+  base::subtle::MemoryBarrier();
+  uint32 write_pos = static_cast<uint32>(
+      base::subtle::Acquire_Load(&header_->write_pos));
+  if (write_pos == position_)
+    return true;
+  // We won't sleep after all, so the producer needn't ring.
+  base::subtle::NoBarrier_Store(&header_->reader_waiting, 0);
+  return false;
+}
+
+void SharedMemoryRing::StopWaitingForData() {
+  // Only touch the shared flag when it is up.
+  if (base::subtle::NoBarrier_Load(&header_->reader_waiting))
+    base::subtle::NoBarrier_Store(&header_->reader_waiting, 0);
+}
+
+bool SharedMemoryRing::TakeWriterWaiting() {
+  base::subtle::MemoryBarrier();
+  return base::subtle::NoBarrier_CompareAndSwap(
+      &header_->writer_waiting, 1, 0) == 1;
+}
+
+bool CreateDoorbell(int* fd) {
+  *fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (*fd < 0) {
+    PLOG(ERROR) << "eventfd";
+    return false;
+  }
+  return true;
+}
+
+bool RingDoorbell(int fd) {
+  const uint64 kIncrement = 1;
+  ssize_t result = HANDLE_EINTR(write(fd, &kIncrement, sizeof(kIncrement)));
+  // EAGAIN means the counter is saturated, so the waiter is awake anyway.
+  if (result < 0 && errno != EAGAIN) {
+    PLOG(ERROR) << "write doorbell";
+    return false;
+  }
+  return true;
+}
+
+void DrainDoorbell(int fd) {
+  uint64 value;
+  ignore_result(HANDLE_EINTR(read(fd, &value, sizeof(value))));
+}
+
+}  // namespace internal
+}  // namespace IPC
@@ -0,0 +1,132 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef IPC_IPC_SHARED_MEMORY_RING_LINUX_H_
+#define IPC_IPC_SHARED_MEMORY_RING_LINUX_H_
+
+#include "base/basictypes.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/shared_memory.h"
+#include "ipc/ipc_export.h"
+
+namespace IPC {
+namespace internal {
+
+// A single-producer, single-consumer byte ring in a base::SharedMemory
+// segment. The POSIX channel uses one per direction to move message bytes
+// between processes without copying them through the kernel.
+//
+// Both sides keep their own copy of their position and only look at the
+// peer's position in shared memory to learn how far it got. Positions read
+// from shared memory are validated, so a peer that scribbles over the ring
+// header can make us fail, but cannot make us touch memory outside the ring.
+//
+// The ring does no signalling of its own. A side that runs out of data (or
+// space) raises its "waiting" flag with WaitForData() (or WaitForSpace()) and
+// goes to sleep on a doorbell; the other side checks the flag with
+// TakeReaderWaiting() (or TakeWriterWaiting()) after making progress and rings
+// the doorbell if it was set.
+class IPC_EXPORT SharedMemoryRing {
+ public:
+  // Size of the data area of the rings the channel creates.
+  static const size_t kDefaultCapacity = 256 * 1024;
+
+  ~SharedMemoryRing();
+
+  // Creates and maps a new ring with a data area of |capacity| bytes, which
+  // must be a power of two. Returns NULL on failure.
+  static scoped_ptr<SharedMemoryRing> Create(size_t capacity);
+
+  // Maps a ring created by Create() in another process. |mapped_size| is the
+  // value that process got from mapped_size(). Takes ownership of |handle|.
+  // Returns NULL if the segment cannot be mapped or does not hold a valid
+  // ring.
+  static scoped_ptr<SharedMemoryRing> Open(
+      const base::SharedMemoryHandle& handle,
+      size_t mapped_size);
+
+  // The handle to send to the peer. Still owned by the ring.
+  base::SharedMemoryHandle handle() const;
+
+  // Size of the whole segment, header included.
+  size_t mapped_size() const;
+
+  size_t capacity() const { return capacity_; }
+
+  // Producer side --------------------------------------------------------------
+
+  // Copies as much of |data| as fits into the ring and returns the number of
+  // bytes copied, or -1 if the ring header is corrupt.
+  int Write(const char* data, size_t len);
+
+  // Raises the producer's waiting flag. Returns true if the ring is still full
+  // afterwards, in which case the caller should wait for its doorbell. Returns
+  // false, with the flag lowered again, if space became available in the
+  // meantime.
+  bool WaitForSpace();
+
+  // Returns true, and lowers the flag, if the consumer is waiting for data.
+  // Call this after Write() has made progress.
+  bool TakeReaderWaiting();
+
+  // Consumer side --------------------------------------------------------------
+
+  // Copies up to |len| bytes out of the ring and returns the number of bytes
+  // copied, or -1 if the ring header is corrupt.
+  int Read(char* buffer, size_t len);
+
+  // Raises the consumer's waiting flag. Returns true if the ring is still
+  // empty afterwards, in which case the caller should wait for its doorbell.
+  // Returns false, with the flag lowered again, if data arrived in the
+  // meantime.
+  bool WaitForData();
+
+  // Lowers the consumer's waiting flag, if the producer hasn't already. Call
+  // this once Read() finds data without waiting for the doorbell, so that
+  // the producer doesn't ring for nothing. A doorbell rung meanwhile only
+  // causes a spurious wake-up.
+  void StopWaitingForData();
+
+  // Returns true, and lowers the flag, if the producer is waiting for space.
+  // Call this after Read() has made progress.
+  bool TakeWriterWaiting();
+
+ private:
+  struct Header;
+
+  SharedMemoryRing();
+
+  // Validates the header of the mapped segment and sets up the pointers into
+  // it.
+  bool Init(size_t mapped_size);
+
+  scoped_ptr<base::SharedMemory> shared_memory_;
+  Header* header_;
+  char* data_;
+  size_t capacity_;
+
+  // Our own position: the producer's write position or the consumer's read
+  // position, depending on which side we are. Positions count bytes modulo
+  // 2^32 and are masked with |capacity_| - 1 to get an offset.
+  uint32 position_;
+
+  DISALLOW_COPY_AND_ASSIGN(SharedMemoryRing);
+};
+
+// Doorbells are eventfds. The waiting side watches its doorbell for
+// readability and drains it when woken up.
+
+// Creates a non-blocking doorbell. Returns false on failure.
+IPC_EXPORT bool CreateDoorbell(int* fd);
+
+// Wakes up whoever waits on |fd|. Returns false on failure.
+IPC_EXPORT bool RingDoorbell(int fd);
+
+// Resets |fd| after a wake-up.
+IPC_EXPORT void DrainDoorbell(int fd);
+
+}  // namespace internal
+}  // namespace IPC
+
+#endif  // IPC_IPC_SHARED_MEMORY_RING_LINUX_H_
@@ -0,0 +1,276 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ipc/ipc_shared_memory_ring_linux.h"
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "base/basictypes.h"
+#include "base/file_descriptor_posix.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/message_loop.h"
+#include "base/posix/eintr_wrapper.h"
+#include "base/test/test_timeouts.h"
+#include "ipc/ipc_channel.h"
+#include "ipc/ipc_listener.h"
+#include "ipc/ipc_message.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace IPC {
+namespace internal {
+namespace {
+
+const size_t kCapacity = 4096;
+
+// Maps |consumer|'s segment a second time, the way the peer process does.
+scoped_ptr<SharedMemoryRing> OpenProducer(SharedMemoryRing* consumer) {
+  base::SharedMemoryHandle handle(dup(consumer->handle().fd), true);
+  return SharedMemoryRing::Open(handle, consumer->mapped_size());
+}
+
+TEST(SharedMemoryRingTest, WriteAndReadAcrossWrap) {
+  scoped_ptr<SharedMemoryRing> consumer(SharedMemoryRing::Create(kCapacity));
+  ASSERT_TRUE(consumer.get());
+  scoped_ptr<SharedMemoryRing> producer(OpenProducer(consumer.get()));
+  ASSERT_TRUE(producer.get());
+  EXPECT_EQ(kCapacity, producer->capacity());
+
+  // Write chunks that do not divide the capacity so that most of them
+  // eventually straddle the end of the data area.
+  const size_t kChunk = 1000;
+  char out[kChunk];
+  char in[kChunk];
+  for (int i = 0; i < 50; ++i) {
+    memset(out, 'a' + i % 26, kChunk);
+    ASSERT_EQ(static_cast<int>(kChunk), producer->Write(out, kChunk));
+    ASSERT_EQ(static_cast<int>(kChunk), consumer->Read(in, kChunk));
+    ASSERT_EQ(0, memcmp(out, in, kChunk));
+  }
+  EXPECT_EQ(0, consumer->Read(in, kChunk));
+}
+
+TEST(SharedMemoryRingTest, PartialWriteWhenFull) {
+  scoped_ptr<SharedMemoryRing> consumer(SharedMemoryRing::Create(kCapacity));
+  ASSERT_TRUE(consumer.get());
+  scoped_ptr<SharedMemoryRing> producer(OpenProducer(consumer.get()));
+  ASSERT_TRUE(producer.get());
+
+  std::string data(kCapacity + 100, 'x');
+  EXPECT_EQ(static_cast<int>(kCapacity),
+            producer->Write(data.data(), data.size()));
+  EXPECT_EQ(0, producer->Write(data.data(), data.size()));
+
+  char buffer[100];
+  EXPECT_EQ(100, consumer->Read(buffer, sizeof(buffer)));
+  EXPECT_EQ(100, producer->Write(data.data(), data.size()));
+}
+
+TEST(SharedMemoryRingTest, WaitingFlags) {
+  scoped_ptr<SharedMemoryRing> consumer(SharedMemoryRing::Create(kCapacity));
+  ASSERT_TRUE(consumer.get());
+  scoped_ptr<SharedMemoryRing> producer(OpenProducer(consumer.get()));
+  ASSERT_TRUE(producer.get());
+
+  // A new ring has the consumer waiting, so the first write rings.
+  EXPECT_TRUE(producer->TakeReaderWaiting());
+  EXPECT_FALSE(producer->TakeReaderWaiting());
+
+  char byte = 'x';
+  char buffer[16];
+  EXPECT_TRUE(consumer->WaitForData());
+  ASSERT_EQ(1, producer->Write(&byte, 1));
+  EXPECT_TRUE(producer->TakeReaderWaiting());
+  // Data arrived, so there is nothing to wait for, nor to ring for.
+  ASSERT_EQ(1, producer->Write(&byte, 1));
+  EXPECT_FALSE(consumer->WaitForData());
+  EXPECT_FALSE(producer->TakeReaderWaiting());
+
+  // The consumer finds data before the producer checks the flag.
+  ASSERT_EQ(2, consumer->Read(buffer, sizeof(buffer)));
+  EXPECT_TRUE(consumer->WaitForData());
+  ASSERT_EQ(1, producer->Write(&byte, 1));
+  ASSERT_EQ(1, consumer->Read(buffer, sizeof(buffer)));
+  consumer->StopWaitingForData();
+  EXPECT_FALSE(producer->TakeReaderWaiting());
+
+  std::string data(kCapacity, 'y');
+  producer->Write(data.data(), data.size());
+  EXPECT_TRUE(producer->WaitForSpace());
+  ASSERT_EQ(16, consumer->Read(buffer, sizeof(buffer)));
+  EXPECT_TRUE(consumer->TakeWriterWaiting());
+  EXPECT_FALSE(consumer->TakeWriterWaiting());
+  // Space was freed, so there is nothing to wait for, nor to ring for.
+  EXPECT_FALSE(producer->WaitForSpace());
+  EXPECT_FALSE(consumer->TakeWriterWaiting());
+}
+
+TEST(SharedMemoryRingTest, RejectsBadSegments) {
+  scoped_ptr<SharedMemoryRing> consumer(SharedMemoryRing::Create(kCapacity));
+  ASSERT_TRUE(consumer.get());
+
+  // The size has to match the header.
+  base::SharedMemoryHandle handle(dup(consumer->handle().fd), true);
+  EXPECT_FALSE(SharedMemoryRing::Open(handle, consumer->mapped_size() / 2));
+
+  // So does the magic.
+  base::SharedMemory other;
+  ASSERT_TRUE(other.CreateAnonymous(consumer->mapped_size()));
+  base::SharedMemoryHandle other_handle(dup(other.handle().fd), true);
+  EXPECT_FALSE(SharedMemoryRing::Open(other_handle, consumer->mapped_size()));
+}
+
+TEST(SharedMemoryRingTest, Doorbell) {
+  int doorbell = -1;
+  ASSERT_TRUE(CreateDoorbell(&doorbell));
+  char buffer[8];
+  EXPECT_LT(HANDLE_EINTR(read(doorbell, buffer, sizeof(buffer))), 0);
+  EXPECT_TRUE(RingDoorbell(doorbell));
+  EXPECT_TRUE(RingDoorbell(doorbell));
+  DrainDoorbell(doorbell);
+  EXPECT_LT(HANDLE_EINTR(read(doorbell, buffer, sizeof(buffer))), 0);
+  EXPECT_EQ(0, HANDLE_EINTR(close(doorbell)));
+}
+
+// Channel-level test --------------------------------------------------------
+
+const uint32 kStartMessage = 1;
+const uint32 kRingTestMessage = 2;
+const int kMessageCount = 200;
+
+// Payload sizes cycled through by the test. The largest does not fit into
+// the ring and has to be streamed through it.
+const size_t kPayloadSizes[] = {
+  16, 1000, 40 * 1024, SharedMemoryRing::kDefaultCapacity * 3 + 7
+};
+
+std::string PayloadFor(int index) {
+  return std::string(kPayloadSizes[index % arraysize(kPayloadSizes)],
+                     static_cast<char>('a' + index % 26));
+}
+
+// Receives the test messages. Once connected it tells the client to start,
+// which it only sees after the ring offer that precedes it.
+class RingTestListener : public Listener {
+ public:
+  RingTestListener() : sender_(NULL), received_(0), channel_error_(false) {}
+
+  void set_sender(Sender* sender) { sender_ = sender; }
+
+  virtual void OnChannelConnected(int32 peer_pid) OVERRIDE {
+    sender_->Send(new Message(MSG_ROUTING_CONTROL, kStartMessage,
+                              Message::PRIORITY_NORMAL));
+  }
+
+  virtual bool OnMessageReceived(const Message& message) OVERRIDE {
+    EXPECT_EQ(kRingTestMessage, message.type());
+    PickleIterator iter(message);
+    int index;
+    std::string payload;
+    EXPECT_TRUE(message.ReadInt(&iter, &index));
+    EXPECT_TRUE(message.ReadString(&iter, &payload));
+    EXPECT_EQ(received_, index);
+    EXPECT_TRUE(payload == PayloadFor(index));
+    // Every tenth message carries a descriptor.
+    if (index % 10 == 0) {
+      base::FileDescriptor descriptor;
+      EXPECT_TRUE(message.ReadFileDescriptor(&iter, &descriptor));
+      EXPECT_EQ(0, HANDLE_EINTR(close(descriptor.fd)));
+    }
+    if (++received_ == kMessageCount)
+      base::MessageLoop::current()->QuitNow();
+    return true;
+  }
+
+  virtual void OnChannelError() OVERRIDE {
+    channel_error_ = true;
+    base::MessageLoop::current()->QuitNow();
+  }
+
+  int received() const { return received_; }
+  bool channel_error() const { return channel_error_; }
+
+ private:
+  Sender* sender_;
+  int received_;
+  bool channel_error_;
+};
+
+// Sends the test messages when told to start.
+class RingSenderListener : public Listener {
+ public:
+  RingSenderListener() : sender_(NULL) {}
+
+  void set_sender(Sender* sender) { sender_ = sender; }
+
+  virtual bool OnMessageReceived(const Message& message) OVERRIDE {
+    EXPECT_EQ(kStartMessage, message.type());
+    for (int i = 0; i < kMessageCount; ++i) {
+      Message* test_message = new Message(
+          MSG_ROUTING_CONTROL, kRingTestMessage, Message::PRIORITY_NORMAL);
+      test_message->WriteInt(i);
+      test_message->WriteString(PayloadFor(i));
+      if (i % 10 == 0) {
+        int fd = open("/dev/null", O_RDONLY);
+        EXPECT_GE(fd, 0);
+        test_message->WriteFileDescriptor(base::FileDescriptor(fd, true));
+      }
+      sender_->Send(test_message);
+    }
+    return true;
+  }
+
+ private:
+  Sender* sender_;
+};
+
+void ExchangeMessages(bool server_ring, bool client_ring) {
+  base::MessageLoopForIO message_loop;
+
+  int fds[2];
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+  ASSERT_GE(fcntl(fds[0], F_SETFL, O_NONBLOCK), 0);
+  ASSERT_GE(fcntl(fds[1], F_SETFL, O_NONBLOCK), 0);
+
+  RingTestListener server_listener;
+  RingSenderListener client_listener;
+  Channel::SetSharedMemoryRingEnabled(server_ring);
+  Channel server(ChannelHandle("RingServer", base::FileDescriptor(fds[0], true)),
+                 Channel::MODE_SERVER, &server_listener);
+  Channel::SetSharedMemoryRingEnabled(client_ring);
+  Channel client(ChannelHandle("RingClient", base::FileDescriptor(fds[1], true)),
+                 Channel::MODE_CLIENT, &client_listener);
+  Channel::SetSharedMemoryRingEnabled(false);
+  server_listener.set_sender(&server);
+  client_listener.set_sender(&client);
+  ASSERT_TRUE(server.Connect());
+  ASSERT_TRUE(client.Connect());
+
+  message_loop.PostDelayedTask(FROM_HERE,
+                               base::MessageLoop::QuitClosure(),
+                               TestTimeouts::action_timeout());
+  message_loop.Run();
+  EXPECT_FALSE(server_listener.channel_error());
+  EXPECT_EQ(kMessageCount, server_listener.received());
+}
+
+TEST(SharedMemoryRingTest, ChannelBothSidesEnabled) {
+  ExchangeMessages(true, true);
+}
+
+// The server offers a ring, but the client keeps writing to the socket.
+TEST(SharedMemoryRingTest, ChannelOnlyReceiverEnabled) {
+  ExchangeMessages(true, false);
+}
+
+TEST(SharedMemoryRingTest, ChannelOnlySenderEnabled) {
+  ExchangeMessages(false, true);
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace IPC
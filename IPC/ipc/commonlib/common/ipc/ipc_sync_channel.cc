@@ -9,6 +9,7 @@
 #include "base/lazy_instance.h"
 #include "base/location.h"
 #include "base/logging.h"
+#include "base/stl_util.h"
 #include "base/synchronization/waitable_event.h"
 #include "base/synchronization/waitable_event_watcher.h"
 #include "base/thread_task_runner_handle.h"
@@ -16,6 +17,7 @@
 #include "ipc/ipc_logging.h"
 #include "ipc/ipc_message_macros.h"
 #include "ipc/ipc_sync_message.h"
+#include "ipc/ipc_sync_wakeup.h"
 
 using base::TimeDelta;
 using base::TimeTicks;
@@ -72,6 +74,7 @@ class SyncChannel::ReceivedSyncMsgQueue :
     }
 
     dispatch_event_.Signal();
+    wakeup_.Signal();
     if (!was_task_pending) {
       listener_task_runner_->PostTask(
           FROM_HERE, base::Bind(&ReceivedSyncMsgQueue::DispatchMessagesTask,
@@ -149,6 +152,7 @@ class SyncChannel::ReceivedSyncMsgQueue :
   }
 
   WaitableEvent* dispatch_event() { return &dispatch_event_; }
+  internal::SyncWakeup* wakeup() { return &wakeup_; }
   base::SingleThreadTaskRunner* listener_task_runner() {
     return listener_task_runner_.get();
   }
@@ -178,6 +182,24 @@ class SyncChannel::ReceivedSyncMsgQueue :
     top_send_done_watcher_ = watcher;
   }
 
+  // Called on the listener thread to get a reset send done event for a sync
+  // Send(). Events are reused across sends so that a round trip does not
+  // allocate one.
+  WaitableEvent* AcquireSendDoneEvent() {
+    if (free_send_done_events_.empty())
+      return new WaitableEvent(true, false);
+    WaitableEvent* event = free_send_done_events_.back();
+    free_send_done_events_.pop_back();
+    return event;
+  }
+
+  // Called on the listener thread once the IPC thread can no longer signal
+  // |event|.
+  void ReleaseSendDoneEvent(WaitableEvent* event) {
+    event->Reset();
+    free_send_done_events_.push_back(event);
+  }
+
  private:
   friend class base::RefCountedThreadSafe<ReceivedSyncMsgQueue>;
 
@@ -192,7 +214,9 @@ class SyncChannel::ReceivedSyncMsgQueue :
       top_send_done_watcher_(NULL) {
   }
 
-  ~ReceivedSyncMsgQueue() {}
+  ~ReceivedSyncMsgQueue() {
+    STLDeleteElements(&free_send_done_events_);
+  }
 
   // Holds information about a queued synchronous message or reply.
   struct QueuedMessage {
@@ -220,6 +244,14 @@ class SyncChannel::ReceivedSyncMsgQueue :
   // a local global stack of send done watchers to ensure that nested sync
   // message loops complete correctly.
   base::WaitableEventWatcher* top_send_done_watcher_;
+
+  // Signaled along with dispatch_event_ and the send done events, to wake
+  // WaitForReply() without a WaitMany().
+  internal::SyncWakeup wakeup_;
+
+  // Send done events not used by any pending Send(). Only accessed on the
+  // listener thread.
+  std::vector<WaitableEvent*> free_send_done_events_;
 };
 
 base::LazyInstance<base::ThreadLocalPointer<SyncChannel::ReceivedSyncMsgQueue> >
@@ -237,8 +269,13 @@ SyncChannel::SyncContext::SyncContext(
 }
 
 SyncChannel::SyncContext::~SyncContext() {
-  while (!deserializers_.empty())
-    Pop();
+  // This may run on the IPC thread, so the events are not returned to the
+  // listener thread's pool.
+  while (!deserializers_.empty()) {
+    delete deserializers_.back().deserializer;
+    delete deserializers_.back().done_event;
+    deserializers_.pop_back();
+  }
 }
 
 // Adds information about an outgoing sync message to the context so that
@@ -255,22 +292,23 @@ void SyncChannel::SyncContext::Push(SyncMessage* sync_msg) {
   // Send completes, so the event will need to remain set.
   PendingSyncMsg pending(SyncMessage::GetMessageId(*sync_msg),
                          sync_msg->GetReplyDeserializer(),
-                         new WaitableEvent(true, false));
+                         received_sync_msgs_->AcquireSendDoneEvent());
   base::AutoLock auto_lock(deserializers_lock_);
   deserializers_.push_back(pending);
 }
 
 bool SyncChannel::SyncContext::Pop() {
   bool result;
+  WaitableEvent* done_event;
   {
     base::AutoLock auto_lock(deserializers_lock_);
     PendingSyncMsg msg = deserializers_.back();
     delete msg.deserializer;
-    delete msg.done_event;
-    msg.done_event = NULL;
+    done_event = msg.done_event;
     deserializers_.pop_back();
     result = msg.send_result;
   }
+  received_sync_msgs_->ReleaseSendDoneEvent(done_event);
 
   // We got a reply to a synchronous Send() call that's blocking the listener
   // thread.  However, further down the call stack there could be another
@@ -314,7 +352,7 @@ bool SyncChannel::SyncContext::TryToUnblockListener(const Message* msg) {
   } else {
     VLOG(1) << "Received error reply";
   }
-  deserializers_.back().done_event->Signal();
+  SignalSendDone(deserializers_.back().done_event);
 
   return true;
 }
@@ -372,7 +410,7 @@ void SyncChannel::SyncContext::OnSendTimeout(int message_id) {
   VLOG(1) << "Send timeout";
   for (iter = deserializers_.begin(); iter != deserializers_.end(); iter++) {
     if (iter->id == message_id) {
-      iter->done_event->Signal();
+      SignalSendDone(iter->done_event);
       break;
     }
   }
@@ -384,7 +422,12 @@ void SyncChannel::SyncContext::CancelPendingSends() {
   // TODO(bauerb): Remove once http://crbug/141055 is fixed.
   VLOG(1) << "Canceling pending sends";
   for (iter = deserializers_.begin(); iter != deserializers_.end(); iter++)
-    iter->done_event->Signal();
+    SignalSendDone(iter->done_event);
+}
+
+void SyncChannel::SyncContext::SignalSendDone(WaitableEvent* done_event) {
+  done_event->Signal();
+  received_sync_msgs_->wakeup()->Signal();
 }
 
 void SyncChannel::SyncContext::OnWaitableEventSignaled(WaitableEvent* event) {
@@ -491,6 +534,27 @@ bool SyncChannel::SendWithTimeout(Message* message, int timeout_ms) {
 void SyncChannel::WaitForReply(
     SyncContext* context, WaitableEvent* pump_messages_event) {
   context->DispatchMessages();
+
+  if (!pump_messages_event) {
+    // Fast path: wait on the thread's SyncWakeup and poll the two events
+    // rather than registering with both for every wait.
+    internal::SyncWakeup* wakeup = context->received_sync_msgs()->wakeup();
+    WaitableEvent* dispatch_event = context->GetDispatchEvent();
+    WaitableEvent* send_done_event = context->GetSendDoneEvent();
+    while (true) {
+      base::subtle::Atomic32 sequence = wakeup->sequence();
+      if (dispatch_event->IsSignaled()) {
+        // See below.
+        dispatch_event->Reset();
+        context->DispatchMessages();
+        continue;
+      }
+      if (send_done_event->IsSignaled())
+        return;
+      wakeup->Wait(sequence);
+    }
+  }
+
   while (true) {
     WaitableEvent* objects[] = {
       context->GetDispatchEvent(),
@@ -47,6 +47,12 @@ class SyncMessage;
 // it's looking for (using the unique message ID), it will execute the
 // deserializer stashed from before, and unblock the original thread.
 //
+// Unless the message pumps messages while it waits, the original thread
+// blocks on a SyncWakeup (a futex on Linux) shared by the SyncChannels of that
+// thread, which the I/O thread signals along with the send done and dispatch
+// events. The send done events are reused per thread, so a round trip does
+// not allocate one.
+//
 //
 // Significant complexity results from the fact that messages are still coming
 // in while the original thread is blocked. Normal async messages are queued
@@ -181,6 +187,10 @@ class IPC_EXPORT SyncChannel : public ChannelProxy {
 
     void OnWaitableEventSignaled(base::WaitableEvent* event);
 
+    // Signals a pending Send()'s done event and wakes the listener thread.
+    // Called with deserializers_lock_ held.
+    void SignalSendDone(base::WaitableEvent* done_event);
+
     typedef std::deque<PendingSyncMsg> PendingSyncMessageQueue;
     PendingSyncMessageQueue deserializers_;
     base::Lock deserializers_lock_;
@@ -309,6 +309,46 @@ TEST_F(IPCSyncChannelTest, Simple) {
 
 //------------------------------------------------------------------------------
 
+// Sends many sync messages back to back, so that send done events get reused,
+// alternating between waiting with and without pumping messages.
+class RepeatedSendServer : public Worker {
+ public:
+  RepeatedSendServer()
+      : Worker(Channel::MODE_SERVER, "repeated_send_server") { }
+  virtual void Run() OVERRIDE {
+    for (int i = 0; i < kSendCount; ++i)
+      SendDouble(i % 4 == 3, true);
+    Done();
+  }
+
+  static const int kSendCount = 200;
+};
+
+class RepeatedSendClient : public Worker {
+ public:
+  RepeatedSendClient()
+      : Worker(Channel::MODE_CLIENT, "repeated_send_client"),
+        received_count_(0) { }
+
+  virtual void OnDouble(int in, int* out) OVERRIDE {
+    *out = in * 2;
+    if (++received_count_ == RepeatedSendServer::kSendCount)
+      Done();
+  }
+
+ private:
+  int received_count_;
+};
+
+TEST_F(IPCSyncChannelTest, RepeatedSend) {
+  std::vector<Worker*> workers;
+  workers.push_back(new RepeatedSendServer());
+  workers.push_back(new RepeatedSendClient());
+  RunTest(workers);
+}
+
+//------------------------------------------------------------------------------
+
 // Worker classes which override how the sync channel is created to use the
 // two-step initialization (calling the lightweight constructor and then
 // ChannelProxy::Init separately) process.
@@ -0,0 +1,83 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ipc/ipc_sync_wakeup.h"
+
+#if defined(OS_LINUX)
+#include <errno.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "base/logging.h"
+
+namespace IPC {
+namespace internal {
+
+#if defined(OS_LINUX)
+
+namespace {
+
+long Futex(volatile base::subtle::Atomic32* address, int op, int value) {
+  return syscall(SYS_futex, const_cast<base::subtle::Atomic32*>(address),
+                 op, value, NULL, NULL, 0);
+}
+
+}  // namespace
+
+SyncWakeup::SyncWakeup() : sequence_(0), waiters_(0) {
+}
+
+SyncWakeup::~SyncWakeup() {
+  DCHECK_EQ(0, base::subtle::NoBarrier_Load(&waiters_));
+}
+
+void SyncWakeup::Signal() {
+  // Both increments are full barriers: either this sees the waiter, or the
+  // waiter sees the new sequence before it sleeps.
+  base::subtle::Barrier_AtomicIncrement(&sequence_, 1);
+  if (base::subtle::NoBarrier_Load(&waiters_))
+    Futex(&sequence_, FUTEX_WAKE_PRIVATE, INT_MAX);
+}
+
+void SyncWakeup::Wait(base::subtle::Atomic32 sequence) {
+  base::subtle::Barrier_AtomicIncrement(&waiters_, 1);
+  while (base::subtle::Acquire_Load(&sequence_) == sequence) {
+    // The kernel rechecks the sequence, so a Signal() after the load above
+    // makes this return right away with EAGAIN.
+    if (Futex(&sequence_, FUTEX_WAIT_PRIVATE, sequence) < 0 &&
+        errno != EAGAIN && errno != EINTR) {
+      DPLOG(ERROR) << "futex";
+      break;
+    }
+  }
+  base::subtle::Barrier_AtomicIncrement(&waiters_, -1);
+}
+
+#else  // defined(OS_LINUX)
+
+SyncWakeup::SyncWakeup() : sequence_(0), condition_(&lock_) {
+}
+
+SyncWakeup::~SyncWakeup() {
+}
+
+void SyncWakeup::Signal() {
+  base::AutoLock auto_lock(lock_);
+  base::subtle::Barrier_AtomicIncrement(&sequence_, 1);
+  condition_.Broadcast();
+}
+
+void SyncWakeup::Wait(base::subtle::Atomic32 sequence) {
+  base::AutoLock auto_lock(lock_);
+  while (base::subtle::NoBarrier_Load(&sequence_) == sequence)
+    condition_.Wait();
+}
+
+#endif  // defined(OS_LINUX)
+
+}  // namespace internal
+}  // namespace IPC
@@ -0,0 +1,63 @@
+// Copyright 2013 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef IPC_IPC_SYNC_WAKEUP_H_
+#define IPC_IPC_SYNC_WAKEUP_H_
+
+#include "base/atomicops.h"
+#include "base/basictypes.h"
+#include "build/build_config.h"
+#include "ipc/ipc_export.h"
+
+#if !defined(OS_LINUX)
+#include "base/synchronization/condition_variable.h"
+#include "base/synchronization/lock.h"
+#endif
+
+namespace IPC {
+namespace internal {
+
+// Wakes a thread blocked in a synchronous Send() when something it waits for
+// may have happened: its reply arrived, it timed out, or an incoming message
+// has to be dispatched.
+//
+// The waiter reads sequence(), checks its conditions, and if none holds calls
+// Wait() with the sequence it read. Signal() bumps the sequence, so a signal
+// sent after the read is never lost. Wake-ups can be spurious.
+//
+// On Linux this is a futex and Signal() makes no system call while nobody
+// waits. Elsewhere it is a condition variable.
+class IPC_EXPORT SyncWakeup {
+ public:
+  SyncWakeup();
+  ~SyncWakeup();
+
+  base::subtle::Atomic32 sequence() const {
+    return base::subtle::Acquire_Load(&sequence_);
+  }
+
+  // Called on any thread.
+  void Signal();
+
+  // Blocks until the sequence is no longer |sequence|.
+  void Wait(base::subtle::Atomic32 sequence);
+
+ private:
+  volatile base::subtle::Atomic32 sequence_;
+
+#if defined(OS_LINUX)
+  // Number of threads in Wait().
+  volatile base::subtle::Atomic32 waiters_;
+#else
+  base::Lock lock_;
+  base::ConditionVariable condition_;
+#endif
+
+  DISALLOW_COPY_AND_ASSIGN(SyncWakeup);
+};
+
+}  // namespace internal
+}  // namespace IPC
+
+#endif  // IPC_IPC_SYNC_WAKEUP_H_
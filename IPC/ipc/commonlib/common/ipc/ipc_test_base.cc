@@ -12,6 +12,7 @@
 #include "base/time.h"
 #include "ipc/ipc_descriptors.h"
 #include "ipc/ipc_switches.h"
+#include "ipc/ipc_sync_channel.h"
 
 // static
 std::string IPCTestBase::GetChannelName(const std::string& test_client_name) {
@@ -82,6 +83,20 @@ void IPCTestBase::CreateChannelProxy(
                                              ipc_task_runner));
 }
 
+void IPCTestBase::CreateSyncChannel(
+    IPC::Listener* listener,
+    base::SingleThreadTaskRunner* ipc_task_runner,
+    base::WaitableEvent* shutdown_event) {
+  CHECK(!channel_.get());
+  CHECK(!channel_proxy_.get());
+  channel_proxy_.reset(new IPC::SyncChannel(GetChannelName(test_client_name_),
+                                            IPC::Channel::MODE_SERVER,
+                                            listener,
+                                            ipc_task_runner,
+                                            true,
+                                            shutdown_event));
+}
+
 void IPCTestBase::DestroyChannelProxy() {
   CHECK(channel_proxy_.get());
   channel_proxy_.reset();
@@ -17,6 +17,7 @@
 
 namespace base {
 class MessageLoopForIO;
+class WaitableEvent;
 }
 
 // A test fixture for multiprocess IPC tests. Such tests include a "client" side
@@ -60,6 +61,13 @@ class IPCTestBase : public base::MultiProcessTest {
                           base::SingleThreadTaskRunner* ipc_task_runner);
   void DestroyChannelProxy();
 
+  // Like CreateChannelProxy(), but creates an IPC::SyncChannel, so that
+  // sender() can send sync messages. |shutdown_event| must outlive the
+  // channel. Destroy it with DestroyChannelProxy().
+  void CreateSyncChannel(IPC::Listener* listener,
+                         base::SingleThreadTaskRunner* ipc_task_runner,
+                         base::WaitableEvent* shutdown_event);
+
   // Starts the client process, returning true if successful; this should be
   // done after connecting to the channel.
   bool StartClient();
@@ -23,6 +23,18 @@
 #define IPC_STRUCT_TRAITS_PARENT(type)
 #define IPC_STRUCT_TRAITS_END()
 
+// Traits generation for POD structs that are serialized as their raw bytes
+// (see IPC::BlittableParamTraits), which makes vectors and tuples of them
+// cheap to serialize. Only use it for structs without padding whose members
+// need no validation. This macro may be redefined later.
+#define IPC_STRUCT_TRAITS_BLITTABLE(struct_name) \
+  namespace IPC { \
+    template <> \
+    struct IsBlittable<struct_name> : base::true_type {}; \
+    template <> \
+    struct ParamTraits<struct_name> : BlittableParamTraits<struct_name> {}; \
+  }
+
 // Convenience macro for defining enumerated type traits for types which are
 // not range-checked by the IPC system. The author of the message handlers
 // is responsible for all validation. This macro should not need to be